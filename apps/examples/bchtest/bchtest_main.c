@@ -0,0 +1,372 @@
+/****************************************************************************
+ * examples/bchtest/bchtest_main.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/ioctl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/fs.h>
+#include <nuttx/ioctl.h>
+#include <nuttx/ramdisk.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_EXAMPLES_BCHTEST_RAMDEVNO - The RAM disk minor number.  The RAM
+ *   disk is /dev/ramN and the character driver is /dev/bchN.  Default 2
+ * CONFIG_EXAMPLES_BCHTEST_NSECTORS - The number of sectors in the RAM disk.
+ *   Default 64
+ * CONFIG_EXAMPLES_BCHTEST_SECTORSIZE - The RAM disk sector size.  Default
+ *   512
+ */
+
+#ifndef CONFIG_EXAMPLES_BCHTEST_RAMDEVNO
+#  define CONFIG_EXAMPLES_BCHTEST_RAMDEVNO 2
+#endif
+
+#ifndef CONFIG_EXAMPLES_BCHTEST_NSECTORS
+#  define CONFIG_EXAMPLES_BCHTEST_NSECTORS 64
+#endif
+
+#ifndef CONFIG_EXAMPLES_BCHTEST_SECTORSIZE
+#  define CONFIG_EXAMPLES_BCHTEST_SECTORSIZE 512
+#endif
+
+#define BCHTEST_STR(x)  #x
+#define BCHTEST_XSTR(x) BCHTEST_STR(x)
+
+#define BCHTEST_RAMDEV  "/dev/ram" BCHTEST_XSTR(CONFIG_EXAMPLES_BCHTEST_RAMDEVNO)
+#define BCHTEST_CHARDEV "/dev/bch" BCHTEST_XSTR(CONFIG_EXAMPLES_BCHTEST_RAMDEVNO)
+
+#define BCHTEST_DISKSIZE \
+  (CONFIG_EXAMPLES_BCHTEST_NSECTORS * CONFIG_EXAMPLES_BCHTEST_SECTORSIZE)
+
+/* The data is written and read in chunks of these sizes, so that most
+ * transfers begin and end in the middle of a sector.
+ */
+
+#define BCHTEST_NCHUNKS 4
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The RAM disk */
+
+static uint8_t g_ramdisk[BCHTEST_DISKSIZE];
+
+/* The data written through the character driver */
+
+static uint8_t g_image[BCHTEST_DISKSIZE];
+static uint8_t g_readback[BCHTEST_DISKSIZE];
+
+static const size_t g_chunksize[BCHTEST_NCHUNKS] =
+{
+  7, 100, CONFIG_EXAMPLES_BCHTEST_SECTORSIZE + 13,
+  4 * CONFIG_EXAMPLES_BCHTEST_SECTORSIZE
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bchtest_nstale
+ *
+ * Description:
+ *   Return the number of sectors of the RAM disk that do not yet hold the
+ *   data written through the character driver.
+ *
+ ****************************************************************************/
+
+static int bchtest_nstale(size_t nbytes)
+{
+  size_t offset;
+  size_t len;
+  int nstale = 0;
+
+  for (offset = 0; offset < nbytes;
+       offset += CONFIG_EXAMPLES_BCHTEST_SECTORSIZE)
+    {
+      len = nbytes - offset;
+      if (len > CONFIG_EXAMPLES_BCHTEST_SECTORSIZE)
+        {
+          len = CONFIG_EXAMPLES_BCHTEST_SECTORSIZE;
+        }
+
+      if (memcmp(&g_ramdisk[offset], &g_image[offset], len) != 0)
+        {
+          nstale++;
+        }
+    }
+
+  return nstale;
+}
+
+/****************************************************************************
+ * Name: bchtest_write
+ *
+ * Description:
+ *   Write the image through the character driver in chunks of varying
+ *   size.
+ *
+ ****************************************************************************/
+
+static int bchtest_write(int fd)
+{
+  size_t offset;
+  size_t len;
+  ssize_t nwritten;
+  int chunk = 0;
+
+  for (offset = 0; offset < BCHTEST_DISKSIZE; offset += len)
+    {
+      len = g_chunksize[chunk];
+      if (++chunk >= BCHTEST_NCHUNKS)
+        {
+          chunk = 0;
+        }
+
+      if (len > BCHTEST_DISKSIZE - offset)
+        {
+          len = BCHTEST_DISKSIZE - offset;
+        }
+
+      nwritten = write(fd, &g_image[offset], len);
+      if (nwritten != len)
+        {
+          printf("bchtest: write at %lu failed: %d\n",
+                 (unsigned long)offset, errno);
+          return ERROR;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: bchtest_read
+ *
+ * Description:
+ *   Read the image back through the character driver in chunks of varying
+ *   size and verify it.
+ *
+ ****************************************************************************/
+
+static int bchtest_read(int fd)
+{
+  size_t offset;
+  size_t len;
+  ssize_t nread;
+  int chunk = BCHTEST_NCHUNKS - 1;
+
+  for (offset = 0; offset < BCHTEST_DISKSIZE; offset += len)
+    {
+      len = g_chunksize[chunk];
+      if (--chunk < 0)
+        {
+          chunk = BCHTEST_NCHUNKS - 1;
+        }
+
+      if (len > BCHTEST_DISKSIZE - offset)
+        {
+          len = BCHTEST_DISKSIZE - offset;
+        }
+
+      nread = read(fd, &g_readback[offset], len);
+      if (nread != len)
+        {
+          printf("bchtest: read at %lu failed: %d\n",
+                 (unsigned long)offset, errno);
+          return ERROR;
+        }
+    }
+
+  if (memcmp(g_readback, g_image, BCHTEST_DISKSIZE) != 0)
+    {
+      printf("bchtest: Data read back does not match\n");
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: bchtest_pass
+ *
+ * Description:
+ *   Write a new image through the character driver and check that it
+ *   reaches the RAM disk when BIOC_FLUSH is issued.  Then read it back.
+ *
+ ****************************************************************************/
+
+static int bchtest_pass(int pass)
+{
+  int ret = OK;
+  int fd;
+  int i;
+
+  for (i = 0; i < BCHTEST_DISKSIZE; i++)
+    {
+      g_image[i] = (uint8_t)(i * (pass + 3) + (i >> 9) + pass);
+    }
+
+  fd = open(BCHTEST_CHARDEV, O_WRONLY);
+  if (fd < 0)
+    {
+      printf("bchtest: open %s failed: %d\n", BCHTEST_CHARDEV, errno);
+      return ERROR;
+    }
+
+  if (bchtest_write(fd) < 0)
+    {
+      close(fd);
+      return ERROR;
+    }
+
+  /* Sectors still in the BCH sector cache have not been written to the
+   * block driver yet.
+   */
+
+  printf("bchtest: Pass %d: %d sectors cached before BIOC_FLUSH\n",
+         pass, bchtest_nstale(BCHTEST_DISKSIZE));
+
+  if (ioctl(fd, BIOC_FLUSH, 0) < 0)
+    {
+      printf("bchtest: BIOC_FLUSH failed: %d\n", errno);
+      ret = ERROR;
+    }
+  else if (bchtest_nstale(BCHTEST_DISKSIZE) != 0)
+    {
+      printf("bchtest: %d sectors not written by BIOC_FLUSH\n",
+             bchtest_nstale(BCHTEST_DISKSIZE));
+      ret = ERROR;
+    }
+
+  close(fd);
+
+  /* Read the data back through the character driver */
+
+  fd = open(BCHTEST_CHARDEV, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("bchtest: open %s failed: %d\n", BCHTEST_CHARDEV, errno);
+      return ERROR;
+    }
+
+  if (bchtest_read(fd) == OK)
+    {
+      printf("bchtest: Pass %d: Verified\n", pass);
+    }
+  else
+    {
+      ret = ERROR;
+    }
+
+  close(fd);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bchtest_main/user_start
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_BCHTEST_BUILTIN
+#  define MAIN_NAME bchtest_main
+#else
+#  define MAIN_NAME user_start
+#endif
+
+int MAIN_NAME(int argc, char *argv[])
+{
+  int ret;
+
+  memset(g_ramdisk, 0, BCHTEST_DISKSIZE);
+  ret = ramdisk_register(CONFIG_EXAMPLES_BCHTEST_RAMDEVNO, g_ramdisk,
+                         CONFIG_EXAMPLES_BCHTEST_NSECTORS,
+                         CONFIG_EXAMPLES_BCHTEST_SECTORSIZE, true);
+  if (ret < 0)
+    {
+      printf("bchtest: ramdisk_register failed: %d\n", -ret);
+      return 1;
+    }
+
+  ret = bchdev_register(BCHTEST_RAMDEV, BCHTEST_CHARDEV, false);
+  if (ret < 0)
+    {
+      printf("bchtest: bchdev_register failed: %d\n", -ret);
+      (void)unregister_blockdriver(BCHTEST_RAMDEV);
+      return 1;
+    }
+
+  printf("bchtest: %s on %s, %d sectors of %d bytes\n",
+         BCHTEST_CHARDEV, BCHTEST_RAMDEV, CONFIG_EXAMPLES_BCHTEST_NSECTORS,
+         CONFIG_EXAMPLES_BCHTEST_SECTORSIZE);
+
+  ret = bchtest_pass(0);
+  if (ret == OK)
+    {
+      ret = bchtest_pass(1);
+    }
+
+  (void)bchdev_unregister(BCHTEST_CHARDEV);
+  (void)unregister_blockdriver(BCHTEST_RAMDEV);
+
+  if (ret < 0)
+    {
+      printf("bchtest: FAILED\n");
+      return 1;
+    }
+
+  printf("bchtest: Done\n");
+  return 0;
+}
@@ -0,0 +1,699 @@
+/****************************************************************************
+ * examples/fatperf/fatperf_main.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <errno.h>
+
+#include <nuttx/fat.h>
+#include <nuttx/ioctl.h>
+#include <nuttx/ramdisk.h>
+#include <nuttx/mkfatfs.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_EXAMPLES_FATPERF_DEVNAME - The name of an existing block device
+ *   that already holds a FAT file system.  If this is not defined, then a
+ *   FAT file system is created on a RAM disk.
+ * CONFIG_EXAMPLES_FATPERF_RAMDEVNO - The RAM disk minor number.  Default 1
+ * CONFIG_EXAMPLES_FATPERF_NSECTORS - The number of sectors in the RAM disk.
+ *   Default 2048
+ * CONFIG_EXAMPLES_FATPERF_SECTORSIZE - The RAM disk sector size.  Default
+ *   512
+ * CONFIG_EXAMPLES_FATPERF_MOUNTPT - The mountpoint.  Default "/mnt/fatperf"
+ * CONFIG_EXAMPLES_FATPERF_NFILES - The number of files used in the
+ *   directory tests.  Default 64
+ * CONFIG_EXAMPLES_FATPERF_NOPENS - The number of files opened at random
+ *   in the open test.  Default 1000
+ * CONFIG_EXAMPLES_FATPERF_FILESIZE - The size of the file used in the
+ *   append and seek tests.  Default 256Kb
+ * CONFIG_EXAMPLES_FATPERF_NSEEKS - The number of random seeks in the seek
+ *   test.  Default 1000
+ * CONFIG_EXAMPLES_FATPERF_COPYBUFSIZE - The size of the user buffer used
+ *   in the file copy test.  Default 4096
+ */
+
+#ifndef CONFIG_EXAMPLES_FATPERF_RAMDEVNO
+#  define CONFIG_EXAMPLES_FATPERF_RAMDEVNO 1
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_NSECTORS
+#  define CONFIG_EXAMPLES_FATPERF_NSECTORS 2048
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_SECTORSIZE
+#  define CONFIG_EXAMPLES_FATPERF_SECTORSIZE 512
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_MOUNTPT
+#  define CONFIG_EXAMPLES_FATPERF_MOUNTPT "/mnt/fatperf"
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_NFILES
+#  define CONFIG_EXAMPLES_FATPERF_NFILES 64
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_NOPENS
+#  define CONFIG_EXAMPLES_FATPERF_NOPENS 1000
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_FILESIZE
+#  define CONFIG_EXAMPLES_FATPERF_FILESIZE (256*1024)
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_NSEEKS
+#  define CONFIG_EXAMPLES_FATPERF_NSEEKS 1000
+#endif
+
+#ifndef CONFIG_EXAMPLES_FATPERF_COPYBUFSIZE
+#  define CONFIG_EXAMPLES_FATPERF_COPYBUFSIZE 4096
+#endif
+
+#define FATPERF_STR(x)  #x
+#define FATPERF_XSTR(x) FATPERF_STR(x)
+
+#ifdef CONFIG_EXAMPLES_FATPERF_DEVNAME
+#  define FATPERF_SOURCE CONFIG_EXAMPLES_FATPERF_DEVNAME
+#else
+#  define FATPERF_SOURCE "/dev/ram" FATPERF_XSTR(CONFIG_EXAMPLES_FATPERF_RAMDEVNO)
+#endif
+
+#define FATPERF_DIR      CONFIG_EXAMPLES_FATPERF_MOUNTPT "/perfdir"
+#define FATPERF_STATFILE CONFIG_EXAMPLES_FATPERF_MOUNTPT "/perfstat.dat"
+#define FATPERF_DATAFILE CONFIG_EXAMPLES_FATPERF_MOUNTPT "/perfdata.dat"
+#define FATPERF_COPYFILE CONFIG_EXAMPLES_FATPERF_MOUNTPT "/perfcopy.dat"
+#define FATPERF_PATHLEN  64
+
+/* The size of each write in the append test */
+
+#define FATPERF_CHUNKSIZE 512
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static char g_path[FATPERF_PATHLEN];
+static uint8_t g_chunk[FATPERF_CHUNKSIZE];
+
+/* The time and the statistics at the start of the current phase */
+
+static struct timespec g_start;
+static struct fat_stats_s g_before;
+
+static int g_statfd = -1;
+static int g_nerrors;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fatperf_getstats
+ *
+ * Description:
+ *   Get the sector cache statistics of the mounted volume.  Any open file
+ *   on the volume may be used for the FIOC_FATSTATS ioctl.
+ *
+ ****************************************************************************/
+
+static int fatperf_getstats(FAR struct fat_stats_s *stats)
+{
+  if (ioctl(g_statfd, FIOC_FATSTATS, (unsigned long)((uintptr_t)stats)) < 0)
+    {
+      printf("fatperf: FIOC_FATSTATS failed: %d\n", errno);
+      memset(stats, 0, sizeof(struct fat_stats_s));
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fatperf_begin and fatperf_end
+ *
+ * Description:
+ *   Bracket one measured phase.  fatperf_end() reports the elapsed time and
+ *   the change in the sector cache statistics during the phase, and
+ *   returns the elapsed time in milliseconds.
+ *
+ ****************************************************************************/
+
+static void fatperf_begin(void)
+{
+  (void)fatperf_getstats(&g_before);
+  (void)clock_gettime(CLOCK_REALTIME, &g_start);
+}
+
+static uint32_t fatperf_end(FAR const char *what)
+{
+  struct fat_stats_s after;
+  struct timespec now;
+  uint32_t elapsed;
+
+  (void)clock_gettime(CLOCK_REALTIME, &now);
+  elapsed = (uint32_t)(now.tv_sec - g_start.tv_sec) * 1000 +
+            (now.tv_nsec - g_start.tv_nsec) / 1000000;
+  (void)fatperf_getstats(&after);
+
+  printf("%-8s %6lu %6lu %6lu %6lu %6lu %6lu %6lu %6lu %6lu\n", what,
+         (unsigned long)elapsed,
+         (unsigned long)(after.st_fathits   - g_before.st_fathits),
+         (unsigned long)(after.st_fatmisses - g_before.st_fatmisses),
+         (unsigned long)(after.st_dirhits   - g_before.st_dirhits),
+         (unsigned long)(after.st_dirmisses - g_before.st_dirmisses),
+         (unsigned long)(after.st_hwreads   - g_before.st_hwreads),
+         (unsigned long)(after.st_hwwrites  - g_before.st_hwwrites),
+         (unsigned long)(after.st_dcachehits   - g_before.st_dcachehits),
+         (unsigned long)(after.st_dcachemisses - g_before.st_dcachemisses));
+  return elapsed;
+}
+
+/****************************************************************************
+ * Name: fatperf_filename
+ ****************************************************************************/
+
+static FAR const char *fatperf_filename(int ndx)
+{
+  snprintf(g_path, FATPERF_PATHLEN, "%s/F%04d.DAT", FATPERF_DIR, ndx);
+  return g_path;
+}
+
+/****************************************************************************
+ * Name: fatperf_error
+ ****************************************************************************/
+
+static void fatperf_error(FAR const char *op, FAR const char *path)
+{
+  printf("fatperf: %s %s failed: %d\n", op, path, errno);
+  g_nerrors++;
+}
+
+/****************************************************************************
+ * Name: fatperf_mount
+ *
+ * Description:
+ *   Create and format the RAM disk (if no other block device was selected)
+ *   and mount the FAT file system.
+ *
+ ****************************************************************************/
+
+static int fatperf_mount(void)
+{
+#ifndef CONFIG_EXAMPLES_FATPERF_DEVNAME
+  struct fat_format_s fmt = FAT_FORMAT_INITIALIZER;
+  FAR uint8_t *buffer;
+#endif
+  int ret;
+
+#ifndef CONFIG_EXAMPLES_FATPERF_DEVNAME
+  buffer = (FAR uint8_t *)malloc(CONFIG_EXAMPLES_FATPERF_NSECTORS *
+                                 CONFIG_EXAMPLES_FATPERF_SECTORSIZE);
+  if (!buffer)
+    {
+      printf("fatperf: Failed to allocate the RAM disk\n");
+      return ERROR;
+    }
+
+  ret = ramdisk_register(CONFIG_EXAMPLES_FATPERF_RAMDEVNO, buffer,
+                         CONFIG_EXAMPLES_FATPERF_NSECTORS,
+                         CONFIG_EXAMPLES_FATPERF_SECTORSIZE, true);
+  if (ret < 0)
+    {
+      printf("fatperf: ramdisk_register failed: %d\n", -ret);
+      free(buffer);
+      return ERROR;
+    }
+
+  ret = mkfatfs(FATPERF_SOURCE, &fmt);
+  if (ret < 0)
+    {
+      printf("fatperf: mkfatfs failed: %d\n", errno);
+      return ERROR;
+    }
+#endif
+
+  ret = mount(FATPERF_SOURCE, CONFIG_EXAMPLES_FATPERF_MOUNTPT, "vfat", 0,
+              NULL);
+  if (ret < 0)
+    {
+      printf("fatperf: mount %s failed: %d\n", FATPERF_SOURCE, errno);
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fatperf_dirtest
+ *
+ * Description:
+ *   A directory intensive workload:  Create many small files in one
+ *   directory, look each of them up, open them in random order, enumerate
+ *   the directory, and then remove everything again.
+ *
+ ****************************************************************************/
+
+static void fatperf_dirtest(void)
+{
+  FAR struct dirent *entry;
+  struct stat buf;
+  FAR DIR *dirp;
+  int nfound;
+  int ndx;
+  int fd;
+  int i;
+
+  fatperf_begin();
+  if (mkdir(FATPERF_DIR, 0777) < 0)
+    {
+      fatperf_error("mkdir", FATPERF_DIR);
+      return;
+    }
+
+  for (i = 0; i < CONFIG_EXAMPLES_FATPERF_NFILES; i++)
+    {
+      fd = open(fatperf_filename(i), O_WRONLY|O_CREAT|O_TRUNC, 0666);
+      if (fd < 0)
+        {
+          fatperf_error("open", g_path);
+          continue;
+        }
+
+      if (write(fd, g_path, strlen(g_path)) < 0)
+        {
+          fatperf_error("write", g_path);
+        }
+
+      close(fd);
+    }
+  fatperf_end("create");
+
+  fatperf_begin();
+  for (i = CONFIG_EXAMPLES_FATPERF_NFILES - 1; i >= 0; i--)
+    {
+      if (stat(fatperf_filename(i), &buf) < 0)
+        {
+          fatperf_error("stat", g_path);
+        }
+    }
+  fatperf_end("stat");
+
+  fatperf_begin();
+  for (i = 0; i < CONFIG_EXAMPLES_FATPERF_NOPENS; i++)
+    {
+      ndx = rand() % CONFIG_EXAMPLES_FATPERF_NFILES;
+      fd  = open(fatperf_filename(ndx), O_RDONLY);
+      if (fd < 0)
+        {
+          fatperf_error("open", g_path);
+          break;
+        }
+
+      close(fd);
+    }
+  fatperf_end("open");
+
+  fatperf_begin();
+  nfound = 0;
+  dirp   = opendir(FATPERF_DIR);
+  if (!dirp)
+    {
+      fatperf_error("opendir", FATPERF_DIR);
+    }
+  else
+    {
+      while ((entry = readdir(dirp)) != NULL)
+        {
+          if (!DIRENT_ISDIRECTORY(entry->d_type))
+            {
+              nfound++;
+            }
+        }
+
+      closedir(dirp);
+    }
+  fatperf_end("readdir");
+
+  if (nfound != CONFIG_EXAMPLES_FATPERF_NFILES)
+    {
+      printf("fatperf: readdir found %d files, expected %d\n",
+             nfound, CONFIG_EXAMPLES_FATPERF_NFILES);
+      g_nerrors++;
+    }
+
+  fatperf_begin();
+  for (i = 0; i < CONFIG_EXAMPLES_FATPERF_NFILES; i++)
+    {
+      if (unlink(fatperf_filename(i)) < 0)
+        {
+          fatperf_error("unlink", g_path);
+        }
+    }
+
+  if (rmdir(FATPERF_DIR) < 0)
+    {
+      fatperf_error("rmdir", FATPERF_DIR);
+    }
+  fatperf_end("unlink");
+}
+
+/****************************************************************************
+ * Name: fatperf_seektest
+ *
+ * Description:
+ *   Append to a file in small chunks (as a data logger would), then seek
+ *   to random positions in the file and verify one byte at each.  Each
+ *   byte of the file holds the low 8 bits of its chunk number.
+ *
+ ****************************************************************************/
+
+static void fatperf_seektest(void)
+{
+  uint32_t nchunks = CONFIG_EXAMPLES_FATPERF_FILESIZE / FATPERF_CHUNKSIZE;
+  uint32_t chunk;
+  uint8_t  ch;
+  int      fd;
+  int      i;
+
+  fd = open(FATPERF_DATAFILE, O_RDWR|O_CREAT|O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      fatperf_error("open", FATPERF_DATAFILE);
+      return;
+    }
+
+  fatperf_begin();
+  for (chunk = 0; chunk < nchunks; chunk++)
+    {
+      memset(g_chunk, (uint8_t)chunk, FATPERF_CHUNKSIZE);
+      if (write(fd, g_chunk, FATPERF_CHUNKSIZE) != FATPERF_CHUNKSIZE)
+        {
+          fatperf_error("write", FATPERF_DATAFILE);
+          goto errout_with_fd;
+        }
+    }
+  fatperf_end("append");
+
+  fatperf_begin();
+  for (i = 0; i < CONFIG_EXAMPLES_FATPERF_NSEEKS; i++)
+    {
+      chunk = (((uint32_t)rand() << 15) | rand()) % nchunks;
+      if (lseek(fd, chunk * FATPERF_CHUNKSIZE + (i % FATPERF_CHUNKSIZE),
+                SEEK_SET) < 0 ||
+          read(fd, &ch, 1) != 1)
+        {
+          fatperf_error("seek", FATPERF_DATAFILE);
+          break;
+        }
+
+      if (ch != (uint8_t)chunk)
+        {
+          printf("fatperf: Bad data at chunk %lu\n", (unsigned long)chunk);
+          g_nerrors++;
+          break;
+        }
+    }
+  fatperf_end("seek");
+
+errout_with_fd:
+  close(fd);
+  (void)unlink(FATPERF_DATAFILE);
+}
+
+/****************************************************************************
+ * Name: fatperf_copy
+ *
+ * Description:
+ *   Copy FATPERF_DATAFILE to FATPERF_COPYFILE using the user buffer.  If
+ *   'skew' is non-zero, then that many bytes are copied first so that all
+ *   of the following transfers start in the middle of a sector.  Returns
+ *   the number of bytes copied or -1 on a failure.
+ *
+ ****************************************************************************/
+
+static ssize_t fatperf_copy(FAR uint8_t *buffer, size_t skew)
+{
+  ssize_t total = 0;
+  ssize_t nread;
+  size_t  size;
+  int     infd;
+  int     outfd;
+
+  infd = open(FATPERF_DATAFILE, O_RDONLY);
+  if (infd < 0)
+    {
+      fatperf_error("open", FATPERF_DATAFILE);
+      return -1;
+    }
+
+  outfd = open(FATPERF_COPYFILE, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+  if (outfd < 0)
+    {
+      fatperf_error("open", FATPERF_COPYFILE);
+      close(infd);
+      return -1;
+    }
+
+  size = skew > 0 ? skew : CONFIG_EXAMPLES_FATPERF_COPYBUFSIZE;
+  while ((nread = read(infd, buffer, size)) > 0)
+    {
+      if (write(outfd, buffer, nread) != nread)
+        {
+          fatperf_error("write", FATPERF_COPYFILE);
+          total = -1;
+          break;
+        }
+
+      total += nread;
+      size   = CONFIG_EXAMPLES_FATPERF_COPYBUFSIZE;
+    }
+
+  if (nread < 0)
+    {
+      fatperf_error("read", FATPERF_DATAFILE);
+      total = -1;
+    }
+
+  close(outfd);
+  close(infd);
+  return total;
+}
+
+/****************************************************************************
+ * Name: fatperf_copytest
+ *
+ * Description:
+ *   Measure file copy throughput, once with sector aligned transfers and
+ *   once with every transfer starting in the middle of a sector.  The
+ *   copy is then verified.  Each byte of the file holds the low 8 bits of
+ *   its chunk number (as in the seek test).
+ *
+ ****************************************************************************/
+
+static void fatperf_copytest(void)
+{
+  FAR uint8_t *buffer;
+  uint32_t nchunks = CONFIG_EXAMPLES_FATPERF_FILESIZE / FATPERF_CHUNKSIZE;
+  uint32_t elapsed;
+  uint32_t chunk;
+  ssize_t  ncopied;
+  int      skew;
+  int      fd;
+  int      i;
+
+  buffer = (FAR uint8_t *)malloc(CONFIG_EXAMPLES_FATPERF_COPYBUFSIZE);
+  if (!buffer)
+    {
+      printf("fatperf: Failed to allocate the copy buffer\n");
+      g_nerrors++;
+      return;
+    }
+
+  /* Create the file to be copied */
+
+  fd = open(FATPERF_DATAFILE, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      fatperf_error("open", FATPERF_DATAFILE);
+      goto errout_with_buffer;
+    }
+
+  for (chunk = 0; chunk < nchunks; chunk++)
+    {
+      memset(g_chunk, (uint8_t)chunk, FATPERF_CHUNKSIZE);
+      if (write(fd, g_chunk, FATPERF_CHUNKSIZE) != FATPERF_CHUNKSIZE)
+        {
+          fatperf_error("write", FATPERF_DATAFILE);
+          close(fd);
+          goto errout_with_files;
+        }
+    }
+  close(fd);
+
+  /* Then copy it, aligned and unaligned */
+
+  for (skew = 0; skew < 2; skew++)
+    {
+      fatperf_begin();
+      ncopied = fatperf_copy(buffer, skew);
+      elapsed = fatperf_end(skew ? "copy+1" : "copy");
+
+      if (ncopied < 0)
+        {
+          goto errout_with_files;
+        }
+
+      if (elapsed == 0)
+        {
+          elapsed = 1;
+        }
+
+      printf("  %ld bytes in %lu msec, %lu Kb/sec\n", (long)ncopied,
+             (unsigned long)elapsed,
+             (unsigned long)((ncopied / 1024) * 1000 / elapsed));
+    }
+
+  /* Verify the last copy */
+
+  fd = open(FATPERF_COPYFILE, O_RDONLY);
+  if (fd < 0)
+    {
+      fatperf_error("open", FATPERF_COPYFILE);
+      goto errout_with_files;
+    }
+
+  for (chunk = 0; chunk < nchunks; chunk++)
+    {
+      if (read(fd, g_chunk, FATPERF_CHUNKSIZE) != FATPERF_CHUNKSIZE)
+        {
+          fatperf_error("read", FATPERF_COPYFILE);
+          break;
+        }
+
+      for (i = 0; i < FATPERF_CHUNKSIZE; i++)
+        {
+          if (g_chunk[i] != (uint8_t)chunk)
+            {
+              printf("fatperf: Bad copy at chunk %lu\n",
+                     (unsigned long)chunk);
+              g_nerrors++;
+              chunk = nchunks;
+              break;
+            }
+        }
+    }
+  close(fd);
+
+errout_with_files:
+  (void)unlink(FATPERF_COPYFILE);
+  (void)unlink(FATPERF_DATAFILE);
+errout_with_buffer:
+  free(buffer);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fatperf_main/user_start
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_FATPERF_BUILTIN
+#  define MAIN_NAME fatperf_main
+#else
+#  define MAIN_NAME user_start
+#endif
+
+int MAIN_NAME(int argc, char *argv[])
+{
+  g_nerrors = 0;
+  if (fatperf_mount() < 0)
+    {
+      return 1;
+    }
+
+  /* The FIOC_FATSTATS ioctl requires an open file on the volume */
+
+  g_statfd = open(FATPERF_STATFILE, O_RDWR|O_CREAT, 0666);
+  if (g_statfd < 0)
+    {
+      printf("fatperf: open %s failed: %d\n", FATPERF_STATFILE, errno);
+      (void)umount(CONFIG_EXAMPLES_FATPERF_MOUNTPT);
+      return 1;
+    }
+
+  printf("fatperf: %s on %s, %d files\n",
+         FATPERF_SOURCE, CONFIG_EXAMPLES_FATPERF_MOUNTPT,
+         CONFIG_EXAMPLES_FATPERF_NFILES);
+  printf("%-8s %6s %6s %6s %6s %6s %6s %6s %6s %6s\n", "Test", "msec",
+         "fathit", "fatmis", "dirhit", "dirmis", "hwrd", "hwwr",
+         "dchit", "dcmis");
+
+  fatperf_dirtest();
+  fatperf_seektest();
+  fatperf_copytest();
+
+  close(g_statfd);
+  (void)unlink(FATPERF_STATFILE);
+  (void)umount(CONFIG_EXAMPLES_FATPERF_MOUNTPT);
+
+  if (g_nerrors > 0)
+    {
+      printf("fatperf: %d errors\n", g_nerrors);
+      return 1;
+    }
+
+  printf("fatperf: Done\n");
+  return 0;
+}
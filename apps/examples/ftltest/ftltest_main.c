@@ -0,0 +1,483 @@
+/****************************************************************************
+ * examples/ftltest/ftltest_main.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <nuttx/fs.h>
+#include <nuttx/ioctl.h>
+#include <nuttx/mtd.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_EXAMPLES_FTLTEST_MINOR - The FTL block driver minor number.  The
+ *   FTL is registered as /dev/mtdblockN and re-mounted as /dev/mtdblockN+1.
+ *   Default 0
+ * CONFIG_EXAMPLES_FTLTEST_NEBLOCKS - The number of erase blocks in the RAM
+ *   MTD device.  Default 32
+ * CONFIG_EXAMPLES_FTLTEST_NWRITES - The number of random sector writes.
+ *   Default 4096
+ */
+
+#ifndef CONFIG_FTL_WEARLEVEL
+#  error "This test requires CONFIG_FTL_WEARLEVEL"
+#endif
+
+#ifndef CONFIG_FTL_FORMAT
+#  error "This test requires CONFIG_FTL_FORMAT to format the RAM FLASH"
+#endif
+
+/* This must exactly match the default configuration in drivers/mtd/rammtd.c */
+
+#ifndef CONFIG_RAMMTD_BLOCKSIZE
+#  define CONFIG_RAMMTD_BLOCKSIZE 512
+#endif
+
+#ifndef CONFIG_RAMMTD_ERASESIZE
+#  define CONFIG_RAMMTD_ERASESIZE 4096
+#endif
+
+#ifndef CONFIG_EXAMPLES_FTLTEST_MINOR
+#  define CONFIG_EXAMPLES_FTLTEST_MINOR 0
+#endif
+
+#ifndef CONFIG_EXAMPLES_FTLTEST_NEBLOCKS
+#  define CONFIG_EXAMPLES_FTLTEST_NEBLOCKS 32
+#endif
+
+#ifndef CONFIG_EXAMPLES_FTLTEST_NWRITES
+#  define CONFIG_EXAMPLES_FTLTEST_NWRITES 4096
+#endif
+
+/* This must match the default in drivers/rwbuffer.c */
+
+#ifndef CONFIG_FS_WRDELAY
+#  define CONFIG_FS_WRDELAY 350
+#endif
+
+#define FTLTEST_FLASHSIZE \
+  (CONFIG_RAMMTD_ERASESIZE * CONFIG_EXAMPLES_FTLTEST_NEBLOCKS)
+
+/* One half of the random writes go to this fraction of the sectors so that
+ * the static wear-levelling has something to do.
+ */
+
+#define FTLTEST_HOTFRACTION 8
+
+#define FTLTEST_PATHLEN 16
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The simulated FLASH */
+
+static uint8_t g_simflash[FTLTEST_FLASHSIZE];
+
+/* One sector of data */
+
+static uint8_t g_sector[CONFIG_RAMMTD_BLOCKSIZE];
+
+/* The number of times that each logical sector has been written */
+
+static FAR uint16_t *g_version;
+
+static char g_devname[FTLTEST_PATHLEN];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ftltest_fill
+ *
+ * Description:
+ *   Fill the sector buffer with the data expected for one version of one
+ *   logical sector.
+ *
+ ****************************************************************************/
+
+static void ftltest_fill(size_t sector, uint16_t version)
+{
+  uint32_t value = ((uint32_t)sector << 16) | version;
+  int i;
+
+  for (i = 0; i < CONFIG_RAMMTD_BLOCKSIZE; i++)
+    {
+      value = value * 1103515245 + 12345;
+      g_sector[i] = (uint8_t)(value >> 16);
+    }
+}
+
+/****************************************************************************
+ * Name: ftltest_write
+ ****************************************************************************/
+
+static int ftltest_write(FAR struct inode *inode, size_t sector)
+{
+  ssize_t nxfrd;
+
+  g_version[sector]++;
+  ftltest_fill(sector, g_version[sector]);
+
+  nxfrd = inode->u.i_bops->write(inode, g_sector, sector, 1);
+  if (nxfrd != 1)
+    {
+      printf("ftltest: Write sector %lu failed: %ld\n",
+             (unsigned long)sector, (long)nxfrd);
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftltest_workload
+ *
+ * Description:
+ *   Write every logical sector once, then write sectors at random.
+ *
+ ****************************************************************************/
+
+static int ftltest_workload(FAR struct inode *inode, size_t nsectors)
+{
+  size_t nhot;
+  size_t sector;
+  int i;
+
+  nhot = nsectors / FTLTEST_HOTFRACTION;
+  if (nhot == 0)
+    {
+      nhot = 1;
+    }
+
+  for (sector = 0; sector < nsectors; sector++)
+    {
+      if (ftltest_write(inode, sector) < 0)
+        {
+          return ERROR;
+        }
+    }
+
+  for (i = 0; i < CONFIG_EXAMPLES_FTLTEST_NWRITES; i++)
+    {
+      if ((rand() & 1) != 0)
+        {
+          sector = rand() % nhot;
+        }
+      else
+        {
+          sector = rand() % nsectors;
+        }
+
+      if (ftltest_write(inode, sector) < 0)
+        {
+          return ERROR;
+        }
+    }
+
+  printf("ftltest: %lu sequential and %d random writes\n",
+         (unsigned long)nsectors, CONFIG_EXAMPLES_FTLTEST_NWRITES);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftltest_verify
+ *
+ * Description:
+ *   Read back every logical sector and compare it with the last version
+ *   written.
+ *
+ ****************************************************************************/
+
+static int ftltest_verify(FAR struct inode *inode, size_t nsectors)
+{
+  uint8_t expected[CONFIG_RAMMTD_BLOCKSIZE];
+  ssize_t nxfrd;
+  size_t sector;
+  int nbad = 0;
+
+  for (sector = 0; sector < nsectors; sector++)
+    {
+      ftltest_fill(sector, g_version[sector]);
+      memcpy(expected, g_sector, CONFIG_RAMMTD_BLOCKSIZE);
+
+      nxfrd = inode->u.i_bops->read(inode, g_sector, sector, 1);
+      if (nxfrd != 1)
+        {
+          printf("ftltest: Read sector %lu failed: %ld\n",
+                 (unsigned long)sector, (long)nxfrd);
+          nbad++;
+        }
+      else if (memcmp(expected, g_sector, CONFIG_RAMMTD_BLOCKSIZE) != 0)
+        {
+          printf("ftltest: Sector %lu does not hold version %u\n",
+                 (unsigned long)sector, g_version[sector]);
+          nbad++;
+        }
+    }
+
+  return nbad > 0 ? ERROR : OK;
+}
+
+/****************************************************************************
+ * Name: ftltest_showstats
+ *
+ * Description:
+ *   Report the BIOC_FTLSTATS statistics.  The write amplification is the
+ *   number of sectors written to the FLASH (including the sectors copied by
+ *   garbage collection and wear-levelling and the erase block header
+ *   writes) for each sector written by the caller.
+ *
+ ****************************************************************************/
+
+static void ftltest_showstats(FAR struct inode *inode)
+{
+  struct ftl_stats_s stats;
+  uint32_t total;
+  int ret;
+
+  ret = inode->u.i_bops->ioctl(inode, BIOC_FTLSTATS,
+                               (unsigned long)((uintptr_t)&stats));
+  if (ret < 0)
+    {
+      printf("ftltest: BIOC_FTLSTATS failed: %d\n", ret);
+      return;
+    }
+
+  total = stats.st_nwritten + stats.st_ncopied + stats.st_nhdrwrites;
+
+  printf("  Sectors read:        %lu\n", (unsigned long)stats.st_nread);
+  printf("  Sectors written:     %lu\n", (unsigned long)stats.st_nwritten);
+  printf("  Sectors copied:      %lu\n", (unsigned long)stats.st_ncopied);
+  printf("  Header writes:       %lu\n", (unsigned long)stats.st_nhdrwrites);
+  printf("  Erase blocks erased: %lu\n", (unsigned long)stats.st_nerased);
+  printf("  Garbage collections: %lu\n", (unsigned long)stats.st_ngc);
+  printf("  Wear-level moves:    %lu\n", (unsigned long)stats.st_nwlmoves);
+  printf("  Erase count:         min %lu max %lu\n",
+         (unsigned long)stats.st_minecount,
+         (unsigned long)stats.st_maxecount);
+
+  if (stats.st_nwritten > 0)
+    {
+      /* Show the write amplification with two decimal places */
+
+      uint32_t wa100 = (uint32_t)(((uint64_t)total * 100) / stats.st_nwritten);
+      printf("  Write amplification: %lu.%02lu\n",
+             (unsigned long)(wa100 / 100), (unsigned long)(wa100 % 100));
+    }
+}
+
+/****************************************************************************
+ * Name: ftltest_open
+ *
+ * Description:
+ *   Create a wear-levelling FTL on the simulated FLASH and open it.
+ *
+ ****************************************************************************/
+
+static int ftltest_open(FAR struct mtd_dev_s *mtd, int minor,
+                        FAR struct inode **inode,
+                        FAR struct geometry *geo)
+{
+  int ret;
+
+  ret = ftl_initialize(minor, mtd);
+  if (ret < 0)
+    {
+      printf("ftltest: ftl_initialize failed: %d\n", ret);
+      return ret;
+    }
+
+  snprintf(g_devname, FTLTEST_PATHLEN, "/dev/mtdblock%d", minor);
+  ret = open_blockdriver(g_devname, 0, inode);
+  if (ret < 0)
+    {
+      printf("ftltest: open_blockdriver(%s) failed: %d\n", g_devname, ret);
+      (void)unregister_blockdriver(g_devname);
+      return ret;
+    }
+
+  ret = (*inode)->u.i_bops->geometry(*inode, geo);
+  if (ret < 0 || geo->geo_sectorsize != CONFIG_RAMMTD_BLOCKSIZE)
+    {
+      printf("ftltest: Bad geometry: %d\n", ret);
+      (void)close_blockdriver(*inode);
+      (void)unregister_blockdriver(g_devname);
+      return -EINVAL;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftltest_close
+ ****************************************************************************/
+
+static void ftltest_close(FAR struct inode *inode, int minor)
+{
+  (void)close_blockdriver(inode);
+
+  /* The FTL cannot be un-initialized, but the name can be re-used */
+
+  snprintf(g_devname, FTLTEST_PATHLEN, "/dev/mtdblock%d", minor);
+  (void)unregister_blockdriver(g_devname);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ftltest_main/user_start
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_FTLTEST_BUILTIN
+#  define MAIN_NAME ftltest_main
+#else
+#  define MAIN_NAME user_start
+#endif
+
+int MAIN_NAME(int argc, char *argv[])
+{
+  FAR struct mtd_dev_s *mtd;
+  FAR struct inode *inode;
+  struct geometry geo;
+  size_t nsectors;
+  int ret;
+
+  /* Start with erased FLASH so that the FTL is formatted */
+
+  memset(g_simflash, 0xff, FTLTEST_FLASHSIZE);
+  mtd = rammtd_initialize(g_simflash, FTLTEST_FLASHSIZE);
+  if (!mtd)
+    {
+      printf("ftltest: Failed to create the RAM MTD instance\n");
+      return 1;
+    }
+
+  if (ftltest_open(mtd, CONFIG_EXAMPLES_FTLTEST_MINOR, &inode, &geo) < 0)
+    {
+      return 1;
+    }
+
+  nsectors  = geo.geo_nsectors;
+  g_version = (FAR uint16_t *)zalloc(nsectors * sizeof(uint16_t));
+  if (!g_version)
+    {
+      printf("ftltest: Failed to allocate the sector versions\n");
+      ftltest_close(inode, CONFIG_EXAMPLES_FTLTEST_MINOR);
+      return 1;
+    }
+
+  printf("ftltest: %d erase blocks of %d bytes, %lu logical sectors\n",
+         CONFIG_EXAMPLES_FTLTEST_NEBLOCKS, CONFIG_RAMMTD_ERASESIZE,
+         (unsigned long)nsectors);
+
+  /* Run the random write workload and verify the data */
+
+  ret = ftltest_workload(inode, nsectors);
+  if (ret == OK)
+    {
+      ret = ftltest_verify(inode, nsectors);
+      if (ret == OK)
+        {
+          printf("ftltest: Verified\n");
+        }
+    }
+
+#if defined(CONFIG_FTL_RWBUFFER) && defined(CONFIG_FS_WRITEBUFFER)
+  /* The block driver cannot be flushed;  wait until the write buffer is
+   * written to the FLASH.
+   */
+
+  usleep((CONFIG_FS_WRDELAY + 100) * 1000);
+#endif
+
+  ftltest_showstats(inode);
+  ftltest_close(inode, CONFIG_EXAMPLES_FTLTEST_MINOR);
+
+  /* Mount the same FLASH again as a new FTL instance.  The sector map is
+   * rebuilt from the erase block headers.
+   */
+
+  if (ret == OK)
+    {
+      ret = ftltest_open(mtd, CONFIG_EXAMPLES_FTLTEST_MINOR + 1, &inode, &geo);
+      if (ret == OK)
+        {
+          if (geo.geo_nsectors != nsectors)
+            {
+              printf("ftltest: Re-mounted with %lu sectors\n",
+                     (unsigned long)geo.geo_nsectors);
+              ret = ERROR;
+            }
+          else
+            {
+              ret = ftltest_verify(inode, nsectors);
+              if (ret == OK)
+                {
+                  printf("ftltest: Verified after re-mounting\n");
+                }
+            }
+
+          ftltest_close(inode, CONFIG_EXAMPLES_FTLTEST_MINOR + 1);
+        }
+    }
+
+  free(g_version);
+
+  if (ret < 0)
+    {
+      printf("ftltest: FAILED\n");
+      return 1;
+    }
+
+  printf("ftltest: Done\n");
+  return 0;
+}
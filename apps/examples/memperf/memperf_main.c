@@ -0,0 +1,453 @@
+/****************************************************************************
+ * examples/memperf/memperf_main.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_EXAMPLES_MEMPERF_MAXSIZE - The largest transfer size measured.
+ * CONFIG_EXAMPLES_MEMPERF_NBYTES - The number of bytes processed for each
+ *   measurement.  This should take at least several system timer ticks.
+ * CONFIG_EXAMPLES_MEMPERF_CPUFREQ - The CPU clock frequency in Hz.  If
+ *   provided, throughput is also reported in bytes per CPU cycle.
+ */
+
+#ifndef CONFIG_EXAMPLES_MEMPERF_MAXSIZE
+#  define CONFIG_EXAMPLES_MEMPERF_MAXSIZE 4096
+#endif
+
+#ifndef CONFIG_EXAMPLES_MEMPERF_NBYTES
+#  define CONFIG_EXAMPLES_MEMPERF_NBYTES (4*1024*1024)
+#endif
+
+#if defined(CONFIG_EXAMPLES_MEMPERF_CPUFREQ) && CONFIG_EXAMPLES_MEMPERF_CPUFREQ < 102400
+#  undef CONFIG_EXAMPLES_MEMPERF_CPUFREQ
+#endif
+
+/* Correctness is verified for all sizes up to MEMPERF_CHECKSIZE and all
+ * source/destination offsets up to MEMPERF_MAXOFFSET.
+ */
+
+#define MEMPERF_CHECKSIZE 64
+#define MEMPERF_MAXOFFSET 8
+#define MEMPERF_BUFSIZE   (CONFIG_EXAMPLES_MEMPERF_MAXSIZE + 2*MEMPERF_MAXOFFSET)
+
+/* Measured operations */
+
+#define MEMPERF_MEMCPY    0
+#define MEMPERF_MEMSET    1
+#define MEMPERF_MEMMOVE   2
+#define MEMPERF_MEMCMP    3
+#define MEMPERF_NOPS      4
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct memperf_align_s
+{
+  uint8_t doffset;          /* Offset of the destination from alignment */
+  uint8_t soffset;          /* Offset of the source from alignment */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static uint32_t g_src[MEMPERF_BUFSIZE / sizeof(uint32_t)];
+static uint32_t g_dest[MEMPERF_BUFSIZE / sizeof(uint32_t)];
+static uint8_t  g_ref[MEMPERF_BUFSIZE];
+
+static volatile int g_sink;
+
+static const char *g_opname[MEMPERF_NOPS] =
+{
+  "memcpy", "memset", "memmove", "memcmp"
+};
+
+static const uint16_t g_sizes[] =
+{
+  8, 32, 128, 512, 1024, CONFIG_EXAMPLES_MEMPERF_MAXSIZE
+};
+
+#define MEMPERF_NSIZES (sizeof(g_sizes) / sizeof(g_sizes[0]))
+
+static const struct memperf_align_s g_aligns[] =
+{
+  {0, 0},                   /* Both aligned */
+  {1, 1},                   /* Same misalignment */
+  {0, 1},                   /* Different alignment */
+  {3, 2}
+};
+
+#define MEMPERF_NALIGNS (sizeof(g_aligns) / sizeof(g_aligns[0]))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: memperf_fill
+ ****************************************************************************/
+
+static void memperf_fill(FAR uint8_t *buffer, size_t len, unsigned int seed)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      buffer[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+/****************************************************************************
+ * Name: memperf_refcmp
+ *
+ * Description:
+ *   Byte-at-a-time comparison used to check memcmp() and the results of
+ *   the other operations.
+ *
+ ****************************************************************************/
+
+static int memperf_refcmp(FAR const uint8_t *p1, FAR const uint8_t *p2,
+                          size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      if (p1[i] != p2[i])
+        {
+          return p1[i] < p2[i] ? -1 : 1;
+        }
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: memperf_verify
+ *
+ * Description:
+ *   Verify the string functions against byte-at-a-time reference
+ *   implementations for all small sizes and alignments.  Returns the
+ *   number of failures.
+ *
+ ****************************************************************************/
+
+static int memperf_verify(void)
+{
+  FAR uint8_t *src  = (FAR uint8_t *)g_src;
+  FAR uint8_t *dest = (FAR uint8_t *)g_dest;
+  int nerrors = 0;
+  int result;
+  int size;
+  int doff;
+  int soff;
+  int i;
+
+  for (size = 0; size <= MEMPERF_CHECKSIZE; size++)
+    {
+      for (doff = 0; doff < MEMPERF_MAXOFFSET; doff++)
+        {
+          for (soff = 0; soff < MEMPERF_MAXOFFSET; soff++)
+            {
+              /* memcpy:  Only the destination range may change */
+
+              memperf_fill(src, MEMPERF_BUFSIZE, 1);
+              memperf_fill(dest, MEMPERF_BUFSIZE, 2);
+              memperf_fill(g_ref, MEMPERF_BUFSIZE, 2);
+              for (i = 0; i < size; i++)
+                {
+                  g_ref[doff + i] = src[soff + i];
+                }
+
+              memcpy(&dest[doff], &src[soff], size);
+              if (memperf_refcmp(dest, g_ref, MEMPERF_BUFSIZE) != 0)
+                {
+                  printf("memcpy FAILED: size=%d doff=%d soff=%d\n",
+                         size, doff, soff);
+                  nerrors++;
+                }
+
+              /* memset */
+
+              memperf_fill(dest, MEMPERF_BUFSIZE, 2);
+              memperf_fill(g_ref, MEMPERF_BUFSIZE, 2);
+              for (i = 0; i < size; i++)
+                {
+                  g_ref[doff + i] = (uint8_t)(0xa5 + soff);
+                }
+
+              memset(&dest[doff], 0xa5 + soff, size);
+              if (memperf_refcmp(dest, g_ref, MEMPERF_BUFSIZE) != 0)
+                {
+                  printf("memset FAILED: size=%d doff=%d val=%02x\n",
+                         size, doff, 0xa5 + soff);
+                  nerrors++;
+                }
+
+              /* memmove within one buffer (the regions overlap whenever
+               * size exceeds the distance between the offsets).
+               */
+
+              memperf_fill(dest, MEMPERF_BUFSIZE, 3);
+              memperf_fill(g_ref, MEMPERF_BUFSIZE, 3);
+              for (i = 0; i < size; i++)
+                {
+                  g_ref[doff + i] = (uint8_t)(3 + (soff + i) * 7);
+                }
+
+              memmove(&dest[doff], &dest[soff], size);
+              if (memperf_refcmp(dest, g_ref, MEMPERF_BUFSIZE) != 0)
+                {
+                  printf("memmove FAILED: size=%d doff=%d soff=%d\n",
+                         size, doff, soff);
+                  nerrors++;
+                }
+
+              /* memcmp:  Equal buffers, then a difference in the last byte */
+
+              memperf_fill(src, MEMPERF_BUFSIZE, 4);
+              memcpy(&dest[doff], &src[soff], size);
+              if (memcmp(&dest[doff], &src[soff], size) != 0)
+                {
+                  printf("memcmp FAILED: size=%d doff=%d soff=%d (equal)\n",
+                         size, doff, soff);
+                  nerrors++;
+                }
+
+              if (size > 0)
+                {
+                  dest[doff + size - 1] ^= 0x80;
+                  result = memcmp(&dest[doff], &src[soff], size);
+                  if (result == 0 ||
+                      (result < 0) !=
+                      (memperf_refcmp(&dest[doff], &src[soff], size) < 0))
+                    {
+                      printf("memcmp FAILED: size=%d doff=%d soff=%d\n",
+                             size, doff, soff);
+                      nerrors++;
+                    }
+                }
+            }
+        }
+    }
+
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: memperf_msec
+ ****************************************************************************/
+
+static uint32_t memperf_msec(void)
+{
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint32_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/****************************************************************************
+ * Name: memperf_measure
+ *
+ * Description:
+ *   Perform one operation repeatedly on blocks of 'size' bytes until
+ *   CONFIG_EXAMPLES_MEMPERF_NBYTES have been processed.  Returns the
+ *   elapsed time in milliseconds.
+ *
+ ****************************************************************************/
+
+static uint32_t memperf_measure(int op, size_t size,
+                                FAR const struct memperf_align_s *align)
+{
+  FAR uint8_t *src  = (FAR uint8_t *)g_src + align->soffset;
+  FAR uint8_t *dest = (FAR uint8_t *)g_dest + align->doffset;
+  uint32_t niterations = CONFIG_EXAMPLES_MEMPERF_NBYTES / size;
+  uint32_t start;
+  uint32_t i;
+  int sum = 0;
+
+  if (op == MEMPERF_MEMCMP)
+    {
+      /* Compare equal buffers so that the whole size is examined */
+
+      memcpy(dest, src, size);
+    }
+
+  start = memperf_msec();
+  for (i = 0; i < niterations; i++)
+    {
+      switch (op)
+        {
+          case MEMPERF_MEMCPY:
+            memcpy(dest, src, size);
+            break;
+
+          case MEMPERF_MEMSET:
+            memset(dest, i, size);
+            break;
+
+          case MEMPERF_MEMMOVE:
+            memmove(dest, src, size);
+            break;
+
+          case MEMPERF_MEMCMP:
+            sum += memcmp(dest, src, size);
+            break;
+        }
+    }
+
+  g_sink = sum;
+  return memperf_msec() - start;
+}
+
+/****************************************************************************
+ * Name: memperf_report
+ ****************************************************************************/
+
+static void memperf_report(int op, size_t size,
+                           FAR const struct memperf_align_s *align,
+                           uint32_t elapsed)
+{
+  uint32_t nbytes = (CONFIG_EXAMPLES_MEMPERF_NBYTES / size) * size;
+  uint32_t kbps;
+
+  if (elapsed == 0)
+    {
+      printf("%-8s %5d   %d/%d     (too fast: increase NBYTES)\n",
+             g_opname[op], (int)size, align->doffset, align->soffset);
+      return;
+    }
+
+  kbps = (nbytes / 1024) * 1000 / elapsed;
+
+#ifdef CONFIG_EXAMPLES_MEMPERF_CPUFREQ
+  {
+    /* Bytes per cycle in hundredths:  kbps * 1024 * 100 / cpufreq */
+
+    uint32_t bpc = kbps / (CONFIG_EXAMPLES_MEMPERF_CPUFREQ / 102400);
+
+    printf("%-8s %5d   %d/%d %8lu %9lu %3lu.%02lu\n",
+           g_opname[op], (int)size, align->doffset, align->soffset,
+           (unsigned long)elapsed, (unsigned long)kbps,
+           (unsigned long)(bpc / 100), (unsigned long)(bpc % 100));
+  }
+#else
+  printf("%-8s %5d   %d/%d %8lu %9lu\n",
+         g_opname[op], (int)size, align->doffset, align->soffset,
+         (unsigned long)elapsed, (unsigned long)kbps);
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: memperf_main/user_start
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_MEMPERF_BUILTIN
+#  define MAIN_NAME memperf_main
+#else
+#  define MAIN_NAME user_start
+#endif
+
+int MAIN_NAME(int argc, char *argv[])
+{
+  uint32_t elapsed;
+  int nerrors;
+  int op;
+  int i;
+  int j;
+
+  /* First, make sure that the functions work */
+
+  printf("memperf: Verifying sizes 0-%d, offsets 0-%d\n",
+         MEMPERF_CHECKSIZE, MEMPERF_MAXOFFSET - 1);
+
+  nerrors = memperf_verify();
+  if (nerrors > 0)
+    {
+      printf("memperf: %d failures\n", nerrors);
+      return 1;
+    }
+
+  /* Then measure them */
+
+  printf("memperf: %lu bytes per measurement\n\n",
+         (unsigned long)CONFIG_EXAMPLES_MEMPERF_NBYTES);
+#ifdef CONFIG_EXAMPLES_MEMPERF_CPUFREQ
+  printf("Function  Size D/S Off     msec    KB/sec  B/cyc\n");
+#else
+  printf("Function  Size D/S Off     msec    KB/sec\n");
+#endif
+
+  for (op = 0; op < MEMPERF_NOPS; op++)
+    {
+      for (i = 0; i < MEMPERF_NSIZES; i++)
+        {
+          for (j = 0; j < MEMPERF_NALIGNS; j++)
+            {
+              /* memset has no source operand */
+
+              if (op == MEMPERF_MEMSET && g_aligns[j].soffset != 0 &&
+                  g_aligns[j].soffset != g_aligns[j].doffset)
+                {
+                  continue;
+                }
+
+              elapsed = memperf_measure(op, g_sizes[i], &g_aligns[j]);
+              memperf_report(op, g_sizes[i], &g_aligns[j], elapsed);
+            }
+        }
+    }
+
+  printf("\nmemperf: Done\n");
+  return 0;
+}
@@ -1,7 +1,7 @@
 /****************************************************************************
  * examples/nettest/nettest.h
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -82,6 +82,15 @@
 #  undef NETTEST_HAVE_SOLINGER
 #endif
 
+/* The number of idle connections that are established before the
+ * connection that carries the test data.  These exercise the look-up of the
+ * data connection when many connections are open.
+ */
+
+#ifndef CONFIG_EXAMPLE_NETTEST_NIDLE
+#  define CONFIG_EXAMPLE_NETTEST_NIDLE 0
+#endif
+
 #define PORTNO     5471
 #define SENDSIZE   4096
 
@@ -60,6 +60,10 @@ void send_client(void)
   char *inbuf;
 #endif
   int sockfd;
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  int idlefd[CONFIG_EXAMPLE_NETTEST_NIDLE];
+  int nidle;
+#endif
   int nbytessent;
 #ifndef CONFIG_EXAMPLE_NETTEST_PERFORMANCE
   int nbytesrecvd;
@@ -82,25 +86,52 @@ void send_client(void)
       exit(1);
     }
 
+  /* Set up the server address */
+
+  myaddr.sin_family      = AF_INET;
+  myaddr.sin_port        = HTONS(PORTNO);
+#if 0
+  myaddr.sin_addr.s_addr = HTONL(INADDR_LOOPBACK);
+#else
+  myaddr.sin_addr.s_addr = HTONL(CONFIG_EXAMPLE_NETTEST_CLIENTIP);
+#endif
+
+  /* Establish the idle connections (if any).  These are held open, but
+   * never used, so that the test data is sent while many connections exist.
+   */
+
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  for (nidle = 0; nidle < CONFIG_EXAMPLE_NETTEST_NIDLE; nidle++)
+    {
+      idlefd[nidle] = socket(PF_INET, SOCK_STREAM, 0);
+      if (idlefd[nidle] < 0)
+        {
+          message("client socket failure %d\n", errno);
+          goto errout_with_idlefd;
+        }
+
+      if (connect(idlefd[nidle], (struct sockaddr*)&myaddr, sizeof(struct sockaddr_in)) < 0)
+        {
+          message("client: connect failure: %d\n", errno);
+          close(idlefd[nidle]);
+          goto errout_with_idlefd;
+        }
+    }
+
+  message("client: Established %d idle connections\n", nidle);
+#endif
+
   /* Create a new TCP socket */
 
   sockfd = socket(PF_INET, SOCK_STREAM, 0);
   if (sockfd < 0)
     {
       message("client socket failure %d\n", errno);
-      goto errout_with_buffers;
+      goto errout_with_idlefd;
     }
 
   /* Connect the socket to the server */
 
-  myaddr.sin_family      = AF_INET;
-  myaddr.sin_port        = HTONS(PORTNO);
-#if 0
-  myaddr.sin_addr.s_addr = HTONL(INADDR_LOOPBACK);
-#else
-  myaddr.sin_addr.s_addr = HTONL(CONFIG_EXAMPLE_NETTEST_CLIENTIP);
-#endif
-
   message("client: Connecting...\n");
   if (connect( sockfd, (struct sockaddr*)&myaddr, sizeof(struct sockaddr_in)) < 0)
     {
@@ -138,7 +169,6 @@ void send_client(void)
                   nbytessent, SENDSIZE);
           goto errout_with_socket;
         }
-      message("Sent %d bytes\n", nbytessent);
     }
 #else
   /* Then send and receive one message */
@@ -191,6 +221,12 @@ void send_client(void)
     }
 
   close(sockfd);
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  while (nidle > 0)
+    {
+      close(idlefd[--nidle]);
+    }
+#endif
   free(outbuf);
 #ifndef CONFIG_EXAMPLE_NETTEST_PERFORMANCE
   free(inbuf);
@@ -201,7 +237,14 @@ void send_client(void)
 errout_with_socket:
   close(sockfd);
 
-errout_with_buffers:
+errout_with_idlefd:
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  while (nidle > 0)
+    {
+      close(idlefd[--nidle]);
+    }
+#endif
+
   free(outbuf);
 #ifndef CONFIG_EXAMPLE_NETTEST_PERFORMANCE
   free(inbuf);
@@ -41,6 +41,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+#include <sys/time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -61,9 +62,18 @@ void recv_server(void)
   char *buffer;
   int listensd;
   int acceptsd;
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  int idlesd[CONFIG_EXAMPLE_NETTEST_NIDLE];
+  int nidle;
+#endif
   socklen_t addrlen;
   int nbytesread;
-#ifndef CONFIG_EXAMPLE_NETTEST_PERFORMANCE
+#ifdef CONFIG_EXAMPLE_NETTEST_PERFORMANCE
+  struct timeval start;
+  struct timeval now;
+  unsigned long nbytes;
+  unsigned long msec;
+#else
   int totalbytesread;
   int nbytessent;
   int ch;
@@ -119,15 +129,35 @@ void recv_server(void)
       goto errout_with_listensd;
     }
 
-  /* Accept only one connection */
-
   message("server: Accepting connections on port %d\n", PORTNO);
+
+  /* Accept the idle connections (if any).  These are held open, but never
+   * used, so that the test data is received while many connections exist.
+   */
+
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  for (nidle = 0; nidle < CONFIG_EXAMPLE_NETTEST_NIDLE; nidle++)
+    {
+      addrlen = sizeof(struct sockaddr_in);
+      idlesd[nidle] = accept(listensd, (struct sockaddr*)&myaddr, &addrlen);
+      if (idlesd[nidle] < 0)
+        {
+          message("server: accept failure: %d\n", errno);
+          goto errout_with_idlesd;
+        }
+    }
+
+  message("server: Accepted %d idle connections\n", nidle);
+#endif
+
+  /* Then accept the one connection that will carry the data */
+
   addrlen = sizeof(struct sockaddr_in);
   acceptsd = accept(listensd, (struct sockaddr*)&myaddr, &addrlen);
   if (acceptsd < 0)
     {
       message("server: accept failure: %d\n", errno);
-      goto errout_with_listensd;
+      goto errout_with_idlesd;
     }
   message("server: Connection accepted -- receiving\n");
 
@@ -144,7 +174,12 @@ void recv_server(void)
 #endif
 
 #ifdef CONFIG_EXAMPLE_NETTEST_PERFORMANCE
-  /* Then receive data forever */
+  /* Then receive data forever, reporting the throughput about once per
+   * second.
+   */
+
+  nbytes = 0;
+  gettimeofday(&start, NULL);
 
   for (;;)
     {
@@ -159,7 +194,19 @@ void recv_server(void)
           message("server: The client broke the connection\n");
           goto errout_with_acceptsd;
         }
-      message("Received %d bytes\n", nbytesread);
+
+      nbytes += nbytesread;
+      gettimeofday(&now, NULL);
+      msec = (now.tv_sec - start.tv_sec) * 1000 +
+             (now.tv_usec - start.tv_usec) / 1000;
+
+      if (msec >= 1000)
+        {
+          message("Received %lu bytes in %lu msec: %lu KB/sec\n",
+                  nbytes, msec, (nbytes / 1024) * 1000 / msec);
+          nbytes = 0;
+          start  = now;
+        }
     }
 #else
   /* Receive canned message */
@@ -229,6 +276,12 @@ void recv_server(void)
 
   close(listensd);
   close(acceptsd);
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  while (nidle > 0)
+    {
+      close(idlesd[--nidle]);
+    }
+#endif
   free(buffer);
   return;
 #endif
@@ -236,6 +289,14 @@ void recv_server(void)
 errout_with_acceptsd:
   close(acceptsd);
 
+errout_with_idlesd:
+#if CONFIG_EXAMPLE_NETTEST_NIDLE > 0
+  while (nidle > 0)
+    {
+      close(idlesd[--nidle]);
+    }
+#endif
+
 errout_with_listensd:
   close(listensd);
 
@@ -40,6 +40,8 @@
 #include <nuttx/config.h>
 
 #include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
 
 #include <stdint.h>
 #include <stdio.h>
@@ -52,6 +54,7 @@
 #include <crc32.h>
 #include <debug.h>
 
+#include <nuttx/ioctl.h>
 #include <nuttx/mtd.h>
 #include <nuttx/nxffs.h>
 
@@ -119,6 +122,10 @@
 #  define CONFIG_EXAMPLES_NXFFS_VERBOSE 0
 #endif
 
+/* A packing pass should never need more steps than this */
+
+#define NXFFS_MAXPACKSTEPS 1024
+
 #if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_FS)
 #  define message    lib_rawprintf
 #  define msgflush()
@@ -139,6 +146,18 @@ struct nxffs_filedesc_s
   uint32_t crc;
 };
 
+/* Every MTD block read is counted so that the cost of finding files on the
+ * FLASH can be compared with and without CONFIG_NXFFS_NINDEX.
+ */
+
+struct nxffs_mtdcount_s
+{
+  struct mtd_dev_s mtd;          /* Must be first: The counting MTD interface */
+  FAR struct mtd_dev_s *lower;   /* The MTD driver that does the real work */
+  uint32_t nreads;               /* Number of read requests */
+  uint32_t nblocks;              /* Number of blocks read */
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -153,6 +172,7 @@ static struct nxffs_filedesc_s g_files[CONFIG_EXAMPLES_NXFFS_MAXOPEN];
 static const char g_mountdir[] = CONFIG_EXAMPLES_NXFFS_MOUNTPT "/";
 static int g_nfiles;
 static int g_ndeleted;
+static struct nxffs_mtdcount_s g_mtdcount;
 
 static struct mallinfo g_mmbefore;
 static struct mallinfo g_mmprevious;
@@ -229,6 +249,75 @@ static void nxffs_endmemusage(void)
       nxffs_showmemusage(&g_mmbefore, &g_mmafter);
 }
 
+/****************************************************************************
+ * Name: nxffs_cnterase, nxffs_cntbread, nxffs_cntbwrite, nxffs_cntread, and
+ *   nxffs_cntioctl
+ *
+ * Description:
+ *   The counting MTD methods.  Each simply counts the reads and passes the
+ *   request on to the lower MTD driver.
+ *
+ ****************************************************************************/
+
+static int nxffs_cnterase(FAR struct mtd_dev_s *dev, off_t startblock,
+                          size_t nblocks)
+{
+  FAR struct nxffs_mtdcount_s *priv = (FAR struct nxffs_mtdcount_s *)dev;
+  return priv->lower->erase(priv->lower, startblock, nblocks);
+}
+
+static ssize_t nxffs_cntbread(FAR struct mtd_dev_s *dev, off_t startblock,
+                              size_t nblocks, FAR uint8_t *buffer)
+{
+  FAR struct nxffs_mtdcount_s *priv = (FAR struct nxffs_mtdcount_s *)dev;
+
+  priv->nreads++;
+  priv->nblocks += nblocks;
+  return priv->lower->bread(priv->lower, startblock, nblocks, buffer);
+}
+
+static ssize_t nxffs_cntbwrite(FAR struct mtd_dev_s *dev, off_t startblock,
+                               size_t nblocks, FAR const uint8_t *buffer)
+{
+  FAR struct nxffs_mtdcount_s *priv = (FAR struct nxffs_mtdcount_s *)dev;
+  return priv->lower->bwrite(priv->lower, startblock, nblocks, buffer);
+}
+
+static ssize_t nxffs_cntread(FAR struct mtd_dev_s *dev, off_t offset,
+                             size_t nbytes, FAR uint8_t *buffer)
+{
+  FAR struct nxffs_mtdcount_s *priv = (FAR struct nxffs_mtdcount_s *)dev;
+
+  priv->nreads++;
+  return priv->lower->read(priv->lower, offset, nbytes, buffer);
+}
+
+static int nxffs_cntioctl(FAR struct mtd_dev_s *dev, int cmd,
+                          unsigned long arg)
+{
+  FAR struct nxffs_mtdcount_s *priv = (FAR struct nxffs_mtdcount_s *)dev;
+  return priv->lower->ioctl(priv->lower, cmd, arg);
+}
+
+/****************************************************************************
+ * Name: nxffs_cntinitialize
+ *
+ * Description:
+ *   Put the counting MTD interface in front of the real MTD driver.
+ *
+ ****************************************************************************/
+
+static FAR struct mtd_dev_s *nxffs_cntinitialize(FAR struct mtd_dev_s *lower)
+{
+  g_mtdcount.mtd.erase  = nxffs_cnterase;
+  g_mtdcount.mtd.bread  = nxffs_cntbread;
+  g_mtdcount.mtd.bwrite = nxffs_cntbwrite;
+  g_mtdcount.mtd.read   = lower->read ? nxffs_cntread : NULL;
+  g_mtdcount.mtd.ioctl  = nxffs_cntioctl;
+  g_mtdcount.lower      = lower;
+  return &g_mtdcount.mtd;
+}
+
 /****************************************************************************
  * Name: nxffs_randchar
  ****************************************************************************/
@@ -630,6 +719,56 @@ static int nxffs_verifyfs(void)
   return OK;
 }
 
+/****************************************************************************
+ * Name: nxffs_lookups
+ *
+ * Description:
+ *   stat() each of the remaining files and report the number of MTD block
+ *   reads needed to find them.  Run the test once with CONFIG_NXFFS_NINDEX=0
+ *   and once with CONFIG_NXFFS_NINDEX non-zero to compare the two.
+ *
+ ****************************************************************************/
+
+static void nxffs_lookups(void)
+{
+  FAR struct nxffs_filedesc_s *file;
+  struct stat buf;
+  uint32_t nreads;
+  uint32_t nblocks;
+  int nfiles;
+  int i;
+
+  nreads  = g_mtdcount.nreads;
+  nblocks = g_mtdcount.nblocks;
+  nfiles  = 0;
+
+  for (i = 0; i < CONFIG_EXAMPLES_NXFFS_MAXOPEN; i++)
+    {
+      file = &g_files[i];
+      if (file->name != NULL && !file->deleted)
+        {
+          if (stat(file->name, &buf) < 0)
+            {
+              message("ERROR: stat failed: %d\n", errno);
+              message("  File name: %s\n", file->name);
+            }
+          nfiles++;
+        }
+    }
+
+  nreads  = g_mtdcount.nreads - nreads;
+  nblocks = g_mtdcount.nblocks - nblocks;
+
+  message("Looked up %d files (CONFIG_NXFFS_NINDEX=%d)\n",
+          nfiles, CONFIG_NXFFS_NINDEX);
+  message("  Read requests:   %lu\n", (unsigned long)nreads);
+  message("  Blocks read:     %lu\n", (unsigned long)nblocks);
+  if (nfiles > 0)
+    {
+      message("  Blocks per file: %lu\n", (unsigned long)(nblocks / nfiles));
+    }
+}
+
 /****************************************************************************
  * Name: nxffs_delfiles
  ****************************************************************************/
@@ -701,6 +840,224 @@ static int nxffs_delfiles(void)
   return OK;
 }
 
+/****************************************************************************
+ * Name: nxffs_showpackstatus
+ ****************************************************************************/
+
+static void nxffs_showpackstatus(FAR struct nxffs_packstatus_s *status)
+{
+  message("  Pack state:      %d\n", status->ps_state);
+  message("  Packed offset:   %ld\n", (long)status->ps_offset);
+  message("  Free offset:     %ld\n", (long)status->ps_froffset);
+  message("  Volume size:     %ld\n", (long)status->ps_size);
+  message("  Packing steps:   %lu\n", (unsigned long)status->ps_nsteps);
+  message("  Packing passes:  %lu\n", (unsigned long)status->ps_npasses);
+}
+
+/****************************************************************************
+ * Name: nxffs_packsteps
+ *
+ * Description:
+ *   Perform incremental packing steps with the FIOC_PACKSTEP ioctl until
+ *   the packing pass completes.  Returns OK when the pass completes or a
+ *   negated errno value if a step fails.  -EBUSY means that nothing more
+ *   can be done until the file open for writing is closed.
+ *
+ ****************************************************************************/
+
+static int nxffs_packsteps(int fd, FAR struct nxffs_packstatus_s *status,
+                           FAR int *nsteps)
+{
+  int ret;
+
+  *nsteps = 0;
+  do
+    {
+      ret = ioctl(fd, FIOC_PACKSTEP, (unsigned long)((uintptr_t)status));
+      if (ret < 0)
+        {
+          return -errno;
+        }
+
+      (*nsteps)++;
+    }
+  while (status->ps_state != NXFFS_PACK_IDLE &&
+         *nsteps < NXFFS_MAXPACKSTEPS);
+
+  return status->ps_state == NXFFS_PACK_IDLE ? OK : -ETIMEDOUT;
+}
+
+/****************************************************************************
+ * Name: nxffs_packtest
+ *
+ * Description:
+ *   Exercise the FIOC_PACKSTEP and FIOC_PACKSTATUS ioctl commands.  First,
+ *   the space left by the deleted files is recovered one step at a time.
+ *   Then a new file is created and packing steps are performed while the
+ *   file is still open for writing.  The files are verified afterward.
+ *
+ ****************************************************************************/
+
+static int nxffs_packtest(void)
+{
+  FAR struct nxffs_filedesc_s *file;
+  struct nxffs_packstatus_s status;
+  off_t froffset;
+  size_t half;
+  ssize_t nbyteswritten;
+  int errcode;
+  int nsteps;
+  int fd;
+  int ret;
+  int i;
+
+  /* The ioctl commands require a file open on the volume */
+
+  for (i = 0; i < CONFIG_EXAMPLES_NXFFS_MAXOPEN; i++)
+    {
+      file = &g_files[i];
+      if (file->name != NULL && !file->deleted)
+        {
+          break;
+        }
+    }
+
+  if (i < CONFIG_EXAMPLES_NXFFS_MAXOPEN)
+    {
+      fd = open(file->name, O_RDONLY);
+      if (fd < 0)
+        {
+          message("ERROR: Failed to open file for reading: %d\n", errno);
+          message("  File name: %s\n", file->name);
+          return ERROR;
+        }
+
+      ret = ioctl(fd, FIOC_PACKSTATUS, (unsigned long)((uintptr_t)&status));
+      if (ret < 0)
+        {
+          message("ERROR: FIOC_PACKSTATUS failed: %d\n", errno);
+          close(fd);
+          return ERROR;
+        }
+
+      froffset = status.ps_froffset;
+
+      ret = nxffs_packsteps(fd, &status, &nsteps);
+      close(fd);
+
+      if (ret < 0)
+        {
+          message("ERROR: FIOC_PACKSTEP failed: %d\n", -ret);
+          nxffs_showpackstatus(&status);
+          return ERROR;
+        }
+
+      message("Packed in %d steps\n", nsteps);
+      message("  Recovered:       %ld\n", (long)(froffset - status.ps_froffset));
+      nxffs_showpackstatus(&status);
+    }
+
+  /* Now create a new file, but write only the first half of it */
+
+  for (i = 0; i < CONFIG_EXAMPLES_NXFFS_MAXOPEN; i++)
+    {
+      file = &g_files[i];
+      if (file->name == NULL)
+        {
+          break;
+        }
+    }
+
+  if (i >= CONFIG_EXAMPLES_NXFFS_MAXOPEN)
+    {
+      return OK;
+    }
+
+  nxffs_randname(file);
+  nxffs_randfile(file);
+
+  fd = open(file->name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0)
+    {
+      /* The volume may be full */
+
+      errcode = errno;
+      if (errcode != ENOSPC)
+        {
+          message("ERROR: Failed to open file for writing: %d\n", errcode);
+          message("  File name: %s\n", file->name);
+        }
+
+      nxffs_freefile(file);
+      return errcode == ENOSPC ? OK : ERROR;
+    }
+
+  half = file->len >> 1;
+  nbyteswritten = write(fd, g_fileimage, half);
+  if (nbyteswritten != half)
+    {
+      goto errout_with_fd;
+    }
+
+  /* Pack while the file is open.  The inodes in front of the new file can
+   * be moved, but the pass cannot complete until the file is closed.
+   */
+
+  ret = nxffs_packsteps(fd, &status, &nsteps);
+  if (ret < 0 && ret != -EBUSY)
+    {
+      message("ERROR: FIOC_PACKSTEP failed with a writer: %d\n", -ret);
+      nxffs_showpackstatus(&status);
+      close(fd);
+      (void)unlink(file->name);
+      nxffs_freefile(file);
+      return ERROR;
+    }
+
+  message("Packed with a writer in %d steps: %s\n", nsteps,
+          ret == -EBUSY ? "Waiting for the writer" : "Complete");
+  nxffs_showpackstatus(&status);
+
+  /* Then write the rest of the file and close it */
+
+  nbyteswritten = write(fd, &g_fileimage[half], file->len - half);
+  if (nbyteswritten != file->len - half)
+    {
+      goto errout_with_fd;
+    }
+
+  close(fd);
+  g_nfiles++;
+  return OK;
+
+errout_with_fd:
+  errcode = errno;
+  close(fd);
+
+  /* The write may fail if the volume is full.  Remove any partial file. */
+
+  if (nbyteswritten >= 0)
+    {
+      message("ERROR: Partial write: %d\n", nbyteswritten);
+      message("  File name: %s\n", file->name);
+      ret = ERROR;
+    }
+  else if (errcode != ENOSPC)
+    {
+      message("ERROR: Failed to write file: %d\n", errcode);
+      message("  File name: %s\n", file->name);
+      ret = ERROR;
+    }
+  else
+    {
+      ret = OK;
+    }
+
+  (void)unlink(file->name);
+  nxffs_freefile(file);
+  return ret;
+}
+
 /****************************************************************************
  * Name: nxffs_delallfiles
  ****************************************************************************/
@@ -816,7 +1173,13 @@ int user_start(int argc, char *argv[])
       exit(1);
     }
 
-  /* Initialize to provide NXFFS on an MTD interface */
+  /* Count the block reads made by NXFFS */
+
+  mtd = nxffs_cntinitialize(mtd);
+
+  /* Initialize to provide NXFFS on an MTD interface.  This includes the
+   * mount-time scan of the FLASH (which also fills the RAM inode index).
+   */
 
   ret = nxffs_initialize(mtd);
   if (ret < 0)
@@ -826,6 +1189,10 @@ int user_start(int argc, char *argv[])
       exit(2);
     }
 
+  message("Mounted (CONFIG_NXFFS_NINDEX=%d)\n", CONFIG_NXFFS_NINDEX);
+  message("  Read requests:   %lu\n", (unsigned long)g_mtdcount.nreads);
+  message("  Blocks read:     %lu\n", (unsigned long)g_mtdcount.nblocks);
+
   /* Mount the file system */
 
   ret = mount(NULL, CONFIG_EXAMPLES_NXFFS_MOUNTPT, "nxffs", 0, NULL);
@@ -891,6 +1258,10 @@ int user_start(int argc, char *argv[])
 #endif
         }
 
+      /* Measure the cost of finding each file on the FLASH */
+
+      nxffs_lookups();
+
       /* Delete some files */
 
       message("\n=== DELETING %d ============================\n", i);
@@ -913,6 +1284,16 @@ int user_start(int argc, char *argv[])
 
       nxffs_directory();
 
+      /* Recover the deleted space with incremental packing steps */
+
+      message("\n=== PACKING %d =============================\n", i);
+      ret = nxffs_packtest();
+      if (ret < 0)
+        {
+          message("ERROR: Incremental packing failed\n");
+        }
+      nxffs_dump(mtd, CONFIG_EXAMPLES_NXFFS_VERBOSE);
+
       /* Verify all files written to FLASH */
 
       ret = nxffs_verifyfs();
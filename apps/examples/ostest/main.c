@@ -409,6 +409,17 @@ static int user_main(int argc, char *argv[])
       check_test_memory_usage();
 #endif /* CONFIG_PRIORITY_INHERITANCE && !CONFIG_DISABLE_SIGNALS && !CONFIG_DISABLE_PTHREAD */
 
+#if !defined(CONFIG_DISABLE_SIGNALS) && !defined(CONFIG_DISABLE_CLOCK) && \
+    !defined(CONFIG_NUTTX_KERNEL)
+      /* Verify watchdog timers and measure their cost.  The watchdog
+       * interfaces are not available to applications in the kernel build.
+       */
+
+      printf("\nuser_main: watchdog timer test\n");
+      wdog_test();
+      check_test_memory_usage();
+#endif
+
       /* Compare memory usage at time user_start started until
        * user_main exits.  These should not be identical, but should
        * be similar enough that we can detect any serious OS memory
@@ -163,6 +163,10 @@ extern void barrier_test(void);
 
 extern void priority_inheritance(void);
 
+/* wdog.c *******************************************************************/
+
+extern void wdog_test(void);
+
 /* APIs exported (conditionally) by the OS specifically for testing of
  * priority inheritance
  */
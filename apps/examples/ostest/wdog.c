@@ -0,0 +1,313 @@
+/****************************************************************************
+ * examples/ostest/wdog.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <wdog.h>
+
+#include "ostest.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/* The benchmark arms up to CONFIG_EXAMPLES_OSTEST_NWDOGS watchdogs (or as
+ * many as can be created from the pool of CONFIG_PREALLOC_WDOGS).  Then,
+ * for 1, 2, 4, ... of those watchdogs active, it counts how many times one
+ * more watchdog can be armed and cancelled in
+ * CONFIG_EXAMPLES_OSTEST_WDOG_TICKS ticks of the system clock.  A single
+ * pair takes much less than one tick, so the pairs are counted over many
+ * ticks rather than timed one by one.
+ */
+
+#ifndef CONFIG_EXAMPLES_OSTEST_NWDOGS
+#  define CONFIG_EXAMPLES_OSTEST_NWDOGS 64
+#endif
+
+#ifndef CONFIG_EXAMPLES_OSTEST_WDOG_TICKS
+#  define CONFIG_EXAMPLES_OSTEST_WDOG_TICKS 20
+#endif
+
+/* The clock is checked after each batch of this many pairs */
+
+#define WDOG_BATCH      16
+
+/* The background watchdogs are given long, distinct delays so that none of
+ * them expire during the test.  The delay of the watchdog being measured
+ * falls in the middle of them so that an ordered list has to be traversed
+ * half way.
+ */
+
+#define WDOG_LONGDELAY  0x10000
+#define WDOG_DELAYSTEP  37
+
+/* Number of watchdogs used in the functional check */
+
+#define WDOG_NCHECK     8
+
+/* If the pool of watchdogs is exhausted, then this many are given back so
+ * that the OS (usleep(), for example) still has watchdogs to use.
+ */
+
+#define WDOG_NRESERVE   4
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static WDOG_ID g_wdogs[CONFIG_EXAMPLES_OSTEST_NWDOGS + 1];
+static volatile int g_nexpired;
+static volatile int g_order[WDOG_NCHECK];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void wdog_expired(int argc, uint32_t arg1)
+{
+  if (g_nexpired < WDOG_NCHECK)
+    {
+      g_order[g_nexpired] = (int)arg1;
+    }
+
+  g_nexpired++;
+}
+
+static void wdog_check(int nwdogs)
+{
+  int ncheck = nwdogs < WDOG_NCHECK ? nwdogs : WDOG_NCHECK;
+  int remaining;
+  int i;
+
+  /* Start the watchdogs so that they expire in the reverse of the order in
+   * which they were started.
+   */
+
+  g_nexpired = 0;
+  for (i = 0; i < ncheck; i++)
+    {
+      (void)wd_start(g_wdogs[i], 2 * (ncheck - i), (wdentry_t)wdog_expired,
+                     1, (uint32_t)i);
+    }
+
+  remaining = wd_gettime(g_wdogs[0]);
+  if (remaining < 1 || remaining > 2 * ncheck)
+    {
+      printf("wdog_test: ERROR wd_gettime returned %d, expected 1-%d\n",
+             remaining, 2 * ncheck);
+    }
+
+  /* Wait for all of them to expire */
+
+  usleep((2 * ncheck + 2) * 1000000L / CLK_TCK);
+
+  if (g_nexpired != ncheck)
+    {
+      printf("wdog_test: ERROR %d of %d watchdogs expired\n",
+             g_nexpired, ncheck);
+      for (i = 0; i < ncheck; i++)
+        {
+          (void)wd_cancel(g_wdogs[i]);
+        }
+    }
+  else
+    {
+      for (i = 0; i < ncheck; i++)
+        {
+          if (g_order[i] != ncheck - 1 - i)
+            {
+              printf("wdog_test: ERROR expiration %d was watchdog %d, "
+                     "expected %d\n", i, g_order[i], ncheck - 1 - i);
+            }
+        }
+    }
+
+  /* A cancelled watchdog must not expire */
+
+  g_nexpired = 0;
+  (void)wd_start(g_wdogs[0], 2, (wdentry_t)wdog_expired, 1, (uint32_t)0);
+  (void)wd_cancel(g_wdogs[0]);
+  usleep(4 * 1000000L / CLK_TCK);
+
+  if (g_nexpired != 0)
+    {
+      printf("wdog_test: ERROR cancelled watchdog expired\n");
+    }
+}
+
+static uint32_t wdog_elapsed(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  (void)clock_gettime(CLOCK_REALTIME, &now);
+  return (uint32_t)(now.tv_sec - start->tv_sec) * 1000000 +
+         (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void wdog_benchmark(int nwdogs)
+{
+  struct timespec res;
+  struct timespec tick;
+  struct timespec start;
+  WDOG_ID probe = g_wdogs[nwdogs];
+  uint32_t resolution;
+  uint32_t duration;
+  uint32_t elapsed;
+  uint32_t npairs;
+  int nactive;
+  int delay;
+  int i;
+
+  /* Get the resolution of the clock in microseconds */
+
+  (void)clock_getres(CLOCK_REALTIME, &res);
+  resolution = res.tv_sec * 1000000 + res.tv_nsec / 1000;
+  if (resolution < 1)
+    {
+      resolution = 1;
+    }
+
+  duration = CONFIG_EXAMPLES_OSTEST_WDOG_TICKS * resolution;
+  printf("wdog_test: Clock resolution %lu usec, counting for %lu usec\n",
+         (unsigned long)resolution, (unsigned long)duration);
+
+  for (nactive = 1; nactive <= nwdogs; nactive <<= 1)
+    {
+      /* Arm the background watchdogs */
+
+      for (i = 0; i < nactive; i++)
+        {
+          (void)wd_start(g_wdogs[i], WDOG_LONGDELAY + i * WDOG_DELAYSTEP,
+                         (wdentry_t)wdog_expired, 1, (uint32_t)i);
+        }
+
+      /* Then time arming and cancelling one more */
+
+      delay = WDOG_LONGDELAY + (nactive / 2) * WDOG_DELAYSTEP + 1;
+
+      /* Start counting on a clock tick */
+
+      (void)clock_gettime(CLOCK_REALTIME, &tick);
+      do
+        {
+          (void)clock_gettime(CLOCK_REALTIME, &start);
+        }
+      while (start.tv_sec == tick.tv_sec && start.tv_nsec == tick.tv_nsec);
+
+      npairs = 0;
+      do
+        {
+          for (i = 0; i < WDOG_BATCH; i++)
+            {
+              (void)wd_start(probe, delay, (wdentry_t)wdog_expired, 1,
+                             (uint32_t)nwdogs);
+              (void)wd_cancel(probe);
+            }
+
+          npairs += WDOG_BATCH;
+          elapsed = wdog_elapsed(&start);
+        }
+      while (elapsed < duration);
+
+      printf("wdog_test: %4d active: %7lu wd_start/wd_cancel in %lu usec "
+             "(%lu nsec each)\n",
+             nactive, (unsigned long)npairs, (unsigned long)elapsed,
+             (unsigned long)((uint64_t)elapsed * 1000 / npairs));
+
+      for (i = 0; i < nactive; i++)
+        {
+          (void)wd_cancel(g_wdogs[i]);
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void wdog_test(void)
+{
+  int nwdogs;
+  int i;
+
+  /* Create as many watchdogs as we can, keeping the last one for the
+   * watchdog being measured.
+   */
+
+  for (nwdogs = 0; nwdogs <= CONFIG_EXAMPLES_OSTEST_NWDOGS; nwdogs++)
+    {
+      g_wdogs[nwdogs] = wd_create();
+      if (!g_wdogs[nwdogs])
+        {
+          break;
+        }
+    }
+
+  if (nwdogs <= CONFIG_EXAMPLES_OSTEST_NWDOGS)
+    {
+      for (i = 0; i < WDOG_NRESERVE && nwdogs > 0; i++)
+        {
+          (void)wd_delete(g_wdogs[--nwdogs]);
+        }
+    }
+
+  if (nwdogs < 2)
+    {
+      printf("wdog_test: ERROR could only create %d watchdogs\n", nwdogs);
+      goto errout;
+    }
+
+  nwdogs--;
+  printf("wdog_test: Created %d watchdogs\n", nwdogs + 1);
+
+  wdog_check(nwdogs);
+  wdog_benchmark(nwdogs);
+
+  nwdogs++;
+
+errout:
+  for (i = 0; i < nwdogs; i++)
+    {
+      (void)wd_delete(g_wdogs[i]);
+    }
+
+  printf("wdog_test: Done\n");
+}
@@ -0,0 +1,512 @@
+/****************************************************************************
+ * examples/rwbperf/rwbperf_main.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+
+#include <nuttx/fs.h>
+#include <nuttx/ioctl.h>
+#include <nuttx/mtd.h>
+#include <nuttx/rwbuffer.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_EXAMPLES_RWBPERF_DEVPATH - The block driver to be measured (such
+ *   as /dev/mmcsd0).  If this is not defined, then an FTL is created on a
+ *   RAM MTD device and registered as /dev/mtdblockN.
+ * CONFIG_EXAMPLES_RWBPERF_MINOR - The FTL minor number N.  Default 0
+ * CONFIG_EXAMPLES_RWBPERF_NEBLOCKS - The number of erase blocks in the RAM
+ *   MTD device.  Default 64
+ * CONFIG_EXAMPLES_RWBPERF_NBLOCKS - The number of blocks covered by the
+ *   sequential tests.  Default 256
+ * CONFIG_EXAMPLES_RWBPERF_NRANDOM - The number of random reads.  Default
+ *   256
+ * CONFIG_EXAMPLES_RWBPERF_WRITE - Also run the write test on the block
+ *   driver named by CONFIG_EXAMPLES_RWBPERF_DEVPATH.  This destroys the
+ *   data on the media!  The write test is always run on the RAM device.
+ */
+
+#if !defined(CONFIG_FS_READAHEAD) && !defined(CONFIG_FS_WRITEBUFFER)
+#  error "This test requires CONFIG_FS_READAHEAD or CONFIG_FS_WRITEBUFFER"
+#endif
+
+#if !defined(CONFIG_EXAMPLES_RWBPERF_DEVPATH) && \
+     defined(CONFIG_FTL_WEARLEVEL) && !defined(CONFIG_FTL_FORMAT)
+#  error "The wear-levelling FTL needs CONFIG_FTL_FORMAT to format the RAM FLASH"
+#endif
+
+/* This must exactly match the default configuration in drivers/mtd/rammtd.c */
+
+#ifndef CONFIG_RAMMTD_BLOCKSIZE
+#  define CONFIG_RAMMTD_BLOCKSIZE 512
+#endif
+
+#ifndef CONFIG_RAMMTD_ERASESIZE
+#  define CONFIG_RAMMTD_ERASESIZE 4096
+#endif
+
+#ifndef CONFIG_EXAMPLES_RWBPERF_MINOR
+#  define CONFIG_EXAMPLES_RWBPERF_MINOR 0
+#endif
+
+#ifndef CONFIG_EXAMPLES_RWBPERF_NEBLOCKS
+#  define CONFIG_EXAMPLES_RWBPERF_NEBLOCKS 64
+#endif
+
+#ifndef CONFIG_EXAMPLES_RWBPERF_NBLOCKS
+#  define CONFIG_EXAMPLES_RWBPERF_NBLOCKS 256
+#endif
+
+#ifndef CONFIG_EXAMPLES_RWBPERF_NRANDOM
+#  define CONFIG_EXAMPLES_RWBPERF_NRANDOM 256
+#endif
+
+/* This must match the default in drivers/rwbuffer.c */
+
+#ifndef CONFIG_FS_WRDELAY
+#  define CONFIG_FS_WRDELAY 350
+#endif
+
+/* The write test destroys the data on the media */
+
+#if defined(CONFIG_FS_WRITABLE) && \
+    (!defined(CONFIG_EXAMPLES_RWBPERF_DEVPATH) || \
+     defined(CONFIG_EXAMPLES_RWBPERF_WRITE))
+#  define RWBPERF_WRITETEST 1
+#endif
+
+#define RWBPERF_STR(x)  #x
+#define RWBPERF_XSTR(x) RWBPERF_STR(x)
+
+#ifdef CONFIG_EXAMPLES_RWBPERF_DEVPATH
+#  define RWBPERF_DEVPATH CONFIG_EXAMPLES_RWBPERF_DEVPATH
+#else
+#  define RWBPERF_DEVPATH "/dev/mtdblock" RWBPERF_XSTR(CONFIG_EXAMPLES_RWBPERF_MINOR)
+#  define RWBPERF_FLASHSIZE \
+     (CONFIG_RAMMTD_ERASESIZE * CONFIG_EXAMPLES_RWBPERF_NEBLOCKS)
+#endif
+
+/* The interleaved test reads one of the first few blocks (as a file system
+ * would read its FAT or directory sectors) after every few blocks of the
+ * sequential stream.
+ */
+
+#define RWBPERF_NMETA   4
+#define RWBPERF_STRIDE  4
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifndef CONFIG_EXAMPLES_RWBPERF_DEVPATH
+/* The simulated FLASH */
+
+static uint8_t g_simflash[RWBPERF_FLASHSIZE];
+#endif
+
+/* One block of data */
+
+static FAR uint8_t *g_block;
+static size_t g_blocksize;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: rwbperf_getstats
+ *
+ * Description:
+ *   Get the read-ahead/write buffer statistics of the block driver.
+ *
+ ****************************************************************************/
+
+static int rwbperf_getstats(FAR struct inode *inode,
+                            FAR struct rwb_stats_s *stats)
+{
+  int ret;
+
+  ret = inode->u.i_bops->ioctl(inode, BIOC_RWBSTATS,
+                               (unsigned long)((uintptr_t)stats));
+  if (ret < 0)
+    {
+      printf("rwbperf: BIOC_RWBSTATS failed: %d\n", ret);
+      memset(stats, 0, sizeof(struct rwb_stats_s));
+      return ret;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rwbperf_read
+ ****************************************************************************/
+
+static int rwbperf_read(FAR struct inode *inode, size_t block)
+{
+  ssize_t nxfrd;
+
+  nxfrd = inode->u.i_bops->read(inode, g_block, block, 1);
+  if (nxfrd != 1)
+    {
+      printf("rwbperf: Read block %lu failed: %ld\n",
+             (unsigned long)block, (long)nxfrd);
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rwbperf_seqread
+ *
+ * Description:
+ *   Read the blocks one at a time from the beginning of the media.
+ *
+ ****************************************************************************/
+
+static int rwbperf_seqread(FAR struct inode *inode, size_t nblocks)
+{
+  size_t block;
+
+  for (block = 0; block < nblocks; block++)
+    {
+      if (rwbperf_read(inode, block) < 0)
+        {
+          return ERROR;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rwbperf_interleaved
+ *
+ * Description:
+ *   Read a sequential stream of blocks interrupted by reads of the first
+ *   few blocks of the media.  Each interruption is a miss, but it should
+ *   not cause the stream to lose its read-ahead window.
+ *
+ ****************************************************************************/
+
+static int rwbperf_interleaved(FAR struct inode *inode, size_t nblocks)
+{
+  size_t block;
+
+  for (block = 0; block < nblocks; block++)
+    {
+      if ((block % RWBPERF_STRIDE) == 0 &&
+          rwbperf_read(inode, (block / RWBPERF_STRIDE) % RWBPERF_NMETA) < 0)
+        {
+          return ERROR;
+        }
+
+      if (rwbperf_read(inode, nblocks + block) < 0)
+        {
+          return ERROR;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rwbperf_random
+ *
+ * Description:
+ *   Read blocks at random.  Nothing should be read ahead.
+ *
+ ****************************************************************************/
+
+static int rwbperf_random(FAR struct inode *inode, size_t nblocks)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_EXAMPLES_RWBPERF_NRANDOM; i++)
+    {
+      if (rwbperf_read(inode, rand() % nblocks) < 0)
+        {
+          return ERROR;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rwbperf_seqwrite
+ *
+ * Description:
+ *   Write the blocks one at a time from the beginning of the media, each
+ *   block twice.  The second write of each block and the sequential blocks
+ *   should be merged into the write buffer.
+ *
+ ****************************************************************************/
+
+#ifdef RWBPERF_WRITETEST
+static int rwbperf_seqwrite(FAR struct inode *inode, size_t nblocks)
+{
+  size_t block;
+  ssize_t nxfrd;
+  int ret = OK;
+  int i;
+
+  for (block = 0; block < nblocks && ret == OK; block++)
+    {
+      for (i = 0; i < 2; i++)
+        {
+          memset(g_block, (int)(block + i), g_blocksize);
+          nxfrd = inode->u.i_bops->write(inode, g_block, block, 1);
+          if (nxfrd != 1)
+            {
+              printf("rwbperf: Write block %lu failed: %ld\n",
+                     (unsigned long)block, (long)nxfrd);
+              ret = ERROR;
+              break;
+            }
+        }
+    }
+
+#ifdef CONFIG_FS_WRITEBUFFER
+  /* The block driver cannot be flushed;  wait until the write buffer is
+   * written to the media.
+   */
+
+  usleep((CONFIG_FS_WRDELAY + 100) * 1000);
+#endif
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: rwbperf_run
+ *
+ * Description:
+ *   Run one test and report the elapsed time and the change in the buffer
+ *   statistics during the test.  The hit rate is the percentage of the
+ *   blocks read by the test that were returned from the read-ahead buffer.
+ *
+ ****************************************************************************/
+
+static int rwbperf_run(FAR struct inode *inode, FAR const char *what,
+                       int (*test)(FAR struct inode *inode, size_t nblocks),
+                       size_t nblocks)
+{
+  struct rwb_stats_s before;
+  struct rwb_stats_s after;
+  struct timespec start;
+  struct timespec end;
+  uint32_t elapsed;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t rate = 0;
+  int ret;
+
+  (void)rwbperf_getstats(inode, &before);
+  (void)clock_gettime(CLOCK_REALTIME, &start);
+
+  ret = test(inode, nblocks);
+
+  (void)clock_gettime(CLOCK_REALTIME, &end);
+  (void)rwbperf_getstats(inode, &after);
+
+  elapsed = (uint32_t)(end.tv_sec - start.tv_sec) * 1000 +
+            (end.tv_nsec - start.tv_nsec) / 1000000;
+
+  hits   = after.st_rhhits   - before.st_rhhits;
+  misses = after.st_rhmisses - before.st_rhmisses;
+  if (hits + misses > 0)
+    {
+      rate = (hits * 100) / (hits + misses);
+    }
+
+  printf("%-8s %6lu %6lu %6lu %4lu%% %6lu %6lu %6lu %6lu %6lu\n", what,
+         (unsigned long)elapsed, (unsigned long)hits, (unsigned long)misses,
+         (unsigned long)rate,
+         (unsigned long)(after.st_rhahead    - before.st_rhahead),
+         (unsigned long)(after.st_rhasync    - before.st_rhasync),
+         (unsigned long)(after.st_wrblocks   - before.st_wrblocks),
+         (unsigned long)(after.st_wrcoalesced - before.st_wrcoalesced),
+         (unsigned long)(after.st_wrflushes  - before.st_wrflushes));
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: rwbperf_main/user_start
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_RWBPERF_BUILTIN
+#  define MAIN_NAME rwbperf_main
+#else
+#  define MAIN_NAME user_start
+#endif
+
+int MAIN_NAME(int argc, char *argv[])
+{
+  FAR struct inode *inode;
+  struct rwb_stats_s stats;
+  struct geometry geo;
+  size_t nblocks;
+  int ret;
+
+#ifndef CONFIG_EXAMPLES_RWBPERF_DEVPATH
+  {
+    FAR struct mtd_dev_s *mtd;
+
+    /* Create an FTL on a RAM MTD device.  drivers/ramdisk.c does not use
+     * the read-ahead/write buffer;  the FTL does when CONFIG_FS_READAHEAD
+     * or CONFIG_FS_WRITEBUFFER is selected.
+     */
+
+    memset(g_simflash, 0xff, RWBPERF_FLASHSIZE);
+    mtd = rammtd_initialize(g_simflash, RWBPERF_FLASHSIZE);
+    if (!mtd)
+      {
+        printf("rwbperf: Failed to create the RAM MTD instance\n");
+        return 1;
+      }
+
+    ret = ftl_initialize(CONFIG_EXAMPLES_RWBPERF_MINOR, mtd);
+    if (ret < 0)
+      {
+        printf("rwbperf: ftl_initialize failed: %d\n", ret);
+        return 1;
+      }
+  }
+#endif
+
+  ret = open_blockdriver(RWBPERF_DEVPATH, 0, &inode);
+  if (ret < 0)
+    {
+      printf("rwbperf: open_blockdriver(%s) failed: %d\n",
+             RWBPERF_DEVPATH, ret);
+      return 1;
+    }
+
+  ret = inode->u.i_bops->geometry(inode, &geo);
+  if (ret < 0 || !geo.geo_available || geo.geo_nsectors < 2)
+    {
+      printf("rwbperf: Bad geometry: %d\n", ret);
+      (void)close_blockdriver(inode);
+      return 1;
+    }
+
+  /* The interleaved test reads the second half of the blocks */
+
+  nblocks = CONFIG_EXAMPLES_RWBPERF_NBLOCKS;
+  if (nblocks > geo.geo_nsectors / 2)
+    {
+      nblocks = geo.geo_nsectors / 2;
+    }
+
+  g_blocksize = geo.geo_sectorsize;
+  g_block     = (FAR uint8_t *)malloc(g_blocksize);
+  if (!g_block)
+    {
+      printf("rwbperf: Failed to allocate the block buffer\n");
+      (void)close_blockdriver(inode);
+      return 1;
+    }
+
+  if (rwbperf_getstats(inode, &stats) < 0)
+    {
+      printf("rwbperf: %s has no read-ahead/write buffer\n",
+             RWBPERF_DEVPATH);
+      free(g_block);
+      (void)close_blockdriver(inode);
+      return 1;
+    }
+
+  printf("rwbperf: %s, %lu blocks of %lu bytes\n", RWBPERF_DEVPATH,
+         (unsigned long)geo.geo_nsectors, (unsigned long)geo.geo_sectorsize);
+
+  printf("%-8s %6s %6s %6s %5s %6s %6s %6s %6s %6s\n", "Test", "msec",
+         "hits", "misses", "rate", "ahead", "async", "wrblks", "merged",
+         "wrxfrs");
+
+  ret = OK;
+#ifdef RWBPERF_WRITETEST
+  if (geo.geo_writeenabled)
+    {
+      ret = rwbperf_run(inode, "seqwrite", rwbperf_seqwrite, 2 * nblocks);
+    }
+#endif
+
+  if (ret == OK)
+    {
+      ret = rwbperf_run(inode, "seqread", rwbperf_seqread, nblocks);
+    }
+
+  if (ret == OK)
+    {
+      ret = rwbperf_run(inode, "interlv", rwbperf_interleaved, nblocks);
+    }
+
+  if (ret == OK)
+    {
+      ret = rwbperf_run(inode, "random", rwbperf_random, 2 * nblocks);
+    }
+
+  free(g_block);
+  (void)close_blockdriver(inode);
+
+  if (ret < 0)
+    {
+      printf("rwbperf: FAILED\n");
+      return 1;
+    }
+
+  printf("rwbperf: Done\n");
+  return 0;
+}
@@ -0,0 +1,557 @@
+/****************************************************************************
+ * examples/strperf/strperf_main.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_EXAMPLES_STRPERF_NBYTES - The number of string bytes processed by
+ *   each measurement.  This should take at least several system timer
+ *   ticks.
+ */
+
+#ifndef CONFIG_EXAMPLES_STRPERF_NBYTES
+#  define CONFIG_EXAMPLES_STRPERF_NBYTES (2*1024*1024)
+#endif
+
+/* Conformance is verified for all string lengths up to STRPERF_CHECKLEN
+ * and all offsets up to STRPERF_MAXOFFSET.  Performance is measured for
+ * lengths up to STRPERF_MAXLEN.
+ */
+
+#define STRPERF_CHECKLEN  40
+#define STRPERF_MAXOFFSET 8
+#define STRPERF_MAXLEN    1024
+#define STRPERF_GARBAGE   8
+#define STRPERF_BUFSIZE   (STRPERF_MAXLEN + STRPERF_MAXOFFSET + STRPERF_GARBAGE + 1)
+
+/* The text searched by the strstr() tests */
+
+#define STRPERF_TEXTLEN   1024
+#define STRPERF_NSEARCHES (CONFIG_EXAMPLES_STRPERF_NBYTES / STRPERF_TEXTLEN)
+
+/* Measured operations */
+
+#define STRPERF_STRLEN    0
+#define STRPERF_STRCHR    1
+#define STRPERF_STRCMP    2
+#define STRPERF_STRNCMP   3
+#define STRPERF_STRCPY    4
+#define STRPERF_STRSTR    5
+#define STRPERF_STRCASESTR 6
+#define STRPERF_NOPS      7
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static uint32_t g_buf1[STRPERF_BUFSIZE / sizeof(uint32_t) + 1];
+static uint32_t g_buf2[STRPERF_BUFSIZE / sizeof(uint32_t) + 1];
+static char     g_text[STRPERF_TEXTLEN + 1];
+
+static volatile int g_sink;
+
+static const char *g_opname[STRPERF_NOPS] =
+{
+  "strlen", "strchr", "strcmp", "strncmp", "strcpy", "strstr", "strcasestr"
+};
+
+static const uint16_t g_lengths[] =
+{
+  8, 32, 128, STRPERF_MAXLEN
+};
+
+#define STRPERF_NLENGTHS (sizeof(g_lengths) / sizeof(g_lengths[0]))
+
+/* Substrings used to measure strstr() and strcasestr().  None of these
+ * occur in the searched text (which uses only the letters a-p).
+ */
+
+static const char *g_needles[] =
+{
+  "az", "zzz", "needlez", "the quick brown fox"
+};
+
+#define STRPERF_NNEEDLES (sizeof(g_needles) / sizeof(g_needles[0]))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: strperf_fill
+ *
+ * Description:
+ *   Fill a buffer with a string of 'len' random characters selected from
+ *   an alphabet of 'nchars' characters (starting with 'a') followed by a
+ *   NUL terminator and STRPERF_GARBAGE bytes of random garbage.
+ *
+ ****************************************************************************/
+
+static void strperf_fill(FAR char *buffer, int len, int nchars)
+{
+  int i;
+
+  for (i = 0; i < len + 1 + STRPERF_GARBAGE; i++)
+    {
+      buffer[i] = 'a' + rand() % nchars;
+    }
+
+  buffer[len] = '\0';
+}
+
+/****************************************************************************
+ * Name: Reference implementations
+ ****************************************************************************/
+
+static size_t ref_strlen(FAR const char *s)
+{
+  size_t len = 0;
+  while (s[len] != '\0') len++;
+  return len;
+}
+
+static FAR char *ref_strchr(FAR const char *s, int c)
+{
+  for (;; s++)
+    {
+      if (*s == (char)c)
+        {
+          return (FAR char *)s;
+        }
+      else if (*s == '\0')
+        {
+          return NULL;
+        }
+    }
+}
+
+static int ref_strncmp(FAR const char *s1, FAR const char *s2, size_t n)
+{
+  FAR const unsigned char *p1 = (FAR const unsigned char *)s1;
+  FAR const unsigned char *p2 = (FAR const unsigned char *)s2;
+
+  for (; n > 0; n--, p1++, p2++)
+    {
+      if (*p1 != *p2)
+        {
+          return *p1 < *p2 ? -1 : 1;
+        }
+      else if (*p1 == '\0')
+        {
+          break;
+        }
+    }
+
+  return 0;
+}
+
+static FAR char *ref_strstr(FAR const char *str, FAR const char *substr,
+                            bool nocase)
+{
+  size_t i;
+
+  for (;; str++)
+    {
+      for (i = 0; substr[i] != '\0'; i++)
+        {
+          if (nocase ? tolower(str[i]) != tolower(substr[i]) :
+                       str[i] != substr[i])
+            {
+              break;
+            }
+        }
+
+      if (substr[i] == '\0')
+        {
+          return (FAR char *)str;
+        }
+      else if (*str == '\0')
+        {
+          return NULL;
+        }
+    }
+}
+
+static int strperf_sign(int value)
+{
+  return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+static void strperf_error(FAR const char *name, int len, int off1, int off2)
+{
+  printf("%s FAILED: len=%d off1=%d off2=%d\n", name, len, off1, off2);
+}
+
+/****************************************************************************
+ * Name: strperf_verify
+ *
+ * Description:
+ *   Verify the string functions against byte-at-a-time reference
+ *   implementations for all short lengths and alignments.  Returns the
+ *   number of failures.
+ *
+ ****************************************************************************/
+
+static int strperf_verify(void)
+{
+  FAR char *buf1 = (FAR char *)g_buf1;
+  FAR char *buf2 = (FAR char *)g_buf2;
+  FAR char *s1;
+  FAR char *s2;
+  int nerrors = 0;
+  int len;
+  int off1;
+  int off2;
+  int i;
+
+  for (len = 0; len <= STRPERF_CHECKLEN; len++)
+    {
+      for (off1 = 0; off1 < STRPERF_MAXOFFSET; off1++)
+        {
+          for (off2 = 0; off2 < STRPERF_MAXOFFSET; off2++)
+            {
+              s1 = buf1 + off1;
+              s2 = buf2 + off2;
+
+              /* strlen */
+
+              strperf_fill(s1, len, 26);
+              if (strlen(s1) != len)
+                {
+                  strperf_error("strlen", len, off1, off2);
+                  nerrors++;
+                }
+
+              /* strchr:  A character that may or may not be present, a
+               * character with the high bit set, and the terminator.
+               */
+
+              strperf_fill(s1, len, 8);
+              if (strchr(s1, 'a' + off2) != ref_strchr(s1, 'a' + off2) ||
+                  strchr(s1, 0xa5) != ref_strchr(s1, 0xa5) ||
+                  strchr(s1, '\0') != &s1[len])
+                {
+                  strperf_error("strchr", len, off1, off2);
+                  nerrors++;
+                }
+
+              /* strcpy */
+
+              strperf_fill(s1, len, 26);
+              strperf_fill(buf2, STRPERF_CHECKLEN + STRPERF_MAXOFFSET, 26);
+              if (strcpy(s2, s1) != s2 || ref_strncmp(s1, s2, len + 1) != 0 ||
+                  ref_strlen(s2) != len)
+                {
+                  strperf_error("strcpy", len, off1, off2);
+                  nerrors++;
+                }
+
+              /* strcmp and strncmp on equal strings, then with a difference
+               * at each position (including one with the high bit set).
+               */
+
+              if (strcmp(s1, s2) != 0 || strncmp(s1, s2, len + 3) != 0)
+                {
+                  strperf_error("strcmp", len, off1, off2);
+                  nerrors++;
+                }
+
+              for (i = 0; i < len; i++)
+                {
+                  char save = s2[i];
+
+                  s2[i] = (i & 1) ? 0xc3 : 'a' + (save - 'a' + 1) % 26;
+                  if (strperf_sign(strcmp(s1, s2)) !=
+                      ref_strncmp(s1, s2, len + 1) ||
+                      strperf_sign(strncmp(s1, s2, len)) !=
+                      ref_strncmp(s1, s2, len) ||
+                      strperf_sign(strncmp(s1, s2, i)) != 0)
+                    {
+                      strperf_error("strcmp", len, off1, off2);
+                      nerrors++;
+                      break;
+                    }
+
+                  s2[i] = save;
+                }
+
+              /* strstr and strcasestr with substrings taken from the string
+               * (so that they will be found) and from another string (so
+               * that they will probably not be found).  A small alphabet
+               * makes partial matches likely.
+               */
+
+              strperf_fill(s1, len, 3);
+              for (i = 0; i <= len && i < 12; i++)
+                {
+                  int start = len > i ? rand() % (len - i + 1) : 0;
+                  char needle[12 + 1 + STRPERF_GARBAGE];
+
+                  memcpy(needle, &s1[start], i);
+                  needle[i] = '\0';
+                  if (strstr(s1, needle) != ref_strstr(s1, needle, false))
+                    {
+                      strperf_error("strstr", len, off1, i);
+                      nerrors++;
+                    }
+
+                  needle[0] = toupper(needle[0]);
+                  if (strcasestr(s1, needle) != ref_strstr(s1, needle, true))
+                    {
+                      strperf_error("strcasestr", len, off1, i);
+                      nerrors++;
+                    }
+
+                  strperf_fill(needle, i, 3);
+                  if (strstr(s1, needle) != ref_strstr(s1, needle, false))
+                    {
+                      strperf_error("strstr", len, off1, i);
+                      nerrors++;
+                    }
+                }
+            }
+        }
+    }
+
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: strperf_msec
+ ****************************************************************************/
+
+static uint32_t strperf_msec(void)
+{
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint32_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/****************************************************************************
+ * Name: strperf_measure
+ *
+ * Description:
+ *   Perform one operation repeatedly on aligned strings of 'len' bytes
+ *   until CONFIG_EXAMPLES_STRPERF_NBYTES have been processed.  Returns the
+ *   elapsed time in milliseconds.
+ *
+ ****************************************************************************/
+
+static uint32_t strperf_measure(int op, int len)
+{
+  FAR char *s1 = (FAR char *)g_buf1;
+  FAR char *s2 = (FAR char *)g_buf2;
+  uint32_t niterations = CONFIG_EXAMPLES_STRPERF_NBYTES / len;
+  uint32_t start;
+  uint32_t i;
+  int sum = 0;
+
+  /* Two equal strings that do not contain the character 'z' */
+
+  strperf_fill(s1, len, 25);
+  strcpy(s2, s1);
+
+  start = strperf_msec();
+  for (i = 0; i < niterations; i++)
+    {
+      switch (op)
+        {
+          case STRPERF_STRLEN:
+            sum += strlen(s1);
+            break;
+
+          case STRPERF_STRCHR:
+            sum += (strchr(s1, 'z') != NULL);
+            break;
+
+          case STRPERF_STRCMP:
+            sum += strcmp(s1, s2);
+            break;
+
+          case STRPERF_STRNCMP:
+            sum += strncmp(s1, s2, len);
+            break;
+
+          case STRPERF_STRCPY:
+            sum += (strcpy(s2, s1) != NULL);
+            break;
+        }
+    }
+
+  g_sink = sum;
+  return strperf_msec() - start;
+}
+
+/****************************************************************************
+ * Name: strperf_search
+ *
+ * Description:
+ *   Search for a substring in a text of STRPERF_TEXTLEN bytes repeatedly
+ *   and return the elapsed time in milliseconds.
+ *
+ ****************************************************************************/
+
+static uint32_t strperf_search(int op, FAR const char *needle)
+{
+  uint32_t start;
+  uint32_t i;
+  int sum = 0;
+
+  start = strperf_msec();
+  for (i = 0; i < STRPERF_NSEARCHES; i++)
+    {
+      if (op == STRPERF_STRSTR)
+        {
+          sum += (strstr(g_text, needle) != NULL);
+        }
+      else
+        {
+          sum += (strcasestr(g_text, needle) != NULL);
+        }
+    }
+
+  g_sink = sum;
+  return strperf_msec() - start;
+}
+
+/****************************************************************************
+ * Name: strperf_report
+ ****************************************************************************/
+
+static void strperf_report(int op, FAR const char *what, uint32_t nbytes,
+                           uint32_t elapsed)
+{
+  if (elapsed == 0)
+    {
+      printf("%-10s %-20s %8s (too fast)\n", g_opname[op], what, "-");
+    }
+  else
+    {
+      printf("%-10s %-20s %8lu %9lu\n", g_opname[op], what,
+             (unsigned long)elapsed,
+             (unsigned long)((nbytes / 1024) * 1000 / elapsed));
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: strperf_main/user_start
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_STRPERF_BUILTIN
+#  define MAIN_NAME strperf_main
+#else
+#  define MAIN_NAME user_start
+#endif
+
+int MAIN_NAME(int argc, char *argv[])
+{
+  uint32_t elapsed;
+  char what[24];
+  int nerrors;
+  int op;
+  int i;
+
+  /* First, make sure that the functions work */
+
+  printf("strperf: Verifying lengths 0-%d, offsets 0-%d\n",
+         STRPERF_CHECKLEN, STRPERF_MAXOFFSET - 1);
+
+  nerrors = strperf_verify();
+  if (nerrors > 0)
+    {
+      printf("strperf: %d failures\n", nerrors);
+      return 1;
+    }
+
+  /* Then measure them */
+
+  printf("strperf: %lu bytes per measurement\n\n",
+         (unsigned long)CONFIG_EXAMPLES_STRPERF_NBYTES);
+  printf("Function   Length/Substring         msec    KB/sec\n");
+
+  for (op = STRPERF_STRLEN; op <= STRPERF_STRCPY; op++)
+    {
+      for (i = 0; i < STRPERF_NLENGTHS; i++)
+        {
+          elapsed = strperf_measure(op, g_lengths[i]);
+          snprintf(what, sizeof(what), "%d", g_lengths[i]);
+          strperf_report(op, what, CONFIG_EXAMPLES_STRPERF_NBYTES, elapsed);
+        }
+    }
+
+  /* Searches are made in text that contains none of the substrings (so that
+   * the whole text is examined).
+   */
+
+  for (i = 0; i < STRPERF_TEXTLEN; i++)
+    {
+      g_text[i] = (rand() % 8) == 0 ? ' ' : 'a' + rand() % 16;
+    }
+
+  g_text[STRPERF_TEXTLEN] = '\0';
+
+  for (op = STRPERF_STRSTR; op <= STRPERF_STRCASESTR; op++)
+    {
+      for (i = 0; i < STRPERF_NNEEDLES; i++)
+        {
+          elapsed = strperf_search(op, g_needles[i]);
+          snprintf(what, sizeof(what), "\"%s\"", g_needles[i]);
+          strperf_report(op, what, STRPERF_TEXTLEN * STRPERF_NSEARCHES,
+                         elapsed);
+        }
+    }
+
+  printf("\nstrperf: Done\n");
+  return 0;
+}
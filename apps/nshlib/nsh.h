@@ -61,6 +61,16 @@
 #  endif
 #endif
 
+/* The top command walks the task list with sched_foreach(), which is not
+ * available to applications in the kernel build.
+ */
+
+#ifdef CONFIG_NUTTX_KERNEL
+#  ifndef CONFIG_NSH_DISABLE_TOP
+#    define CONFIG_NSH_DISABLE_TOP 1
+#  endif
+#endif
+
 /* Telnetd requires networking support */
 
 #ifndef CONFIG_NET
@@ -512,6 +522,9 @@ void nsh_dumpbuffer(FAR struct nsh_vtbl_s *vtbl, const char *msg,
 #  ifndef CONFIG_NSH_DISABLE_USLEEP
       int cmd_usleep(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #  endif
+#  if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_NSH_DISABLE_TOP)
+      int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
+#  endif
 #endif /* CONFIG_DISABLE_SIGNALS */
 
 #endif /* __APPS_NSHLIB_NSH_H */
@@ -209,6 +209,8 @@ static inline void uip_statistics(FAR struct nsh_vtbl_s *vtbl)
             uip_stat.tcp.ackerr, uip_stat.tcp.syndrop);
   nsh_output(vtbl, "            RST: %04x %04x\n", 
             uip_stat.tcp.rst, uip_stat.tcp.synrst);
+  nsh_output(vtbl, "            RAH: %04x\n",
+            uip_stat.tcp.rcvdrop);
 #endif
 
   nsh_output(vtbl, "  Type      %04x",uip_stat.ip.protoerr);
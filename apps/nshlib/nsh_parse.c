@@ -321,6 +321,12 @@ static const struct cmdmap_s g_cmdmap[] =
   { "test",     cmd_test,     3, NSH_MAX_ARGUMENTS, "<expression>" },
 #endif
 
+#if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_DISABLE_SIGNALS)
+# ifndef CONFIG_NSH_DISABLE_TOP
+  { "top",      cmd_top,      1, 5, "[-d <sec>] [-n <count>]" },
+# endif
+#endif
+
 #if !defined(CONFIG_DISABLE_MOUNTPOINT) && CONFIG_NFILE_DESCRIPTORS > 0 && defined(CONFIG_FS_READABLE)
 # ifndef CONFIG_NSH_DISABLE_UMOUNT
   { "umount",   cmd_umount,   2, 2, "<dir-path>" },
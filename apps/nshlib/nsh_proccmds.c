@@ -39,8 +39,10 @@
 
 #include <nuttx/config.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sched.h>
 #include <errno.h>
@@ -52,6 +54,10 @@
  * Definitions
  ****************************************************************************/
 
+/* The number of characters of the task name shown by 'top' */
+
+#define TOP_NAMELEN 15
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -62,6 +68,28 @@
 
 typedef int (*exec_t)(void);
 
+/* One sample of one task taken by the 'top' command */
+
+#if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_DISABLE_SIGNALS) && \
+   !defined(CONFIG_NSH_DISABLE_TOP)
+struct top_sample_s
+{
+  pid_t    pid;                     /* Task ID (-1 if the task has exited) */
+  uint8_t  priority;                /* Task priority */
+  char     name[TOP_NAMELEN+1];     /* Task name */
+  struct cpuload_s load;            /* CPU accounting information */
+};
+
+/* One sample of all tasks */
+
+struct top_samples_s
+{
+  FAR struct top_sample_s *sample;  /* Array of CONFIG_MAX_TASKS samples */
+  int nsamples;                     /* Number of valid samples */
+  uint32_t total;                   /* Time base when the samples were taken */
+};
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -150,6 +178,150 @@ static void ps_task(FAR _TCB *tcb, FAR void *arg)
 }
 #endif
 
+/****************************************************************************
+ * Name: top_task
+ ****************************************************************************/
+
+#if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_DISABLE_SIGNALS) && \
+   !defined(CONFIG_NSH_DISABLE_TOP)
+static void top_task(FAR _TCB *tcb, FAR void *arg)
+{
+  FAR struct top_samples_s *samples = (FAR struct top_samples_s *)arg;
+  FAR struct top_sample_s *sample;
+
+  /* This runs with interrupts disabled, so just remember the task.  The
+   * CPU accounting information is sampled later.
+   */
+
+  if (samples->nsamples < CONFIG_MAX_TASKS)
+    {
+      sample = &samples->sample[samples->nsamples++];
+      sample->pid      = tcb->pid;
+      sample->priority = tcb->sched_priority;
+      strncpy(sample->name, tcb->argv[0] ? tcb->argv[0] : "", TOP_NAMELEN);
+      sample->name[TOP_NAMELEN] = '\0';
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: top_sample
+ ****************************************************************************/
+
+#if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_DISABLE_SIGNALS) && \
+   !defined(CONFIG_NSH_DISABLE_TOP)
+static void top_sample(FAR struct top_samples_s *samples)
+{
+  FAR struct top_sample_s *sample;
+  int i;
+
+  samples->nsamples = 0;
+  samples->total    = 0;
+  sched_foreach(top_task, samples);
+
+  for (i = 0; i < samples->nsamples; i++)
+    {
+      sample = &samples->sample[i];
+      if (sched_cpuload(sample->pid, &sample->load) != OK)
+        {
+          /* The task exited after it was enumerated */
+
+          sample->pid = -1;
+        }
+      else
+        {
+          samples->total = sample->load.total;
+        }
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: top_show
+ ****************************************************************************/
+
+#if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_DISABLE_SIGNALS) && \
+   !defined(CONFIG_NSH_DISABLE_TOP)
+static void top_show(FAR struct nsh_vtbl_s *vtbl,
+                     FAR const struct top_samples_s *prev,
+                     FAR const struct top_samples_s *curr)
+{
+  FAR const struct top_sample_s *before;
+  FAR const struct top_sample_s *after;
+  uint32_t active;
+  uint32_t total;
+  uint32_t switches;
+  uint32_t load;
+  int i;
+  int j;
+
+  nsh_output(vtbl, "PID   PRI   CPU%% SWITCHES   STACK    USED NAME\n");
+
+  for (i = 0; i < curr->nsamples; i++)
+    {
+      after = &curr->sample[i];
+      if (after->pid < 0)
+        {
+          continue;
+        }
+
+      /* Find the previous sample of the same task */
+
+      for (j = 0, before = NULL; j < prev->nsamples; j++)
+        {
+          if (prev->sample[j].pid == after->pid)
+            {
+              before = &prev->sample[j];
+              break;
+            }
+        }
+
+      /* Tasks started during the interval are charged with all of their
+       * run time over the whole interval.
+       */
+
+      if (before)
+        {
+          active   = after->load.active   - before->load.active;
+          total    = after->load.total    - before->load.total;
+          switches = after->load.switches - before->load.switches;
+        }
+      else
+        {
+          active   = after->load.active;
+          total    = after->load.total - prev->total;
+          switches = after->load.switches;
+        }
+
+      /* The load is in tenths of a percent.  Scale the total down rather
+       * than the active time up to avoid overflow.
+       */
+
+      total /= 1000;
+      load   = total > 0 ? active / total : 0;
+      if (load > 1000)
+        {
+          load = 1000;
+        }
+
+      nsh_output(vtbl, "%5d %3d %4d.%d %8u %7u ",
+                 after->pid, after->priority, load / 10, load % 10,
+                 (unsigned int)switches, (unsigned int)after->load.stacksize);
+
+      if (after->load.stackused > 0)
+        {
+          nsh_output(vtbl, "%7u ", (unsigned int)after->load.stackused);
+        }
+      else
+        {
+          nsh_output(vtbl, "%7s ", "-");
+        }
+
+      nsh_output(vtbl, "%s\n", after->name);
+    }
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -189,6 +361,118 @@ int cmd_ps(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
 }
 #endif
 
+/****************************************************************************
+ * Name: cmd_top
+ ****************************************************************************/
+
+#if defined(CONFIG_SCHED_CPULOAD) && !defined(CONFIG_DISABLE_SIGNALS)
+#ifndef CONFIG_NSH_DISABLE_TOP
+int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
+{
+  struct top_samples_s samples[2];
+  FAR struct top_samples_s *prev;
+  FAR struct top_samples_s *curr;
+  FAR struct top_samples_s *tmp;
+  bool badarg = false;
+  int delay = 1;
+  int count = 1;
+  int option;
+
+  /* Get the top options */
+
+  while ((option = getopt(argc, argv, ":d:n:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'd':
+            delay = atoi(optarg);
+            if (delay < 1 || delay > 3600)
+              {
+                nsh_output(vtbl, g_fmtargrange, argv[0]);
+                badarg = true;
+              }
+            break;
+
+          case 'n':
+            count = atoi(optarg);
+            if (count < 1 || count > 10000)
+              {
+                nsh_output(vtbl, g_fmtargrange, argv[0]);
+                badarg = true;
+              }
+            break;
+
+          case ':':
+            nsh_output(vtbl, g_fmtargrequired, argv[0]);
+            badarg = true;
+            break;
+
+          case '?':
+          default:
+            nsh_output(vtbl, g_fmtarginvalid, argv[0]);
+            badarg = true;
+            break;
+        }
+    }
+
+  /* If a bad argument was encountered, then return without processing
+   * the command.  There should be no other arguments.
+   */
+
+  if (badarg)
+    {
+      return ERROR;
+    }
+
+  if (optind < argc)
+    {
+      nsh_output(vtbl, g_fmttoomanyargs, argv[0]);
+      return ERROR;
+    }
+
+  /* Allocate space for two samples of every possible task */
+
+  samples[0].sample = (FAR struct top_sample_s *)
+    malloc(2 * CONFIG_MAX_TASKS * sizeof(struct top_sample_s));
+
+  if (!samples[0].sample)
+    {
+      nsh_output(vtbl, g_fmtcmdoutofmemory, argv[0]);
+      return ERROR;
+    }
+
+  samples[1].sample = &samples[0].sample[CONFIG_MAX_TASKS];
+
+  /* The load of each task is the change in its run time over each
+   * interval.
+   */
+
+  prev = &samples[0];
+  curr = &samples[1];
+  top_sample(prev);
+
+  while (count-- > 0)
+    {
+      sleep(delay);
+      top_sample(curr);
+      top_show(vtbl, prev, curr);
+
+      if (count > 0)
+        {
+          nsh_output(vtbl, "\n");
+        }
+
+      tmp  = prev;
+      prev = curr;
+      curr = tmp;
+    }
+
+  free(samples[0].sample);
+  return OK;
+}
+#endif
+#endif
+
 /****************************************************************************
  * Name: cmd_kill
  ****************************************************************************/
@@ -46,6 +46,7 @@
 
 #include <arch/irq.h>
 #include <nuttx/sched.h>
+#include <nuttx/sched_note.h>
 
 #ifdef CONFIG_NUTTX_KERNEL
 #  include <syscall.h>
@@ -138,6 +139,7 @@ static inline void dispatch_syscall(uint32_t *regs)
       /* Call the correct stub for each SYS call, based on the number of parameters */
 
       svcdbg("Calling stub%d at %p\n", index, g_stubloopkup[index].stub0);
+      sched_note_syscall(cmd, true);
 
       switch (g_stubnparms[index])
         {
@@ -197,6 +199,8 @@ static inline void dispatch_syscall(uint32_t *regs)
           break;
         }
 
+      sched_note_syscall(cmd, false);
+
 #ifdef SYSCALL_INTERRUPTIBLE
       irqdisable();
 #endif
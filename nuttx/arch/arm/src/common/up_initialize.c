@@ -44,6 +44,7 @@
 #include <nuttx/arch.h>
 #include <nuttx/fs.h>
 #include <nuttx/ramlog.h>
+#include <nuttx/sched_note.h>
 
 #include <arch/board/board.h>
 
@@ -167,6 +168,12 @@ void up_initialize(void)
   ramlog_sysloginit();
 #endif
 
+  /* Register the scheduler instrumentation note driver */
+
+#if defined(CONFIG_SCHED_NOTE_BUFFER) && CONFIG_NFILE_DESCRIPTORS > 0
+  note_register();
+#endif
+
   /* Initialize the netwok */
 
   up_netinitialize();
@@ -375,8 +375,7 @@ extern void up_usbuninitialize(void);
 
 #if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
 extern size_t up_check_stack(void);
-extern size_t up_check_tcbstack(FAR _TCB);
-extern size_t up_check_tcbstack_remain(FAR _TCB);
+extern size_t up_check_stack_remain(void);
 #endif
 
 #endif /* __ASSEMBLY__ */
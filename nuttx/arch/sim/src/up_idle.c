@@ -94,11 +94,23 @@ extern void up_x11update(void);
 
 void up_idle(void)
 {
+#if defined(CONFIG_SIM_WALLTIME) || defined(CONFIG_SIM_X11FB)
+  unsigned int usec;
+#endif
+
+#ifdef CONFIG_SCHED_TICKLESS
+  /* In the tickless mode, process the "fake" alarm interrupt only if the
+   * one-shot alarm has expired.
+   */
+
+  up_timer_update();
+#else
   /* If the system is idle, then process "fake" timer interrupts.
    * Hopefully, something will wake up.
    */
 
   sched_process_timer();
+#endif
 
   /* Run the network if enabled */
 
@@ -125,11 +137,17 @@ void up_idle(void)
 #endif
 
   /* Wait a bit so that the sched_process_timer() is called close to the
-   * correct rate.
+   * correct rate.  In the tickless mode, wait until the alarm expires but
+   * no longer than one tick so that the network and X11 are still polled.
    */
 
 #if defined(CONFIG_SIM_WALLTIME) || defined(CONFIG_SIM_X11FB)
-  (void)up_hostusleep(1000000 / CLK_TCK);
+#ifdef CONFIG_SCHED_TICKLESS
+  usec = up_timer_idleusec(1000000 / CLK_TCK);
+#else
+  usec = 1000000 / CLK_TCK;
+#endif
+  (void)up_hostusleep(usec);
 
   /* Handle X11-related events */
 
@@ -147,7 +165,7 @@ void up_idle(void)
 
       /* Update the display periodically */
 
-      g_x11refresh += 1000000 / CLK_TCK;
+      g_x11refresh += usec;
       if (g_x11refresh > 500000)
         {
           up_x11update();
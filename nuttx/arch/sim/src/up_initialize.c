@@ -44,6 +44,7 @@
 #include <nuttx/arch.h>
 #include <nuttx/fs.h>
 #include <nuttx/ramlog.h>
+#include <nuttx/sched_note.h>
 
 #include "up_internal.h"
 
@@ -111,6 +112,10 @@ void up_initialize(void)
   ramlog_sysloginit();      /* System logging device */
 #endif
 
+#if defined(CONFIG_SCHED_NOTE_BUFFER) && CONFIG_NFILE_DESCRIPTORS > 0
+  note_register();          /* Scheduler instrumentation notes */
+#endif
+
 #if defined(CONFIG_FS_FAT) && !defined(CONFIG_DISABLE_MOUNTPOINT)
   up_registerblockdevice(); /* Our FAT ramdisk at /dev/ram0 */
 #endif
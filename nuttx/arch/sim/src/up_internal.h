@@ -165,6 +165,19 @@ extern char *up_deviceimage(void);
 extern size_t up_hostread(void *buffer, size_t len);
 extern size_t up_hostwrite(const void *buffer, size_t len);
 
+/* up_hosttime.c **********************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+extern void up_hostgettime(unsigned long *sec, unsigned long *nsec);
+#endif
+
+/* up_tickless.c **********************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+extern void up_timer_update(void);
+extern unsigned int up_timer_idleusec(unsigned int maxusec);
+#endif
+
 /* up_netdev.c ************************************************************/
 
 #ifdef CONFIG_NET
@@ -0,0 +1,216 @@
+/****************************************************************************
+ * arch/sim/src/up_tickless.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+
+#include "up_internal.h"
+
+#ifdef CONFIG_SCHED_TICKLESS
+
+/****************************************************************************
+ * Private Definitions
+ ****************************************************************************/
+
+/* The simulation has no timer hardware.  The free-running counter is the
+ * host monotonic clock and the one-shot alarm is emulated:  The expiration
+ * time is recorded by up_timer_start() and checked by up_timer_update()
+ * each time that the IDLE loop runs (this is also when the simulated
+ * timer interrupt would have been processed in the periodic tick mode).
+ */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static bool     g_alarm_active;  /* True: The one-shot alarm is pending */
+static uint64_t g_alarm_time;    /* Expiration time (nanoseconds) */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: up_timer_nsec
+ *
+ * Description:
+ *   Return the host time in nanoseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t up_timer_nsec(void)
+{
+  unsigned long sec;
+  unsigned long nsec;
+
+  up_hostgettime(&sec, &nsec);
+  return (uint64_t)sec * NSEC_PER_SEC + nsec;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: up_timer_gettime
+ *
+ * Description:
+ *   Return the time elapsed since the simulation was started.
+ *
+ ****************************************************************************/
+
+int up_timer_gettime(FAR struct timespec *ts)
+{
+  uint64_t now = up_timer_nsec();
+
+  ts->tv_sec  = (time_t)(now / NSEC_PER_SEC);
+  ts->tv_nsec = (long)(now % NSEC_PER_SEC);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: up_timer_start
+ *
+ * Description:
+ *   Start the one-shot alarm, replacing any alarm that is already pending.
+ *
+ ****************************************************************************/
+
+int up_timer_start(FAR const struct timespec *ts)
+{
+  irqstate_t flags = irqsave();
+
+  g_alarm_time   = up_timer_nsec() +
+                   (uint64_t)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+  g_alarm_active = true;
+
+  irqrestore(flags);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: up_timer_cancel
+ *
+ * Description:
+ *   Cancel the one-shot alarm and return the time that remained.
+ *
+ ****************************************************************************/
+
+int up_timer_cancel(FAR struct timespec *ts)
+{
+  irqstate_t flags = irqsave();
+  uint64_t remaining = 0;
+  uint64_t now;
+
+  if (g_alarm_active)
+    {
+      now = up_timer_nsec();
+      if (g_alarm_time > now)
+        {
+          remaining = g_alarm_time - now;
+        }
+
+      g_alarm_active = false;
+    }
+
+  irqrestore(flags);
+
+  if (ts)
+    {
+      ts->tv_sec  = (time_t)(remaining / NSEC_PER_SEC);
+      ts->tv_nsec = (long)(remaining % NSEC_PER_SEC);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: up_timer_update
+ *
+ * Description:
+ *   Called from the IDLE loop.  If the one-shot alarm has expired, then
+ *   simulate the timer interrupt by calling sched_timer_expiration().
+ *
+ ****************************************************************************/
+
+void up_timer_update(void)
+{
+  if (g_alarm_active && up_timer_nsec() >= g_alarm_time)
+    {
+      g_alarm_active = false;
+      sched_timer_expiration();
+    }
+}
+
+/****************************************************************************
+ * Name: up_timer_idleusec
+ *
+ * Description:
+ *   Return the number of microseconds that the IDLE loop may sleep on the
+ *   host before the one-shot alarm expires, but no more than 'maxusec'.
+ *
+ ****************************************************************************/
+
+unsigned int up_timer_idleusec(unsigned int maxusec)
+{
+  uint64_t now;
+  uint64_t usec;
+
+  if (!g_alarm_active)
+    {
+      return maxusec;
+    }
+
+  now = up_timer_nsec();
+  if (g_alarm_time <= now)
+    {
+      return 0;
+    }
+
+  usec = (g_alarm_time - now + NSEC_PER_USEC - 1) / NSEC_PER_USEC;
+  return usec < maxusec ? (unsigned int)usec : maxusec;
+}
+
+#endif /* CONFIG_SCHED_TICKLESS */
@@ -56,6 +56,7 @@
 #include <nuttx/net/uip/uip.h>
 #include <nuttx/net/uip/uip-arch.h>
 #include <nuttx/net/uip/uip-arp.h>
+#include <nuttx/net/uip/uip-iob.h>
 
 #include "up_internal.h"
 
@@ -65,6 +66,12 @@
 
 #define BUF ((struct ether_header*)g_sim_dev.d_buf)
 
+/* A connection produces at most one packet each time that it is polled.
+ * Poll repeatedly after each transfer so that TCP can fill its send window.
+ */
+
+#define SIM_MAXPOLLS CONFIG_NET_TCP_SNDSEGS
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -85,6 +92,16 @@ struct timer
 
 static struct timer g_periodic_timer;
 static struct uip_driver_s g_sim_dev;
+static volatile bool g_sim_txavail;  /* New TX data is available */
+static bool g_sim_txdata;            /* The last poll produced a packet */
+
+/* With I/O buffers, the packets produced by one poll are queued here and
+ * then sent together.
+ */
+
+#ifdef CONFIG_NET_IOB
+static sq_queue_t g_sim_txq;
+#endif
 
 /****************************************************************************
  * Private Functions
@@ -123,8 +140,21 @@ static int sim_uiptxpoll(struct uip_driver_s *dev)
 
   if (g_sim_dev.d_len > 0)
     {
+      g_sim_txdata = true;
       uip_arp_out(&g_sim_dev);
+#ifdef CONFIG_NET_IOB
+      /* Queue the packet and continue polling into a new I/O buffer.  Stop
+       * polling if there are no more I/O buffers.
+       */
+
+      uip_iobenqueue(&g_sim_txq, uip_iobdetach(&g_sim_dev));
+      if (uip_iobattach(&g_sim_dev) < 0)
+        {
+          return 1;
+        }
+#else
       netdev_send(g_sim_dev.d_buf, g_sim_dev.d_len);
+#endif
     }
 
   /* If zero is returned, the polling will continue until all connections have
@@ -134,12 +164,79 @@ static int sim_uiptxpoll(struct uip_driver_s *dev)
   return 0;
 }
 
+#ifdef CONFIG_NET_IOB
+static void sim_txflush(void)
+{
+  FAR struct uip_iob_s *iob;
+
+  /* Send all queued packets and return their I/O buffers to the pool */
+
+  while ((iob = uip_iobdequeue(&g_sim_txq)) != NULL)
+    {
+      netdev_send(iob->io_data, iob->io_len);
+      uip_iobfree(iob);
+    }
+}
+#endif
+
+static void sim_txpoll(void)
+{
+  int npolls;
+
+  /* This is what a real driver would do on the TX done interrupt:  Poll the
+   * connections for new TX data.  Keep polling as long as packets are being
+   * produced (up to a limit).
+   */
+
+  g_sim_txavail = false;
+  for (npolls = 0; npolls < SIM_MAXPOLLS; npolls++)
+    {
+#ifdef CONFIG_NET_IOB
+      if (!g_sim_dev.d_buf && uip_iobattach(&g_sim_dev) < 0)
+        {
+          break;
+        }
+#endif
+
+      g_sim_txdata = false;
+      uip_poll(&g_sim_dev, sim_uiptxpoll);
+#ifdef CONFIG_NET_IOB
+      sim_txflush();
+#endif
+      if (!g_sim_txdata)
+        {
+          break;
+        }
+    }
+}
+
+static int sim_txavail(struct uip_driver_s *dev)
+{
+  /* Just note that there is new TX data.  uipdriver_loop() will poll for
+   * it the next time that the IDLE thread runs.
+   */
+
+  g_sim_txavail = true;
+  return OK;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
 void uipdriver_loop(void)
 {
+  /* With I/O buffers, make sure that the device has a packet buffer.  The
+   * packet is received directly into it and passed to uIP without copying.
+   */
+
+#ifdef CONFIG_NET_IOB
+  if (!g_sim_dev.d_buf && uip_iobattach(&g_sim_dev) < 0)
+    {
+      return;
+    }
+#endif
+
   /* netdev_read will return 0 on a timeout event and >0 on a data received event */
 
   g_sim_dev.d_len = netdev_read((unsigned char*)g_sim_dev.d_buf, CONFIG_NET_BUFSIZE);
@@ -179,6 +276,12 @@ void uipdriver_loop(void)
                   uip_arp_out(&g_sim_dev);
                   netdev_send(g_sim_dev.d_buf, g_sim_dev.d_len);
                 }
+
+              /* An ACK may have opened the send window.  Poll for more
+               * TX data.
+               */
+
+              sim_txpoll();
             }
           else if (BUF->ether_type == htons(UIP_ETHTYPE_ARP))
             {
@@ -203,7 +306,18 @@ void uipdriver_loop(void)
     {
       timer_reset(&g_periodic_timer);
       uip_timer(&g_sim_dev, sim_uiptxpoll, 1);
+#ifdef CONFIG_NET_IOB
+      sim_txflush();
+#endif
+    }
+
+  /* Or there may be new TX data to send */
+
+  else if (g_sim_txavail)
+    {
+      sim_txpoll();
     }
+
   sched_unlock();
 }
 
@@ -212,8 +326,15 @@ int uipdriver_init(void)
   /* Internal initalization */
 
   timer_set(&g_periodic_timer, 500);
+#ifdef CONFIG_NET_IOB
+  sq_init(&g_sim_txq);
+#endif
   netdev_init();
 
+  /* Provide a callback so that we are notified of new TX data */
+
+  g_sim_dev.d_txavail = sim_txavail;
+
   /* Register the device with the OS so that socket IOCTLs can be performed */
 
   (void)netdev_register(&g_sim_dev);
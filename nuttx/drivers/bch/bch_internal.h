@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/bch/bch_internal.h
  *
- *   Copyright (C) 2008-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2008-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -52,9 +52,32 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Configuration ************************************************************/
+/* CONFIG_BCH_NCACHESECTORS - The number of consecutive sectors held in the
+ *   sector cache.  When more than one sector is cached, sequential reads
+ *   are read ahead to fill the cache, sequential writes are coalesced, and
+ *   dirty sectors are written back only when the cache is re-used or the
+ *   device is closed.  Transfers of this many whole sectors or more go
+ *   directly to the block driver.  Default: 1 (a single sector buffer that
+ *   is flushed at the end of each write).
+ */
+
+#ifndef CONFIG_BCH_NCACHESECTORS
+#  define CONFIG_BCH_NCACHESECTORS 1
+#endif
+
+#if CONFIG_BCH_NCACHESECTORS < 1
+#  error "CONFIG_BCH_NCACHESECTORS must be at least 1"
+#endif
+
 #define bchlib_semgive(d) sem_post(&(d)->sem)  /* To match bchlib_semtake */
 #define MAX_OPENCNT     (255)                  /* Limit of uint8_t */
 
+/* Address of a cached sector in the sector buffer */
+
+#define bchlib_sectbuffer(d,s) \
+  (&(d)->buffer[((s) - (d)->sector) * (d)->sectsize])
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -64,12 +87,16 @@ struct bchlib_s
   struct inode *inode; /* I-node of the block driver */
   sem_t    sem;        /* For atomic accesses to this structure */
   size_t   nsectors;   /* Number of sectors supported by the device */
-  size_t   sector;     /* The current sector in the buffer */
+  size_t   sector;     /* The first sector in the buffer */
+  size_t   rdnext;     /* The sector following the last sector read */
   uint16_t sectsize;   /* The size of one sector on the device */
+  uint16_t ncached;    /* Number of sectors in the buffer */
+  uint16_t dirtyfirst; /* First dirty sector in the buffer (index) */
+  uint16_t dirtylast;  /* Last dirty sector in the buffer (index) */
   uint8_t  refs;       /* Number of references */
   bool  dirty;         /* Data has been written to the buffer */
   bool  readonly;      /* true:  Only read operations are supported */
-  FAR uint8_t *buffer; /* One sector buffer */
+  FAR uint8_t *buffer; /* CONFIG_BCH_NCACHESECTORS sector buffer */
 };
 
 /****************************************************************************
@@ -93,6 +120,11 @@ EXTERN const struct file_operations bch_fops;
 EXTERN void bchlib_semtake(FAR struct bchlib_s *bch);
 EXTERN int  bchlib_flushsector(FAR struct bchlib_s *bch);
 EXTERN int  bchlib_readsector(FAR struct bchlib_s *bch, size_t sector);
+EXTERN int  bchlib_writesector(FAR struct bchlib_s *bch, size_t sector,
+                               FAR const uint8_t *buffer, uint16_t offset,
+                               uint16_t nbytes);
+EXTERN int  bchlib_syncrange(FAR struct bchlib_s *bch, size_t sector,
+                             size_t nsectors, bool discard);
 
 #undef EXTERN
 #if defined(__cplusplus)
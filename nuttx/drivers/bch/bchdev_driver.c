@@ -246,6 +246,14 @@ static int bch_ioctl(FAR struct file *filp, int cmd, unsigned long arg)
         }
       bchlib_semgive(bch);
     }
+  else if (cmd == BIOC_FLUSH)
+    {
+      /* Write any dirty sectors in the sector cache to the block driver */
+
+      bchlib_semtake(bch);
+      ret = bchlib_flushsector(bch);
+      bchlib_semgive(bch);
+    }
 
   return ret;
 }
@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/bch/bchlib_cache.c
  *
- *   Copyright (C) 2008-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2008-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -40,7 +40,9 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <errno.h>
 #include <assert.h>
 #include <debug.h>
@@ -65,6 +67,88 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: bchlib_cachesector
+ *
+ * Description:
+ *   Make sure that the sector is in the sector buffer.  The cached sectors
+ *   are always consecutive:  If the sector follows the cached sectors and
+ *   there is room, it is added to the cache;  otherwise, the cache is
+ *   flushed and re-used.  If nread is non-zero, the sector and up to
+ *   nread - 1 following sectors are read from the device;  if nread is zero,
+ *   the sector will be completely overwritten by the caller and is not read.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+static int bchlib_cachesector(FAR struct bchlib_s *bch, size_t sector,
+                              size_t nread)
+{
+  FAR struct inode *inode;
+  uint16_t index;
+  ssize_t ret;
+
+  /* Is the sector already in the cache? */
+
+  if (bch->ncached > 0 && sector >= bch->sector &&
+      sector < bch->sector + bch->ncached)
+    {
+      return OK;
+    }
+
+  /* Does it follow the cached sectors? */
+
+  if (bch->ncached > 0 && bch->ncached < CONFIG_BCH_NCACHESECTORS &&
+      sector == bch->sector + bch->ncached)
+    {
+      index = bch->ncached;
+    }
+  else
+    {
+      ret = bchlib_flushsector(bch);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      bch->sector  = sector;
+      bch->ncached = 0;
+      index        = 0;
+    }
+
+  if (nread == 0)
+    {
+      bch->ncached = index + 1;
+      return OK;
+    }
+
+  /* Don't read past the end of the cache or of the device */
+
+  if (nread > CONFIG_BCH_NCACHESECTORS - index)
+    {
+      nread = CONFIG_BCH_NCACHESECTORS - index;
+    }
+
+  if (nread > bch->nsectors - sector)
+    {
+      nread = bch->nsectors - sector;
+    }
+
+  inode = bch->inode;
+  ret   = inode->u.i_bops->read(inode, &bch->buffer[index * bch->sectsize],
+                                sector, nread);
+  if (ret <= 0)
+    {
+      fdbg("Read failed: %d\n", ret);
+      return ret < 0 ? ret : -EIO;
+    }
+
+  bch->ncached = index + ret;
+  return OK;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -73,7 +157,8 @@
  * Name: bchlib_flushsector
  *
  * Description:
- *   Flush the current contents of the sector buffer (if dirty)
+ *   Flush the current contents of the sector buffer (if dirty).  All dirty
+ *   sectors are written with one transfer.
  *
  * Assumptions:
  *   Caller must assume mutual exclusion
@@ -83,18 +168,28 @@
 int bchlib_flushsector(FAR struct bchlib_s *bch)
 {
   FAR struct inode *inode;
+  size_t nsectors;
   ssize_t ret = OK;
 
   if (bch->dirty)
     {
-      inode = bch->inode;
-      ret = inode->u.i_bops->write(inode, bch->buffer, bch->sector, 1);
+      inode    = bch->inode;
+      nsectors = bch->dirtylast - bch->dirtyfirst + 1;
+      ret      = inode->u.i_bops->write(inode,
+                   &bch->buffer[bch->dirtyfirst * bch->sectsize],
+                   bch->sector + bch->dirtyfirst, nsectors);
       if (ret < 0)
         {
-          fdbg("Write failed: %d\n");
+          fdbg("Write failed: %d\n", ret);
+        }
+      else
+        {
+          ret = OK;
         }
+
       bch->dirty = false;
     }
+
   return (int)ret;
 }
 
@@ -102,7 +197,9 @@ int bchlib_flushsector(FAR struct bchlib_s *bch)
  * Name: bchlib_readsector
  *
  * Description:
- *   Flush the current contents of the sector buffer (if dirty)
+ *   Make sure that the sector is in the sector buffer, reading it from the
+ *   device if necessary.  If the sector follows the last sector that was
+ *   read, the following sectors are read ahead to fill the cache.
  *
  * Assumptions:
  *   Caller must assume mutual exclusion
@@ -111,23 +208,94 @@ int bchlib_flushsector(FAR struct bchlib_s *bch)
 
 int bchlib_readsector(FAR struct bchlib_s *bch, size_t sector)
 {
-  FAR struct inode *inode;
-  ssize_t ret = OK;
+  size_t nread = 1;
 
-  if (bch->sector != sector)
+  if (sector == bch->rdnext)
     {
-      inode = bch->inode;
+      nread = CONFIG_BCH_NCACHESECTORS;
+    }
 
-      (void)bchlib_flushsector(bch);
-      bch->sector = (size_t)-1;
+  return bchlib_cachesector(bch, sector, nread);
+}
 
-      ret = inode->u.i_bops->read(inode, bch->buffer, sector, 1);
-      if (ret < 0)
+/****************************************************************************
+ * Name: bchlib_writesector
+ *
+ * Description:
+ *   Write nbytes at offset in the sector through the sector buffer.  The
+ *   sector is read from the device first only if it is not completely
+ *   overwritten.  The data is written to the device when the sector buffer
+ *   is flushed.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+int bchlib_writesector(FAR struct bchlib_s *bch, size_t sector,
+                       FAR const uint8_t *buffer, uint16_t offset,
+                       uint16_t nbytes)
+{
+  uint16_t index;
+  int ret;
+
+  ret = bchlib_cachesector(bch, sector, nbytes < bch->sectsize ? 1 : 0);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memcpy(bchlib_sectbuffer(bch, sector) + offset, buffer, nbytes);
+
+  /* Extend the range of dirty sectors */
+
+  index = sector - bch->sector;
+  if (!bch->dirty)
+    {
+      bch->dirtyfirst = index;
+      bch->dirtylast  = index;
+      bch->dirty      = true;
+    }
+  else if (index < bch->dirtyfirst)
+    {
+      bch->dirtyfirst = index;
+    }
+  else if (index > bch->dirtylast)
+    {
+      bch->dirtylast  = index;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: bchlib_syncrange
+ *
+ * Description:
+ *   Sectors are about to be transferred directly between the caller's
+ *   buffer and the device.  If any are cached, flush the sector buffer so
+ *   that the device is up to date.  If 'discard' is true, the sectors are
+ *   about to be overwritten and the cached copies are discarded.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+int bchlib_syncrange(FAR struct bchlib_s *bch, size_t sector,
+                     size_t nsectors, bool discard)
+{
+  int ret = OK;
+
+  if (bch->ncached > 0 && sector < bch->sector + bch->ncached &&
+      sector + nsectors > bch->sector)
+    {
+      ret = bchlib_flushsector(bch);
+      if (discard)
         {
-          fdbg("Read failed: %d\n");
+          bch->ncached = 0;
         }
-      bch->sector = sector;
     }
-  return (int)ret;
-}
 
+  return ret;
+}
@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/bch/bchlib_read.c
  *
- *   Copyright (C) 2008-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2008-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -87,6 +87,7 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
   uint16_t sectoffset;
   size_t   nbytes;
   size_t   bytesread;
+  size_t   i;
   int      ret;
 
   /* Get rid of this special case right away */
@@ -115,7 +116,11 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
     {
       /* Read the sector into the sector buffer */
 
-      bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
       /* Copy the tail end of the sector to the user buffer */
 
@@ -128,12 +133,13 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
           nbytes = len;
         }
 
-      memcpy(buffer, &bch->buffer[sectoffset], nbytes);
+      memcpy(buffer, bchlib_sectbuffer(bch, sector) + sectoffset, nbytes);
 
       /* Adjust pointers and counts */
 
-      sectoffset = 0;
+      sectoffset  = 0;
       sector++;
+      bch->rdnext = sector;
 
       if (sector >= bch->nsectors)
         {
@@ -145,8 +151,10 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
       len       -= nbytes;
     }
 
-  /* Then read all of the full sectors following the partial sector directly
-   * into the user buffer.
+  /* Then read all of the full sectors following the partial sector.  If
+   * there are at least as many as the sector buffer holds, they are read
+   * directly into the user buffer.  Otherwise, they are copied from the
+   * sector buffer so that the sectors that follow are read ahead.
    */
 
   if (len >= bch->sectsize )
@@ -157,21 +165,48 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
           nsectors = bch->nsectors - sector;
         }
 
-      ret = bch->inode->u.i_bops->read(bch->inode, (FAR uint8_t *)buffer,
-                                       sector, nsectors);
-      if (ret < 0)
+      if (nsectors >= CONFIG_BCH_NCACHESECTORS)
         {
-          fdbg("Read failed: %d\n");
-          return ret;
+          /* Make sure that the device holds any modified sectors first */
+
+          ret = bchlib_syncrange(bch, sector, nsectors, false);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          ret = bch->inode->u.i_bops->read(bch->inode, (FAR uint8_t *)buffer,
+                                           sector, nsectors);
+          if (ret < 0)
+            {
+              fdbg("Read failed: %d\n", ret);
+              return ret;
+            }
+        }
+      else
+        {
+          for (i = 0; i < nsectors; i++)
+            {
+              ret = bchlib_readsector(bch, sector + i);
+              if (ret < 0)
+                {
+                  return ret;
+                }
+
+              memcpy(&buffer[i * bch->sectsize],
+                     bchlib_sectbuffer(bch, sector + i), bch->sectsize);
+              bch->rdnext = sector + i + 1;
+            }
         }
 
       /* Adjust pointers and counts */
 
-      sectoffset = 0;
-      sector    += nsectors;
+      sectoffset  = 0;
+      sector     += nsectors;
+      bch->rdnext = sector;
 
-      nbytes     = nsectors * bch->sectsize;
-      bytesread += nbytes;
+      nbytes      = nsectors * bch->sectsize;
+      bytesread  += nbytes;
 
       if (sector >= bch->nsectors)
         {
@@ -188,15 +223,20 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
     {
       /* Read the sector into the sector buffer */
 
-      bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
       /* Copy the head end of the sector to the user buffer */
 
-      memcpy(buffer, bch->buffer, len);
+      memcpy(buffer, bchlib_sectbuffer(bch, sector), len);
 
       /* Adjust counts */
 
-      bytesread += len;
+      bch->rdnext = sector + 1;
+      bytesread  += len;
     }
 
   return bytesread;
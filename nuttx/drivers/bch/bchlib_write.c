@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/bch/bchlib_write.c
  *
- *   Copyright (C) 2008-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2008-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -88,6 +88,7 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
   uint16_t sectoffset;
   size_t   nbytes;
   size_t   byteswritten;
+  size_t   i;
   int      ret;
 
   /* Get rid of this special case right away */
@@ -112,11 +113,9 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
   byteswritten = 0;
   if (sectoffset > 0)
     {
-      /* Read the full sector into the sector buffer */
-
-      bchlib_readsector(bch, sector);
-
-      /* Copy the tail end of the sector from the user buffer */
+      /* Copy the tail end of the sector from the user buffer into the
+       * sector buffer.
+       */
 
       if (sectoffset + len > bch->sectsize)
         {
@@ -127,26 +126,32 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
           nbytes = len;
         }
 
-      memcpy(&bch->buffer[sectoffset], buffer, nbytes);
-      bch->dirty = true;
+      ret = bchlib_writesector(bch, sector, (FAR const uint8_t *)buffer,
+                               sectoffset, nbytes);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
       /* Adjust pointers and counts */
 
       sectoffset    = 0;
       sector++;
+      byteswritten  = nbytes;
 
       if (sector >= bch->nsectors)
         {
-          return nbytes;
+          goto flush;
         }
 
-      byteswritten  = nbytes;
       buffer       += nbytes;
       len          -= nbytes;
     }
 
-  /* Then write all of the full sectors following the partial sector
-   * directly from the user buffer.
+  /* Then write all of the full sectors following the partial sector.  If
+   * there are at least as many as the sector buffer holds, they are written
+   * directly from the user buffer.  Otherwise, they are added to the sector
+   * buffer so that small sequential writes are coalesced.
    */
 
   if (len >= bch->sectsize )
@@ -157,14 +162,40 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
           nsectors = bch->nsectors - sector;
         }
 
-      /* Write the contiguous sectors */
-
-      ret = bch->inode->u.i_bops->write(bch->inode, (FAR uint8_t *)buffer,
-                                        sector, nsectors);
-      if (ret < 0)
+      if (nsectors >= CONFIG_BCH_NCACHESECTORS)
         {
-          fdbg("Write failed: %d\n", ret);
-          return ret;
+          /* Write any modified sectors first and discard cached copies of
+           * the sectors that are about to be overwritten.
+           */
+
+          ret = bchlib_syncrange(bch, sector, nsectors, true);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          /* Write the contiguous sectors */
+
+          ret = bch->inode->u.i_bops->write(bch->inode, (FAR uint8_t *)buffer,
+                                            sector, nsectors);
+          if (ret < 0)
+            {
+              fdbg("Write failed: %d\n", ret);
+              return ret;
+            }
+        }
+      else
+        {
+          for (i = 0; i < nsectors; i++)
+            {
+              ret = bchlib_writesector(bch, sector + i,
+                      (FAR const uint8_t *)&buffer[i * bch->sectsize],
+                      0, bch->sectsize);
+              if (ret < 0)
+                {
+                  return ret;
+                }
+            }
         }
 
       /* Adjust pointers and counts */
@@ -177,7 +208,7 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
 
       if (sector >= bch->nsectors)
         {
-          return byteswritten;
+          goto flush;
         }
 
       buffer    += nbytes;
@@ -188,29 +219,37 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
 
   if (len > 0)
     {
-      /* Read the sector into the sector buffer */
-
-      bchlib_readsector(bch, sector);
+      /* Copy the head end of the sector from the user buffer into the
+       * sector buffer.
+       */
 
-      /* Copy the head end of the sector from the user buffer */
-
-      memcpy(bch->buffer, buffer, len);
-      bch->dirty = true;
+      ret = bchlib_writesector(bch, sector, (FAR const uint8_t *)buffer,
+                               0, len);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
       /* Adjust counts */
 
       byteswritten += len;
     }
 
-  /* Finally, flush any cached writes to the device as well */
+  /* Finally, flush any cached writes to the device as well.  If there is
+   * more than one sector in the sector buffer, the sectors are written back
+   * later (when the cache is re-used, when the device is closed, or on
+   * BIOC_FLUSH) so that sequential writes are coalesced.
+   */
 
+flush:
+#if CONFIG_BCH_NCACHESECTORS < 2
   ret = bchlib_flushsector(bch);
   if (ret < 0)
     {
       fdbg("Flush failed: %d\n", ret);
       return ret;
     }
+#endif
 
   return byteswritten;
 }
-
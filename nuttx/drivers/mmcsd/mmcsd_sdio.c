@@ -69,6 +69,23 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Configuration ************************************************************/
+/* Read-ahead and write buffering (see drivers/rwbuffer.c).  The buffer
+ * sizes are in units of 512 byte blocks.
+ */
+
+#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_READAHEAD)
+#  define CONFIG_MMCSD_RWBUFFER 1
+#endif
+
+#ifndef CONFIG_MMCSD_NRHBLOCKS
+#  define CONFIG_MMCSD_NRHBLOCKS 8
+#endif
+
+#ifndef CONFIG_MMCSD_NWRBLOCKS
+#  define CONFIG_MMCSD_NWRBLOCKS 8
+#endif
+
 /* The maximum number of references on the driver (because a uint8_t is used.
  * Use a larger type if more references are needed.
  */
@@ -140,7 +157,7 @@ struct mmcsd_state_s
 #endif
   /* Read-ahead and write buffering support */
 
-#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_READAHEAD)
+#ifdef CONFIG_MMCSD_RWBUFFER
   struct rwbuffer_s rwbuffer;
 #endif
 };
@@ -199,7 +216,7 @@ static ssize_t mmcsd_readsingle(FAR struct mmcsd_state_s *priv,
 static ssize_t mmcsd_readmultiple(FAR struct mmcsd_state_s *priv,
                  FAR uint8_t *buffer, off_t startblock, size_t nblocks);
 #endif
-#ifdef CONFIG_FS_READAHEAD
+#ifdef CONFIG_MMCSD_RWBUFFER
 static ssize_t mmcsd_reload(FAR void *dev, FAR uint8_t *buffer,
                  off_t startblock, size_t nblocks);
 #endif
@@ -210,7 +227,7 @@ static ssize_t mmcsd_writesingle(FAR struct mmcsd_state_s *priv,
 static ssize_t mmcsd_writemultiple(FAR struct mmcsd_state_s *priv,
                  FAR const uint8_t *buffer, off_t startblock, size_t nblocks);
 #endif
-#ifdef CONFIG_FS_WRITEBUFFER
+#ifdef CONFIG_MMCSD_RWBUFFER
 static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
                  off_t startblock, size_t nblocks);
 #endif
@@ -1477,11 +1494,12 @@ static ssize_t mmcsd_readmultiple(FAR struct mmcsd_state_s *priv,
  *
  * Description:
  *   Reload the specified number of sectors from the physical device into the
- *   read-ahead buffer.
+ *   read-ahead buffer.  This is called from the buffer logic, perhaps on the
+ *   worker thread, so it must get exclusive access to the slot itself.
  *
  ****************************************************************************/
 
-#ifdef CONFIG_FS_READAHEAD
+#ifdef CONFIG_MMCSD_RWBUFFER
 static ssize_t mmcsd_reload(FAR void *dev, FAR uint8_t *buffer,
                             off_t startblock, size_t nblocks)
 {
@@ -1492,7 +1510,9 @@ static ssize_t mmcsd_reload(FAR void *dev, FAR uint8_t *buffer,
 #endif
   ssize_t ret;
 
-  DEBUGASSERT(priv != NULL && buffer != NULL && nblocks > 0)
+  DEBUGASSERT(priv != NULL && buffer != NULL && nblocks > 0);
+
+  mmcsd_takesem(priv);
 
 #ifdef CONFIG_MMCSD_MULTIBLOCK_DISABLE
   /* Read each block using only the single block transfer method */
@@ -1512,6 +1532,11 @@ static ssize_t mmcsd_reload(FAR void *dev, FAR uint8_t *buffer,
 
       buffer += priv->blocksize;
     }
+
+  if (ret >= 0)
+    {
+      ret = nblocks;
+    }
 #else
   /* Use either the single- or muliple-block transfer method */
 
@@ -1525,6 +1550,8 @@ static ssize_t mmcsd_reload(FAR void *dev, FAR uint8_t *buffer,
     }
 #endif
 
+  mmcsd_givesem(priv);
+
   /* On success, return the number of blocks read */
 
   return ret;
@@ -1801,21 +1828,24 @@ static ssize_t mmcsd_writemultiple(FAR struct mmcsd_state_s *priv,
  *
  * Description:
  *   Flush the specified number of sectors from the write buffer to the card.
+ *   Like mmcsd_reload(), this gets exclusive access to the slot itself.
  *
  ****************************************************************************/
 
-#if defined(CONFIG_FS_WRITABLE) && defined(CONFIG_FS_WRITEBUFFER)
+#if defined(CONFIG_FS_WRITABLE) && defined(CONFIG_MMCSD_RWBUFFER)
 static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
                            off_t startblock, size_t nblocks)
 {
   FAR struct mmcsd_state_s *priv = (FAR struct mmcsd_state_s *)dev;
-#ifndef CONFIG_MMCSD_MULTIBLOCK_DISABLE
+#ifdef CONFIG_MMCSD_MULTIBLOCK_DISABLE
   size_t block;
   size_t endblock;
 #endif
   ssize_t ret;
 
-  DEBUGASSERT(priv != NULL && buffer != NULL && nblocks > 0)
+  DEBUGASSERT(priv != NULL && buffer != NULL && nblocks > 0);
+
+  mmcsd_takesem(priv);
 
 #ifdef CONFIG_MMCSD_MULTIBLOCK_DISABLE
   /* Write each block using only the single block transfer method */
@@ -1835,6 +1865,11 @@ static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
 
       buffer += priv->blocksize;
     }
+
+  if (ret >= 0)
+    {
+      ret = nblocks;
+    }
 #else
   if (nblocks == 1)
     {
@@ -1846,6 +1881,8 @@ static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
     }
 #endif
 
+  mmcsd_givesem(priv);
+
   /* On success, return the number of blocks written */
 
   return ret;
@@ -1916,7 +1953,7 @@ static ssize_t mmcsd_read(FAR struct inode *inode, unsigned char *buffer,
                           size_t startsector, unsigned int nsectors)
 {
   FAR struct mmcsd_state_s *priv;
-#if !defined(CONFIG_FS_READAHEAD) && defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
+#if !defined(CONFIG_MMCSD_RWBUFFER) && defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
   size_t sector;
   size_t endsector;
 #endif
@@ -1929,14 +1966,17 @@ static ssize_t mmcsd_read(FAR struct inode *inode, unsigned char *buffer,
 
   if (nsectors > 0)
     {
-      mmcsd_takesem(priv);
-
-#if defined(CONFIG_FS_READAHEAD)
-      /* Get the data from the read-ahead buffer */
+#ifdef CONFIG_MMCSD_RWBUFFER
+      /* Get the data through the read-ahead buffer.  The semaphore is not
+       * held here:  It is taken by mmcsd_reload() when the buffer logic
+       * needs to access the card.
+       */
 
       ret = rwb_read(&priv->rwbuffer, startsector, nsectors, buffer);
+#else
+      mmcsd_takesem(priv);
 
-#elif defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
+#if defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
       /* Read each block using only the single block transfer method */
 
       endsector = startsector + nsectors - 1;
@@ -1954,6 +1994,11 @@ static ssize_t mmcsd_read(FAR struct inode *inode, unsigned char *buffer,
 
           buffer += priv->blocksize;
         }
+
+      if (ret >= 0)
+        {
+          ret = nsectors;
+        }
 #else
       /* Use either the single- or muliple-block transfer method */
 
@@ -1967,6 +2012,7 @@ static ssize_t mmcsd_read(FAR struct inode *inode, unsigned char *buffer,
         }
 #endif
       mmcsd_givesem(priv);
+#endif /* CONFIG_MMCSD_RWBUFFER */
     }
 
   /* On success, return the number of blocks read */
@@ -1988,7 +2034,7 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
                            size_t startsector, unsigned int nsectors)
 {
   FAR struct mmcsd_state_s *priv;
-#if !defined(CONFIG_FS_WRITEBUFFER) && defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
+#if !defined(CONFIG_MMCSD_RWBUFFER) && defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
   size_t sector;
   size_t endsector;
 #endif
@@ -1998,14 +2044,17 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
   DEBUGASSERT(inode && inode->i_private);
   priv = (FAR struct mmcsd_state_s *)inode->i_private;
 
-  mmcsd_takesem(priv);
-
-#if defined(CONFIG_FS_WRITEBUFFER)
-  /* Write the data to the write buffer */
+#ifdef CONFIG_MMCSD_RWBUFFER
+  /* Write the data through the write buffer (which also keeps the
+   * read-ahead buffer coherent).  mmcsd_flush() takes the semaphore when
+   * the data is written to the card.
+   */
 
   ret = rwb_write(&priv->rwbuffer, startsector, nsectors, buffer);
+#else
+  mmcsd_takesem(priv);
 
-#elif defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
+#if defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
   /* Write each block using only the single block transfer method */
 
   endsector = startsector + nsectors - 1;
@@ -2023,6 +2072,11 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
 
       buffer += priv->blocksize;
     }
+
+  if (ret >= 0)
+    {
+      ret = nsectors;
+    }
 #else
   /* Use either the single- or multiple-block transfer method */
 
@@ -2036,6 +2090,7 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
     }
 #endif
   mmcsd_givesem(priv);
+#endif /* CONFIG_MMCSD_RWBUFFER */
 
   /* On success, return the number of blocks written */
 
@@ -2153,12 +2208,35 @@ static int mmcsd_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
       }
       break;
 
+#ifdef CONFIG_MMCSD_RWBUFFER
+    case BIOC_RWBSTATS: /* Get read-ahead/write buffer statistics */
+      {
+        fvdbg("BIOC_RWBSTATS\n");
+        ret = rwb_stats(&priv->rwbuffer,
+                        (FAR struct rwb_stats_s *)((uintptr_t)arg));
+      }
+      break;
+#endif
+
     default:
       ret = -ENOTTY;
       break;
     }
 
   mmcsd_givesem(priv);
+
+#ifdef CONFIG_MMCSD_RWBUFFER
+  /* Discard any data buffered for the ejected card.  This must be done
+   * without holding the semaphore because the buffer logic takes it when
+   * it calls back into mmcsd_reload() or mmcsd_flush().
+   */
+
+  if (cmd == BIOC_EJECT)
+    {
+      (void)rwb_mediaremoved(&priv->rwbuffer);
+    }
+#endif
+
   return ret;
 }
 
@@ -2187,6 +2265,17 @@ static void mmcsd_mediachange(FAR void *arg)
   fvdbg("arg: %p\n", arg);
   DEBUGASSERT(priv);
 
+  /* Any buffered data belongs to the card that was (or is being) replaced.
+   * Discard it before the new card is probed so that no stale data can be
+   * read from (or written to) the new card.  This must be done before
+   * taking the slot semaphore:  The buffer callouts take the slot semaphore
+   * while holding the buffer semaphores.
+   */
+
+#ifdef CONFIG_MMCSD_RWBUFFER
+  (void)rwb_mediaremoved(&priv->rwbuffer);
+#endif
+
   /* Is there a card present in the slot? */
   
   mmcsd_takesem(priv);
@@ -2597,7 +2686,8 @@ static int mmcsd_cardidentify(FAR struct mmcsd_state_s *priv)
    * operating condition. CMD 8 is reserved on SD version 1.0 and MMC.
    *
    * CMD8 Argument:
-   *    [31:12]: Reserved (shall be set to '0')   *    [11:8]: Supply Voltage (VHS) 0x1 (Range: 2.7-3.6 V)
+   *    [31:12]: Reserved (shall be set to '0')
+   *    [11:8]: Supply Voltage (VHS) 0x1 (Range: 2.7-3.6 V)
    *    [7:0]: Check Pattern (recommended 0xaa)
    * CMD8 Response: R7
    */
@@ -2888,6 +2978,12 @@ static int mmcsd_probe(FAR struct mmcsd_state_s *priv)
                 fvdbg("Capacity: %lu Kbytes\n", (unsigned long)(priv->capacity / 1024));
                 priv->mediachanged = true;
 
+#ifdef CONFIG_MMCSD_RWBUFFER
+                /* Let the buffer logic know the size of the new card */
+
+                priv->rwbuffer.nblocks = priv->nblocks;
+#endif
+
                 /* Set up to receive asynchronous, media removal events */
 
                 SDIO_CALLBACKENABLE(priv->dev, SDIOMEDIA_EJECTED);
@@ -3139,9 +3235,29 @@ int mmcsd_slotinitialize(int minor, FAR struct sdio_dev_s *dev)
             }
         }
 
-      /* Initialize buffering */
+      /* Initialize buffering.  The block size is always 512 bytes (see
+       * mmcsd_decodeCSD()).  The number of blocks is zero if there is no
+       * card in the slot; it is updated by mmcsd_probe().
+       */
 
-#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_READAHEAD)
+#ifdef CONFIG_MMCSD_RWBUFFER
+      priv->rwbuffer.blocksize   = 1 << 9;
+      priv->rwbuffer.nblocks     = priv->nblocks;
+      priv->rwbuffer.dev         = (FAR void *)priv;
+      priv->rwbuffer.rhreload    = mmcsd_reload;
+#ifdef CONFIG_FS_WRITABLE
+      priv->rwbuffer.wrflush     = mmcsd_flush;
+#endif
+#ifdef CONFIG_FS_WRITEBUFFER
+#ifdef CONFIG_FS_WRITABLE
+      priv->rwbuffer.wrmaxblocks = CONFIG_MMCSD_NWRBLOCKS;
+#else
+      priv->rwbuffer.wrmaxblocks = 0;
+#endif
+#endif
+#ifdef CONFIG_FS_READAHEAD
+      priv->rwbuffer.rhmaxblocks = CONFIG_MMCSD_NRHBLOCKS;
+#endif
 
       ret = rwb_initialize(&priv->rwbuffer);
       if (ret < 0)
@@ -3167,7 +3283,7 @@ int mmcsd_slotinitialize(int minor, FAR struct sdio_dev_s *dev)
   return OK;
 
 errout_with_buffers:
-#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_READAHEAD)
+#ifdef CONFIG_MMCSD_RWBUFFER
   rwb_uninitialize(&priv->rwbuffer);
 errout_with_hwinit:
 #endif
@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/mtd/ftl.c
  *
- *   Copyright (C) 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -60,13 +60,91 @@
  ****************************************************************************/
 
 #if defined(CONFIG_FS_READAHEAD) || (defined(CONFIG_FS_WRITABLE) && defined(CONFIG_FS_WRITEBUFFER))
-#  defined CONFIG_FTL_RWBUFFER 1
+#  define CONFIG_FTL_RWBUFFER 1
+#endif
+
+/* Wear-levelling configuration.  CONFIG_FTL_NSPARE is the number of erase
+ * blocks that are not included in the capacity of the block device.  At
+ * least two are needed:  One that is being filled and one that is held in
+ * reserve as the destination of garbage collection.  More spare erase
+ * blocks reduce the amount of data that must be copied by garbage
+ * collection when the device is nearly full.
+ *
+ * If an erase block has been erased CONFIG_FTL_WLTHRESHOLD more times than
+ * the least worn erase block that holds data, then the data in the least
+ * worn erase block is moved (static wear levelling).
+ */
+
+#ifdef CONFIG_FTL_WEARLEVEL
+#  ifndef CONFIG_FTL_NSPARE
+#    define CONFIG_FTL_NSPARE 2
+#  endif
+#  if CONFIG_FTL_NSPARE < 2
+#    error "CONFIG_FTL_NSPARE must be at least 2"
+#  endif
+#  ifndef CONFIG_FTL_WLTHRESHOLD
+#    define CONFIG_FTL_WLTHRESHOLD 64
+#  endif
+
+/* Each erase block begins with one or more header sectors:
+ *
+ *   Offset  Size  Contents
+ *   0       4     Magic number ("FTLw")
+ *   4       4     Erase count (little endian)
+ *   8       4     Sequence number.  Erased until the erase block is opened
+ *                 for writing.  Then the order in which erase blocks were
+ *                 opened.
+ *   12      2*n   One entry for each of the n data sectors that follow the
+ *                 header sectors:  The logical sector number held in the
+ *                 data sector, FTL_SLOTFREE if the data sector has not been
+ *                 written, or FTL_SLOTBAD if it must not be used.
+ *
+ * The header is written when the erase block is erased and then re-written
+ * as entries are added.  Like NXFFS, this relies on the FLASH allowing
+ * erased bytes of a previously written block to be written later.  The
+ * FLASH must erase to 0xff.
+ *
+ * A logical sector may have been written several times.  The newest copy is
+ * the one in the erase block with the largest sequence number and, within
+ * that erase block, the one in the last data sector.
+ */
+
+#  define FTL_HDR_MAGIC      0
+#  define FTL_HDR_ECOUNT     4
+#  define FTL_HDR_SEQNO      8
+#  define FTL_HDR_ENTRIES    12
+#  define FTL_HDR_ENTRY(n)   (FTL_HDR_ENTRIES + ((n) << 1))
+
+#  define FTL_ERASEDSTATE    0xff
+#  define FTL_SLOTFREE       0xffff     /* Data sector not yet written */
+#  define FTL_SLOTBAD        0xfffe     /* Data sector must not be used */
+#  define FTL_UNMAPPED       0xffff     /* Logical sector never written */
+#  define FTL_NOBLOCK        0xffff     /* No erase block */
+#  define FTL_NOSEQNO        0xffffffff /* Erase block not yet opened */
+
+/* Erase block states */
+
+#  define FTL_EBFREE         0          /* Erased, ready to be opened */
+#  define FTL_EBUSED         1          /* Opened and (maybe) holding data */
+#  define FTL_EBERASE        2          /* Must be erased (during mount) */
 #endif
 
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_FTL_WEARLEVEL
+/* The RAM state of one erase block */
+
+struct ftl_eblock_s
+{
+  uint32_t              ecount;  /* Number of times the block was erased */
+  uint32_t              seqno;   /* Order in which the block was opened */
+  uint16_t              nvalid;  /* Number of data sectors still mapped */
+  uint8_t               state;   /* See FTL_EB* definitions */
+};
+#endif
+
 struct ftl_struct_s
 {
   FAR struct mtd_dev_s *mtd;     /* Contained MTD interface */
@@ -75,7 +153,20 @@ struct ftl_struct_s
   struct rwbuffer_s     rwb;     /* Read-ahead/write buffer support */
 #endif
   uint16_t              blkper;  /* R/W blocks per erase block */
-#ifdef CONFIG_FS_WRITABLE
+#ifdef CONFIG_FTL_WEARLEVEL
+  uint16_t              nhdr;    /* Header sectors per erase block */
+  uint16_t              ndata;   /* Data sectors per erase block */
+  uint16_t              nfree;   /* Number of free erase blocks */
+  uint16_t              open;    /* Erase block being filled (or FTL_NOBLOCK) */
+  uint16_t              slot;    /* Next data sector in the open erase block */
+  uint32_t              seqno;   /* Next erase block sequence number */
+  size_t                nsectors; /* Number of logical sectors */
+  FAR uint16_t         *map;     /* Logical to physical sector map */
+  FAR struct ftl_eblock_s *eblocks; /* State of each erase block */
+  FAR uint8_t          *hdr;     /* Header of the open erase block */
+  FAR uint8_t          *scratch; /* Another header plus one sector */
+  struct ftl_stats_s    stats;   /* Statistics for BIOC_FTLSTATS */
+#elif defined(CONFIG_FS_WRITABLE)
   FAR uint8_t          *eblock;  /* One, in-memory erase block */
 #endif
 };
@@ -117,6 +208,12 @@ static const struct block_operations g_bops =
   ftl_ioctl     /* ioctl    */
 };
 
+#ifdef CONFIG_FTL_WEARLEVEL
+/* The magic number at the beginning of each erase block header */
+
+static const uint8_t g_ftlmagic[4] = { 'F', 'T', 'L', 'w' };
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -147,6 +244,768 @@ static int ftl_close(FAR struct inode *inode)
   return OK;
 }
 
+/****************************************************************************
+ * Name: ftl_getle16, ftl_getle32, ftl_putle16, and ftl_putle32
+ *
+ * Description: Get/put little endian values in an erase block header
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static inline uint16_t ftl_getle16(FAR const uint8_t *src)
+{
+  return (uint16_t)src[1] << 8 | (uint16_t)src[0];
+}
+
+static inline uint32_t ftl_getle32(FAR const uint8_t *src)
+{
+  return (uint32_t)ftl_getle16(&src[2]) << 16 | (uint32_t)ftl_getle16(src);
+}
+
+static inline void ftl_putle16(FAR uint8_t *dest, uint16_t val)
+{
+  dest[0] = val & 0xff;
+  dest[1] = val >> 8;
+}
+
+static inline void ftl_putle32(FAR uint8_t *dest, uint32_t val)
+{
+  ftl_putle16(dest, (uint16_t)(val & 0xffff));
+  ftl_putle16(&dest[2], (uint16_t)(val >> 16));
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_erase
+ *
+ * Description:  Erase one erase block and write a new header that retains
+ *   the erase count.  The erase block is then free.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_erase(FAR struct ftl_struct_s *dev, uint16_t eblock)
+{
+  FAR struct ftl_eblock_s *eb = &dev->eblocks[eblock];
+  FAR uint8_t *hdr = dev->scratch;
+  ssize_t nxfrd;
+  int ret;
+
+  ret = MTD_ERASE(dev->mtd, eblock, 1);
+  if (ret < 0)
+    {
+      fdbg("Erase block=%d failed: %d\n", eblock, ret);
+      return ret;
+    }
+
+  eb->ecount++;
+  eb->seqno  = FTL_NOSEQNO;
+  eb->nvalid = 0;
+  eb->state  = FTL_EBFREE;
+  dev->nfree++;
+  dev->stats.st_nerased++;
+
+  /* Write the first header sector.  The sequence number and the entries
+   * are left in the erased state.
+   */
+
+  memset(hdr, FTL_ERASEDSTATE, dev->geo.blocksize);
+  memcpy(&hdr[FTL_HDR_MAGIC], g_ftlmagic, 4);
+  ftl_putle32(&hdr[FTL_HDR_ECOUNT], eb->ecount);
+
+  nxfrd = MTD_BWRITE(dev->mtd, eblock * dev->blkper, 1, hdr);
+  if (nxfrd != 1)
+    {
+      fdbg("Write header of erase block %d failed: %d\n", eblock, nxfrd);
+      return -EIO;
+    }
+
+  dev->stats.st_nhdrwrites++;
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_openblock
+ *
+ * Description:  Select a free erase block and assign it the next sequence
+ *   number so that it can be filled with data sectors.  Normally, the
+ *   least worn free erase block is selected (dynamic wear levelling).  When
+ *   static data is moved (static wear levelling), the most worn free erase
+ *   block is selected instead.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_openblock(FAR struct ftl_struct_s *dev, bool worn)
+{
+  FAR struct ftl_eblock_s *eb;
+  uint16_t best = FTL_NOBLOCK;
+  uint16_t i;
+  ssize_t nxfrd;
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      eb = &dev->eblocks[i];
+      if (eb->state == FTL_EBFREE &&
+          (best == FTL_NOBLOCK ||
+           (worn && eb->ecount > dev->eblocks[best].ecount) ||
+           (!worn && eb->ecount < dev->eblocks[best].ecount)))
+        {
+          best = i;
+        }
+    }
+
+  if (best == FTL_NOBLOCK)
+    {
+      return -ENOSPC;
+    }
+
+  eb         = &dev->eblocks[best];
+  eb->seqno  = dev->seqno++;
+  eb->state  = FTL_EBUSED;
+  dev->nfree--;
+
+  /* Write the sequence number into the first header sector */
+
+  memset(dev->hdr, FTL_ERASEDSTATE, dev->nhdr * dev->geo.blocksize);
+  memcpy(&dev->hdr[FTL_HDR_MAGIC], g_ftlmagic, 4);
+  ftl_putle32(&dev->hdr[FTL_HDR_ECOUNT], eb->ecount);
+  ftl_putle32(&dev->hdr[FTL_HDR_SEQNO], eb->seqno);
+
+  nxfrd = MTD_BWRITE(dev->mtd, best * dev->blkper, 1, dev->hdr);
+  if (nxfrd != 1)
+    {
+      fdbg("Write header of erase block %d failed: %d\n", best, nxfrd);
+      return -EIO;
+    }
+
+  dev->stats.st_nhdrwrites++;
+  dev->open = best;
+  dev->slot = 0;
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_wrhdr
+ *
+ * Description:  Write the header sectors of the open erase block that hold
+ *   the entries for n data sectors beginning with data sector 'slot'.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_wrhdr(FAR struct ftl_struct_s *dev, uint16_t slot, uint16_t n)
+{
+  uint16_t first;
+  uint16_t last;
+  ssize_t nxfrd;
+
+  first = FTL_HDR_ENTRY(slot) / dev->geo.blocksize;
+  last  = FTL_HDR_ENTRY(slot + n - 1) / dev->geo.blocksize;
+
+  nxfrd = MTD_BWRITE(dev->mtd, dev->open * dev->blkper + first,
+                     last - first + 1,
+                     &dev->hdr[first * dev->geo.blocksize]);
+  if (nxfrd != last - first + 1)
+    {
+      fdbg("Write header of erase block %d failed: %d\n", dev->open, nxfrd);
+      return -EIO;
+    }
+
+  dev->stats.st_nhdrwrites += last - first + 1;
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_wrslots
+ *
+ * Description:  Write sectors to the next data sectors of the open erase
+ *   block and record their logical sector numbers in its header.  The
+ *   previous copies of the logical sectors become stale.  If 'commit' is
+ *   false, the caller must write the header with ftl_wrhdr().
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_wrslots(FAR struct ftl_struct_s *dev, off_t lsector,
+                       FAR const uint8_t *buffer, uint16_t n, bool commit)
+{
+  uint16_t physical;
+  uint16_t previous;
+  uint16_t slot;
+  uint16_t i;
+  ssize_t nxfrd;
+
+  DEBUGASSERT(dev->open != FTL_NOBLOCK && n > 0 &&
+              dev->slot + n <= dev->ndata);
+
+  /* Write the data first.  If power is lost before the header is written,
+   * the data sectors are discarded when the FLASH is next mounted.
+   */
+
+  slot     = dev->slot;
+  physical = dev->open * dev->blkper + dev->nhdr + slot;
+  nxfrd    = MTD_BWRITE(dev->mtd, physical, n, buffer);
+  dev->slot += n;
+
+  if (nxfrd != n)
+    {
+      fdbg("Write %d sectors at %d failed: %d\n", n, physical, nxfrd);
+      return -EIO;
+    }
+
+  /* Update the map and the header entries */
+
+  for (i = 0; i < n; i++)
+    {
+      previous = dev->map[lsector + i];
+      if (previous != FTL_UNMAPPED)
+        {
+          dev->eblocks[previous / dev->blkper].nvalid--;
+        }
+
+      dev->map[lsector + i] = physical + i;
+      ftl_putle16(&dev->hdr[FTL_HDR_ENTRY(slot + i)], lsector + i);
+    }
+
+  dev->eblocks[dev->open].nvalid += n;
+
+  /* Then write the header sectors holding the new entries */
+
+  return commit ? ftl_wrhdr(dev, slot, n) : OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_move
+ *
+ * Description:  Copy the valid data sectors of an erase block to the open
+ *   erase block, then erase it.  The open erase block must have room for
+ *   all of them.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_move(FAR struct ftl_struct_s *dev, uint16_t eblock)
+{
+  FAR struct ftl_eblock_s *eb = &dev->eblocks[eblock];
+  FAR uint8_t *hdr = dev->scratch;
+  FAR uint8_t *sector = &dev->scratch[dev->nhdr * dev->geo.blocksize];
+  uint16_t physical;
+  uint16_t lsector;
+  uint16_t slot;
+  uint16_t i;
+  ssize_t nxfrd;
+  int ret;
+
+  DEBUGASSERT(eblock != dev->open &&
+              eb->nvalid <= dev->ndata - dev->slot);
+  slot = dev->slot;
+
+  nxfrd = MTD_BREAD(dev->mtd, eblock * dev->blkper, dev->nhdr, hdr);
+  if (nxfrd != dev->nhdr)
+    {
+      fdbg("Read header of erase block %d failed: %d\n", eblock, nxfrd);
+      return -EIO;
+    }
+
+  /* A data sector is valid if the map still refers to it */
+
+  for (i = 0; i < dev->ndata && eb->nvalid > 0; i++)
+    {
+      lsector  = ftl_getle16(&hdr[FTL_HDR_ENTRY(i)]);
+      physical = eblock * dev->blkper + dev->nhdr + i;
+
+      if (lsector < dev->nsectors && dev->map[lsector] == physical)
+        {
+          nxfrd = MTD_BREAD(dev->mtd, physical, 1, sector);
+          if (nxfrd != 1)
+            {
+              fdbg("Read sector %d failed: %d\n", physical, nxfrd);
+              return -EIO;
+            }
+
+          ret = ftl_wrslots(dev, lsector, sector, 1, false);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          dev->stats.st_ncopied++;
+        }
+    }
+
+  /* Commit all of the copies with one header update before the erase block
+   * is erased.
+   */
+
+  if (dev->slot > slot)
+    {
+      ret = ftl_wrhdr(dev, slot, dev->slot - slot);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return ftl_erase(dev, eblock);
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_allocate
+ *
+ * Description:  Make sure that the open erase block has at least one free
+ *   data sector.  When a new erase block must be opened, this is where
+ *   garbage collection and static wear levelling are performed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_allocate(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_eblock_s *eb;
+  uint32_t maxecount;
+  uint16_t victim;
+  uint16_t cold;
+  uint16_t i;
+  bool moved = false;
+  int ret;
+
+  while (dev->open == FTL_NOBLOCK || dev->slot >= dev->ndata)
+    {
+      /* The open erase block is full.  Find the erase block with the fewest
+       * valid sectors and the least worn erase block that holds data.
+       */
+
+      dev->open = FTL_NOBLOCK;
+      victim    = FTL_NOBLOCK;
+      cold      = FTL_NOBLOCK;
+      maxecount = 0;
+
+      for (i = 0; i < dev->geo.neraseblocks; i++)
+        {
+          eb = &dev->eblocks[i];
+          if (eb->ecount > maxecount)
+            {
+              maxecount = eb->ecount;
+            }
+
+          if (eb->state == FTL_EBUSED)
+            {
+              if (victim == FTL_NOBLOCK ||
+                  eb->nvalid < dev->eblocks[victim].nvalid)
+                {
+                  victim = i;
+                }
+
+              if (cold == FTL_NOBLOCK ||
+                  eb->ecount < dev->eblocks[cold].ecount)
+                {
+                  cold = i;
+                }
+            }
+        }
+
+      /* Static wear levelling:  Move the data of an erase block that has
+       * not been erased for a long time into the most worn free erase block
+       * (at most once per call).  The least worn erase block is then
+       * erased and reused.
+       */
+
+      if (!moved && cold != FTL_NOBLOCK && dev->nfree > 0 &&
+          maxecount - dev->eblocks[cold].ecount > CONFIG_FTL_WLTHRESHOLD)
+        {
+          ret = ftl_openblock(dev, true);
+          if (ret == OK)
+            {
+              ret = ftl_move(dev, cold);
+            }
+
+          dev->stats.st_nwlmoves++;
+          moved = true;
+        }
+
+      /* Garbage collection:  One free erase block is always kept in reserve
+       * so that the valid sectors of the victim can be copied.  Because
+       * CONFIG_FTL_NSPARE erase blocks are not included in the capacity,
+       * the victim always has at least one stale sector.
+       */
+
+      else if (dev->nfree < 2)
+        {
+          if (victim == FTL_NOBLOCK || dev->eblocks[victim].nvalid >= dev->ndata)
+            {
+              fdbg("No erase block to reclaim\n");
+              return -ENOSPC;
+            }
+
+          if (dev->eblocks[victim].nvalid == 0)
+            {
+              ret = ftl_erase(dev, victim);
+            }
+          else if (dev->nfree > 0)
+            {
+              ret = ftl_openblock(dev, false);
+              if (ret == OK)
+                {
+                  ret = ftl_move(dev, victim);
+                }
+            }
+          else
+            {
+              ret = -ENOSPC;
+            }
+
+          dev->stats.st_ngc++;
+        }
+
+      /* Otherwise, just open the least worn free erase block */
+
+      else
+        {
+          ret = ftl_openblock(dev, false);
+        }
+
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_mount
+ *
+ * Description:  Rebuild the logical to physical sector map from the erase
+ *   block headers.  If some erase blocks have a valid header, then the
+ *   FLASH holds an FTL volume and any erase block without a valid header
+ *   was being erased (or its header was being written) when power was
+ *   lost;  such erase blocks are erased again.  If no erase block has a
+ *   valid header, then the FLASH holds no FTL volume.  It is formatted only
+ *   if CONFIG_FTL_FORMAT is selected;  otherwise the mount fails rather
+ *   than destroy whatever the FLASH holds.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_mount(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_eblock_s *eb;
+  FAR uint8_t *hdr = dev->scratch;
+  FAR uint8_t *sector = &dev->scratch[dev->nhdr * dev->geo.blocksize];
+  uint32_t maxecount = 0;
+  uint16_t newest = FTL_NOBLOCK;
+  uint16_t nvalid = 0;
+  uint16_t physical;
+  uint16_t previous;
+  uint16_t lsector;
+  uint16_t i;
+  uint16_t j;
+  ssize_t nxfrd;
+  int ret;
+
+  /* Get the state of each erase block from its first header sector */
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      eb    = &dev->eblocks[i];
+      nxfrd = MTD_BREAD(dev->mtd, i * dev->blkper, 1, hdr);
+      if (nxfrd != 1)
+        {
+          fdbg("Read header of erase block %d failed: %d\n", i, nxfrd);
+          return -EIO;
+        }
+
+      if (memcmp(&hdr[FTL_HDR_MAGIC], g_ftlmagic, 4) != 0)
+        {
+          eb->state = FTL_EBERASE;
+          continue;
+        }
+
+      nvalid++;
+      eb->ecount = ftl_getle32(&hdr[FTL_HDR_ECOUNT]);
+      eb->seqno  = ftl_getle32(&hdr[FTL_HDR_SEQNO]);
+      if (eb->ecount > maxecount)
+        {
+          maxecount = eb->ecount;
+        }
+
+      if (eb->seqno == FTL_NOSEQNO)
+        {
+          eb->state = FTL_EBFREE;
+          dev->nfree++;
+        }
+      else
+        {
+          eb->state = FTL_EBUSED;
+          if (newest == FTL_NOBLOCK || eb->seqno > dev->eblocks[newest].seqno)
+            {
+              newest = i;
+            }
+        }
+    }
+
+  /* Don't erase the FLASH if it is not an FTL volume, unless formatting
+   * was requested.
+   */
+
+#ifndef CONFIG_FTL_FORMAT
+  if (nvalid == 0)
+    {
+      fdbg("No FTL volume (select CONFIG_FTL_FORMAT to format the FLASH)\n");
+      return -ENODEV;
+    }
+#endif
+
+  /* Then map each logical sector to its newest copy */
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      eb = &dev->eblocks[i];
+      if (eb->state != FTL_EBUSED)
+        {
+          continue;
+        }
+
+      nxfrd = MTD_BREAD(dev->mtd, i * dev->blkper, dev->nhdr, hdr);
+      if (nxfrd != dev->nhdr)
+        {
+          fdbg("Read header of erase block %d failed: %d\n", i, nxfrd);
+          return -EIO;
+        }
+
+      for (j = 0; j < dev->ndata; j++)
+        {
+          lsector = ftl_getle16(&hdr[FTL_HDR_ENTRY(j)]);
+          if (lsector >= dev->nsectors)
+            {
+              continue;
+            }
+
+          /* A copy in a later erase block, or later in the same erase
+           * block, is newer.
+           */
+
+          physical = i * dev->blkper + dev->nhdr + j;
+          previous = dev->map[lsector];
+          if (previous != FTL_UNMAPPED)
+            {
+              FAR struct ftl_eblock_s *prev =
+                &dev->eblocks[previous / dev->blkper];
+
+              if (prev->seqno > eb->seqno ||
+                  (prev == eb && previous > physical))
+                {
+                  continue;
+                }
+
+              prev->nvalid--;
+            }
+
+          dev->map[lsector] = physical;
+          eb->nvalid++;
+        }
+    }
+
+  /* Continue filling the newest erase block after its last entry.  Data
+   * sectors written after that entry (before a power loss) must not be
+   * used.  If the newest erase block has no entries at all, power was lost
+   * just after it was opened (perhaps by garbage collection).  It is erased
+   * so that the reserved free erase block is not lost.
+   */
+
+  dev->open = FTL_NOBLOCK;
+  if (newest != FTL_NOBLOCK)
+    {
+      dev->seqno = dev->eblocks[newest].seqno + 1;
+
+      nxfrd = MTD_BREAD(dev->mtd, newest * dev->blkper, dev->nhdr, dev->hdr);
+      if (nxfrd != dev->nhdr)
+        {
+          fdbg("Read header of erase block %d failed: %d\n", newest, nxfrd);
+          return -EIO;
+        }
+
+      for (j = dev->ndata;
+           j > 0 && ftl_getle16(&dev->hdr[FTL_HDR_ENTRY(j - 1)]) == FTL_SLOTFREE;
+           j--);
+
+      if (j == 0)
+        {
+          ret = ftl_erase(dev, newest);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          newest = FTL_NOBLOCK;
+        }
+    }
+
+  if (newest != FTL_NOBLOCK)
+    {
+      dev->open = newest;
+      dev->slot = j;
+
+      for (; dev->slot < dev->ndata; dev->slot++)
+        {
+          physical = newest * dev->blkper + dev->nhdr + dev->slot;
+          nxfrd    = MTD_BREAD(dev->mtd, physical, 1, sector);
+          if (nxfrd != 1)
+            {
+              fdbg("Read sector %d failed: %d\n", physical, nxfrd);
+              return -EIO;
+            }
+
+          for (j = 0;
+               j < dev->geo.blocksize && sector[j] == FTL_ERASEDSTATE;
+               j++);
+
+          if (j >= dev->geo.blocksize)
+            {
+              break;
+            }
+
+          ftl_putle16(&dev->hdr[FTL_HDR_ENTRY(dev->slot)], FTL_SLOTBAD);
+          ret = ftl_wrhdr(dev, dev->slot, 1);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  /* Erase the erase blocks that have no valid header.  This formats the
+   * FLASH or completes an interrupted erase.  Their erase counts are not
+   * known;  assume the worst.
+   */
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      eb = &dev->eblocks[i];
+      if (eb->state == FTL_EBERASE)
+        {
+          eb->ecount = maxecount;
+          ret = ftl_erase(dev, i);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_wlinitialize
+ *
+ * Description: Size the logical sector space, allocate the sector map and
+ *   header buffers, and mount the FLASH.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_WEARLEVEL
+static int ftl_wlinitialize(FAR struct ftl_struct_s *dev)
+{
+  size_t nslots;
+  int ret;
+
+  /* Each erase block begins with enough header sectors to hold the header
+   * and one entry for each of the remaining data sectors.
+   */
+
+  for (dev->nhdr = 1; dev->nhdr < dev->blkper; dev->nhdr++)
+    {
+      nslots = dev->blkper - dev->nhdr;
+      if (FTL_HDR_ENTRY(nslots) <= dev->nhdr * dev->geo.blocksize)
+        {
+          break;
+        }
+    }
+
+  dev->ndata = dev->blkper - dev->nhdr;
+
+  /* The spare erase blocks are not included in the capacity.  All sector
+   * numbers must fit in the 16-bit header entries.
+   */
+
+  if (dev->ndata == 0 || dev->geo.neraseblocks <= CONFIG_FTL_NSPARE ||
+      (size_t)dev->geo.neraseblocks * dev->blkper >= FTL_SLOTBAD)
+    {
+      fdbg("Unsupported geometry: %d x %d\n",
+           dev->geo.neraseblocks, dev->blkper);
+      return -EINVAL;
+    }
+
+  dev->nsectors = (size_t)(dev->geo.neraseblocks - CONFIG_FTL_NSPARE) *
+                  dev->ndata;
+  dev->nfree    = 0;
+  dev->open     = FTL_NOBLOCK;
+  dev->slot     = 0;
+  dev->seqno    = 0;
+
+  dev->eblocks  = (FAR struct ftl_eblock_s *)
+    kzalloc(dev->geo.neraseblocks * sizeof(struct ftl_eblock_s));
+  dev->map      = (FAR uint16_t *)kmalloc(dev->nsectors * sizeof(uint16_t));
+  dev->hdr      = (FAR uint8_t *)kmalloc(dev->nhdr * dev->geo.blocksize);
+  dev->scratch  = (FAR uint8_t *)
+    kmalloc((dev->nhdr + 1) * dev->geo.blocksize);
+
+  if (!dev->eblocks || !dev->map || !dev->hdr || !dev->scratch)
+    {
+      fdbg("Failed to allocate the sector map\n");
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  memset(dev->map, 0xff, dev->nsectors * sizeof(uint16_t));
+  memset(&dev->stats, 0, sizeof(struct ftl_stats_s));
+
+  ret = ftl_mount(dev);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  fvdbg("%d logical sectors, %d header sectors per erase block\n",
+        dev->nsectors, dev->nhdr);
+  return OK;
+
+errout:
+  if (dev->eblocks)
+    {
+      kfree(dev->eblocks);
+    }
+
+  if (dev->map)
+    {
+      kfree(dev->map);
+    }
+
+  if (dev->hdr)
+    {
+      kfree(dev->hdr);
+    }
+
+  if (dev->scratch)
+    {
+      kfree(dev->scratch);
+    }
+
+  return ret;
+}
+
+#endif
+
 /****************************************************************************
  * Name: ftl_reload
  *
@@ -159,6 +1018,54 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
 {
   struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
   ssize_t nread;
+#ifdef CONFIG_FTL_WEARLEVEL
+  uint16_t physical;
+  size_t i;
+  size_t n;
+
+  /* Don't let the read exceed the capacity of the device */
+
+  if (startblock >= dev->nsectors)
+    {
+      return 0;
+    }
+
+  if (startblock + nblocks > dev->nsectors)
+    {
+      nblocks = dev->nsectors - startblock;
+    }
+
+  /* Read each run of logical sectors that are in consecutive physical
+   * sectors with one MTD transfer.  Sectors that were never written read as
+   * erased FLASH.
+   */
+
+  for (i = 0; i < nblocks; i += n, buffer += n * dev->geo.blocksize)
+    {
+      physical = dev->map[startblock + i];
+      if (physical == FTL_UNMAPPED)
+        {
+          memset(buffer, FTL_ERASEDSTATE, dev->geo.blocksize);
+          n = 1;
+          continue;
+        }
+
+      for (n = 1;
+           i + n < nblocks && dev->map[startblock + i + n] == physical + n;
+           n++);
+
+      nread = MTD_BREAD(dev->mtd, physical, n, buffer);
+      if (nread != n)
+        {
+          fdbg("Read %d blocks starting at block %d failed: %d\n",
+                n, physical, nread);
+          return -EIO;
+        }
+    }
+
+  dev->stats.st_nread += nblocks;
+  return nblocks;
+#else
 
   /* Read the full erase block into the buffer */
 
@@ -169,6 +1076,7 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
             nblocks, startblock, nread);
     }
   return nread;
+#endif
 }
 
 /****************************************************************************
@@ -187,7 +1095,7 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
 
   DEBUGASSERT(inode && inode->i_private);
   dev = (struct ftl_struct_s *)inode->i_private;
-#ifdef CONFIG_FS_READAHEAD
+#ifdef CONFIG_FTL_RWBUFFER
   return rwb_read(&dev->rwb, start_sector, nsectors, buffer);
 #else
   return ftl_reload(dev, buffer, start_sector, nsectors);
@@ -195,13 +1103,64 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
 }
 
 /****************************************************************************
- * Name: ftl_write
+ * Name: ftl_flush
  *
  * Description: Write the specified number of sectors
  *
  ****************************************************************************/
 
-#ifdef CONFIG_FS_WRITABLE
+#if defined(CONFIG_FS_WRITABLE) && defined(CONFIG_FTL_WEARLEVEL)
+static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
+                         off_t startblock, size_t nblocks)
+{
+  struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
+  size_t remaining;
+  uint16_t n;
+  int ret;
+
+  /* Don't let the write exceed the capacity of the device */
+
+  if (startblock >= dev->nsectors)
+    {
+      return 0;
+    }
+
+  if (startblock + nblocks > dev->nsectors)
+    {
+      nblocks = dev->nsectors - startblock;
+    }
+
+  /* Write the sectors out-of-place, filling the open erase block */
+
+  for (remaining = nblocks; remaining > 0; remaining -= n)
+    {
+      ret = ftl_allocate(dev);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      n = dev->ndata - dev->slot;
+      if (n > remaining)
+        {
+          n = remaining;
+        }
+
+      ret = ftl_wrslots(dev, startblock, buffer, n, true);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      startblock += n;
+      buffer     += n * dev->geo.blocksize;
+    }
+
+  dev->stats.st_nwritten += nblocks;
+  return nblocks;
+}
+
+#elif defined(CONFIG_FS_WRITABLE)
 static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
                          off_t startblock, size_t nblocks)
 {
@@ -365,7 +1324,7 @@ static ssize_t ftl_write(FAR struct inode *inode, const unsigned char *buffer,
 
   DEBUGASSERT(inode && inode->i_private);
   dev = (struct ftl_struct_s *)inode->i_private;
-#ifdef CONFIG_FS_WRITEBUFFER
+#ifdef CONFIG_FTL_RWBUFFER
   return rwb_write(&dev->rwb, start_sector, nsectors, buffer);
 #else
   return ftl_flush(dev, buffer, start_sector, nsectors);
@@ -397,7 +1356,11 @@ static int ftl_geometry(FAR struct inode *inode, struct geometry *geometry)
 #else
       geometry->geo_writeenabled  = false;
 #endif
+#ifdef CONFIG_FTL_WEARLEVEL
+      geometry->geo_nsectors      = dev->nsectors;
+#else
       geometry->geo_nsectors      = dev->geo.neraseblocks * dev->blkper;
+#endif
       geometry->geo_sectorsize    = dev->geo.blocksize;
 
       fvdbg("available: true mediachanged: false writeenabled: %s\n",
@@ -424,6 +1387,88 @@ static int ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
 
   fvdbg("Entry\n");
   DEBUGASSERT(inode && inode->i_private);
+  dev = (struct ftl_struct_s *)inode->i_private;
+
+#ifdef CONFIG_FTL_RWBUFFER
+  /* Return the read-ahead/write buffer statistics */
+
+  if (cmd == BIOC_RWBSTATS)
+    {
+      return rwb_stats(&dev->rwb, (FAR struct rwb_stats_s *)((uintptr_t)arg));
+    }
+
+  /* Erasing the FLASH invalidates any buffered data */
+
+  if (cmd == MTDIOC_BULKERASE)
+    {
+      (void)rwb_mediaremoved(&dev->rwb);
+    }
+#endif
+
+#ifdef CONFIG_FTL_WEARLEVEL
+  /* The wear-levelling FTL returns its statistics.  When logical sectors
+   * are mapped to physical sectors, the FLASH cannot be accessed directly
+   * and the MTD driver cannot be permitted to erase it without re-writing
+   * the erase block headers.
+   */
+
+  if (cmd == BIOC_FTLSTATS)
+    {
+      FAR struct ftl_stats_s *stats = (FAR struct ftl_stats_s *)((uintptr_t)arg);
+      uint16_t i;
+
+      if (!stats)
+        {
+          return -EINVAL;
+        }
+
+      memcpy(stats, &dev->stats, sizeof(struct ftl_stats_s));
+      stats->st_minecount = UINT32_MAX;
+      stats->st_maxecount = 0;
+
+      for (i = 0; i < dev->geo.neraseblocks; i++)
+        {
+          if (dev->eblocks[i].ecount < stats->st_minecount)
+            {
+              stats->st_minecount = dev->eblocks[i].ecount;
+            }
+
+          if (dev->eblocks[i].ecount > stats->st_maxecount)
+            {
+              stats->st_maxecount = dev->eblocks[i].ecount;
+            }
+        }
+
+      return OK;
+    }
+  else if (cmd == BIOC_XIPBASE)
+    {
+      return -ENOTTY;
+    }
+  else if (cmd == MTDIOC_BULKERASE)
+    {
+      uint16_t i;
+
+      /* Erase each erase block individually so that the erase counts are
+       * retained.
+       */
+
+      dev->nfree = 0;
+      dev->open  = FTL_NOBLOCK;
+      memset(dev->map, 0xff, dev->nsectors * sizeof(uint16_t));
+
+      for (i = 0; i < dev->geo.neraseblocks; i++)
+        {
+          ret = ftl_erase(dev, i);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      return OK;
+    }
+#endif
 
   /* Only one block driver ioctl command is supported by this driver (and
    * that command is just passed on to the MTD driver in a slightly
@@ -455,7 +1500,6 @@ static int ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
    * to the MTD driver (unchanged).
    */
 
-  dev = (struct ftl_struct_s *)inode->i_private;
   ret = MTD_IOCTL(dev->mtd, cmd, arg);
   if (ret < 0)
     {
@@ -519,9 +1563,28 @@ int ftl_initialize(int minor, FAR struct mtd_dev_s *mtd)
           return ret;
         }
 
+      /* Get the number of R/W blocks per erase block */
+
+      dev->blkper = dev->geo.erasesize / dev->geo.blocksize;
+      DEBUGASSERT(dev->blkper * dev->geo.blocksize == dev->geo.erasesize);
+
+#ifdef CONFIG_FTL_WEARLEVEL
+      /* Allocate the sector map and erase block headers and mount the
+       * FLASH (formatting it if CONFIG_FTL_FORMAT is selected and the FLASH
+       * holds no FTL volume).
+       */
+
+      ret = ftl_wlinitialize(dev);
+      if (ret < 0)
+        {
+          fdbg("Failed to initialize the wear-levelling FTL: %d\n", ret);
+          kfree(dev);
+          return ret;
+        }
+
+#elif defined(CONFIG_FS_WRITABLE)
       /* Allocate one, in-memory erase block buffer */
 
-#ifdef CONFIG_FS_WRITABLE
       dev->eblock  = (FAR uint8_t *)kmalloc(dev->geo.erasesize);
       if (!dev->eblock)
         {
@@ -531,26 +1594,34 @@ int ftl_initialize(int minor, FAR struct mtd_dev_s *mtd)
         }
 #endif
 
-      /* Get the number of R/W blocks per erase block */
-
-      dev->blkper = dev->geo.erasesize / dev->geo.blocksize;
-      DEBUGASSERT(dev->blkper * dev->geo.blocksize == dev->geo.erasesize);
-
       /* Configure read-ahead/write buffering */
 
 #ifdef CONFIG_FTL_RWBUFFER
       dev->rwb.blocksize   = dev->geo.blocksize;
+#ifdef CONFIG_FTL_WEARLEVEL
+      dev->rwb.nblocks     = dev->nsectors;
+#else
       dev->rwb.nblocks     = dev->geo.neraseblocks * dev->blkper;
+#endif
       dev->rwb.dev         = (FAR void *)dev;
+      dev->rwb.rhreload    = ftl_reload;
 
-#if defined(CONFIG_FS_WRITABLE) && defined(CONFIG_FS_WRITEBUFFER)
-      dev->rwb.wrmaxblocks = dev->blkper;
+#ifdef CONFIG_FS_WRITABLE
       dev->rwb.wrflush     = ftl_flush;
+#else
+      dev->rwb.wrflush     = NULL;
+#endif
+
+#ifdef CONFIG_FS_WRITEBUFFER
+#ifdef CONFIG_FS_WRITABLE
+      dev->rwb.wrmaxblocks = dev->blkper;
+#else
+      dev->rwb.wrmaxblocks = 0;
+#endif
 #endif
 
 #ifdef CONFIG_FS_READAHEAD
       dev->rwb.rhmaxblocks = dev->blkper;
-      dev->rwb.rhreload    = ftl_reload;
 #endif
       ret = rwb_initialize(&dev->rwb);
       if (ret < 0)
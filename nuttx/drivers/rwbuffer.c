@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/rwbuffer.c
  *
- *   Copyright (C) 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -51,6 +51,7 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/clock.h>
 #include <nuttx/wqueue.h>
 #include <nuttx/rwbuffer.h>
 
@@ -62,14 +63,44 @@
 
 /* Configuration ************************************************************/
 
-#ifndef CONFIG_SCHED_WORKQUEUE
-#  error "Worker thread support is required (CONFIG_SCHED_WORKQUEUE)"
+#ifndef CONFIG_FS_READAHEAD
+#  undef CONFIG_FS_RHASYNC
+#endif
+
+#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_RHASYNC)
+#  ifndef CONFIG_SCHED_WORKQUEUE
+#    error "Worker thread support is required (CONFIG_SCHED_WORKQUEUE)"
+#  endif
 #endif
 
 #ifndef CONFIG_FS_WRDELAY
 #  define CONFIG_FS_WRDELAY 350
 #endif
 
+/* Locking ******************************************************************/
+/* The read-ahead buffer semaphore (rhsem) is always taken before the write
+ * buffer semaphore (wrsem).  All of the configured semaphores are held
+ * whenever a callout to the block driver is made so the callouts for one
+ * rwbuffer instance are serialized, no matter if they are made on the
+ * caller's thread or on the worker thread.
+ */
+
+#ifdef CONFIG_FS_READAHEAD
+#  define rwb_rhtake(r) rwb_semtake(&(r)->rhsem)
+#  define rwb_rhgive(r) rwb_semgive(&(r)->rhsem)
+#else
+#  define rwb_rhtake(r)
+#  define rwb_rhgive(r)
+#endif
+
+#ifdef CONFIG_FS_WRITEBUFFER
+#  define rwb_wrtake(r) rwb_semtake(&(r)->wrsem)
+#  define rwb_wrgive(r) rwb_semgive(&(r)->wrsem)
+#else
+#  define rwb_wrtake(r)
+#  define rwb_wrgive(r)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -120,10 +151,13 @@ static inline bool rwb_overlap(off_t blockstart1, size_t nblocks1,
   off_t blockend1 = blockstart1 + nblocks1;
   off_t blockend2 = blockstart2 + nblocks2;
 
-  /* If the buffer 1 is wholly outside of buffer 2, return false */
+  /* If either buffer is empty or if buffer 1 is wholly outside of buffer 2,
+   * return false.  The end blocks are one beyond the last block.
+   */
 
-  if ((blockend1   < blockstart2) || /* Wholly "below" */
-      (blockstart1 > blockend2))     /* Wholly "above" */
+  if ((nblocks1 == 0) || (nblocks2 == 0) ||
+      (blockend1   <= blockstart2) || /* Wholly "below" */
+      (blockstart1 >= blockend2))     /* Wholly "above" */
     {
       return false;
     }
@@ -133,6 +167,36 @@ static inline bool rwb_overlap(off_t blockstart1, size_t nblocks1,
     }
 }
 
+/****************************************************************************
+ * Name: rwb_wrmedia
+ *
+ * Description:
+ *   Write blocks to the media using the driver callout.  Returns the
+ *   number of blocks written or a negated errno value.
+ *
+ ****************************************************************************/
+
+static ssize_t rwb_wrmedia(FAR struct rwbuffer_s *rwb,
+                           FAR const uint8_t *buffer, off_t startblock,
+                           size_t nblocks)
+{
+  ssize_t ret;
+
+  /* We assume that the caller holds the semaphores */
+
+  ret = rwb->wrflush(rwb->dev, buffer, startblock, nblocks);
+  if (ret != (ssize_t)nblocks)
+    {
+      fdbg("ERROR: Write of %d blocks at %ld failed: %d\n",
+           nblocks, (long)startblock, ret);
+      return ret < 0 ? ret : -EIO;
+    }
+
+  rwb->stats.st_wrflushes++;
+  rwb->stats.st_wrflushed += nblocks;
+  return ret;
+}
+
 /****************************************************************************
  * Name: rwb_resetwrbuffer
  ****************************************************************************/
@@ -142,44 +206,40 @@ static inline void rwb_resetwrbuffer(struct rwbuffer_s *rwb)
 {
   /* We assume that the caller holds the wrsem */
 
-  rwb->wrnblocks       = 0;
-  rwb->wrblockstart    = (off_t)-1;
-  rwb->wrexpectedblock = (off_t)-1;
+  rwb->wrnblocks    = 0;
+  rwb->wrblockstart = (off_t)-1;
 }
 #endif
 
 /****************************************************************************
  * Name: rwb_wrflush
+ *
+ * Description:
+ *   Write the content of the write buffer to the media.  The caller holds
+ *   the wrsem (and the rhsem, if there is one).
+ *
  ****************************************************************************/
 
 #ifdef CONFIG_FS_WRITEBUFFER
-static void rwb_wrflush(struct rwbuffer_s *rwb)
+static int rwb_wrflush(struct rwbuffer_s *rwb)
 {
-  int ret;
+  ssize_t ret = OK;
 
-  fvdbg("Timeout!\n");
-  
-  rwb_semtake(&rwb->wrsem);
   if (rwb->wrnblocks)
     {
       fvdbg("Flushing: blockstart=0x%08lx nblocks=%d from buffer=%p\n",
-      (long)rwb->wrblockstart, rwb->wrnblocks, rwb->wrbuffer);
+            (long)rwb->wrblockstart, rwb->wrnblocks, rwb->wrbuffer);
 
-      /* Flush cache.  On success, the flush method will return the number
-       * of blocks written.  Anything other than the number requested is
-       * an error.
+      /* Flush cache.  The buffer is discarded even if the write fails;
+       * there is no way to report the failure to the original writer.
        */
 
-      ret = rwb->wrflush(rwb->dev, rwb->wrbuffer, rwb->wrblockstart, rwb->wrnblocks);
-      if (ret != rwb->wrnblocks)
-        {
-          fdbg("ERROR: Error flushing write buffer: %d\n", ret);
-        }
-      
+      ret = rwb_wrmedia(rwb, rwb->wrbuffer, rwb->wrblockstart,
+                        rwb->wrnblocks);
       rwb_resetwrbuffer(rwb);
     }
 
-  rwb_semgive(&rwb->wrsem);
+  return ret < 0 ? (int)ret : OK;
 }
 #endif
 
@@ -187,6 +247,7 @@ static void rwb_wrflush(struct rwbuffer_s *rwb)
  * Name: rwb_wrtimeout
  ****************************************************************************/
 
+#ifdef CONFIG_FS_WRITEBUFFER
 static void rwb_wrtimeout(FAR void *arg)
 {
   /* The following assumes that the size of a pointer is 4-bytes or less */
@@ -199,93 +260,201 @@ static void rwb_wrtimeout(FAR void *arg)
    * worker thread.
    */
 
-  rwb_wrflush(rwb);
+  fvdbg("Timeout!\n");
+
+  rwb_rhtake(rwb);
+  rwb_wrtake(rwb);
+  (void)rwb_wrflush(rwb);
+  rwb_wrgive(rwb);
+  rwb_rhgive(rwb);
 }
+#endif
 
 /****************************************************************************
  * Name: rwb_wrstarttimeout
  ****************************************************************************/
 
+#ifdef CONFIG_FS_WRITEBUFFER
 static void rwb_wrstarttimeout(FAR struct rwbuffer_s *rwb)
 {
-  /* CONFIG_FS_WRDELAY provides the delay period in milliseconds. CLK_TCK
-   * provides the clock tick of the system (frequency in Hz).
-   */
+  /* CONFIG_FS_WRDELAY provides the delay period in milliseconds */
 
-  int ticks = (CONFIG_FS_WRDELAY + CLK_TCK/2) / CLK_TCK;
-  (void)work_queue(&rwb->work, rwb_wrtimeout, (FAR void *)rwb, ticks);
+  uint32_t ticks = MSEC2TICK(CONFIG_FS_WRDELAY);
+  (void)work_queue(LPWORK, &rwb->work, rwb_wrtimeout, (FAR void *)rwb, ticks);
 }
+#endif
 
 /****************************************************************************
  * Name: rwb_wrcanceltimeout
  ****************************************************************************/
 
+#ifdef CONFIG_FS_WRITEBUFFER
 static inline void rwb_wrcanceltimeout(struct rwbuffer_s *rwb)
 {
-  (void)work_cancel(&rwb->work);
+  (void)work_cancel(LPWORK, &rwb->work);
 }
+#endif
 
 /****************************************************************************
  * Name: rwb_writebuffer
+ *
+ * Description:
+ *   Add data to the write buffer.  Writes that overwrite or extend the
+ *   buffered blocks are merged into the buffer; the buffer is written to
+ *   the media only when it is full, when a write is not contiguous with
+ *   it, or when the write delay expires.  Writes that are too large to
+ *   buffer go directly to the media.  The caller holds the wrsem.
+ *
  ****************************************************************************/
 
 #ifdef CONFIG_FS_WRITEBUFFER
 static ssize_t rwb_writebuffer(FAR struct rwbuffer_s *rwb,
-                               off_t startblock, uint32_t nblocks,
+                               off_t startblock, size_t nblocks,
                                FAR const uint8_t *wrbuffer)
 {
-  int ret;
-
-  /* Write writebuffer Logic */
+  size_t remaining;
+  size_t offset;
+  size_t ncopy;
+  ssize_t ret;
 
   rwb_wrcanceltimeout(rwb);
-  
-  /* First: Should we flush out our cache? We would do that if (1) we already
-   * buffering blocks and the next block writing is not in the same sequence,
-   * or (2) the number of blocks would exceed our allocated buffer capacity
-   */
 
-  if (((startblock != rwb->wrexpectedblock) && (rwb->wrnblocks)) ||
-      ((rwb->wrnblocks + nblocks) > rwb->wrmaxblocks))
+  for (remaining = nblocks; remaining > 0; )
     {
-      fvdbg("writebuffer miss, expected: %08x, given: %08x\n",
-            rwb->wrexpectedblock, startblock);
-    
-      /* Flush the write buffer */
+      /* Does this data overwrite or immediately follow the buffered blocks
+       * (with room left in the buffer)?  An empty buffer also qualifies
+       * once wrblockstart has been set below.
+       */
 
-      ret = rwb->wrflush(rwb, rwb->wrbuffer, rwb->wrblockstart, rwb->wrnblocks);
-      if (ret < 0)
+      offset = (size_t)(startblock - rwb->wrblockstart);
+      if (rwb->wrblockstart != (off_t)-1 && startblock >= rwb->wrblockstart &&
+          offset <= rwb->wrnblocks && offset < rwb->wrmaxblocks)
         {
-          fdbg("ERROR: Error writing multiple from cache: %d\n", -ret);
-          return ret;
+          /* Yes.. merge as much as will fit into the buffer */
+
+          ncopy = rwb->wrmaxblocks - offset;
+          if (ncopy > remaining)
+            {
+              ncopy = remaining;
+            }
+
+          fvdbg("writebuffer: copying %d blocks from %p to block %d\n",
+                ncopy, wrbuffer, offset);
+
+          memcpy(&rwb->wrbuffer[offset * rwb->blocksize], wrbuffer,
+                 ncopy * rwb->blocksize);
+
+          if (offset + ncopy > rwb->wrnblocks)
+            {
+              rwb->stats.st_wrcoalesced += rwb->wrnblocks - offset;
+              rwb->wrnblocks             = offset + ncopy;
+            }
+          else
+            {
+              rwb->stats.st_wrcoalesced += ncopy;
+            }
+
+          startblock += ncopy;
+          wrbuffer   += ncopy * rwb->blocksize;
+          remaining  -= ncopy;
         }
+      else
+        {
+          /* No.. the buffer is full or the write is elsewhere.  Flush the
+           * buffer first so that writes reach the media in order.
+           */
 
-      rwb_resetwrbuffer(rwb);
+          fvdbg("writebuffer miss, blockstart: %08lx given: %08lx\n",
+                (long)rwb->wrblockstart, (long)startblock);
+
+          ret = rwb_wrflush(rwb);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          if (remaining >= rwb->wrmaxblocks)
+            {
+              /* Too much to buffer; transfer the data directly */
+
+              ret = rwb_wrmedia(rwb, wrbuffer, startblock, remaining);
+              if (ret < 0)
+                {
+                  return ret;
+                }
+
+              remaining = 0;
+            }
+          else
+            {
+              /* Start a new buffer at this block */
+
+              fvdbg("Fresh cache starting at block: 0x%08lx\n",
+                    (long)startblock);
+              rwb->wrblockstart = startblock;
+            }
+        }
     }
-  
-  /* writebuffer is empty? Then initialize it */
 
-  if (!rwb->wrnblocks)
+  /* Write the buffered data if nothing else happens for a while */
+
+  if (rwb->wrnblocks > 0)
     {
-      fvdbg("Fresh cache starting at block: 0x%08x\n", startblock);
-      rwb->wrblockstart = startblock;
+      rwb_wrstarttimeout(rwb);
     }
-  
-  /* Add data to cache */
-
-  fvdbg("writebuffer: copying %d bytes from %p to %p\n",
-        nblocks * wrb->blocksize, wrbuffer,
-        &rwb->wrbuffer[rwb->wrnblocks * rwb->blocksize]);
-  memcpy(&rwb->wrbuffer[rwb->wrnblocks * rwb->blocksize],
-         wrbuffer, nblocks * rwb->blocksize);
-
-  rwb->wrnblocks      += nblocks;
-  rwb->wrexpectedblock = rwb->wrblockstart + rwb->wrnblocks;
-  rwb_wrstarttimeout(rwb);
+
   return nblocks;
 }
 #endif
 
+/****************************************************************************
+ * Name: rwb_rdmedia
+ *
+ * Description:
+ *   Read blocks from the media using the driver callout after writing any
+ *   overlapping data from the write buffer.  Returns the number of blocks
+ *   read or a negated errno value.  The caller holds the rhsem (if any).
+ *
+ ****************************************************************************/
+
+static ssize_t rwb_rdmedia(FAR struct rwbuffer_s *rwb, FAR uint8_t *buffer,
+                           off_t startblock, size_t nblocks)
+{
+  ssize_t ret;
+
+  rwb_wrtake(rwb);
+
+#ifdef CONFIG_FS_WRITEBUFFER
+  /* If the write buffer overlaps the block(s) to be read, then flush the
+   * write data onto the physical media before reading.  We could attempt
+   * some more exotic handling -- but this simple logic is well-suited for
+   * simple streaming applications.
+   */
+
+  if (rwb_overlap(rwb->wrblockstart, rwb->wrnblocks, startblock, nblocks))
+    {
+      ret = rwb_wrflush(rwb);
+      if (ret < 0)
+        {
+          rwb_wrgive(rwb);
+          return ret;
+        }
+    }
+#endif
+
+  ret = rwb->rhreload(rwb->dev, buffer, startblock, nblocks);
+  rwb_wrgive(rwb);
+
+  if (ret != (ssize_t)nblocks)
+    {
+      fdbg("ERROR: Read of %d blocks at %ld failed: %d\n",
+           nblocks, (long)startblock, ret);
+      return ret < 0 ? ret : -EIO;
+    }
+
+  return ret;
+}
+
 /****************************************************************************
  * Name: rwb_resetrhbuffer
  ****************************************************************************/
@@ -293,7 +462,7 @@ static ssize_t rwb_writebuffer(FAR struct rwbuffer_s *rwb,
 #ifdef CONFIG_FS_READAHEAD
 static inline void rwb_resetrhbuffer(struct rwbuffer_s *rwb)
 {
-  /* We assume that the caller holds the readAheadBufferSemphore */
+  /* We assume that the caller holds the rhsem */
 
   rwb->rhnblocks    = 0;
   rwb->rhblockstart = (off_t)-1;
@@ -301,82 +470,290 @@ static inline void rwb_resetrhbuffer(struct rwbuffer_s *rwb)
 #endif
 
 /****************************************************************************
- * Name: rwb_bufferread
+ * Name: rwb_rhcontains
+ *
+ * Description:
+ *   Return true if the block is held in the read-ahead buffer.
+ *
  ****************************************************************************/
 
 #ifdef CONFIG_FS_READAHEAD
-static inline void
-rwb_bufferread(struct rwbuffer_s *rwb,  off_t startblock,
-               size_t nblocks, uint8_t **rdbuffer)
+static inline bool rwb_rhcontains(FAR struct rwbuffer_s *rwb, off_t block)
 {
-  /* We assume that (1) the caller holds the readAheadBufferSemphore, and (2)
-   * that the caller already knows that all of the blocks are in the
-   * read-ahead buffer.
-   */
+  return (rwb->rhnblocks > 0 && block >= rwb->rhblockstart &&
+          block < rwb->rhblockstart + rwb->rhnblocks);
+}
+#endif
 
-  /* Convert the units from blocks to bytes */
+/****************************************************************************
+ * Name: rwb_rhreload
+ *
+ * Description:
+ *   Reload the read-ahead buffer with (up to) nblocks starting at
+ *   startblock.  Returns the number of blocks loaded or a negated errno.
+ *
+ ****************************************************************************/
 
-  off_t  blockoffset = startblock - rwb->rhblockstart;
-  off_t  byteoffset  = rwb->blocksize * blockoffset;
-  size_t nbytes      = rwb->blocksize * nblocks;
+#ifdef CONFIG_FS_READAHEAD
+static ssize_t rwb_rhreload(struct rwbuffer_s *rwb, off_t startblock,
+                            size_t nblocks)
+{
+  ssize_t ret;
 
-  /* Get the byte address in the read-ahead buffer */
+  /* Reset the read buffer */
 
-  uint8_t *rhbuffer    = rwb->rhbuffer + byteoffset;
+  rwb_resetrhbuffer(rwb);
 
-  /* Copy the data from the read-ahead buffer into the IO buffer */
+  /* Make sure that we don't read ahead past the end of the device (a
+   * request that starts beyond the end is left for the driver to reject).
+   */
 
-  memcpy(*rdbuffer, rhbuffer, nbytes);
+  if ((size_t)startblock < rwb->nblocks &&
+      nblocks > rwb->nblocks - (size_t)startblock)
+    {
+      nblocks = rwb->nblocks - (size_t)startblock;
+    }
 
-  /* Update the caller's copy for the next address */
+  /* Now perform the read */
 
-  *rdbuffer += nbytes;
+  ret = rwb_rdmedia(rwb, rwb->rhbuffer, startblock, nblocks);
+  if (ret > 0)
+    {
+      /* Update information about what is in the read-ahead buffer */
+
+      rwb->rhnblocks    = nblocks;
+      rwb->rhblockstart = startblock;
+    }
+
+  return ret;
 }
 #endif
 
 /****************************************************************************
- * Name: rwb_rhreload
+ * Name: rwb_rhdetect
+ *
+ * Description:
+ *   Adapt the read-ahead window to the access pattern:  It is doubled
+ *   (up to rhmaxblocks) each time that a read starts where the previous
+ *   read ended and halved (down to one block) each time that a read
+ *   falls outside of the read-ahead buffer.  Re-reading data that is
+ *   already buffered leaves the window unchanged.  Returns true if the
+ *   read is sequential.
+ *
  ****************************************************************************/
 
 #ifdef CONFIG_FS_READAHEAD
-static int rwb_rhreload(struct rwbuffer_s *rwb, off_t startblock)
+static bool rwb_rhdetect(FAR struct rwbuffer_s *rwb, off_t startblock,
+                         size_t nblocks)
 {
-  /* Get the block number +1 of the last block that will fit in the
-   * read-ahead buffer
+  bool sequential = false;
+
+  if (startblock == rwb->rhexpected)
+    {
+      if (rwb->rhwindow < rwb->rhmaxblocks)
+        {
+          rwb->rhwindow <<= 1;
+          if (rwb->rhwindow > rwb->rhmaxblocks)
+            {
+              rwb->rhwindow = rwb->rhmaxblocks;
+            }
+        }
+
+      sequential = true;
+    }
+  else if (!rwb_rhcontains(rwb, startblock))
+    {
+      if (rwb->rhwindow > 1)
+        {
+          rwb->rhwindow >>= 1;
+        }
+
+#ifdef CONFIG_FS_RHASYNC
+      /* Any pending read-ahead was for the stream that just ended */
+
+      rwb->rhprefetch = (off_t)-1;
+#endif
+    }
+
+  rwb->rhexpected = startblock + nblocks;
+  return sequential;
+}
+#endif
+
+/****************************************************************************
+ * Name: rwb_rhworker
+ *
+ * Description:
+ *   Perform an asynchronous read-ahead on the worker thread.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_RHASYNC
+static void rwb_rhworker(FAR void *arg)
+{
+  FAR struct rwbuffer_s *rwb = (struct rwbuffer_s *)arg;
+  ssize_t ret;
+
+  DEBUGASSERT(rwb != NULL);
+
+  rwb_semtake(&rwb->rhsem);
+
+  /* The read-ahead may have been cancelled or already satisfied by a
+   * synchronous read while this work was waiting to run.
    */
 
-  off_t  endblock  = startblock + rwb->rhmaxblocks;
-  size_t nblocks;
-  int    ret;
+  if (rwb->rhprefetch != (off_t)-1 && !rwb_rhcontains(rwb, rwb->rhprefetch))
+    {
+      fvdbg("Prefetch: blockstart=%ld nblocks=%d\n",
+            (long)rwb->rhprefetch, rwb->rhwindow);
+
+      ret = rwb_rhreload(rwb, rwb->rhprefetch, rwb->rhwindow);
+      if (ret > 0)
+        {
+          rwb->stats.st_rhahead += ret;
+          rwb->stats.st_rhasync++;
+        }
+    }
 
-  /* Reset the read buffer */
+  rwb->rhprefetch = (off_t)-1;
+  rwb_semgive(&rwb->rhsem);
+}
+#endif
 
-  rwb_resetrhbuffer(rwb);
+/****************************************************************************
+ * Name: rwb_rhstartasync
+ *
+ * Description:
+ *   A sequential read has consumed the read-ahead buffer.  Start loading
+ *   the next window on the worker thread so that it is (hopefully) ready
+ *   when the next read arrives.  The caller holds the rhsem.
+ *
+ ****************************************************************************/
 
-  /* Make sure that we don't read past the end of the device */
+#ifdef CONFIG_FS_RHASYNC
+static void rwb_rhstartasync(FAR struct rwbuffer_s *rwb)
+{
+  off_t next = rwb->rhexpected;
 
-  if (endblock > rwb->nblocks)
+  if ((size_t)next < rwb->nblocks && !rwb_rhcontains(rwb, next) &&
+      rwb->rhprefetch != next)
     {
-      endblock = rwb->nblocks;
+      rwb->rhprefetch = next;
+      (void)work_cancel(LPWORK, &rwb->rhwork);
+      (void)work_queue(LPWORK, &rwb->rhwork, rwb_rhworker, (FAR void *)rwb, 0);
     }
-  nblocks = endblock - startblock;
+}
+#endif
 
-  /* Now perform the read */
+/****************************************************************************
+ * Name: rwb_rhread
+ *
+ * Description:
+ *   Read through the read-ahead buffer.  The caller holds the rhsem.
+ *
+ *   Blocks found in the read-ahead buffer are copied from it.  Missing
+ *   blocks of a sequential read are loaded into the read-ahead buffer
+ *   together with the rest of the current read-ahead window and copied
+ *   from there.  Missing blocks are read directly into the caller's buffer
+ *   if the read is not sequential or if it is at least as large as the
+ *   window.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_READAHEAD
+static ssize_t rwb_rhread(FAR struct rwbuffer_s *rwb, off_t startblock,
+                          size_t nblocks, FAR uint8_t *rdbuffer)
+{
+  size_t remaining;
+  size_t nbufblocks;
+  size_t offset;
+  bool   sequential;
+  bool   loaded = false;
+  ssize_t ret;
+
+  /* Adapt the read-ahead window to this read */
+
+  sequential = rwb_rhdetect(rwb, startblock, nblocks);
 
-  ret = rwb->rhreload(rwb->dev, rwb->rhbuffer, startblock, nblocks);
-  if (ret == nblocks)
+  /* Loop until we have read all of the requested blocks */
+
+  for (remaining = nblocks; remaining > 0; )
     {
-      /* Update information about what is in the read-ahead buffer */
+      if (rwb_rhcontains(rwb, startblock))
+        {
+          /* Copy what we can from the read-ahead buffer */
 
-      rwb->rhnblocks    = nblocks;
-      rwb->rhblockstart = startblock;
+          nbufblocks = rwb->rhblockstart + rwb->rhnblocks - startblock;
+          if (nbufblocks > remaining)
+            {
+              nbufblocks = remaining;
+            }
+
+          offset = (size_t)(startblock - rwb->rhblockstart) * rwb->blocksize;
+          memcpy(rdbuffer, &rwb->rhbuffer[offset], nbufblocks * rwb->blocksize);
+
+          if (!loaded)
+            {
+              rwb->stats.st_rhhits += nbufblocks;
+            }
 
-      /* The return value is not the number of blocks we asked to be loaded. */
+          startblock += nbufblocks;
+          rdbuffer   += nbufblocks * rwb->blocksize;
+          remaining  -= nbufblocks;
+        }
+      else if (!sequential || remaining >= rwb->rhwindow)
+        {
+          /* Nothing to read ahead (or the read is not part of a sequential
+           * stream and should not displace the buffered data).  Bypass the
+           * read-ahead buffer.
+           */
 
-      return nblocks;
+          ret = rwb_rdmedia(rwb, rdbuffer, startblock, remaining);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          rwb->stats.st_rhmisses += remaining;
+          remaining = 0;
+        }
+      else
+        {
+          /* Fill the read-ahead buffer and try again */
+
+          ret = rwb_rhreload(rwb, startblock, rwb->rhwindow);
+          if (ret < 0)
+            {
+              fdbg("ERROR: Failed to fill the read-ahead buffer: %d\n", -ret);
+              return ret;
+            }
+
+          if ((size_t)ret > remaining)
+            {
+              rwb->stats.st_rhmisses += remaining;
+              rwb->stats.st_rhahead  += ret - remaining;
+            }
+          else
+            {
+              rwb->stats.st_rhmisses += ret;
+            }
+
+          loaded = true;
+        }
     }
 
-  return -EIO;
+#ifdef CONFIG_FS_RHASYNC
+  /* Read ahead in the background if a full window would also hold the
+   * next read of this size.
+   */
+
+  if (sequential && nblocks < rwb->rhwindow)
+    {
+      rwb_rhstartasync(rwb);
+    }
+#endif
+
+  return nblocks;
 }
 #endif
 
@@ -395,18 +772,24 @@ int rwb_initialize(FAR struct rwbuffer_s *rwb)
 
   DEBUGASSERT(rwb != NULL);
   DEBUGASSERT(rwb->blocksize > 0);
-  DEBUGASSERT(rwb->nblocks > 0);
   DEBUGASSERT(rwb->dev != NULL);
+  DEBUGASSERT(rwb->rhreload != NULL);
+
+  memset(&rwb->stats, 0, sizeof(struct rwb_stats_s));
 
   /* Setup so that rwb_uninitialize can handle a failure */
 
 #ifdef CONFIG_FS_WRITEBUFFER
-  DEBUGASSERT(rwb->wrflush!= NULL);
+  DEBUGASSERT(rwb->wrflush != NULL || rwb->wrmaxblocks == 0);
   rwb->wrbuffer = NULL;
+  memset(&rwb->work, 0, sizeof(struct work_s));
 #endif
 #ifdef CONFIG_FS_READAHEAD
-  DEBUGASSERT(rwb->rhreload != NULL);
   rwb->rhbuffer = NULL;
+#ifdef CONFIG_FS_RHASYNC
+  memset(&rwb->rhwork, 0, sizeof(struct work_s));
+  rwb->rhprefetch = (off_t)-1;
+#endif
 #endif
 
 #ifdef CONFIG_FS_WRITEBUFFER
@@ -422,19 +805,18 @@ int rwb_initialize(FAR struct rwbuffer_s *rwb)
 
   /* Allocate the write buffer */
 
-  rwb->wrbuffer = NULL;
   if (rwb->wrmaxblocks > 0)
     {
       allocsize     = rwb->wrmaxblocks * rwb->blocksize;
       rwb->wrbuffer = kmalloc(allocsize);
       if (!rwb->wrbuffer)
         {
-          fdbg("Write buffer kmalloc(%d) failed\n", allocsizee);
+          fdbg("Write buffer kmalloc(%d) failed\n", allocsize);
           return -ENOMEM;
         }
+
+      fvdbg("Write buffer size: %d bytes\n", allocsize);
     }
-  
-  fvdbg("Write buffer size: %d bytes\n", allocsize);
 #endif /* CONFIG_FS_WRITEBUFFER */
 
 #ifdef CONFIG_FS_READAHEAD
@@ -444,13 +826,16 @@ int rwb_initialize(FAR struct rwbuffer_s *rwb)
 
   sem_init(&rwb->rhsem, 0, 1);
 
-  /* Initialize read-ahead buffer parameters */
+  /* Initialize read-ahead buffer parameters.  The read-ahead window starts
+   * small and grows only if the reads turn out to be sequential.
+   */
 
   rwb_resetrhbuffer(rwb);
+  rwb->rhwindow   = 1;
+  rwb->rhexpected = (off_t)-1;
 
   /* Allocate the read-ahead buffer */
 
-  rwb->rhbuffer = NULL;
   if (rwb->rhmaxblocks > 0)
     {
       allocsize     = rwb->rhmaxblocks * rwb->blocksize;
@@ -460,9 +845,9 @@ int rwb_initialize(FAR struct rwbuffer_s *rwb)
           fdbg("Read-ahead buffer kmalloc(%d) failed\n", allocsize);
           return -ENOMEM;
         }
+
+      fvdbg("Read-ahead buffer size: %d bytes\n", allocsize);
     }
-  
-  fvdbg("Read-ahead buffer size: %d bytes\n", allocsize);
 #endif /* CONFIG_FS_READAHEAD */
   return 0;
 }
@@ -483,6 +868,9 @@ void rwb_uninitialize(FAR struct rwbuffer_s *rwb)
 #endif
 
 #ifdef CONFIG_FS_READAHEAD
+#ifdef CONFIG_FS_RHASYNC
+  (void)work_cancel(LPWORK, &rwb->rhwork);
+#endif
   sem_destroy(&rwb->rhsem);
   if (rwb->rhbuffer)
     {
@@ -495,110 +883,63 @@ void rwb_uninitialize(FAR struct rwbuffer_s *rwb)
  * Name: rwb_read
  ****************************************************************************/
 
-int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
-             FAR uint8_t *rdbuffer)
+ssize_t rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock,
+                 size_t nblocks, FAR uint8_t *rdbuffer)
 {
-  uint32_t remaining;
- 
+  ssize_t ret;
+
   fvdbg("startblock=%ld nblocks=%ld rdbuffer=%p\n",
         (long)startblock, (long)nblocks, rdbuffer);
 
-#ifdef CONFIG_FS_WRITEBUFFER
-  /* If the new read data overlaps any part of the write buffer, then
-   * flush the write data onto the physical media before reading.  We
-   * could attempt some more exotic handling -- but this simple logic
-   * is well-suited for simple streaming applications.
-   */
+  DEBUGASSERT(rwb != NULL && rdbuffer != NULL);
 
-  if (rwb->wrmaxblocks > 0)
+  if (nblocks == 0)
     {
-      /* If the write buffer overlaps the block(s) requested, then flush the
-       * write buffer.
-       */
-
-      rwb_semtake(&rwb->wrsem);
-      if (rwb_overlap(rwb->wrblockstart, rwb->wrnblocks, startblock, nblocks))
-        {
-          rwb_wrflush(rwb);
-        }
-      rwb_semgive(&rwb->wrsem);
+      return 0;
     }
-#endif
 
-#ifdef CONFIG_FS_READAHEAD
-  /* Loop until we have read all of the requested blocks */
+  rwb_rhtake(rwb);
 
-  rwb_semtake(&rwb->rhsem);
-  for (remaining = nblocks; remaining > 0;)
+#ifdef CONFIG_FS_READAHEAD
+  if (rwb->rhmaxblocks > 0)
     {
-      /* Is there anything in the read-ahead buffer? */
-
-      if (rwb->rhnblocks > 0)
-        {
-          off_t  startblock = startblock;
-          size_t nbufblocks = 0;
-          off_t  bufferend;
-
-          /* Loop for each block we find in the read-head buffer.  Count the
-           * number of buffers that we can read from read-ahead buffer.
-           */
-
-          bufferend = rwb->rhblockstart + rwb->rhnblocks;
-
-          while ((startblock >= rwb->rhblockstart) &&
-                 (startblock < bufferend) &&
-                 (remaining > 0))
-            {
-              /* This is one more that we will read from the read ahead buffer */
-
-              nbufblocks++;
-
-              /* And one less that we will read from the media */
-
-              startblock++;
-              remaining--;
-            }
-
-          /* Then read the data from the read-ahead buffer */
-
-          rwb_bufferread(rwb, startblock, nbufblocks, &rdbuffer);
-        }
-
-      /* If we did not get all of the data from the buffer, then we have to refill
-       * the buffer and try again.
-       */
-
-      if (remaining > 0)
+      ret = rwb_rhread(rwb, startblock, nblocks, rdbuffer);
+    }
+  else
+#endif
+    {
+      ret = rwb_rdmedia(rwb, rdbuffer, startblock, nblocks);
+      if (ret > 0)
         {
-          int ret = rwb_rhreload(rwb, startblock);
-          if (ret < 0)
-            {
-              fdbg("ERROR: Failed to fill the read-ahead buffer: %d\n", -ret);
-              return ret;
-            }
+          rwb->stats.st_rhmisses += ret;
         }
     }
 
+  rwb_rhgive(rwb);
+
   /* On success, return the number of blocks that we were requested to read.
    * This is for compatibility with the normal return of a block driver read
    * method
    */
 
-  rwb_semgive(&rwb->rhsem);
-  return 0;
-#else
-  return rwb->rhreload(rwb->dev, startblock, nblocks, rdbuffer);
-#endif
+  return ret;
 }
 
 /****************************************************************************
  * Name: rwb_write
  ****************************************************************************/
 
-int rwb_write(FAR struct rwbuffer_s *rwb, off_t startblock,
-              size_t nblocks, FAR const uint8_t *wrbuffer)
+ssize_t rwb_write(FAR struct rwbuffer_s *rwb, off_t startblock,
+                  size_t nblocks, FAR const uint8_t *wrbuffer)
 {
-  int ret;
+  ssize_t ret;
+
+  fvdbg("startblock=%ld nblocks=%ld wrbuffer=%p\n",
+        (long)startblock, (long)nblocks, wrbuffer);
+
+  DEBUGASSERT(rwb != NULL && rwb->wrflush != NULL && wrbuffer != NULL);
+
+  rwb_rhtake(rwb);
 
 #ifdef CONFIG_FS_READAHEAD
   /* If the new write data overlaps any part of the read buffer, then
@@ -607,73 +948,98 @@ int rwb_write(FAR struct rwbuffer_s *rwb, off_t startblock,
    * streaming applications.
    */
 
-  rwb_semtake(&rwb->rhsem);
   if (rwb_overlap(rwb->rhblockstart, rwb->rhnblocks, startblock, nblocks))
     {
       rwb_resetrhbuffer(rwb);
     }
-  rwb_give(&rwb->rhsem);
 #endif
 
-#ifdef CONFIG_FS_WRITEBUFFER
-  fvdbg("startblock=%d wrbuffer=%p\n", startblock, wrbuffer);
+  rwb->stats.st_wrblocks += nblocks;
+  rwb_wrtake(rwb);
 
-  /* Use the block cache unless the buffer size is bigger than block cache */   
-     
-  if (nblocks > rwb->wrmaxblocks)
+#ifdef CONFIG_FS_WRITEBUFFER
+  if (rwb->wrmaxblocks > 0)
     {
-      /* First flush the cache */
-
-      rwb_semtake(&rwb->wrsem);
-      rwb_wrflush(rwb);
-      rwb_semgive(&rwb->wrsem);
-
-      /* Then transfer the data directly to the media */
+      /* Buffer the data in the write buffer */
 
-      ret = rwb->wrflush(rwb->dev, startblock, nblocks, wrbuffer);
+      ret = rwb_writebuffer(rwb, startblock, nblocks, wrbuffer);
     }
   else
+#endif
     {
-      /* Buffer the data in the write buffer */
+      /* Transfer the data directly to the media */
 
-      ret = rwb_writebuffer(rwb, startblock, nblocks, wrbuffer);
+      ret = rwb_wrmedia(rwb, wrbuffer, startblock, nblocks);
     }
 
+  rwb_wrgive(rwb);
+  rwb_rhgive(rwb);
+
   /* On success, return the number of blocks that we were requested to write.
    * This is for compatibility with the normal return of a block driver write
    * method
    */
 
   return ret;
-
-#else
-
-  return rwb->wrflush(rwb->dev, startblock, nblocks, wrbuffer);
-
-#endif
 }
 
 /****************************************************************************
  * Name: rwb_mediaremoved
  ****************************************************************************/
 
-/* The following function is called when media is removed */
+/* The following function is called when media is removed.  Buffered write
+ * data is discarded.  It must not be called while holding a lock that is
+ * also taken by the driver callouts.
+ */
 
 int rwb_mediaremoved(FAR struct rwbuffer_s *rwb)
 {
+  rwb_rhtake(rwb);
+
 #ifdef CONFIG_FS_WRITEBUFFER
   rwb_semtake(&rwb->wrsem);
+  rwb_wrcanceltimeout(rwb);
   rwb_resetwrbuffer(rwb);
   rwb_semgive(&rwb->wrsem);
 #endif
 
 #ifdef CONFIG_FS_READAHEAD
-  rwb_semtake(&rwb->rhsem);
   rwb_resetrhbuffer(rwb);
-  rwb_semgive(&rwb->rhsem);
+  rwb->rhwindow   = 1;
+  rwb->rhexpected = (off_t)-1;
+#ifdef CONFIG_FS_RHASYNC
+  rwb->rhprefetch = (off_t)-1;
 #endif
+#endif
+
+  rwb_rhgive(rwb);
   return 0;
 }
 
-#endif /* CONFIG_FS_WRITEBUFFER || CONFIG_FS_READAHEAD */
+/****************************************************************************
+ * Name: rwb_stats
+ *
+ * Description:
+ *   Return a copy of the buffer statistics.  No semaphore is taken so that
+ *   this may be called from a driver ioctl method that holds the driver's
+ *   own lock;  each counter is a single 32-bit word.
+ *
+ ****************************************************************************/
 
+int rwb_stats(FAR struct rwbuffer_s *rwb, FAR struct rwb_stats_s *stats)
+{
+  if (!stats)
+    {
+      return -EINVAL;
+    }
+
+  memcpy(stats, &rwb->stats, sizeof(struct rwb_stats_s));
+#ifdef CONFIG_FS_READAHEAD
+  stats->st_rhwindow = rwb->rhmaxblocks > 0 ? rwb->rhwindow : 0;
+#else
+  stats->st_rhwindow = 0;
+#endif
+  return OK;
+}
+
+#endif /* CONFIG_FS_WRITEBUFFER || CONFIG_FS_READAHEAD */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * drivers/usbhost/usbhost_hidkbd.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -1670,7 +1670,7 @@ static int usbhost_disconnected(struct usbhost_class_s *class)
        */
 
       DEBUGASSERT(priv->work.worker == NULL);
-      (void)work_queue(&priv->work, usbhost_destroy, priv, 0);
+      (void)work_queue(LPWORK, &priv->work, usbhost_destroy, priv, 0);
     }
 
   return OK;
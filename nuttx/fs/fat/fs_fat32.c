@@ -62,6 +62,7 @@
 #include <nuttx/fs.h>
 #include <nuttx/fat.h>
 #include <nuttx/dirent.h>
+#include <nuttx/ioctl.h>
 
 #include "fs_internal.h"
 #include "fs_fat32.h"
@@ -431,8 +432,11 @@ static ssize_t fat_read(FAR struct file *filep, char *buffer, size_t buflen)
   unsigned int          bytesread;
   unsigned int          readsize;
   unsigned int          nsectors;
+  unsigned int          ncontig;
   size_t                bytesleft;
   int32_t               cluster;
+  uint32_t              runcluster;
+  uint32_t              clustndx;
   uint8_t               *userbuffer = (uint8_t*)buffer;
   int                   sectorindex;
   int                   ret;
@@ -519,12 +523,14 @@ static ssize_t fat_read(FAR struct file *filep, char *buffer, size_t buflen)
            *
            * Limit the number of sectors that we read on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster and in any following clusters that are
+           * adjacent on the media.
            */
 
-          if (nsectors > ff->ff_sectorsincluster)
+          ncontig = fat_ffcontiguous(fs, ff, filep->f_pos, nsectors, false);
+          if (nsectors > ncontig)
             {
-              nsectors = ff->ff_sectorsincluster;
+              nsectors = ncontig;
             }
 
           /* We are not sure of the state of the file buffer so
@@ -541,7 +547,7 @@ static ssize_t fat_read(FAR struct file *filep, char *buffer, size_t buflen)
               goto errout_with_semaphore;
             }
 
-          ff->ff_sectorsincluster -= nsectors;
+          ff->ff_sectorsincluster  = ncontig - nsectors;
           ff->ff_currentsector    += nsectors;
           bytesread                = nsectors * fs->fs_hwsectorsize;
         }
@@ -592,15 +598,26 @@ static ssize_t fat_read(FAR struct file *filep, char *buffer, size_t buflen)
 
       if (ff->ff_sectorsincluster < 1)
         {
-          /* Find the next cluster in the FAT. */
+          /* Find the next cluster in the cluster run cache or in the FAT. */
+
+          clustndx = filep->f_pos / CLUS_SIZE(fs);
+          if (fat_runlookup(ff, clustndx, &runcluster) == clustndx)
+            {
+              cluster = runcluster;
+            }
+          else
+            {
+              cluster = fat_getcluster(fs, ff->ff_currentcluster);
+            }
 
-          cluster = fat_getcluster(fs, ff->ff_currentcluster);
           if (cluster < 2 || cluster >= fs->fs_nclusters)
             {
               ret = -EINVAL; /* Not the right error */
               goto errout_with_semaphore;
             }
 
+          fat_runadd(ff, clustndx, cluster);
+
           /* Setup to read the first sector from the new cluster */
 
           ff->ff_currentcluster   = cluster;
@@ -628,9 +645,12 @@ static ssize_t fat_write(FAR struct file *filep, const char *buffer,
   struct fat_mountpt_s *fs;
   struct fat_file_s    *ff;
   int32_t               cluster;
+  uint32_t              runcluster;
+  uint32_t              clustndx;
   unsigned int          byteswritten;
   unsigned int          writesize;
   unsigned int          nsectors;
+  unsigned int          ncontig;
   uint8_t              *userbuffer = (uint8_t*)buffer;
   int                   sectorindex;
   int                   ret;
@@ -720,12 +740,14 @@ static ssize_t fat_write(FAR struct file *filep, const char *buffer,
            *
            * Limit the number of sectors that we write on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster and in any following clusters that are
+           * adjacent on the media (allocating them if necessary).
            */
 
-          if (nsectors > ff->ff_sectorsincluster)
+          ncontig = fat_ffcontiguous(fs, ff, filep->f_pos, nsectors, true);
+          if (nsectors > ncontig)
             {
-              nsectors = ff->ff_sectorsincluster;
+              nsectors = ncontig;
             }
 
           /* We are not sure of the state of the sector cache so the
@@ -743,7 +765,7 @@ static ssize_t fat_write(FAR struct file *filep, const char *buffer,
               goto errout_with_semaphore;
             }
 
-          ff->ff_sectorsincluster -= nsectors;
+          ff->ff_sectorsincluster  = ncontig - nsectors;
           ff->ff_currentsector    += nsectors;
           writesize                = nsectors * fs->fs_hwsectorsize;
           ff->ff_bflags           |= FFBUFF_MODIFIED;
@@ -832,10 +854,19 @@ static ssize_t fat_write(FAR struct file *filep, const char *buffer,
       if (ff->ff_sectorsincluster < 1)
         {
           /* Extend the current cluster by one (unless lseek was used to
-           * move the file position back from the end of the file)
+           * move the file position back from the end of the file and the
+           * next cluster is already known).
            */
 
-          cluster = fat_extendchain(fs, ff->ff_currentcluster);
+          clustndx = filep->f_pos / CLUS_SIZE(fs);
+          if (fat_runlookup(ff, clustndx, &runcluster) == clustndx)
+            {
+              cluster = runcluster;
+            }
+          else
+            {
+              cluster = fat_extendchain(fs, ff->ff_currentcluster);
+            }
 
           /* Verify the cluster number */
 
@@ -850,6 +881,8 @@ static ssize_t fat_write(FAR struct file *filep, const char *buffer,
               goto errout_with_semaphore;
             }
 
+          fat_runadd(ff, clustndx, cluster);
+
           /* Setup to write the first sector from the new cluster */
 
           ff->ff_currentcluster   = cluster;
@@ -883,6 +916,8 @@ static off_t fat_seek(FAR struct file *filep, off_t offset, int whence)
   struct fat_mountpt_s *fs;
   struct fat_file_s    *ff;
   int32_t               cluster;
+  uint32_t              runcluster;
+  uint32_t              clustndx;
   off_t                 position;
   unsigned int          clustersize;
   int                   ret;
@@ -984,7 +1019,20 @@ static off_t fat_seek(FAR struct file *filep, off_t offset, int whence)
        * requested position.
        */
 
-      clustersize = fs->fs_fatsecperclus * fs->fs_hwsectorsize;
+      clustersize = CLUS_SIZE(fs);
+
+      /* Skip directly to the last cluster before the requested position
+       * that is known in the cluster run cache.
+       */
+
+      clustndx = fat_runlookup(ff, position / clustersize, &runcluster);
+      if (clustndx > 0)
+        {
+          cluster       = runcluster;
+          filep->f_pos  = clustndx * clustersize;
+          position     -= filep->f_pos;
+        }
+
       for (;;)
         {
           /* Skip over clusters prior to the one containing
@@ -1051,8 +1099,11 @@ static off_t fat_seek(FAR struct file *filep, off_t offset, int whence)
               goto errout_with_semaphore;
             }
 
-          /* Otherwise, update the position and continue looking */
+          /* Otherwise, remember the cluster, update the position and
+           * continue looking.
+           */
 
+          fat_runadd(ff, ++clustndx, cluster);
           filep->f_pos += clustersize;
           position     -= clustersize;
         }
@@ -1132,6 +1183,25 @@ static int fat_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       return ret;
     }
 
+  /* Return the statistics of the sector cache */
+
+  if (cmd == FIOC_FATSTATS)
+    {
+      FAR struct fat_stats_s *stats = (FAR struct fat_stats_s *)((uintptr_t)arg);
+      if (stats)
+        {
+          memcpy(stats, &fs->fs_stats, sizeof(struct fat_stats_s));
+          ret = OK;
+        }
+      else
+        {
+          ret = -EINVAL;
+        }
+
+      fat_semgive(fs);
+      return ret;
+    }
+
   /* ioctl calls are just passed through to the contained block driver */
 
   fat_semgive(fs);
@@ -1451,11 +1521,32 @@ static int fat_readdir(struct inode *mountpt, struct fs_dirent_s *dir)
 
       if (fat_nextdirentry(fs, &dir->u.fat) != OK)
         {
-          ret = -ENOENT;
-          goto errout_with_semaphore;
+          /* There are no further directory entries.  But don't discard
+           * the entry that we just found in the last slot of the final
+           * directory sector; instead, return it now and report the end
+           * of the directory on the next call.
+           */
+
+          if (!found)
+            {
+              ret = -ENOENT;
+              goto errout_with_semaphore;
+            }
+
+          dir->u.fat.fd_currsector = 0;
         }
     }
 
+  /* The loop also terminates without finding an entry if the end of the
+   * directory was reached on a previous call.
+   */
+
+  if (!found)
+    {
+      ret = -ENOENT;
+      goto errout_with_semaphore;
+    }
+
   fat_semgive(fs);
   return OK;
 
@@ -1628,6 +1719,10 @@ static int fat_unbind(void *handle, FAR struct inode **blkdriver)
     }
   else
     {
+      /* Write back any dirty sectors that remain in the sector cache */
+
+      (void)fat_fscacheflush(fs);
+
        /* Unmount ... close the block driver */
 
       if (fs->fs_blkdriver)
@@ -1655,11 +1750,21 @@ static int fat_unbind(void *handle, FAR struct inode **blkdriver)
 
       /* Release the mountpoint private data */
 
-      if (fs->fs_buffer)
+      if (fs->fs_cachebuffer)
+        {
+          kfree(fs->fs_cachebuffer);
+        }
+
+#ifdef CONFIG_FAT_FREEBITMAP
+      if (fs->fs_freemap)
         {
-          kfree(fs->fs_buffer);
+          kfree(fs->fs_freemap);
         }
+#endif
+
+      sem_destroy(&fs->fs_sem);
       kfree(fs);
+      return OK;
     }
 
   fat_semgive(fs);
@@ -1859,8 +1964,8 @@ static int fat_mkdir(struct inode *mountpt, const char *relpath, mode_t mode)
       goto errout_with_semaphore;
     }
 
-  /* Flush any existing, dirty data in fs_buffer (because we need 
-   * it to create the directory entries.
+  /* Flush any existing, dirty data in the sector cache and then get a
+   * cleared sector buffer for the first sector of the new directory.
    */
 
   ret = fat_fscacheflush(fs);
@@ -1869,15 +1974,16 @@ static int fat_mkdir(struct inode *mountpt, const char *relpath, mode_t mode)
       goto errout_with_semaphore;
     }
 
+  ret = fat_fscacheclear(fs, dirsector);
+  if (ret < 0)
+    {
+      goto errout_with_semaphore;
+    }
+
   /* Get a pointer to the first directory entry in the sector */
 
   direntry = fs->fs_buffer;
 
-  /* Now erase the contents of fs_buffer */
-
-  fs->fs_currentsector = dirsector;
-  memset(direntry, 0, fs->fs_hwsectorsize);
-
   /* Now clear all sectors in the new directory cluster (except for the first) */
 
   for (i = 1; i < fs->fs_fatsecperclus; i++)
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/fat/fs_fat32.h
  *
- *   Copyright (C) 2007-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -49,10 +49,75 @@
 #include <time.h>
 
 #include <nuttx/dirent.h>
+#include <nuttx/fat.h>
 
 /****************************************************************************
  * Definitions
  ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_FAT_NCACHESECTORS - The number of sectors held in the per-mount
+ *   sector cache that is used for FAT, directory, and FSINFO sectors.  The
+ *   least recently used sector is replaced when a new sector is needed.
+ *   Dirty sectors are written back when they are replaced or when the
+ *   cache is flushed.  Default: 1 (a single sector buffer).
+ * CONFIG_FAT_NFATCACHESECTORS - The number of the cached sectors that are
+ *   reserved for sectors of the FAT table so that walking a cluster chain
+ *   does not evict directory sectors and vice versa.  Zero means that all
+ *   cached sectors are shared.  Default: 0
+ * CONFIG_FAT_FREEBITMAP - Keep a bitmap of allocated clusters in RAM.  The
+ *   bitmap is built by scanning the FAT the first time that a cluster is
+ *   allocated (or that the number of free clusters is requested) and is
+ *   then kept up to date as the FAT is modified.  Free clusters are then
+ *   found without reading the FAT and the free cluster count is always
+ *   exact.  The bitmap needs one bit per cluster.  If the bitmap cannot be
+ *   allocated, the FAT is searched instead.
+ * CONFIG_FAT_NCLUSTERRUNS - The number of runs of contiguous clusters that
+ *   are remembered for each open file.  The runs are recorded as the
+ *   cluster chain of the file is followed so that lseek() can locate
+ *   clusters that have already been visited with a binary search instead of
+ *   following the chain from its start.  Sequential accesses within a run
+ *   also do not need to read the FAT.  Default: 0 (disabled)
+ * CONFIG_FAT_NDIRCACHE - The number of entries in the per-mount cache of
+ *   recently found directory entries.  Each entry remembers where the
+ *   directory entry for one name in one directory was found so that the
+ *   next look-up of the same path segment can go straight to it instead of
+ *   searching the directory from the beginning.  The cache is two-way set
+ *   associative, indexed by a hash of the directory and the name, so the
+ *   number must be even.  It is flushed whenever a directory entry is
+ *   removed.  Default: 0 (disabled)
+ */
+
+#ifndef CONFIG_FAT_NCACHESECTORS
+#  define CONFIG_FAT_NCACHESECTORS 1
+#endif
+
+#ifndef CONFIG_FAT_NFATCACHESECTORS
+#  define CONFIG_FAT_NFATCACHESECTORS 0
+#endif
+
+#if CONFIG_FAT_NCACHESECTORS < 1 || CONFIG_FAT_NCACHESECTORS > 255
+#  error "CONFIG_FAT_NCACHESECTORS must be in the range 1-255"
+#endif
+
+#if CONFIG_FAT_NFATCACHESECTORS >= CONFIG_FAT_NCACHESECTORS
+#  error "CONFIG_FAT_NFATCACHESECTORS must be less than CONFIG_FAT_NCACHESECTORS"
+#endif
+
+#ifndef CONFIG_FAT_NCLUSTERRUNS
+#  define CONFIG_FAT_NCLUSTERRUNS 0
+#endif
+
+#if CONFIG_FAT_NCLUSTERRUNS > 255
+#  error "CONFIG_FAT_NCLUSTERRUNS must be less than 256"
+#endif
+
+#ifndef CONFIG_FAT_NDIRCACHE
+#  define CONFIG_FAT_NDIRCACHE 0
+#endif
+
+#if (CONFIG_FAT_NDIRCACHE & 1) != 0
+#  error "CONFIG_FAT_NDIRCACHE must be a multiple of 2"
+#endif
 
 /****************************************************************************
  * These offsets describes the master boot record.
@@ -220,6 +285,7 @@
 #define SEC_NSECTORS(f,n)   ((n) / (f)->fs_hwsectorsize)
 
 #define CLUS_NDXMASK(f)     ((f)->fs_fatsecperclus - 1)
+#define CLUS_SIZE(f)        ((f)->fs_fatsecperclus * (f)->fs_hwsectorsize)
 
 /****************************************************************************
  * The FAT "long" file name (LFN) directory entry */
@@ -680,6 +746,42 @@
  * Public Types
  ****************************************************************************/
 
+/* This structure describes one sector in the per-mount sector cache */
+
+struct fat_cachesect_s
+{
+  off_t    cs_sector;              /* Sector held in cs_buffer (-1 if none) */
+  uint32_t cs_lastuse;             /* Value of fs_cacheclock at the last access */
+  bool     cs_dirty;               /* true: cs_buffer must be written back */
+  uint8_t *cs_buffer;              /* The sector data (part of fs_cachebuffer) */
+};
+
+/* This structure describes one run of contiguous clusters in the cluster
+ * chain of an open file.
+ */
+
+#if CONFIG_FAT_NCLUSTERRUNS > 0
+struct fat_clusterrun_s
+{
+  uint32_t cr_index;               /* Index of the first cluster in the file */
+  uint32_t cr_cluster;             /* First cluster of the run */
+  uint32_t cr_length;              /* Number of clusters in the run */
+};
+#endif
+
+/* This structure describes one entry in the directory entry cache.  dc_dir
+ * is the directory position at which the search for the name should begin
+ * (the first long file name entry or the short file name entry).
+ */
+
+#if CONFIG_FAT_NDIRCACHE > 0
+struct fat_dircache_s
+{
+  uint32_t dc_hash;                /* Hash of directory and name (0: unused) */
+  struct fs_fatdir_s dc_dir;       /* Position of the directory entry */
+};
+#endif
+
 /* This structure represents the overall mountpoint state.  An instance of this
  * structure is retained as inode private data on each mountpoint that is
  * mounted with a fat32 filesystem.
@@ -698,7 +800,7 @@ struct fat_mountpt_s
   off_t    fs_rootbase;            /* MBR: Cluster no. of 1st cluster of root dir */
   off_t    fs_database;            /* Logical block of start data sectors */
   off_t    fs_fsinfo;              /* MBR: Sector number of FSINFO sector */
-  off_t    fs_currentsector;       /* The sector number buffered in fs_buffer */
+  off_t    fs_currentsector;       /* The sector number buffered in fs_buffer (or -1) */
   uint32_t fs_nclusters;           /* Maximum number of data clusters */
   uint32_t fs_nfatsects;           /* MBR: Count of sectors occupied by one fat */
   uint32_t fs_fattotsec;           /* MBR: Total count of sectors on the volume */
@@ -712,8 +814,19 @@ struct fat_mountpt_s
   uint8_t  fs_type;                /* FSTYPE_FAT12, FSTYPE_FAT16, or FSTYPE_FAT32 */
   uint8_t  fs_fatnumfats;          /* MBR: Number of FATs (probably 2) */
   uint8_t  fs_fatsecperclus;       /* MBR: Sectors per allocation unit: 2**n, n=0..7 */
-  uint8_t *fs_buffer;              /* This is an allocated buffer to hold one sector
-                                    * from the device */
+  uint8_t  fs_cachecurr;           /* Index of the sector cache entry in fs_buffer */
+  uint32_t fs_cacheclock;          /* Counts accesses to the sector cache (for LRU) */
+  uint8_t *fs_buffer;              /* The buffer of the current sector in the sector
+                                    * cache */
+  uint8_t *fs_cachebuffer;         /* Allocated storage for all cached sectors */
+  struct fat_cachesect_s fs_cache[CONFIG_FAT_NCACHESECTORS];
+  struct fat_stats_s fs_stats;     /* Sector cache and block driver statistics */
+#ifdef CONFIG_FAT_FREEBITMAP
+  uint32_t *fs_freemap;            /* Bitmap of allocated clusters (or NULL) */
+#endif
+#if CONFIG_FAT_NDIRCACHE > 0
+  struct fat_dircache_s fs_dircache[CONFIG_FAT_NDIRCACHE];
+#endif
 };
 
 /* This structure represents on open file under the mountpoint.  An instance
@@ -736,6 +849,10 @@ struct fat_file_s
   off_t    ff_currentsector;       /* Current sector being operated on */
   off_t    ff_cachesector;         /* Current sector in the file buffer */
   uint8_t *ff_buffer;              /* File buffer (for partial sector accesses) */
+#if CONFIG_FAT_NCLUSTERRUNS > 0
+  uint8_t  ff_nruns;               /* Number of valid entries in ff_runs[] */
+  struct fat_clusterrun_s ff_runs[CONFIG_FAT_NCLUSTERRUNS];
+#endif
 };
 
 /* This structure holds the sequency of directory entries used by one
@@ -869,6 +986,21 @@ EXTERN int    fat_removechain(struct fat_mountpt_s *fs, uint32_t cluster);
 EXTERN int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster);
 
 #define fat_createchain(fs) fat_extendchain(fs, 0)
+EXTERN unsigned int fat_ffcontiguous(struct fat_mountpt_s *fs,
+                                    struct fat_file_s *ff, off_t position,
+                                    unsigned int nsectors, bool extend);
+
+/* Cluster run cache of an open file */
+
+#if CONFIG_FAT_NCLUSTERRUNS > 0
+EXTERN uint32_t fat_runlookup(struct fat_file_s *ff, uint32_t clustndx,
+                              uint32_t *pcluster);
+EXTERN void   fat_runadd(struct fat_file_s *ff, uint32_t clustndx,
+                         uint32_t cluster);
+#else
+#  define fat_runlookup(ff,n,c) (*(c) = (ff)->ff_startcluster, 0)
+#  define fat_runadd(ff,n,c)
+#endif
 
 /* Help for traversing directory trees and accessing directory entries */
 
@@ -890,8 +1022,10 @@ EXTERN int    fat_remove(struct fat_mountpt_s *fs, const char *relpath, bool dir
 
 /* Mountpoint and file buffer cache (for partial sector accesses) */
 
+EXTERN void   fat_fscacheinit(struct fat_mountpt_s *fs);
 EXTERN int    fat_fscacheflush(struct fat_mountpt_s *fs);
 EXTERN int    fat_fscacheread(struct fat_mountpt_s *fs, off_t sector);
+EXTERN int    fat_fscacheclear(struct fat_mountpt_s *fs, off_t sector);
 EXTERN int    fat_ffcacheflush(struct fat_mountpt_s *fs, struct fat_file_s *ff);
 EXTERN int    fat_ffcacheread(struct fat_mountpt_s *fs, struct fat_file_s *ff, off_t sector);
 EXTERN int    fat_ffcacheinvalidate(struct fat_mountpt_s *fs, struct fat_file_s *ff);
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/fat/fs_fat32dirent.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -90,6 +90,21 @@
  * Definitions
  ****************************************************************************/
 
+/* The directory entry cache is organized as sets of two entries.
+ * DIRCACHE_SET gives the index of the first entry of the set for a hash.
+ *
+ * When a directory entry is freed, the cached positions of other entries
+ * may no longer be valid (and the freed directory cluster may be re-used).
+ */
+
+#if CONFIG_FAT_NDIRCACHE > 0
+#  define DIRCACHE_SET(h)       (((h) % (CONFIG_FAT_NDIRCACHE / 2)) << 1)
+#  define fat_dircacheflush(fs) \
+     memset((fs)->fs_dircache, 0, sizeof((fs)->fs_dircache))
+#else
+#  define fat_dircacheflush(fs)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -153,6 +168,15 @@ static int fat_putlfname(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo
 static int fat_putsfdirentry(struct fat_mountpt_s *fs,
                              struct fat_dirinfo_s *dirinfo,
                              uint8_t attributes, uint32_t fattime);
+static inline int fat_findentry(struct fat_mountpt_s *fs,
+                                struct fat_dirinfo_s *dirinfo);
+#if CONFIG_FAT_NDIRCACHE > 0
+static uint32_t fat_dircachehash(struct fat_dirinfo_s *dirinfo);
+static int fat_dircachefind(struct fat_mountpt_s *fs,
+                            struct fat_dirinfo_s *dirinfo, uint32_t hash);
+static void fat_dircacheadd(struct fat_mountpt_s *fs,
+                            struct fat_dirinfo_s *dirinfo, uint32_t hash);
+#endif
 
 /****************************************************************************
  * Private Variables
@@ -796,7 +820,7 @@ static inline int fat_findalias(struct fat_mountpt_s *fs,
    * with the first entry.
    */
 
-  tmpinfo.dir.fd_startcluster = tmpinfo.dir.fd_currcluster;
+  tmpinfo.dir.fd_currcluster  = tmpinfo.dir.fd_startcluster;
   tmpinfo.dir.fd_currsector   = tmpinfo.fd_seq.ds_startsector;
   tmpinfo.dir.fd_index        = 0;
 
@@ -2227,6 +2251,195 @@ static int fat_putsfdirentry(struct fat_mountpt_s *fs,
   return OK;
 }
 
+/****************************************************************************
+ * Name: fat_findentry
+ *
+ * Desciption: Search the directory, beginning at the current position in
+ *   dirinfo->dir, for the entry (or sequence of entries) that matches the
+ *   path segment in dirinfo.
+ *
+ * NOTE: As a side effect, this function returns with the sector containing
+ *   the short file name directory entry in the cache.
+ *
+ ****************************************************************************/
+
+static inline int fat_findentry(struct fat_mountpt_s *fs,
+                                struct fat_dirinfo_s *dirinfo)
+{
+  /* Is this a path segment a long or a short file.  Was a long file
+   * name parsed?
+   */
+
+#ifdef CONFIG_FAT_LFN
+  if (dirinfo->fd_lfname[0] != '\0')
+    {
+      /* Yes.. Search for the sequence of long file name directory
+       * entries.
+       */
+
+      return fat_findlfnentry(fs, dirinfo);
+    }
+#endif
+
+  /* No.. Search for the single short file name directory entry */
+
+  return fat_findsfnentry(fs, dirinfo);
+}
+
+/****************************************************************************
+ * Name: fat_dircachehash
+ *
+ * Desciption: Return the hash of the directory being searched and of the
+ *   path segment name.  Zero is reserved to mark unused cache entries.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FAT_NDIRCACHE > 0
+static uint32_t fat_dircachehash(struct fat_dirinfo_s *dirinfo)
+{
+  const uint8_t *name = dirinfo->fd_name;
+  int namelen = DIR_MAXFNAME;
+  uint32_t hash;
+  int i;
+
+#ifdef CONFIG_FAT_LFN
+  if (dirinfo->fd_lfname[0] != '\0')
+    {
+      name    = dirinfo->fd_lfname;
+      namelen = strlen((char*)name);
+    }
+#endif
+
+  /* FNV-1a of the directory start cluster and then the name */
+
+  hash = 2166136261u ^ (uint32_t)dirinfo->dir.fd_startcluster;
+  hash *= 16777619u;
+
+  for (i = 0; i < namelen; i++)
+    {
+      hash ^= name[i];
+      hash *= 16777619u;
+    }
+
+  return hash ? hash : 1;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_dircachefind
+ *
+ * Desciption: Check if the position of the path segment in dirinfo is in
+ *   the directory entry cache.  If so, search from that position.  This
+ *   confirms the match so a stale entry or a hash collision simply costs
+ *   a full search.  Returns -ENOENT if the full search must be performed
+ *   (dirinfo->dir is then unchanged).
+ *
+ *   The cache is two-way set associative.  The first entry of each set is
+ *   the most recently used one.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FAT_NDIRCACHE > 0
+static int fat_dircachefind(struct fat_mountpt_s *fs,
+                            struct fat_dirinfo_s *dirinfo, uint32_t hash)
+{
+  struct fat_dircache_s *dc = &fs->fs_dircache[DIRCACHE_SET(hash)];
+  struct fat_dircache_s tmp;
+  struct fs_fatdir_s dirstart;
+  int ret;
+  int way;
+
+  for (way = 0; way < 2; way++)
+    {
+      if (dc[way].dc_hash == hash &&
+          dc[way].dc_dir.fd_startcluster == dirinfo->dir.fd_startcluster)
+        {
+          break;
+        }
+    }
+
+  if (way >= 2)
+    {
+      fs->fs_stats.st_dcachemisses++;
+      return -ENOENT;
+    }
+
+  /* Resume the search at the cached position */
+
+  memcpy(&dirstart, &dirinfo->dir, sizeof(struct fs_fatdir_s));
+  memcpy(&dirinfo->dir, &dc[way].dc_dir, sizeof(struct fs_fatdir_s));
+
+  ret = fat_findentry(fs, dirinfo);
+  if (ret == OK)
+    {
+      /* The alias logic may need to re-scan the directory from its real
+       * starting sector.
+       */
+
+#ifdef CONFIG_FAT_LFN
+      dirinfo->fd_seq.ds_startsector = dirstart.fd_currsector;
+#endif
+
+      /* Make this the most recently used entry of the set */
+
+      if (way > 0)
+        {
+          memcpy(&tmp, &dc[0], sizeof(struct fat_dircache_s));
+          memcpy(&dc[0], &dc[1], sizeof(struct fat_dircache_s));
+          memcpy(&dc[1], &tmp, sizeof(struct fat_dircache_s));
+        }
+
+      fs->fs_stats.st_dcachehits++;
+      return OK;
+    }
+
+  /* Not there.  Discard the entry and fall back to the full search */
+
+  dc[way].dc_hash = 0;
+  memcpy(&dirinfo->dir, &dirstart, sizeof(struct fs_fatdir_s));
+  fs->fs_stats.st_dcachemisses++;
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_dircacheadd
+ *
+ * Desciption: Remember the position of the directory entry just found,
+ *   replacing the least recently used entry of the set.  The search for a
+ *   long file name must begin at the first long file name entry; these
+ *   immediately precede the short file name entry.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FAT_NDIRCACHE > 0
+static void fat_dircacheadd(struct fat_mountpt_s *fs,
+                            struct fat_dirinfo_s *dirinfo, uint32_t hash)
+{
+  struct fat_dircache_s *dc = &fs->fs_dircache[DIRCACHE_SET(hash)];
+
+  if (dc[0].dc_hash != 0)
+    {
+      memcpy(&dc[1], &dc[0], sizeof(struct fat_dircache_s));
+    }
+
+  dc->dc_hash = hash;
+  memcpy(&dc->dc_dir, &dirinfo->dir, sizeof(struct fs_fatdir_s));
+
+#ifdef CONFIG_FAT_LFN
+  if (dirinfo->fd_lfname[0] != '\0')
+    {
+      int namelen = strlen((char*)dirinfo->fd_lfname);
+
+      dc->dc_dir.fd_currcluster = dirinfo->fd_seq.ds_lfncluster;
+      dc->dc_dir.fd_currsector  = dirinfo->fd_seq.ds_lfnsector;
+      dc->dc_dir.fd_index      -= (namelen + LDIR_MAXLFNCHARS - 1) /
+                                  LDIR_MAXLFNCHARS;
+    }
+#endif
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -2248,6 +2461,9 @@ int fat_finddirentry(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo,
 {
   off_t    cluster;
   uint8_t *direntry;
+#if CONFIG_FAT_NDIRCACHE > 0
+  uint32_t hash;
+#endif
   char     terminator;
   int      ret;
 
@@ -2316,28 +2532,26 @@ int fat_finddirentry(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo,
           return ret;
         }
 
-      /* Is this a path segment a long or a short file.  Was a long file
-       * name parsed?
+      /* Search for the directory entry.  Check the directory entry cache
+       * first, if there is one.  NOTE: As a side effect, this returns with
+       * the sector containing the short file name directory entry in the
+       * cache.
        */
 
-#ifdef CONFIG_FAT_LFN
-      if (dirinfo->fd_lfname[0] != '\0')
+#if CONFIG_FAT_NDIRCACHE > 0
+      hash = fat_dircachehash(dirinfo);
+      ret  = fat_dircachefind(fs, dirinfo, hash);
+      if (ret == -ENOENT)
         {
-          /* Yes.. Search for the sequence of long file name directory
-           * entries. NOTE: As a side effect, this function returns with
-           * the sector containing the short file name directory entry
-           * in the cache.
-           */
- 
-          ret = fat_findlfnentry(fs, dirinfo);
+          ret = fat_findentry(fs, dirinfo);
+          if (ret == OK)
+            {
+              fat_dircacheadd(fs, dirinfo, hash);
+            }
         }
-      else
+#else
+      ret = fat_findentry(fs, dirinfo);
 #endif
-        {
-          /* No.. Search for the single short file name directory entry */
-
-          ret = fat_findsfnentry(fs, dirinfo);
-        }
 
       /* Did we find the directory entries? */
 
@@ -2405,18 +2619,20 @@ int fat_allocatedirentry(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo
   int      ret;
   int      i;
 
-  /* Re-initialize directory object */
-
-  cluster = dirinfo->dir.fd_startcluster;
-
   /* Loop until we successfully allocate the sequence of directory entries
-   * or until to fail to extend the directory cluster chain.
+   * or until to fail to extend the directory cluster chain.  Each search
+   * starts at the beginning of the directory:  A sequence of long file name
+   * entries may begin with the free entries at the end of the old cluster
+   * and continue into the new cluster.
    */
 
   for (;;)
     {
-      /* Can this cluster chain be extended */
+      /* Re-initialize directory object.  Can this cluster chain be
+       * extended?
+       */
 
+      cluster = dirinfo->dir.fd_startcluster;
       if (cluster)
         {
          /* Cluster chain can be extended */
@@ -2490,8 +2706,9 @@ int fat_allocatedirentry(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo
           return cluster;
         }
 
-     /* Flush out any cached data in fs_buffer.. we are going to use
-      * it to initialize the new directory cluster.
+     /* Flush out any cached data in the sector cache.. we are going to
+      * use a cleared sector buffer to initialize the new directory
+      * cluster.
       */
 
       ret = fat_fscacheflush(fs);
@@ -2502,10 +2719,13 @@ int fat_allocatedirentry(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo
 
       /* Clear all sectors comprising the new directory cluster */
 
-      fs->fs_currentsector = fat_cluster2sector(fs, cluster);
-      memset(fs->fs_buffer, 0, fs->fs_hwsectorsize);
+      sector = fat_cluster2sector(fs, cluster);
+      ret = fat_fscacheclear(fs, sector);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
-      sector = fs->fs_currentsector;
       for (i = fs->fs_fatsecperclus; i; i--)
         {
           ret = fat_hwwrite(fs, fs->fs_buffer, sector, 1);
@@ -2536,6 +2756,8 @@ int fat_freedirentry(struct fat_mountpt_s *fs, struct fat_dirseq_s *seq)
   uint8_t *direntry;
   int      ret;
 
+  fat_dircacheflush(fs);
+
   /* Set it to the cluster containing the "last" LFN entry (that appears
    * first on the media).
    */
@@ -2593,6 +2815,8 @@ int fat_freedirentry(struct fat_mountpt_s *fs, struct fat_dirseq_s *seq)
   uint8_t *direntry;
   int      ret;
 
+  fat_dircacheflush(fs);
+
   /* Free the single short file name entry.
    *
    * Make sure that the sector containing the directory entry is in the
@@ -2894,10 +3118,16 @@ int fat_remove(struct fat_mountpt_s *fs, const char *relpath, bool directory)
               return -ENOTEMPTY;
             }
 
-          /* Get the next directory entry */
+          /* Get the next directory entry.  -ENOSPC means that the end of
+           * the last directory cluster was reached:  The directory is empty.
+           */
 
           ret = fat_nextdirentry(fs, &dirinfo.dir);
-          if (ret < 0)
+          if (ret == -ENOSPC)
+            {
+              break;
+            }
+          else if (ret < 0)
             {
               return ret;
             }
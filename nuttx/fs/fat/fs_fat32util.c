@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/fat/fs_fat32util.c
  *
- *   Copyright (C) 2007-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * References:
@@ -106,8 +106,8 @@ static int fat_checkfsinfo(struct fat_mountpt_s *fs)
           FSI_GETSTRUCTSIG(fs->fs_buffer) == 0x61417272 &&
           FSI_GETTRAILSIG(fs->fs_buffer) == BOOT_SIGNATURE32)
         {
-          fs->fs_fsinextfree  = FSI_GETFREECOUNT(fs->fs_buffer);
-          fs->fs_fsifreecount = FSI_GETNXTFREE(fs->fs_buffer);
+          fs->fs_fsifreecount = FSI_GETFREECOUNT(fs->fs_buffer);
+          fs->fs_fsinextfree  = FSI_GETNXTFREE(fs->fs_buffer);
           return OK;
         }
     }
@@ -284,6 +284,440 @@ static int fat_checkbootrecord(struct fat_mountpt_s *fs)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fat_isfatsector
+ *
+ * Desciption: Return true if the sector lies in the (first) FAT table
+ *
+ ****************************************************************************/
+
+static inline bool fat_isfatsector(struct fat_mountpt_s *fs, off_t sector)
+{
+  return sector >= fs->fs_fatbase &&
+         sector < fs->fs_fatbase + fs->fs_nfatsects;
+}
+
+/****************************************************************************
+ * Name: fat_cachesave
+ *
+ * Desciption: The fs_dirty flag applies to the current sector in the
+ *   cache.  Save it in the cache entry before another sector becomes
+ *   current.
+ *
+ ****************************************************************************/
+
+static inline void fat_cachesave(struct fat_mountpt_s *fs)
+{
+  if (fs->fs_dirty)
+    {
+      fs->fs_cache[fs->fs_cachecurr].cs_dirty = true;
+      fs->fs_dirty = false;
+    }
+}
+
+/****************************************************************************
+ * Name: fat_cachewriteback
+ *
+ * Desciption: Write one dirty sector in the cache back to the media.
+ *
+ ****************************************************************************/
+
+static int fat_cachewriteback(struct fat_mountpt_s *fs,
+                              struct fat_cachesect_s *cs)
+{
+  off_t sector = cs->cs_sector;
+  int ret;
+  int i;
+
+  /* Write the dirty sector */
+
+  ret = fat_hwwrite(fs, cs->cs_buffer, sector, 1);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Does the sector lie in the FAT region?  If so, then make the change in
+   * the FAT copies as well.
+   */
+
+  if (fat_isfatsector(fs, sector))
+    {
+      for (i = fs->fs_fatnumfats; i >= 2; i--)
+        {
+          sector += fs->fs_nfatsects;
+          ret = fat_hwwrite(fs, cs->cs_buffer, sector, 1);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  /* No longer dirty */
+
+  cs->cs_dirty = false;
+  fs->fs_stats.st_writebacks++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fat_cachelookup
+ *
+ * Desciption: Return the index of the cache entry that holds the sector or
+ *   a negative value if the sector is not in the cache.
+ *
+ ****************************************************************************/
+
+static int fat_cachelookup(struct fat_mountpt_s *fs, off_t sector)
+{
+  int ndx;
+
+  for (ndx = 0; ndx < CONFIG_FAT_NCACHESECTORS; ndx++)
+    {
+      if (fs->fs_cache[ndx].cs_sector == sector)
+        {
+          return ndx;
+        }
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Name: fat_cachealloc
+ *
+ * Desciption: Select a cache entry to hold the sector (which is not in the
+ *   cache).  An unused entry is selected if there is one; otherwise the
+ *   least recently used entry is written back (if it is dirty) and
+ *   re-used.  If CONFIG_FAT_NFATCACHESECTORS is non-zero, the first entries
+ *   are used only for FAT sectors and the others only for other sectors.
+ *
+ * Returned Value:
+ *   The index of the selected entry or a negated errno value if the old
+ *   content of the entry could not be written back.
+ *
+ ****************************************************************************/
+
+static int fat_cachealloc(struct fat_mountpt_s *fs, off_t sector)
+{
+  struct fat_cachesect_s *cs;
+  uint32_t age;
+  uint32_t oldest;
+  int first;
+  int last;
+  int victim;
+  int ndx;
+  int ret;
+
+#if CONFIG_FAT_NFATCACHESECTORS > 0
+  if (fat_isfatsector(fs, sector))
+    {
+      first = 0;
+      last  = CONFIG_FAT_NFATCACHESECTORS;
+    }
+  else
+    {
+      first = CONFIG_FAT_NFATCACHESECTORS;
+      last  = CONFIG_FAT_NCACHESECTORS;
+    }
+#else
+  first = 0;
+  last  = CONFIG_FAT_NCACHESECTORS;
+#endif
+
+  victim = first;
+  oldest = 0;
+
+  for (ndx = first; ndx < last; ndx++)
+    {
+      cs = &fs->fs_cache[ndx];
+      if (cs->cs_sector < 0)
+        {
+          return ndx;
+        }
+
+      /* The age is computed modulo 2**32 so that wrap-around of the
+       * clock does not matter.
+       */
+
+      age = fs->fs_cacheclock - cs->cs_lastuse;
+      if (age >= oldest)
+        {
+          oldest = age;
+          victim = ndx;
+        }
+    }
+
+  /* Write back the old content of the selected entry if it is dirty */
+
+  cs = &fs->fs_cache[victim];
+  if (cs->cs_dirty)
+    {
+      ret = fat_cachewriteback(fs, cs);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return victim;
+}
+
+/****************************************************************************
+ * Name: fat_cacheselect
+ *
+ * Desciption: Make the cache entry the current sector (fs_buffer).
+ *
+ ****************************************************************************/
+
+static inline void fat_cacheselect(struct fat_mountpt_s *fs, int ndx,
+                                   off_t sector)
+{
+  struct fat_cachesect_s *cs = &fs->fs_cache[ndx];
+
+  cs->cs_sector        = sector;
+  cs->cs_lastuse       = ++fs->fs_cacheclock;
+  fs->fs_cachecurr     = ndx;
+  fs->fs_buffer        = cs->cs_buffer;
+  fs->fs_currentsector = sector;
+}
+
+/****************************************************************************
+ * Name: fat_freemapset
+ *
+ * Desciption: Mark a cluster as allocated or as free in the bitmap of
+ *   allocated clusters.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_FREEBITMAP
+static inline void fat_freemapset(struct fat_mountpt_s *fs, uint32_t cluster,
+                                  bool inuse)
+{
+  uint32_t bit = (uint32_t)1 << (cluster & 31);
+
+  if (inuse)
+    {
+      fs->fs_freemap[cluster >> 5] |= bit;
+    }
+  else
+    {
+      fs->fs_freemap[cluster >> 5] &= ~bit;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_freemapbuild
+ *
+ * Desciption: Allocate the bitmap of allocated clusters and initialize it
+ *   by scanning the FAT.  The count of free clusters is corrected as a side
+ *   effect.
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value if the bitmap could not be
+ *   allocated or the FAT could not be read.  fs_freemap remains NULL in
+ *   that case and the FAT is searched for free clusters instead.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_FREEBITMAP
+static int fat_freemapbuild(struct fat_mountpt_s *fs)
+{
+  uint32_t nwords = (fs->fs_nclusters + 31) >> 5;
+  uint32_t nfreeclusters;
+  uint32_t cluster;
+  off_t    nextcluster;
+
+  fs->fs_freemap = (uint32_t*)kzalloc(nwords * sizeof(uint32_t));
+  if (!fs->fs_freemap)
+    {
+      return -ENOMEM;
+    }
+
+  /* Clusters 0 and 1 are reserved.  The unused bits at the end of the
+   * bitmap are also marked as allocated so that they are never selected.
+   */
+
+  fat_freemapset(fs, 0, true);
+  fat_freemapset(fs, 1, true);
+
+  for (cluster = fs->fs_nclusters; cluster < (nwords << 5); cluster++)
+    {
+      fat_freemapset(fs, cluster, true);
+    }
+
+  /* Then examine every cluster in the FAT */
+
+  nfreeclusters = 0;
+  for (cluster = 2; cluster < fs->fs_nclusters; cluster++)
+    {
+      nextcluster = fat_getcluster(fs, cluster);
+      if (nextcluster < 0)
+        {
+          kfree(fs->fs_freemap);
+          fs->fs_freemap = NULL;
+          return nextcluster;
+        }
+      else if (nextcluster != 0)
+        {
+          fat_freemapset(fs, cluster, true);
+        }
+      else
+        {
+          nfreeclusters++;
+        }
+    }
+
+  /* Now we know the exact number of free clusters */
+
+  if (fs->fs_fsifreecount != nfreeclusters)
+    {
+      fs->fs_fsifreecount = nfreeclusters;
+      if (fs->fs_type == FSTYPE_FAT32)
+        {
+          fs->fs_fsidirty = true;
+        }
+    }
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_freemapsearch
+ *
+ * Desciption: Find the first free cluster after 'cluster' in the bitmap of
+ *   allocated clusters, wrapping around to the beginning of the volume if
+ *   necessary.  32 clusters are examined at a time.
+ *
+ * Return: 0: no free cluster, >=2: the number of the free cluster
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_FREEBITMAP
+static uint32_t fat_freemapsearch(struct fat_mountpt_s *fs, uint32_t cluster)
+{
+  uint32_t nwords = (fs->fs_nclusters + 31) >> 5;
+  uint32_t ndx;
+  uint32_t word;
+  uint32_t i;
+  int      bit;
+
+  cluster++;
+  if (cluster >= fs->fs_nclusters)
+    {
+      cluster = 2;
+    }
+
+  /* Ignore the clusters before the starting cluster in the first word.  They
+   * are examined last, when the search wraps around to the first word.
+   */
+
+  ndx  = cluster >> 5;
+  word = fs->fs_freemap[ndx] | (((uint32_t)1 << (cluster & 31)) - 1);
+
+  for (i = 0; i <= nwords; i++)
+    {
+      if (word != 0xffffffff)
+        {
+          /* There is a free cluster in this word.  Find the first one. */
+
+          for (bit = 0; (word & 1) != 0; bit++)
+            {
+              word >>= 1;
+            }
+
+          return (ndx << 5) + bit;
+        }
+
+      if (++ndx >= nwords)
+        {
+          ndx = 0;
+        }
+
+      word = fs->fs_freemap[ndx];
+    }
+
+  return 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_searchfat
+ *
+ * Desciption: Search the FAT for the first free cluster after startcluster,
+ *   wrapping around to the beginning of the volume if necessary.
+ *
+ * Return: <0:error, 0: no free cluster, >=2: the number of the free cluster
+ *
+ ****************************************************************************/
+
+static int32_t fat_searchfat(struct fat_mountpt_s *fs, uint32_t startcluster)
+{
+  off_t    startsector;
+  uint32_t newcluster;
+
+  /* Loop until (1) we discover that there are not free clusters
+   * (return 0), an errors occurs (return -errno), or (3) we find
+   * the next cluster (return the new cluster number).
+   */
+
+  newcluster = startcluster;
+  for (;;)
+    {
+      /* Examine the next cluster in the FAT */
+
+      newcluster++;
+      if (newcluster >= fs->fs_nclusters)
+        {
+          /* If we hit the end of the available clusters, then
+           * wrap back to the beginning because we might have
+           * started at a non-optimal place.  But don't continue
+           * past the start cluster.
+           */
+
+          newcluster = 2;
+          if (newcluster > startcluster)
+            {
+              /* We are back past the starting cluster, then there
+               * is no free cluster.
+               */
+
+              return 0;
+            }
+        }
+
+      /* We have a candidate cluster.  Check if the cluster number is
+       * mapped to a group of sectors.
+       */
+
+      startsector = fat_getcluster(fs, newcluster);
+      if (startsector == 0)
+        {
+          /* Found have found a free cluster */
+
+          return newcluster;
+        }
+      else if (startsector < 0)
+        {
+          /* Some error occurred, return the error number */
+
+          return startsector;
+        }
+
+      /* We wrap all the back to the starting cluster?  If so, then
+       * there are no free clusters.
+       */
+
+      if (newcluster == startcluster)
+        {
+          return 0;
+        }
+    }
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -294,15 +728,12 @@ static int fat_checkbootrecord(struct fat_mountpt_s *fs)
 
 uint16_t fat_getuint16(uint8_t *ptr)
 {
-#ifdef CONFIG_ENDIAN_BIG
-  /* The bytes always have to be swapped if the target is big-endian */
-
-  return ((uint16_t)ptr[0] << 8) | ptr[1];
-#else
-  /* Byte-by-byte transfer is still necessary if the address is un-aligned */
+  /* FAT values are little-endian.  Assembling the value with shifts works
+   * on both big- and little-endian targets, and byte-by-byte transfer is
+   * necessary anyway if the address is un-aligned.
+   */
 
   return ((uint16_t)ptr[1] << 8) | ptr[0];
-#endif
 }
 
 /****************************************************************************
@@ -311,15 +742,9 @@ uint16_t fat_getuint16(uint8_t *ptr)
 
 uint32_t fat_getuint32(uint8_t *ptr)
 {
-#ifdef CONFIG_ENDIAN_BIG
-  /* The bytes always have to be swapped if the target is big-endian */
-
-  return ((uint32_t)fat_getuint16(&ptr[0]) << 16) | fat_getuint16(&ptr[2]);
-#else
-  /* Byte-by-byte transfer is still necessary if the address is un-aligned */
+  /* The low half-word comes first (see fat_getuint16) */
 
   return ((uint32_t)fat_getuint16(&ptr[2]) << 16) | fat_getuint16(&ptr[0]);
-#endif
 }
 
 /****************************************************************************
@@ -352,13 +777,13 @@ void fat_putuint32(uint8_t *ptr, uint32_t value32)
 #ifdef CONFIG_ENDIAN_BIG
   /* The bytes always have to be swapped if the target is big-endian */
 
-  fat_putuint16(&ptr[0], val[2]);
+  fat_putuint16(&ptr[0], val[1]);
   fat_putuint16(&ptr[2], val[0]);
 #else
   /* Byte-by-byte transfer is still necessary if the address is un-aligned */
 
   fat_putuint16(&ptr[0], val[0]);
-  fat_putuint16(&ptr[2], val[2]);
+  fat_putuint16(&ptr[2], val[1]);
 #endif
 }
 
@@ -540,15 +965,18 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
   fs->fs_hwsectorsize = geo.geo_sectorsize;
   fs->fs_hwnsectors   = geo.geo_nsectors;
 
-  /* Allocate a buffer to hold one hardware sector */
+  /* Allocate the buffers of the sector cache */
 
-  fs->fs_buffer = (uint8_t*)kmalloc(fs->fs_hwsectorsize);
-  if (!fs->fs_buffer)
+  fs->fs_cachebuffer =
+    (uint8_t*)kmalloc(CONFIG_FAT_NCACHESECTORS * fs->fs_hwsectorsize);
+  if (!fs->fs_cachebuffer)
     {
       ret = -ENOMEM;
       goto errout;
     }
 
+  fat_fscacheinit(fs);
+
   /* Search FAT boot record on the drive.  First check at sector zero.  This
    * could be either the boot record or a partition that refers to the boot
    * record.
@@ -668,8 +1096,9 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
   return OK;
 
  errout_with_buffer:
-  kfree(fs->fs_buffer);
-  fs->fs_buffer = 0;
+  kfree(fs->fs_cachebuffer);
+  fs->fs_cachebuffer = NULL;
+  fs->fs_buffer      = NULL;
  errout:
   fs->fs_mounted = false;
   return ret;
@@ -746,6 +1175,7 @@ int fat_hwread(struct fat_mountpt_s *fs, uint8_t *buffer,  off_t sector,
                                                        sector, nsectors);
           if (nSectorsRead == nsectors)
             {
+              fs->fs_stats.st_hwreads += nsectors;
               ret = OK;
             }
           else if (nSectorsRead < 0)
@@ -778,6 +1208,31 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
 
           if (nSectorsWritten == nsectors)
             {
+              int ndx;
+
+              fs->fs_stats.st_hwwrites += nsectors;
+
+              /* Sectors that are written directly (not from the sector
+               * cache) replace any stale copies in the sector cache.
+               */
+
+              for (ndx = 0; ndx < CONFIG_FAT_NCACHESECTORS; ndx++)
+                {
+                  struct fat_cachesect_s *cs = &fs->fs_cache[ndx];
+                  if (cs->cs_sector >= sector &&
+                      cs->cs_sector < sector + nsectors &&
+                      cs->cs_buffer != buffer)
+                    {
+                      cs->cs_sector = -1;
+                      cs->cs_dirty  = false;
+                      if (ndx == fs->fs_cachecurr)
+                        {
+                          fs->fs_currentsector = -1;
+                          fs->fs_dirty         = false;
+                        }
+                    }
+                }
+
               ret = OK;
             }
           else if (nSectorsWritten < 0)
@@ -1078,9 +1533,21 @@ int fat_putcluster(struct fat_mountpt_s *fs, uint32_t clusterno, off_t nextclust
               return -EINVAL;
         }
 
-      /* Mark the modified sector as "dirty" and return success */
+      /* Mark the modified sector as "dirty" */
 
       fs->fs_dirty = true;
+
+#ifdef CONFIG_FAT_FREEBITMAP
+      /* Keep the bitmap of allocated clusters up to date */
+
+      if (fs->fs_freemap && clusterno >= 2)
+        {
+          fat_freemapset(fs, clusterno, nextcluster != 0);
+        }
+#endif
+
+      /* And return success */
+
       return OK;
     }
 
@@ -1169,94 +1636,73 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
         }
     }
   else
-    {
-      /* We are extending an existing chain. Verify that this
-       * is a valid cluster by examining its start sector.
-       */
-
-      startsector = fat_getcluster(fs, cluster);
-      if (startsector < 0)
-        {
-          /* An error occurred, return the error value */
-
-          return startsector;
-        }
-      else if (startsector < 2)
-        {
-          /* Oops.. this cluster does not exist. */
-
-          return 0;
-        }
-      else if (startsector < fs->fs_nclusters)
-        {
-          /* It is already followed by next cluster */
-
-          return startsector;
-        }
-
-      /* Okay.. it checks out */
-
-      startcluster = cluster;
-    }
-
-  /* Loop until (1) we discover that there are not free clusters
-   * (return 0), an errors occurs (return -errno), or (3) we find
-   * the next cluster (return the new cluster number).
-   */
-
-  newcluster = startcluster;
-  for (;;)
-    {
-      /* Examine the next cluster in the FAT */
-
-      newcluster++;
-      if (newcluster >= fs->fs_nclusters)
-        {
-          /* If we hit the end of the available clusters, then
-           * wrap back to the beginning because we might have
-           * started at a non-optimal place.  But don't continue
-           * past the start cluster.
-           */
-
-          newcluster = 2;
-          if (newcluster > startcluster)
-            {
-              /* We are back past the starting cluster, then there
-               * is no free cluster.
-               */
-
-              return 0;
-            }
-        }
-
-      /* We have a candidate cluster.  Check if the cluster number is
-       * mapped to a group of sectors.
+    {
+      /* We are extending an existing chain. Verify that this
+       * is a valid cluster by examining its start sector.
        */
 
-      startsector = fat_getcluster(fs, newcluster);
-      if (startsector == 0)
+      startsector = fat_getcluster(fs, cluster);
+      if (startsector < 0)
         {
-          /* Found have found a free cluster break out*/
-          break;
+          /* An error occurred, return the error value */
+
+          return startsector;
         }
-      else if (startsector < 0)
+      else if (startsector < 2)
         {
-          /* Some error occurred, return the error number */
+          /* Oops.. this cluster does not exist. */
+
+          return 0;
+        }
+      else if (startsector < fs->fs_nclusters)
+        {
+          /* It is already followed by next cluster */
+
           return startsector;
         }
 
-      /* We wrap all the back to the starting cluster?  If so, then
-       * there are no free clusters.
-       */
+      /* Okay.. it checks out */
 
-      if (newcluster == startcluster)
+      startcluster = cluster;
+    }
+
+#ifdef CONFIG_FAT_FREEBITMAP
+  /* Use the bitmap of allocated clusters to find the next free cluster.
+   * The bitmap is built the first time that it is needed.
+   */
+
+  if (!fs->fs_freemap)
+    {
+      (void)fat_freemapbuild(fs);
+    }
+
+  if (fs->fs_freemap)
+    {
+      newcluster = fat_freemapsearch(fs, startcluster);
+    }
+  else
+#endif
+    {
+      /* Search the FAT for the next free cluster */
+
+      ret = fat_searchfat(fs, startcluster);
+      if (ret < 0)
         {
-          return 0;
+          return ret;
         }
+
+      newcluster = ret;
+    }
+
+  if (newcluster == 0)
+    {
+      /* There are no free clusters */
+
+      return 0;
     }
 
-  /* We get here only if we break out with an available cluster
-   * number in 'newcluster'  Now mark that cluster as in-use.
+  /* We get here only if we found an available cluster number in
+   * 'newcluster'  Now mark that cluster as in-use.
    */
 
   ret = fat_putcluster(fs, newcluster, 0x0fffffff);
@@ -1293,6 +1739,205 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
   return newcluster;
 }
 
+/****************************************************************************
+ * Name: fat_runlookup
+ *
+ * Desciption: Find the cluster at index 'clustndx' of the cluster chain of
+ *   an open file in the file's cluster run cache.  If that part of the
+ *   chain has not been visited yet, then the last cluster before it that is
+ *   known is returned instead.  The runs are sorted by cr_index, so this is
+ *   a binary search.
+ *
+ * Return: The index of the cluster that was found (which is clustndx if
+ *   the cluster is in the cache).  The cluster number is returned in
+ *   *pcluster.  If the cache is empty, then 0 is returned and *pcluster is
+ *   the start cluster of the file.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FAT_NCLUSTERRUNS > 0
+uint32_t fat_runlookup(struct fat_file_s *ff, uint32_t clustndx,
+                       uint32_t *pcluster)
+{
+  struct fat_clusterrun_s *run;
+  int low;
+  int high;
+  int mid;
+
+  if (ff->ff_nruns == 0)
+    {
+      *pcluster = ff->ff_startcluster;
+      return 0;
+    }
+
+  /* Find the last run that begins at or before clustndx.  The first run
+   * always begins at index zero.
+   */
+
+  low  = 0;
+  high = ff->ff_nruns - 1;
+  while (low < high)
+    {
+      mid = (low + high + 1) >> 1;
+      if (ff->ff_runs[mid].cr_index <= clustndx)
+        {
+          low = mid;
+        }
+      else
+        {
+          high = mid - 1;
+        }
+    }
+
+  /* If clustndx lies beyond the end of the run, then it must also lie
+   * beyond the end of the cached part of the chain.  Return the last known
+   * cluster.
+   */
+
+  run = &ff->ff_runs[low];
+  if (clustndx >= run->cr_index + run->cr_length)
+    {
+      clustndx = run->cr_index + run->cr_length - 1;
+    }
+
+  *pcluster = run->cr_cluster + (clustndx - run->cr_index);
+  return clustndx;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_runadd
+ *
+ * Desciption: Record that 'cluster' is at index 'clustndx' of the cluster
+ *   chain of an open file.  The cache describes the chain from its start
+ *   without gaps so only the cluster that immediately follows the cached
+ *   part of the chain can be added.  It extends the last run if it is
+ *   contiguous with it or begins a new run if there is room for one.
+ *   Other clusters are ignored.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FAT_NCLUSTERRUNS > 0
+void fat_runadd(struct fat_file_s *ff, uint32_t clustndx, uint32_t cluster)
+{
+  struct fat_clusterrun_s *run;
+
+  /* The first run begins with the start cluster of the file */
+
+  if (ff->ff_nruns == 0)
+    {
+      if (ff->ff_startcluster < 2)
+        {
+          return;
+        }
+
+      run             = &ff->ff_runs[0];
+      run->cr_index   = 0;
+      run->cr_cluster = ff->ff_startcluster;
+      run->cr_length  = 1;
+      ff->ff_nruns    = 1;
+    }
+
+  /* Does this cluster immediately follow the cached part of the chain? */
+
+  run = &ff->ff_runs[ff->ff_nruns - 1];
+  if (clustndx != run->cr_index + run->cr_length)
+    {
+      return;
+    }
+
+  /* Yes.. extend the last run or begin a new one */
+
+  if (cluster == run->cr_cluster + run->cr_length)
+    {
+      run->cr_length++;
+    }
+  else if (ff->ff_nruns < CONFIG_FAT_NCLUSTERRUNS)
+    {
+      run++;
+      run->cr_index   = clustndx;
+      run->cr_cluster = cluster;
+      run->cr_length  = 1;
+      ff->ff_nruns++;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_ffcontiguous
+ *
+ * Desciption: Determine how many sectors, beginning with the current sector
+ *   of an open file, are contiguous on the media so that up to 'nsectors'
+ *   sectors can be transferred with a single block driver request.  If the
+ *   transfer would run past the end of the current cluster, then the
+ *   following clusters of the file are examined (and allocated if 'extend'
+ *   is true).  ff_currentcluster is advanced to the last cluster that is
+ *   contiguous with the current cluster.
+ *
+ *   'position' is the (sector aligned) file position of the current sector.
+ *
+ * Return: The number of contiguous sectors.  This may be more than
+ *   nsectors; the caller must set ff_sectorsincluster to the number of
+ *   contiguous sectors that remain after the transfer.
+ *
+ ****************************************************************************/
+
+unsigned int fat_ffcontiguous(struct fat_mountpt_s *fs, struct fat_file_s *ff,
+                              off_t position, unsigned int nsectors,
+                              bool extend)
+{
+  unsigned int ncontig = ff->ff_sectorsincluster;
+  uint32_t     runcluster;
+  uint32_t     clustndx;
+  int32_t      cluster;
+
+  /* The index of the cluster that follows the current cluster */
+
+  clustndx = position / CLUS_SIZE(fs) + 1;
+
+  while (ncontig < nsectors)
+    {
+      /* Get the next cluster from the cluster run cache or from the FAT */
+
+      if (fat_runlookup(ff, clustndx, &runcluster) == clustndx)
+        {
+          cluster = runcluster;
+        }
+      else if (extend)
+        {
+          cluster = fat_extendchain(fs, ff->ff_currentcluster);
+        }
+      else
+        {
+          cluster = fat_getcluster(fs, ff->ff_currentcluster);
+        }
+
+      /* Errors and the end of the chain are handled (or reported) when the
+       * caller moves to the next cluster.  Here we just stop.
+       */
+
+      if (cluster < 2 || cluster >= fs->fs_nclusters)
+        {
+          break;
+        }
+
+      fat_runadd(ff, clustndx, cluster);
+
+      /* Stop if the next cluster is not adjacent to the current one */
+
+      if (cluster != ff->ff_currentcluster + 1)
+        {
+          break;
+        }
+
+      ff->ff_currentcluster = cluster;
+      ncontig += fs->fs_fatsecperclus;
+      clustndx++;
+    }
+
+  return ncontig;
+}
+
 /****************************************************************************
  * Name: fat_nextdirentry
  *
@@ -1451,100 +2096,182 @@ int  fat_dirtruncate(struct fat_mountpt_s *fs, struct fat_dirinfo_s *dirinfo)
   return fat_fscacheread(fs, savesector);
 }
 
+/****************************************************************************
+ * Name: fat_fscacheinit
+ *
+ * Desciption: Initialize the sector cache when the volume is mounted.
+ *   fs_cachebuffer must hold the storage for CONFIG_FAT_NCACHESECTORS
+ *   sectors.  All entries are initially empty.
+ *
+ ****************************************************************************/
+
+void fat_fscacheinit(struct fat_mountpt_s *fs)
+{
+  int ndx;
+
+  for (ndx = 0; ndx < CONFIG_FAT_NCACHESECTORS; ndx++)
+    {
+      fs->fs_cache[ndx].cs_sector  = -1;
+      fs->fs_cache[ndx].cs_lastuse = 0;
+      fs->fs_cache[ndx].cs_dirty   = false;
+      fs->fs_cache[ndx].cs_buffer  =
+        &fs->fs_cachebuffer[ndx * fs->fs_hwsectorsize];
+    }
+
+  fs->fs_cachecurr     = 0;
+  fs->fs_cacheclock    = 0;
+  fs->fs_buffer        = fs->fs_cache[0].cs_buffer;
+  fs->fs_currentsector = -1;
+  fs->fs_dirty         = false;
+}
+
 /****************************************************************************
  * Name: fat_fscacheflush
  *
- * Desciption: Flush any dirty sector if fs_buffer as necessary
+ * Desciption: Write back all dirty sectors in the sector cache
  *
  ****************************************************************************/
 
 int fat_fscacheflush(struct fat_mountpt_s *fs)
 {
   int ret;
+  int ndx;
 
-  /* Check if the fs_buffer is dirty.  In this case, we will write back the
-   * contents of fs_buffer.
-   */
+  fat_cachesave(fs);
 
-  if (fs->fs_dirty)
+  for (ndx = 0; ndx < CONFIG_FAT_NCACHESECTORS; ndx++)
     {
-      /* Write the dirty sector */
-
-      ret = fat_hwwrite(fs, fs->fs_buffer, fs->fs_currentsector, 1);
-      if (ret < 0)
-        {
-          return ret;
-        }
-
-      /* Does the sector lie in the FAT region? */
-
-      if (fs->fs_currentsector >= fs->fs_fatbase &&
-          fs->fs_currentsector < fs->fs_fatbase + fs->fs_nfatsects)
+      if (fs->fs_cache[ndx].cs_dirty)
         {
-          /* Yes, then make the change in the FAT copy as well */
-          int i;
-
-          for (i = fs->fs_fatnumfats; i >= 2; i--)
-            { 
-              fs->fs_currentsector += fs->fs_nfatsects;
-              ret = fat_hwwrite(fs, fs->fs_buffer, fs->fs_currentsector, 1);
-              if (ret < 0)
-                {
-                  return ret;
-                }
+          ret = fat_cachewriteback(fs, &fs->fs_cache[ndx]);
+          if (ret < 0)
+            {
+              return ret;
             }
         }
-
-      /* No longer dirty */
-
-      fs->fs_dirty = false;
     }
+
   return OK;
 }
 
 /****************************************************************************
  * Name: fat_fscacheread
  *
- * Desciption: Read the specified sector into the sector cache, flushing any
- *   existing dirty sectors as necessary.
+ * Desciption: Make the specified sector the current sector in the sector
+ *   cache (fs_buffer), reading it from the media if it is not already in
+ *   the cache.  The least recently used sector is replaced (and written
+ *   back if it is dirty) if necessary.
  *
  ****************************************************************************/
 
 int fat_fscacheread(struct fat_mountpt_s *fs, off_t sector)
 {
+  bool isfat = fat_isfatsector(fs, sector);
+  int ndx;
   int ret;
 
   /* fs->fs_currentsector holds the current sector that is buffered in
    * fs->fs_buffer. If the requested sector is the same as this sector, then
-   * we do nothing. Otherwise, we will have to read the new sector.
+   * we do nothing but update its age.
    */
 
-    if (fs->fs_currentsector != sector)
-      {
-        /* We will need to read the new sector.  First, flush the cached
-         * sector if it is dirty.
-         */
+  if (fs->fs_currentsector == sector)
+    {
+      ndx = fs->fs_cachecurr;
+    }
+  else
+    {
+      /* Save the dirty state of the current sector and look for the
+       * requested sector elsewhere in the cache.
+       */
+
+      fat_cachesave(fs);
+
+      ndx = fat_cachelookup(fs, sector);
+      if (ndx < 0)
+        {
+          /* Not in the cache.  Select an entry and read the sector into
+           * it.
+           */
+
+          if (isfat)
+            {
+              fs->fs_stats.st_fatmisses++;
+            }
+          else
+            {
+              fs->fs_stats.st_dirmisses++;
+            }
+
+          ndx = fat_cachealloc(fs, sector);
+          if (ndx < 0)
+            {
+              return ndx;
+            }
+
+          ret = fat_hwread(fs, fs->fs_cache[ndx].cs_buffer, sector, 1);
+          if (ret < 0)
+            {
+              /* The old content of the entry is lost */
+
+              fs->fs_cache[ndx].cs_sector = -1;
+              if (ndx == fs->fs_cachecurr)
+                {
+                  fs->fs_currentsector = -1;
+                }
 
-        ret = fat_fscacheflush(fs);
-        if (ret < 0)
-          {
               return ret;
-          }
+            }
 
-        /* Then read the specified sector into the cache */
+          fat_cacheselect(fs, ndx, sector);
+          return OK;
+        }
+    }
 
-        ret = fat_hwread(fs, fs->fs_buffer, sector, 1);
-        if (ret < 0)
-          {
-            return ret;
-          }
+  if (isfat)
+    {
+      fs->fs_stats.st_fathits++;
+    }
+  else
+    {
+      fs->fs_stats.st_dirhits++;
+    }
 
-        /* Update the cached sector number */
+  fat_cacheselect(fs, ndx, sector);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fat_fscacheclear
+ *
+ * Desciption: Make the specified sector the current sector in the sector
+ *   cache with all zero content.  The sector is not read from the media.
+ *   This is used when the entire sector will be overwritten.  The caller
+ *   must set fs_dirty if the new content is to be written back.
+ *
+ ****************************************************************************/
+
+int fat_fscacheclear(struct fat_mountpt_s *fs, off_t sector)
+{
+  int ndx;
+
+  fat_cachesave(fs);
 
-        fs->fs_currentsector = sector;
+  ndx = fat_cachelookup(fs, sector);
+  if (ndx < 0)
+    {
+      ndx = fat_cachealloc(fs, sector);
+      if (ndx < 0)
+        {
+          return ndx;
+        }
     }
 
-    return OK;
+  fs->fs_cache[ndx].cs_dirty = false;
+  memset(fs->fs_cache[ndx].cs_buffer, 0, fs->fs_hwsectorsize);
+
+  fat_cacheselect(fs, ndx, sector);
+  return OK;
 }
 
 /****************************************************************************
@@ -1669,7 +2396,7 @@ int fat_updatefsinfo(struct fat_mountpt_s *fs)
 {
   int ret;
 
-  /* Flush the fs_buffer if it is dirty */
+  /* Write back all dirty sectors in the sector cache */
 
   ret = fat_fscacheflush(fs);
   if (ret == OK)
@@ -1684,7 +2411,12 @@ int fat_updatefsinfo(struct fat_mountpt_s *fs)
         {
           /* Create an image of the FSINFO sector in the fs_buffer */
 
-          memset(fs->fs_buffer, 0, fs->fs_hwsectorsize);
+          ret = fat_fscacheclear(fs, fs->fs_fsinfo);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
           FSI_PUTLEADSIG(fs->fs_buffer, 0x41615252);
           FSI_PUTSTRUCTSIG(fs->fs_buffer, 0x61417272);
           FSI_PUTFREECOUNT(fs->fs_buffer, fs->fs_fsifreecount);
@@ -1693,9 +2425,8 @@ int fat_updatefsinfo(struct fat_mountpt_s *fs)
 
           /* Then flush this to disk */
 
-          fs->fs_currentsector = fs->fs_fsinfo;
-          fs->fs_dirty         = true;
-          ret                  = fat_fscacheflush(fs);
+          fs->fs_dirty = true;
+          ret          = fat_fscacheflush(fs);
 
           /* No longer dirty */
 
@@ -1716,6 +2447,23 @@ int fat_nfreeclusters(struct fat_mountpt_s *fs, off_t *pfreeclusters)
 {
   uint32_t nfreeclusters;
 
+#ifdef CONFIG_FAT_FREEBITMAP
+  /* The free cluster count is exact once the bitmap of allocated clusters
+   * has been built.
+   */
+
+  if (!fs->fs_freemap)
+    {
+      (void)fat_freemapbuild(fs);
+    }
+
+  if (fs->fs_freemap)
+    {
+      *pfreeclusters = fs->fs_fsifreecount;
+      return OK;
+    }
+#endif
+
   /* If number of the first free cluster is valid, then just return that value. */
 
   if (fs->fs_fsifreecount <= fs->fs_nclusters - 2)
@@ -1762,7 +2510,7 @@ int fat_nfreeclusters(struct fat_mountpt_s *fs, off_t *pfreeclusters)
 
           if (offset >= fs->fs_hwsectorsize)
             {
-              ret = fat_fscacheread(fs, fatsector++);
+              ret = fat_fscacheread(fs, fatsector);
               if (ret < 0)
                 {
                   return ret;
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs.h
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -52,6 +52,10 @@
 #include <nuttx/mtd.h>
 #include <nuttx/nxffs.h>
 
+#if CONFIG_NXFFS_PACKRESERVE > 0
+#  include <nuttx/wqueue.h>
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -246,6 +250,18 @@ struct nxffs_entry_s
   uint32_t                  datlen;    /* Length of inode data */
 };
 
+/* This structure describes one entry in the RAM inode index.  The index is
+ * kept in sorted order by the hash of the inode name.
+ */
+
+#if CONFIG_NXFFS_NINDEX > 0
+struct nxffs_ixentry_s
+{
+  uint32_t                  hash;      /* CRC32 of the inode name */
+  off_t                     hoffset;   /* FLASH offset to the inode header */
+};
+#endif
+
 /* This structure describes int in-memory representation of the data block */
 
 struct nxffs_blkentry_s
@@ -301,6 +317,22 @@ struct nxffs_volume_s
   FAR struct nxffs_ofile_s *ofiles;    /* A singly-linked list of open files */
   FAR uint8_t              *cache;     /* On cached erase block for general I/O */
   FAR uint8_t              *pack;      /* A full erase block to support packing */
+#if CONFIG_NXFFS_NINDEX > 0
+  bool                      ixvalid;   /* True: The inode index is complete */
+  uint16_t                  nix;       /* Number of entries in the inode index */
+  struct nxffs_ixentry_s    ix[CONFIG_NXFFS_NINDEX]; /* RAM inode index */
+#endif
+  bool                      pkstale;   /* True: Inodes may have been deleted */
+  bool                      pkblocked; /* True: Packing waits for the writer */
+  uint8_t                   pkstate;   /* Incremental packing state (NXFFS_PACK_*) */
+  off_t                     pkoffset;  /* FLASH before this offset is packed */
+  off_t                     pkblock;   /* Next erase block to be erased */
+  off_t                     pkend;     /* Free FLASH offset when erasing began */
+  uint32_t                  pksteps;   /* Number of incremental packing steps */
+  uint32_t                  pkpasses;  /* Number of completed packing passes */
+#if CONFIG_NXFFS_PACKRESERVE > 0
+  struct work_s             pkwork;    /* Supports packing on the worker thread */
+#endif
 };
 
 /* This structure describes the state of the blocks on the NXFFS volume */
@@ -666,6 +698,135 @@ extern int nxffs_findinode(FAR struct nxffs_volume_s *volume,
 extern off_t nxffs_inodeend(FAR struct nxffs_volume_s *volume,
                             FAR struct nxffs_entry_s *entry);
 
+/****************************************************************************
+ * Name: nxffs_ixreset
+ *
+ * Description:
+ *   Discard the content of the RAM inode index and mark it as complete.
+ *   This is called before the inodes on FLASH are enumerated by
+ *   nxffs_limits() and after the FLASH is re-formatted.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   None
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_NINDEX > 0
+extern void nxffs_ixreset(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_ixreset(v)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixadd
+ *
+ * Description:
+ *   Add a valid inode to the RAM inode index.  If there is no space in
+ *   the index for the new inode, then the index is marked incomplete and
+ *   will not be used until it is rebuilt.
+ *
+ * Input Parameters:
+ *   volume  - Describes the NXFFS volume
+ *   name    - The name of the inode
+ *   hoffset - The FLASH offset to the inode header
+ *
+ * Returned Value:
+ *   None
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_NINDEX > 0
+extern void nxffs_ixadd(FAR struct nxffs_volume_s *volume,
+                        FAR const char *name, off_t hoffset);
+#else
+#  define nxffs_ixadd(v,n,o)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixremove
+ *
+ * Description:
+ *   Remove a deleted inode from the RAM inode index.
+ *
+ * Input Parameters:
+ *   volume  - Describes the NXFFS volume
+ *   name    - The name of the inode
+ *   hoffset - The FLASH offset to the inode header
+ *
+ * Returned Value:
+ *   None
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_NINDEX > 0
+extern void nxffs_ixremove(FAR struct nxffs_volume_s *volume,
+                           FAR const char *name, off_t hoffset);
+#else
+#  define nxffs_ixremove(v,n,o)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixbuild
+ *
+ * Description:
+ *   Rebuild the RAM inode index by enumerating all of the valid inodes on
+ *   FLASH.  This is necessary after the FLASH has been re-packed and the
+ *   inodes have moved.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   None.  If the index could not be rebuilt, it is marked incomplete
+ *   and file lookups will search the FLASH.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_NINDEX > 0
+extern void nxffs_ixbuild(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_ixbuild(v)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixfind
+ *
+ * Description:
+ *   Use the RAM inode index to find the inode with the provided name.  The
+ *   inode header at each candidate FLASH offset is read and the name is
+ *   compared, so hash collisions are harmless.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *   name   - The name of the inode to find
+ *   entry  - The location to return information about the inode.
+ *
+ * Returned Value:
+ *   Zero is returned on success.  -ENOENT is returned if there is no such
+ *   inode.  -ESTALE is returned if the index is not usable; in that case
+ *   the caller must search the FLASH for the inode.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_NINDEX > 0
+extern int nxffs_ixfind(FAR struct nxffs_volume_s *volume,
+                        FAR const char *name,
+                        FAR struct nxffs_entry_s *entry);
+#endif
+
 /****************************************************************************
  * Name: nxffs_verifyblock
  *
@@ -1034,6 +1195,104 @@ extern int nxffs_rminode(FAR struct nxffs_volume_s *volume, FAR const char *name
 
 extern int nxffs_pack(FAR struct nxffs_volume_s *volume);
 
+/****************************************************************************
+ * Name: nxffs_packstep
+ *
+ * Description:
+ *   Perform one step of an incremental packing pass.  If no pass is in
+ *   progress, then a new pass is started.  Each step either moves valid
+ *   inodes into (about) one erase block at the beginning of FLASH or erases
+ *   one erase block of the reclaimed FLASH at the end.  The caller must
+ *   hold the volume exclsem.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Returned Values:
+ *   Zero on success; volume->pkstate will be NXFFS_PACK_IDLE when the pass
+ *   is complete.  -EBUSY is returned if nothing more can be done until the
+ *   file that is open for writing is closed:  All inodes before its data
+ *   have been moved, but its data cannot be moved and the reclaimed FLASH
+ *   cannot be erased.  Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ * Defined in nxffs_pack.c
+ *
+ ****************************************************************************/
+
+extern int nxffs_packstep(FAR struct nxffs_volume_s *volume);
+
+/****************************************************************************
+ * Name: nxffs_packfinish
+ *
+ * Description:
+ *   Finish erasing the reclaimed FLASH if an incremental packing pass has
+ *   started to erase it.  This must be done before a file is opened for
+ *   writing:  Inode searches stop at the first run of erased FLASH so new
+ *   data cannot be written after partially erased FLASH.  The caller must
+ *   hold the volume exclsem.
+ *
+ * Input Parameters:
+ *   volume - The volume being packed.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ * Defined in nxffs_pack.c
+ *
+ ****************************************************************************/
+
+extern int nxffs_packfinish(FAR struct nxffs_volume_s *volume);
+
+/****************************************************************************
+ * Name: nxffs_packrecover
+ *
+ * Description:
+ *   Check if the volume was mounted while the incremental packing logic was
+ *   erasing the reclaimed FLASH (as after a power failure).  In that case,
+ *   old inode data may still follow the free FLASH region and that FLASH
+ *   must be erased before anything more can be written.  This is called
+ *   from nxffs_initialize() after the file system limits are known.
+ *
+ * Input Parameters:
+ *   volume - The volume to be checked.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ * Defined in nxffs_pack.c
+ *
+ ****************************************************************************/
+
+extern int nxffs_packrecover(FAR struct nxffs_volume_s *volume);
+
+/****************************************************************************
+ * Name: nxffs_packcheck
+ *
+ * Description:
+ *   Check if fewer than CONFIG_NXFFS_PACKRESERVE bytes of FLASH remain free
+ *   and, if so, schedule incremental packing on the worker thread.  This is
+ *   called with the volume exclsem held after FLASH is written or inodes
+ *   are deleted.
+ *
+ * Input Parameters:
+ *   volume - The volume to be checked.
+ *
+ * Returned Values:
+ *   None
+ *
+ * Defined in nxffs_pack.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_PACKRESERVE > 0
+extern void nxffs_packcheck(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_packcheck(v)
+#endif
+
 /****************************************************************************
  * Standard mountpoint operation methods
  *
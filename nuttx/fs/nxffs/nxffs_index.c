@@ -0,0 +1,374 @@
+/****************************************************************************
+ * fs/nxffs/nxffs_index.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <crc32.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/mtd.h>
+
+#include "nxffs.h"
+
+#if CONFIG_NXFFS_NINDEX > 0
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/****************************************************************************
+ * Public Variables
+ ****************************************************************************/
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_ixhash
+ *
+ * Description:
+ *   Return the hash of an inode name.
+ *
+ ****************************************************************************/
+
+static inline uint32_t nxffs_ixhash(FAR const char *name)
+{
+  return crc32((FAR const uint8_t *)name, strlen(name));
+}
+
+/****************************************************************************
+ * Name: nxffs_ixsearch
+ *
+ * Description:
+ *   Return the index of the first entry in the RAM inode index with a hash
+ *   value greater than or equal to the provided hash value.
+ *
+ ****************************************************************************/
+
+static int nxffs_ixsearch(FAR struct nxffs_volume_s *volume, uint32_t hash)
+{
+  int low  = 0;
+  int high = volume->nix;
+
+  while (low < high)
+    {
+      int mid = (low + high) >> 1;
+      if (volume->ix[mid].hash < hash)
+        {
+          low = mid + 1;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  return low;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_ixreset
+ *
+ * Description:
+ *   Discard the content of the RAM inode index and mark it as complete.
+ *   This is called before the inodes on FLASH are enumerated by
+ *   nxffs_limits() and after the FLASH is re-formatted.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void nxffs_ixreset(FAR struct nxffs_volume_s *volume)
+{
+  volume->nix     = 0;
+  volume->ixvalid = true;
+}
+
+/****************************************************************************
+ * Name: nxffs_ixadd
+ *
+ * Description:
+ *   Add a valid inode to the RAM inode index.  If there is no space in
+ *   the index for the new inode, then the index is marked incomplete and
+ *   will not be used until it is rebuilt.
+ *
+ * Input Parameters:
+ *   volume  - Describes the NXFFS volume
+ *   name    - The name of the inode
+ *   hoffset - The FLASH offset to the inode header
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void nxffs_ixadd(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                 off_t hoffset)
+{
+  uint32_t hash;
+  int ndx;
+
+  /* Nothing is added to an incomplete index */
+
+  if (!volume->ixvalid)
+    {
+      return;
+    }
+
+  /* Is there space for another inode? */
+
+  if (volume->nix >= CONFIG_NXFFS_NINDEX)
+    {
+      /* No.. Abandon the index.  All lookups will search the FLASH until
+       * the index is rebuilt.
+       */
+
+      fvdbg("Inode index is full\n");
+      volume->ixvalid = false;
+      return;
+    }
+
+  /* Insert the new entry, keeping the index in sorted order */
+
+  hash = nxffs_ixhash(name);
+  ndx  = nxffs_ixsearch(volume, hash);
+
+  memmove(&volume->ix[ndx + 1], &volume->ix[ndx],
+          (volume->nix - ndx) * sizeof(struct nxffs_ixentry_s));
+
+  volume->ix[ndx].hash    = hash;
+  volume->ix[ndx].hoffset = hoffset;
+  volume->nix++;
+}
+
+/****************************************************************************
+ * Name: nxffs_ixremove
+ *
+ * Description:
+ *   Remove a deleted inode from the RAM inode index.
+ *
+ * Input Parameters:
+ *   volume  - Describes the NXFFS volume
+ *   name    - The name of the inode
+ *   hoffset - The FLASH offset to the inode header
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void nxffs_ixremove(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                    off_t hoffset)
+{
+  uint32_t hash;
+  int ndx;
+
+  if (!volume->ixvalid)
+    {
+      return;
+    }
+
+  /* Find the entry with this hash and FLASH offset */
+
+  hash = nxffs_ixhash(name);
+  for (ndx = nxffs_ixsearch(volume, hash);
+       ndx < volume->nix && volume->ix[ndx].hash == hash;
+       ndx++)
+    {
+      if (volume->ix[ndx].hoffset == hoffset)
+        {
+          /* Found it.. close the gap */
+
+          volume->nix--;
+          memmove(&volume->ix[ndx], &volume->ix[ndx + 1],
+                  (volume->nix - ndx) * sizeof(struct nxffs_ixentry_s));
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: nxffs_ixbuild
+ *
+ * Description:
+ *   Rebuild the RAM inode index by enumerating all of the valid inodes on
+ *   FLASH.  This is necessary after the FLASH has been re-packed and the
+ *   inodes have moved.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   None.  If the index could not be rebuilt, it is marked incomplete
+ *   and file lookups will search the FLASH.
+ *
+ ****************************************************************************/
+
+void nxffs_ixbuild(FAR struct nxffs_volume_s *volume)
+{
+  struct nxffs_entry_s entry;
+  off_t offset;
+  int ret;
+
+  /* Enumerate the inodes in the same way as does nxffs_findinode() */
+
+  nxffs_ixreset(volume);
+  offset = volume->inoffset;
+
+  while ((ret = nxffs_nextentry(volume, offset, &entry)) == OK)
+    {
+      nxffs_ixadd(volume, entry.name, entry.hoffset);
+      offset = nxffs_inodeend(volume, &entry);
+      nxffs_freeentry(&entry);
+
+      /* There is no point in continuing if the index overflowed */
+
+      if (!volume->ixvalid)
+        {
+          return;
+        }
+    }
+
+  /* -ENOENT simply means that the end of the inodes was reached */
+
+  if (ret != -ENOENT)
+    {
+      fdbg("Failed to rebuild the inode index: %d\n", -ret);
+      volume->ixvalid = false;
+    }
+}
+
+/****************************************************************************
+ * Name: nxffs_ixfind
+ *
+ * Description:
+ *   Use the RAM inode index to find the inode with the provided name.  The
+ *   inode header at each candidate FLASH offset is read and the name is
+ *   compared, so hash collisions are harmless.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *   name   - The name of the inode to find
+ *   entry  - The location to return information about the inode.
+ *
+ * Returned Value:
+ *   Zero is returned on success.  -ENOENT is returned if there is no such
+ *   inode.  -ESTALE is returned if the index is not usable; in that case
+ *   the caller must search the FLASH for the inode.
+ *
+ ****************************************************************************/
+
+int nxffs_ixfind(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                 FAR struct nxffs_entry_s *entry)
+{
+  uint32_t hash;
+  off_t hoffset;
+  int ndx;
+  int ret;
+
+  if (!volume->ixvalid)
+    {
+      return -ESTALE;
+    }
+
+  /* Check each inode with a matching hash value */
+
+  hash = nxffs_ixhash(name);
+  for (ndx = nxffs_ixsearch(volume, hash);
+       ndx < volume->nix && volume->ix[ndx].hash == hash;
+       ndx++)
+    {
+      /* Read the inode header at this FLASH offset.  It must be a valid
+       * inode at exactly the same offset.
+       */
+
+      hoffset = volume->ix[ndx].hoffset;
+      ret = nxffs_nextentry(volume, hoffset, entry);
+      if (ret < 0 || entry->hoffset != hoffset)
+        {
+          /* The index does not agree with the FLASH.  This should not
+           * happen but, if it does, abandon the index.
+           */
+
+          fdbg("No valid inode at offset %d\n", hoffset);
+          if (ret == OK)
+            {
+              nxffs_freeentry(entry);
+            }
+
+          volume->ixvalid = false;
+          return -ESTALE;
+        }
+
+      /* Is this the NXFFS inode we are looking for? */
+
+      if (strcmp(name, entry->name) == 0)
+        {
+          return OK;
+        }
+
+      /* No.. just a hash collision */
+
+      nxffs_freeentry(entry);
+    }
+
+  /* The index is complete so, if the name is not in the index, then
+   * there is no inode with this name.
+   */
+
+  return -ENOENT;
+}
+
+#endif /* CONFIG_NXFFS_NINDEX > 0 */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_initialize.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -132,6 +132,61 @@ struct nxffs_volume_s g_volume;
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxffs_dataend
+ *
+ * Description:
+ *   Return the exact FLASH offset to the first byte after the inode data.
+ *   Unlike nxffs_inodeend(), this follows the chain of data blocks and so
+ *   requires additional FLASH accesses.
+ *
+ * Input Parameters:
+ *   volume - Identifies the NXFFS volume
+ *   entry  - Describes the inode.
+ *
+ * Returned Value:
+ *   The FLASH offset to the first byte after the inode data.  If the data
+ *   blocks cannot be followed, the approximate offset from
+ *   nxffs_inodeend() is returned.
+ *
+ ****************************************************************************/
+
+static off_t nxffs_dataend(FAR struct nxffs_volume_s *volume,
+                           FAR struct nxffs_entry_s *entry)
+{
+  struct nxffs_blkentry_s blkentry;
+  off_t offset;
+  off_t nbytes;
+  int ret;
+
+  /* A zero length file has no data blocks.  It ends with the inode name */
+
+  if (entry->doffset == 0)
+    {
+      return entry->noffset + strlen(entry->name);
+    }
+
+  /* Otherwise, follow the data blocks until all of the data is accounted
+   * for.
+   */
+
+  offset = entry->doffset;
+  for (nbytes = 0; nbytes < entry->datlen; )
+    {
+      ret = nxffs_nextblock(volume, offset, &blkentry);
+      if (ret < 0)
+        {
+          fdbg("Failed to find next data block: %d\n", -ret);
+          return nxffs_inodeend(volume, entry);
+        }
+
+      nbytes += blkentry.datlen;
+      offset  = blkentry.hoffset + SIZEOF_NXFFS_DATA_HDR + blkentry.datlen;
+    }
+
+  return offset;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -165,6 +220,18 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
 #ifdef CONFIG_NXFSS_PREALLOCATED
 
   volume = &g_volume;
+
+#if CONFIG_NXFFS_PACKRESERVE > 0
+  /* Make sure that there is no packing work still queued for the previous
+   * instance of the volume before the volume structure is re-initialized.
+   */
+
+  if (volume->pkwork.worker != NULL)
+    {
+      (void)work_cancel(LPWORK, &volume->pkwork);
+    }
+#endif
+
   memset(volume, 0, sizeof(struct nxffs_volume_s));
 
 #else
@@ -181,8 +248,9 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
 
   /* Initialize the NXFFS volume structure */
 
-  volume->mtd    = mtd;
-  volume->cblock = (off_t)-1;
+  volume->mtd     = mtd;
+  volume->cblock  = (off_t)-1;
+  volume->pkstale = true;   /* Deleted inodes may already be on the FLASH */
   sem_init(&volume->exclsem, 0, 1);
   sem_init(&volume->wrsem, 0, 1);
 
@@ -269,11 +337,20 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
   /* Get the file system limits */
 
   ret = nxffs_limits(volume);
+  if (ret < 0)
+    {
+      fdbg("Failed to calculate file system limits: %d\n", -ret);
+      goto errout_with_buffer;
+    }
+
+  /* Finish any incremental packing that was interrupted while erasing */
+
+  ret = nxffs_packrecover(volume);
   if (ret == OK)
     {
       return OK;
     }
-  fdbg("Failed to calculate file system limits: %d\n", -ret);
+  fdbg("Failed to recover incremental packing: %d\n", -ret);
 
 errout_with_buffer:
   kfree(volume->pack);
@@ -316,10 +393,17 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
   FAR struct nxffs_entry_s entry;
   off_t block;
   off_t offset;
+  off_t lastinode;
   bool noinodes = false;
   int nerased;
   int ret;
 
+  /* Start a new RAM inode index.  All of the inodes will be added as they
+   * are enumerated.
+   */
+
+  nxffs_ixreset(volume);
+
   /* Get the offset to the first valid block on the FLASH */
 
   block = 0;
@@ -361,10 +445,14 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
       /* Save the offset to the first inode */
 
       volume->inoffset = entry.hoffset;
+      lastinode        = entry.hoffset;
       fvdbg("First inode at offset %d\n", volume->inoffset);
 
-      /* Discard this entry and set the next offset. */
+      /* Add the inode to the index, discard this entry, and set the next
+       * offset.
+       */
 
+      nxffs_ixadd(volume, entry.name, entry.hoffset);
       offset = nxffs_inodeend(volume, &entry);
       nxffs_freeentry(&entry);
     }
@@ -375,11 +463,29 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
     {
       while ((ret = nxffs_nextentry(volume, offset, &entry)) == OK)
         {
-          /* Discard the entry and guess the next offset. */
+          /* Add the inode to the index, discard the entry and guess the
+           * next offset.
+           */
 
-          offset = nxffs_inodeend(volume, &entry);
+          nxffs_ixadd(volume, entry.name, entry.hoffset);
+          lastinode = entry.hoffset;
+          offset    = nxffs_inodeend(volume, &entry);
           nxffs_freeentry(&entry);    
         }
+
+      /* The offset from nxffs_inodeend() is only approximate.  Searching
+       * for erased FLASH from there could mistake trailing data bytes that
+       * happen to have the erased value for the free FLASH region.  So get
+       * the exact end of the data of the last inode.
+       */
+
+      ret = nxffs_nextentry(volume, lastinode, &entry);
+      if (ret == OK)
+        {
+          offset = nxffs_dataend(volume, &entry);
+          nxffs_freeentry(&entry);
+        }
+
       fvdbg("Last inode before offset %d\n", offset);
     }
 
@@ -395,11 +501,13 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
       if (ch < 0)
         {
           /* Failed to read the next byte... this could mean that the FLASH
-           * is full?
+           * is full?  (The offset may also lie just beyond the end of FLASH
+           * if the data of the last inode fills the very last byte).
            */
 
-          if (volume->ioblock + 1 >= volume->nblocks &&
-              volume->iooffset + 1 >= volume->geo.blocksize)
+          if (volume->ioblock >= volume->nblocks ||
+              (volume->ioblock + 1 >= volume->nblocks &&
+               volume->iooffset + 1 >= volume->geo.blocksize))
             {
               /* Yes.. the FLASH is full.  Force the offsets to the end of FLASH */
 
@@ -447,7 +555,12 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
         }
       else
         {
-          offset += nerased + 1;
+          /* Not erased.  The free FLASH region cannot begin before the next
+           * byte.  NOTE:  The offset must be recovered from the I/O position
+           * because nxffs_getc() silently skips over block headers.
+           */
+
+          offset  = nxffs_iotell(volume);
           nerased = 0;
         }
     }
@@ -514,7 +627,37 @@ int nxffs_unbind(FAR void *handle, FAR struct inode **blkdriver)
 {
 #ifndef CONFIG_NXFSS_PREALLOCATED
 #  error "No design to support dynamic allocation of volumes"
+#else
+#if CONFIG_NXFFS_PACKRESERVE > 0
+  int ret;
+
+  ret = sem_wait(&g_volume.exclsem);
+  if (ret != OK)
+    {
+      fdbg("sem_wait failed: %d\n", errno);
+      return -errno;
+    }
+
+  if (g_volume.ofiles)
+    {
+      sem_post(&g_volume.exclsem);
+      return -EBUSY;
+    }
+
+  /* Cancel any packing work that is still queued and forget the pass in
+   * progress.  If the worker is already running, it is waiting for the
+   * exclsem and will find that there is nothing left to do.
+   */
+
+  (void)work_cancel(LPWORK, &g_volume.pkwork);
+  g_volume.pkstate   = NXFFS_PACK_IDLE;
+  g_volume.pkstale   = false;
+  g_volume.pkblocked = false;
+
+  sem_post(&g_volume.exclsem);
+  return OK;
 #else
   return g_volume.ofiles ? -EBUSY : OK;
 #endif
+#endif
 }
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_inode.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -392,6 +392,18 @@ int nxffs_findinode(FAR struct nxffs_volume_s *volume, FAR const char *name,
   off_t offset;
   int ret;
 
+#if CONFIG_NXFFS_NINDEX > 0
+  /* If the RAM inode index is complete, then it can be used to go directly
+   * to the inode header (or to know that there is no such inode).
+   */
+
+  ret = nxffs_ixfind(volume, name, entry);
+  if (ret != -ESTALE)
+    {
+      return ret;
+    }
+#endif
+
   /* Start with the first valid inode that was discovered when the volume
    * was created (or modified after the last file system re-packing).
    */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_ioctl.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -68,6 +68,26 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxffs_packstatus
+ *
+ * Description:
+ *   Return the state of incremental packing for the FIOC_PACKSTEP and
+ *   FIOC_PACKSTATUS commands.
+ *
+ ****************************************************************************/
+
+static void nxffs_packstatus(FAR struct nxffs_volume_s *volume,
+                             FAR struct nxffs_packstatus_s *status)
+{
+  status->ps_state    = volume->pkstate;
+  status->ps_offset   = volume->pkoffset;
+  status->ps_froffset = volume->froffset;
+  status->ps_size     = volume->nblocks * volume->geo.blocksize;
+  status->ps_nsteps   = volume->pksteps;
+  status->ps_npasses  = volume->pkpasses;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -108,7 +128,9 @@ int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       goto errout;
     }
 
-  /* Only a reformat and optimize commands are supported */
+  /* Only reformat, optimize, and incremental packing commands are
+   * supported.
+   */
 
   if (cmd == FIOC_REFORMAT)
     {
@@ -136,6 +158,41 @@ int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
       ret = nxffs_pack(volume);
     }
+
+  else if (cmd == FIOC_PACKSTEP)
+    {
+      FAR struct nxffs_packstatus_s *status =
+        (FAR struct nxffs_packstatus_s *)((uintptr_t)arg);
+
+      fvdbg("Pack step command\n");
+
+      /* Perform one incremental packing step, then return the status if
+       * the caller asked for it.
+       */
+
+      ret = nxffs_packstep(volume);
+      if (status)
+        {
+          nxffs_packstatus(volume, status);
+        }
+    }
+
+  else if (cmd == FIOC_PACKSTATUS)
+    {
+      FAR struct nxffs_packstatus_s *status =
+        (FAR struct nxffs_packstatus_s *)((uintptr_t)arg);
+
+      fvdbg("Pack status command\n");
+
+      if (!status)
+        {
+          ret = -EINVAL;
+          goto errout_with_semaphore;
+        }
+
+      nxffs_packstatus(volume, status);
+      ret = OK;
+    }
   else
     {
       /* No other commands supported */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_open.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -498,6 +498,17 @@ static inline int nxffs_wropen(FAR struct nxffs_volume_s *volume,
       goto errout_with_exclsem;
     }
 
+  /* If incremental packing has started to erase the end of FLASH, then
+   * that must be finished before any new data is written.
+   */
+
+  ret = nxffs_packfinish(volume);
+  if (ret < 0)
+    {
+      fdbg("Failed to finish packing: %d\n", -ret);
+      goto errout_with_exclsem;
+    }
+
   /* Yes.. Create a new structure that will describe the state of this open
    * file.  NOTE that a special variant of the open file structure is used
    * that includes additional information to support the write operation.
@@ -671,7 +682,7 @@ static inline int nxffs_wropen(FAR struct nxffs_volume_s *volume,
   return OK;
 
 errout_with_name:
-  kfree(wrfile->ofile.entry.name);
+  nxffs_freeentry(&wrfile->ofile.entry);
 errout_with_ofile:
 #ifndef CONFIG_NXFSS_PREALLOCATED
   kfree(wrfile);
@@ -1117,6 +1128,13 @@ int nxffs_close(FAR struct file *filep)
       if ((ofile->oflags & O_WROK) != 0)
         {
           ret = nxffs_wrclose(volume, (FAR struct nxffs_wrfile_s *)ofile);
+
+          /* Incremental packing may have been waiting for the writer to
+           * close, or the FLASH may now be nearly full.
+           */
+
+          volume->pkblocked = false;
+          nxffs_packcheck(volume);
         }
 
       /* Release all resouces held by the open file */
@@ -1217,11 +1235,14 @@ int nxffs_wrinode(FAR struct nxffs_volume_s *volume,
       fdbg("Failed to write inode header block %d: %d\n",
            volume->ioblock, -ret);
     }
+  else
+    {
+      /* The inode is now valid on FLASH.  Add it to the RAM inode index */
 
-  /* The volume is now available for other writers */
+      nxffs_ixadd(volume, entry->name, entry->hoffset);
+    }
 
 errout:
-  sem_post(&volume->wrsem);
   return ret;
 }
 
@@ -1247,10 +1268,14 @@ int nxffs_updateinode(FAR struct nxffs_volume_s *volume,
 {
   FAR struct nxffs_ofile_s *ofile;
 
-  /* Find the open inode structure matching this name */
+  /* Find the open inode structure matching this name.  Ignore the writer:
+   * If the writer has the same name, then it is re-creating (truncating)
+   * the file and the inode being moved is the old one.  The writer's own
+   * inode is not yet on FLASH; it is moved by nxffs_packwriter().
+   */
 
   ofile = nxffs_findofile(volume, entry->name);
-  if (ofile)
+  if (ofile && (ofile->oflags & O_WROK) == 0)
     {
       /* Yes.. the file is open.  Update the FLASH offsets to inode headers */
 
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_pack.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -48,6 +48,7 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/clock.h>
 
 #include "nxffs.h"
 
@@ -86,6 +87,13 @@ struct nxffs_pack_s
   off_t                ioblock;    /* I/O block number */
   off_t                block0;     /* First I/O block number in the erase block */
   uint16_t             iooffset;   /* I/O block offset */
+
+  /* These support incremental packing (see nxffs_packstep()) */
+
+  bool                 incremental; /* Stop after one erase block is written */
+  uint16_t             nerased;    /* Number of erase blocks written */
+  off_t                srcend;     /* End of the last source inode moved */
+  off_t                limit;      /* If non-zero, don't move inodes after this */
 };
 
 /****************************************************************************
@@ -317,17 +325,23 @@ static inline int nxffs_startpos(FAR struct nxffs_volume_s *volume,
           return OK;
         }
 
-      /* Free the allocated memory in the entry */
-
-      nxffs_freeentry(&pack->src.entry);
-
       /* Update the offset to the first byte at the end of the last data
-       * block.
+       * block.  Zero-length files have no data blocks; the inode then ends
+       * with the inode name.
        */
 
       nbytes = 0;
       offset = pack->src.entry.doffset;
 
+      if (offset == 0)
+        {
+          offset = pack->src.entry.noffset + strlen(pack->src.entry.name);
+        }
+
+      /* Free the allocated memory in the entry */
+
+      nxffs_freeentry(&pack->src.entry);
+
       while (nbytes < pack->src.entry.datlen)
         {
           /* Read the next data block header */
@@ -702,14 +716,22 @@ static int nxffs_wrinodehdr(FAR struct nxffs_volume_s *volume,
       inode->state = INODE_STATE_FILE;
       nxffs_wrle32(inode->crc, crc);
 
-      /* If any open files reference this inode, then update the open file
-       * state.
-       */
+      /* The inode will be valid on FLASH when this erase block is written */
+
+      nxffs_ixadd(volume, pack->dest.entry.name, pack->dest.entry.hoffset);
+      ret = OK;
+    }
 
+  /* If any open files reference this inode, then update the open file
+   * state.
+   */
+
+  if (ret == OK)
+    {
       ret = nxffs_updateinode(volume, &pack->dest.entry);
       if (ret < 0)
         {
-          fdbg("Failed to update inode info: %s\n", -ret);
+          fdbg("Failed to update inode info: %d\n", -ret);
         }
     }
 
@@ -948,18 +970,52 @@ static inline int nxffs_packblock(FAR struct nxffs_volume_s *volume,
       if (pack->src.fpos >= pack->src.entry.datlen)
         {
           /* Write the final destination data block header and inode
-           * headers.
+           * headers.  The old inode header no longer belongs in the RAM
+           * inode index.
            */
 
+          nxffs_ixremove(volume, pack->dest.entry.name,
+                         pack->src.entry.hoffset);
+
           nxffs_wrdathdr(volume, pack);
           nxffs_wrinodehdr(volume, pack);
 
           /* Find the next valid source inode */
 
-          offset = pack->src.blkoffset + pack->src.blklen;
+          if (pack->src.blkoffset > 0)
+            {
+              offset = pack->src.blkoffset + pack->src.blklen;
+            }
+          else
+            {
+              /* A zero-length file has no data blocks */
+
+              offset = pack->src.entry.noffset;
+            }
+
           memset(&pack->src, 0, sizeof(struct nxffs_packstream_s));
 
+          /* An incremental pack stops at the first inode boundary after an
+           * erase block has been written.  Remember where the source inode
+           * ended so that the old copies of the moved inodes can be found.
+           */
+
+          if (pack->incremental && pack->nerased > 0)
+            {
+              pack->srcend = offset;
+              return -EAGAIN;
+            }
+
           ret = nxffs_nextentry(volume, offset, &pack->src.entry);
+          if (ret == OK && pack->limit > 0 &&
+              pack->src.entry.hoffset >= pack->limit)
+            {
+              /* Nothing at or after the limit may be moved */
+
+              nxffs_freeentry(&pack->src.entry);
+              ret = -ENOENT;
+            }
+
           if (ret < 0)
             {
               /* No more valid inode entries.  Just return an end-of-flash error
@@ -1247,18 +1303,60 @@ static inline int nxffs_packwriter(FAR struct nxffs_volume_s *volume,
 }
 
 /****************************************************************************
- * Public Functions
+ * Name: nxffs_packflush
+ *
+ * Description:
+ *   Erase the current erase block and write the content of the pack buffer
+ *   to it.
+ *
+ * Input Parameters:
+ *   volume - The volume being packed
+ *   pack   - The volume packing state structure.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
  ****************************************************************************/
 
+static int nxffs_packflush(FAR struct nxffs_volume_s *volume,
+                           FAR struct nxffs_pack_s *pack)
+{
+  off_t eblock = pack->block0 / volume->blkper;
+  int ret;
+
+  ret = MTD_ERASE(volume->mtd, eblock, 1);
+  if (ret < 0)
+    {
+      fdbg("Failed to erase block %d [%d]: %d\n",
+           eblock, pack->block0, -ret);
+      return ret;
+    }
+
+  ret = MTD_BWRITE(volume->mtd, pack->block0, volume->blkper, volume->pack);
+  if (ret < 0)
+    {
+      fdbg("Failed to write erase block %d [%d]: %d\n",
+           eblock, pack->block0, -ret);
+      return ret;
+    }
+
+  pack->nerased++;
+  return OK;
+}
+
 /****************************************************************************
- * Name: nxffs_pack
+ * Name: nxffs_packdelete
  *
  * Description:
- *   Pack and re-write the filesystem in order to free up memory at the end
- *   of FLASH.
+ *   After an incremental packing step, the old copies of the inodes that
+ *   were moved still lie after the packed region of FLASH.  Mark all of the
+ *   valid inodes in the range as deleted, just as nxffs_rminode() does.
  *
  * Input Parameters:
- *   volume - The volume to be packed.
+ *   volume - The volume being packed
+ *   offset - FLASH offset to the end of the packed region
+ *   end    - FLASH offset to the end of the last inode that was moved
  *
  * Returned Values:
  *   Zero on success; Otherwise, a negated errno value is returned to
@@ -1266,153 +1364,247 @@ static inline int nxffs_packwriter(FAR struct nxffs_volume_s *volume,
  *
  ****************************************************************************/
 
-int nxffs_pack(FAR struct nxffs_volume_s *volume)
+static int nxffs_packdelete(FAR struct nxffs_volume_s *volume, off_t offset,
+                            off_t end)
 {
-  struct nxffs_pack_s pack;
-  FAR struct nxffs_wrfile_s *wrfile;
-  off_t iooffset;
-  off_t eblock;
-  off_t block;
-  bool packed;
-  int i;
+  FAR struct nxffs_inode_s *inode;
+  struct nxffs_entry_s entry;
   int ret;
 
-  /* Get the offset to the first valid inode entry */
+  /* The FLASH was just re-written from the pack buffer, so whatever is in
+   * the volume cache may be stale.
+   */
 
-  wrfile = NULL;
-  packed = false;
+  volume->cblock = (off_t)-1;
 
-  iooffset = nxffs_mediacheck(volume, &pack);
-  if (iooffset == 0)
+  while (offset < end && nxffs_nextentry(volume, offset, &entry) == OK)
     {
-      /* Offset zero is only returned if no valid blocks were found on the
-       * FLASH media or if there are no valid inode entries on the FLASH after
-       * the first valid block.  There are two possibilities:  (1) there 
-       * really is nothing on the FLASH, or (2) there is a file being written
-       * to the FLASH now.
-       */
-
-      /* Is there a writer? */
+      /* Stop at the first inode that was not moved */
 
-      wrfile = nxffs_setupwriter(volume, &pack);
-      if (wrfile)
+      nxffs_freeentry(&entry);
+      if (entry.hoffset >= end)
         {
-          /* If there is a write, just set ioffset to the offset of data in
-           * first block. Setting 'packed' to true will supress normal inode
-           * packing operation.  Then we can start compacting the FLASH.
-           */
-
-          iooffset = SIZEOF_NXFFS_BLOCK_HDR;
-          packed   = true;
-          goto start_pack;
+          break;
         }
-      else
-        {
-          /* No, there is no write in progress.  We just have an empty flash
-           * full of deleted files.  In this case, the media needs to be re-
-           * formatted.
-            */
 
-          ret = nxffs_reformat(volume);
-          if (ret == OK)
-            {
-              /* The free flash offset will be in the first valid block of
-               * the FLASH.
-               */
+      /* Mark the old inode header as deleted */
 
-              block = 0;
-              ret = nxffs_validblock(volume, &block);
-              if (ret == OK)
-                {
-                  /* Set to the offset past the block header in the first
-                   * valid block
-                   */
+      nxffs_ioseek(volume, entry.hoffset);
+      ret = nxffs_rdcache(volume, volume->ioblock);
+      if (ret < 0)
+        {
+          fdbg("Failed to read inode header block %d: %d\n",
+               volume->ioblock, -ret);
+          return ret;
+        }
 
-                  volume->froffset =
-                    block * volume->geo.blocksize + SIZEOF_NXFFS_BLOCK_HDR;
-                }
-            }
+      inode = (FAR struct nxffs_inode_s *)&volume->cache[volume->iooffset];
+      inode->state = INODE_STATE_DELETED;
 
+      ret = nxffs_wrcache(volume);
+      if (ret < 0)
+        {
+          fdbg("Failed to write inode header block %d: %d\n",
+               volume->ioblock, -ret);
           return ret;
         }
+
+      offset = entry.hoffset + SIZEOF_NXFFS_INODE_HDR;
     }
 
-  /* There is a valid format and valid inodes on the media.. setup up to
-   * begin the packing operation.
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_packtail
+ *
+ * Description:
+ *   There are no further inodes to be moved by the incremental packing
+ *   pass.  Decide whether the FLASH after the packed region should be
+ *   erased.  As with nxffs_pack(), the tail of the FLASH is not erased
+ *   unless there is a worthwhile savings or unless inodes were moved.
+ *
+ * Input Parameters:
+ *   volume - The volume being packed
+ *   offset - FLASH offset to the end of the packed region
+ *   moved  - True: Inodes were moved during this pass
+ *   limit  - If non-zero, the FLASH offset to the data of the file that is
+ *            open for writing
+ *
+ * Returned Values:
+ *   Zero (OK) on success.  -EBUSY if there is a file open for writing.
+ *
+ ****************************************************************************/
+
+static int nxffs_packtail(FAR struct nxffs_volume_s *volume, off_t offset,
+                          bool moved, off_t limit)
+{
+  /* The data of a file open for writing lies at the end of FLASH.  It
+   * cannot be moved and the FLASH around it cannot be erased until the
+   * file is closed.  Leave the pass where it is until then.
    */
 
-  ret = nxffs_startpos(volume, &pack, &iooffset);
-  if (ret < 0)
+  if (limit > 0)
     {
-      /* This is a normal situation if the volume is full */
+      return -EBUSY;
+    }
 
-      if (ret == -ENOSPC)
-        {
-          /* In the case where the volume is full, nxffs_startpos() will
-           * recalculate the free FLASH offset and store it in iooffset.  There
-           * may be deleted files at the end of FLASH.  In this case, we don't
-           * have to pack any files, we simply have to erase FLASH at the end.
-           * But don't do this unless there is some particularly big FLASH
-           * savings (otherwise, we risk wearing out these final blocks).
-           */
+  if (offset < volume->froffset &&
+      (moved || offset + CONFIG_NXFFS_TAILTHRESHOLD < volume->froffset))
+    {
+      fvdbg("Erasing %d-%d\n", offset, volume->froffset);
 
-          if (iooffset + CONFIG_NXFFS_TAILTHRESHOLD < volume->froffset)
-            {
-               /* Setting 'packed' to true will supress normal inode packing
-                * operation.
-                */
+      volume->pkstate  = NXFFS_PACK_ERASING;
+      volume->pkoffset = offset;
+      volume->pkblock  = offset / volume->geo.erasesize;
+      volume->pkend    = volume->froffset;
+    }
+  else
+    {
+      /* Nothing more can be done.  The pass is complete. */
 
-               packed = true;
+      volume->pkstate  = NXFFS_PACK_IDLE;
+      volume->pkpasses++;
+    }
 
-               /* Writing is performed at the end of the free FLASH region.
-                * If we are not packing files, we could still need to pack
-                * the partially written file at the end of FLASH.
-                */
+  return OK;
+}
 
-               wrfile = nxffs_setupwriter(volume, &pack);
-             }
+/****************************************************************************
+ * Name: nxffs_packmove
+ *
+ * Description:
+ *   Perform one incremental packing step in the NXFFS_PACK_MOVING state:
+ *   Valid inodes are moved into the packed region at the beginning of FLASH
+ *   until at least one erase block has been re-written.  Packing stops at
+ *   an inode boundary so that the FLASH is always in a consistent state
+ *   between steps.
+ *
+ * Input Parameters:
+ *   volume - The volume being packed
+ *   limit  - If non-zero, the FLASH offset to the data of the file that is
+ *            open for writing.  Only the inodes before it are moved.
+ *
+ * Returned Values:
+ *   Zero on success; -EBUSY if nothing more can be done until the file
+ *   open for writing is closed.  Otherwise, a negated errno value is
+ *   returned to indicate the nature of the failure.
+ *
+ ****************************************************************************/
 
-          /* Otherwise return OK.. meaning that there is nothing more we can
-           * do to recover FLASH space.
+static inline int nxffs_packmove(FAR struct nxffs_volume_s *volume,
+                                 off_t limit)
+{
+  struct nxffs_pack_s pack;
+  off_t froffset;
+  off_t iooffset;
+  off_t eblock;
+  off_t block;
+  off_t end;
+  int i;
+  int ret;
+
+  if (volume->pkoffset == 0)
+    {
+      /* This is the first step of a new pass.  Get the offset to the first
+       * valid inode entry.
+       */
+
+      iooffset = nxffs_mediacheck(volume, &pack);
+      if (iooffset > 0 && limit > 0 && pack.src.entry.hoffset >= limit)
+        {
+          /* The only data is that of the file open for writing */
+
+          nxffs_freeentry(&pack.src.entry);
+          return nxffs_packtail(volume, iooffset, false, limit);
+        }
+
+      if (iooffset == 0)
+        {
+          /* There are no valid inodes on the FLASH.  Everything after the
+           * first valid block header may be erased.
            */
 
-          else
+          block = 0;
+          ret = nxffs_validblock(volume, &block);
+          if (ret < 0)
             {
+              volume->pkstate = NXFFS_PACK_IDLE;
               return OK;
             }
+
+          iooffset = block * volume->geo.blocksize + SIZEOF_NXFFS_BLOCK_HDR;
+          return nxffs_packtail(volume, iooffset, false, limit);
         }
-      else
+    }
+  else
+    {
+      /* Resume after the FLASH that has already been packed */
+
+      memset(&pack, 0, sizeof(struct nxffs_pack_s));
+      iooffset = volume->pkoffset;
+
+      ret = nxffs_nextentry(volume, iooffset, &pack.src.entry);
+      if (ret == OK && limit > 0 && pack.src.entry.hoffset >= limit)
         {
-          fvdbg("Failed to find a packing position: %d\n", -ret);
-          return ret;
+          nxffs_freeentry(&pack.src.entry);
+          ret = -ENOENT;
+        }
+
+      if (ret < 0)
+        {
+          return nxffs_packtail(volume, iooffset, true, limit);
         }
     }
 
-  /* Otherwise, begin pack at this src/dest block combination.  Initialize
-   * ioblock and iooffset with the position of the first inode header.  In
-   * this case, the FLASH offset to the first inode header is return in 
-   * iooffset.
-   */
+  /* Find the first gap worth packing */
 
-start_pack:
+  ret = nxffs_startpos(volume, &pack, &iooffset);
+  if (ret < 0)
+    {
+      if (ret == -ENOSPC)
+        {
+          return nxffs_packtail(volume, iooffset, volume->pkoffset != 0,
+                                limit);
+        }
+
+      fvdbg("Failed to find a packing position: %d\n", -ret);
+      return ret;
+    }
+
+  if (limit > 0 && pack.src.entry.hoffset >= limit)
+    {
+      /* The first gap lies just before the file open for writing */
+
+      nxffs_freeentry(&pack.src.entry);
+      return nxffs_packtail(volume, iooffset, volume->pkoffset != 0, limit);
+    }
+
+  /* The packing logic updates the free FLASH offset as it goes.  That is
+   * correct for nxffs_pack(), but here the inodes at the end of FLASH stay
+   * where they are.
+   */
 
+  froffset         = volume->froffset;
+  pack.incremental = true;
+  pack.limit       = limit;
   pack.ioblock     = nxffs_getblock(volume, iooffset);
   pack.iooffset    = nxffs_getoffset(volume, iooffset, pack.ioblock);
-  volume->froffset = iooffset;
 
-  /* Then pack all erase blocks starting with the erase block that contains
-   * the ioblock and through the final erase block on the FLASH.
+  if (pack.iooffset < SIZEOF_NXFFS_BLOCK_HDR)
+    {
+      pack.iooffset = SIZEOF_NXFFS_BLOCK_HDR;
+    }
+
+  /* Pack erase blocks until nxffs_packblock() stops at an inode boundary
+   * (-EAGAIN) or runs out of inodes (-ENOSPC).
    */
 
+  ret = -ENOSPC;
   for (eblock = pack.ioblock / volume->blkper;
        eblock < volume->geo.neraseblocks;
        eblock++)
     {
-      /* Read the erase block into the pack buffer.  We need to do this even
-       * if we are overwriting the entire block so that we skip over
-       * previously marked bad blocks.
-       */
-
       pack.block0 = eblock * volume->blkper;
       ret = MTD_BREAD(volume->mtd, pack.block0, volume->blkper, volume->pack);
       if (ret < 0)
@@ -1421,8 +1613,460 @@ start_pack:
           goto errout_with_pack;
         }
 
-      /* Pack each I/O block */
-
+      ret = OK;
+      for (i = 0, block = pack.block0, pack.iobuffer = volume->pack;
+           i < volume->blkper;
+           i++, block++, pack.iobuffer += volume->geo.blocksize)
+        {
+          if (block >= pack.ioblock)
+            {
+              pack.ioblock = block;
+              if (nxffs_packvalid(&pack))
+                {
+                  ret = nxffs_packblock(volume, &pack);
+                  if (ret < 0)
+                    {
+                      /* Leave the rest of the erase block unchanged */
+
+                      break;
+                    }
+                }
+
+              /* Set any unused portion at the end of the block to the
+               * erased state.
+               */
+
+              if (pack.iooffset < volume->geo.blocksize)
+                {
+                  memset(&pack.iobuffer[pack.iooffset],
+                         CONFIG_NXFFS_ERASEDSTATE,
+                         volume->geo.blocksize - pack.iooffset);
+                }
+
+              pack.iooffset = SIZEOF_NXFFS_BLOCK_HDR;
+            }
+        }
+
+      if (ret < 0 && ret != -EAGAIN && ret != -ENOSPC)
+        {
+          fdbg("Failed to pack into block %d: %d\n", block, ret);
+          goto errout_with_pack;
+        }
+
+      /* Re-write the erase block */
+
+      i = nxffs_packflush(volume, &pack);
+      if (i < 0)
+        {
+          ret = i;
+          goto errout_with_pack;
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  /* The packed region now ends at the current destination position.  The
+   * old copies of the inodes that were moved lie between there and the end
+   * of the last source inode (or the end of the FLASH data if all inodes
+   * were moved, or the data of the file open for writing).
+   */
+
+  DEBUGASSERT(ret == -EAGAIN || ret == -ENOSPC);
+
+  if (ret == -EAGAIN)
+    {
+      end = pack.srcend;
+    }
+  else
+    {
+      end = limit > 0 ? limit : froffset;
+    }
+
+  volume->pkoffset   = nxffs_packtell(volume, &pack);
+  volume->froffset   = froffset;
+
+  ret = nxffs_packdelete(volume, volume->pkoffset, end);
+  if (ret < 0)
+    {
+      goto errout_with_pack;
+    }
+
+  /* If there are no more inodes to be moved, then the rest of the FLASH can
+   * be erased.
+   */
+
+  if (end == froffset)
+    {
+      return nxffs_packtail(volume, volume->pkoffset, true, limit);
+    }
+
+  return OK;
+
+errout_with_pack:
+  nxffs_freeentry(&pack.src.entry);
+  nxffs_freeentry(&pack.dest.entry);
+  volume->froffset = froffset;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxffs_packerase
+ *
+ * Description:
+ *   Perform one incremental packing step in the NXFFS_PACK_ERASING state:
+ *   Erase one erase block of the FLASH after the packed region.  Block
+ *   headers (and bad block marks) are preserved.  When the final erase block
+ *   has been erased, the free FLASH offset is moved back to the end of the
+ *   packed region.
+ *
+ *   NOTE:  Inode searches stop at the first run of erased FLASH.  No new
+ *   data may be written after the partially erased FLASH; see
+ *   nxffs_packfinish().
+ *
+ * Input Parameters:
+ *   volume - The volume being packed
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ ****************************************************************************/
+
+static inline int nxffs_packerase(FAR struct nxffs_volume_s *volume)
+{
+  FAR uint8_t *iobuffer;
+  off_t block0;
+  off_t offset;
+  int i;
+  int ret;
+
+  /* If a file was written since the erasing began, then its inode must be
+   * moved into the packed region first.
+   */
+
+  if (volume->froffset != volume->pkend)
+    {
+      volume->pkstate = NXFFS_PACK_MOVING;
+      return OK;
+    }
+
+  /* Read the erase block into the pack buffer and reset all data after the
+   * packed region to the erased state.
+   */
+
+  block0 = volume->pkblock * volume->blkper;
+  ret = MTD_BREAD(volume->mtd, block0, volume->blkper, volume->pack);
+  if (ret < 0)
+    {
+      fdbg("Failed to read erase block %d: %d\n", volume->pkblock, -ret);
+      return ret;
+    }
+
+  for (i = 0, iobuffer = volume->pack;
+       i < volume->blkper;
+       i++, iobuffer += volume->geo.blocksize)
+    {
+      offset = volume->pkoffset - (block0 + i) * volume->geo.blocksize;
+      if (offset < volume->geo.blocksize)
+        {
+          if (offset < SIZEOF_NXFFS_BLOCK_HDR)
+            {
+              offset = SIZEOF_NXFFS_BLOCK_HDR;
+            }
+
+          memset(&iobuffer[offset], CONFIG_NXFFS_ERASEDSTATE,
+                 volume->geo.blocksize - offset);
+        }
+    }
+
+  ret = MTD_ERASE(volume->mtd, volume->pkblock, 1);
+  if (ret < 0)
+    {
+      fdbg("Failed to erase block %d: %d\n", volume->pkblock, -ret);
+      return ret;
+    }
+
+  ret = MTD_BWRITE(volume->mtd, block0, volume->blkper, volume->pack);
+  if (ret < 0)
+    {
+      fdbg("Failed to write erase block %d: %d\n", volume->pkblock, -ret);
+      return ret;
+    }
+
+  /* Is this the last erase block to be erased? */
+
+  volume->pkblock++;
+  if (volume->pkblock * volume->geo.erasesize >= volume->pkend)
+    {
+      /* Yes.. all of the FLASH after the packed region is now free */
+
+      volume->froffset = volume->pkoffset;
+      volume->pkstate  = NXFFS_PACK_IDLE;
+      volume->pkpasses++;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_packworker
+ *
+ * Description:
+ *   Perform incremental packing steps on the worker thread.
+ *
+ * Input Parameters:
+ *   arg - The volume to be packed
+ *
+ * Returned Values:
+ *   None
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_PACKRESERVE > 0
+static void nxffs_packworker(FAR void *arg)
+{
+  FAR struct nxffs_volume_s *volume = (FAR struct nxffs_volume_s *)arg;
+  int ret;
+
+  ret = sem_wait(&volume->exclsem);
+  if (ret != OK)
+    {
+      fdbg("sem_wait failed: %d\n", errno);
+      return;
+    }
+
+  /* The volume may have been unmounted while the worker waited for the
+   * exclsem.  In that case, there is nothing left to do.
+   */
+
+  if (volume->pkstate == NXFFS_PACK_IDLE && !volume->pkstale)
+    {
+      sem_post(&volume->exclsem);
+      return;
+    }
+
+  /* Perform one step and, if the pass is not complete, schedule the next
+   * step.  If nothing more can be done while a file is open for writing
+   * (-EBUSY), packing will resume when the file is closed.
+   *
+   * The work structure was released before this function was called, so
+   * nxffs_packcheck() may have queued it again while this worker waited
+   * for the exclsem.  It must not be queued a second time.
+   */
+
+  ret = nxffs_packstep(volume);
+  if (ret == OK && volume->pkstate != NXFFS_PACK_IDLE &&
+      volume->pkwork.worker == NULL)
+    {
+      (void)work_queue(LPWORK, &volume->pkwork, nxffs_packworker, volume,
+                       MSEC2TICK(CONFIG_NXFFS_PACKDELAY));
+    }
+
+  sem_post(&volume->exclsem);
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_pack
+ *
+ * Description:
+ *   Pack and re-write the filesystem in order to free up memory at the end
+ *   of FLASH.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ ****************************************************************************/
+
+int nxffs_pack(FAR struct nxffs_volume_s *volume)
+{
+  struct nxffs_pack_s pack;
+  FAR struct nxffs_wrfile_s *wrfile;
+  off_t iooffset;
+  off_t eblock;
+  off_t block;
+  bool packed;
+  int i;
+  int ret;
+
+  /* Finish any incremental erasing of the end of FLASH first */
+
+  ret = nxffs_packfinish(volume);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Get the offset to the first valid inode entry */
+
+  wrfile = NULL;
+  packed = false;
+
+  iooffset = nxffs_mediacheck(volume, &pack);
+  if (iooffset == 0)
+    {
+      /* Offset zero is only returned if no valid blocks were found on the
+       * FLASH media or if there are no valid inode entries on the FLASH after
+       * the first valid block.  There are two possibilities:  (1) there 
+       * really is nothing on the FLASH, or (2) there is a file being written
+       * to the FLASH now.
+       */
+
+      /* Is there a writer? */
+
+      wrfile = nxffs_setupwriter(volume, &pack);
+      if (wrfile)
+        {
+          /* If there is a write, just set ioffset to the offset of data in
+           * first block. Setting 'packed' to true will supress normal inode
+           * packing operation.  Then we can start compacting the FLASH.
+           */
+
+          iooffset = SIZEOF_NXFFS_BLOCK_HDR;
+          packed   = true;
+          goto start_pack;
+        }
+      else
+        {
+          /* No, there is no write in progress.  We just have an empty flash
+           * full of deleted files.  In this case, the media needs to be re-
+           * formatted.
+            */
+
+          ret = nxffs_reformat(volume);
+          if (ret == OK)
+            {
+              /* The free flash offset will be in the first valid block of
+               * the FLASH.
+               */
+
+              block = 0;
+              ret = nxffs_validblock(volume, &block);
+              if (ret == OK)
+                {
+                  /* Set to the offset past the block header in the first
+                   * valid block
+                   */
+
+                  volume->froffset =
+                    block * volume->geo.blocksize + SIZEOF_NXFFS_BLOCK_HDR;
+                  volume->inoffset = volume->froffset;
+                }
+            }
+
+          return ret;
+        }
+    }
+
+  /* There is a valid format and valid inodes on the media.. setup up to
+   * begin the packing operation.
+   */
+
+  ret = nxffs_startpos(volume, &pack, &iooffset);
+  if (ret < 0)
+    {
+      /* This is a normal situation if the volume is full */
+
+      if (ret == -ENOSPC)
+        {
+          /* In the case where the volume is full, nxffs_startpos() will
+           * recalculate the free FLASH offset and store it in iooffset.  There
+           * may be deleted files at the end of FLASH.  In this case, we don't
+           * have to pack any files, we simply have to erase FLASH at the end.
+           * But don't do this unless there is some particularly big FLASH
+           * savings (otherwise, we risk wearing out these final blocks).
+           */
+
+          if (iooffset + CONFIG_NXFFS_TAILTHRESHOLD < volume->froffset)
+            {
+               /* Setting 'packed' to true will supress normal inode packing
+                * operation.
+                */
+
+               packed = true;
+
+               /* Writing is performed at the end of the free FLASH region.
+                * If we are not packing files, we could still need to pack
+                * the partially written file at the end of FLASH.
+                */
+
+               wrfile = nxffs_setupwriter(volume, &pack);
+             }
+
+          /* Otherwise return OK.. meaning that there is nothing more we can
+           * do to recover FLASH space.
+           */
+
+          else
+            {
+              return OK;
+            }
+        }
+      else
+        {
+          fvdbg("Failed to find a packing position: %d\n", -ret);
+          return ret;
+        }
+    }
+
+  /* Otherwise, begin pack at this src/dest block combination.  Initialize
+   * ioblock and iooffset with the position of the first inode header.  In
+   * this case, the FLASH offset to the first inode header is return in 
+   * iooffset.
+   */
+
+start_pack:
+
+  pack.ioblock     = nxffs_getblock(volume, iooffset);
+  pack.iooffset    = nxffs_getoffset(volume, iooffset, pack.ioblock);
+
+  /* If the last valid data ended exactly at the end of a block, then the
+   * offset refers to the beginning of the next block.  Skip over its
+   * block header (as nxffs_wrreserve() does).
+   */
+
+  if (pack.iooffset < SIZEOF_NXFFS_BLOCK_HDR)
+    {
+      pack.iooffset = SIZEOF_NXFFS_BLOCK_HDR;
+      iooffset      = nxffs_packtell(volume, &pack);
+    }
+
+  volume->froffset = iooffset;
+
+  /* Then pack all erase blocks starting with the erase block that contains
+   * the ioblock and through the final erase block on the FLASH.
+   */
+
+  for (eblock = pack.ioblock / volume->blkper;
+       eblock < volume->geo.neraseblocks;
+       eblock++)
+    {
+      /* Read the erase block into the pack buffer.  We need to do this even
+       * if we are overwriting the entire block so that we skip over
+       * previously marked bad blocks.
+       */
+
+      pack.block0 = eblock * volume->blkper;
+      ret = MTD_BREAD(volume->mtd, pack.block0, volume->blkper, volume->pack);
+      if (ret < 0)
+        {
+          fdbg("Failed to read erase block %d: %d\n", eblock, -ret);
+          goto errout_with_pack;
+        }
+
+      /* Pack each I/O block */
+
       for (i = 0, block = pack.block0, pack.iobuffer = volume->pack;
            i < volume->blkper;
            i++, block++, pack.iobuffer += volume->geo.blocksize)
@@ -1568,5 +2212,311 @@ start_pack:
 errout_with_pack:
   nxffs_freeentry(&pack.src.entry);
   nxffs_freeentry(&pack.dest.entry);
+
+  /* The FLASH was re-written from the pack buffer, so whatever is in the
+   * volume cache may now be stale.  Force it to be re-read.
+   */
+
+  volume->cblock = (off_t)-1;
+
+  /* Inodes may now lie before the old offset to the first inode.  Inode
+   * searches must begin again just after the first valid block header.
+   */
+
+  block = 0;
+  if (nxffs_validblock(volume, &block) == OK)
+    {
+      volume->inoffset = block * volume->geo.blocksize +
+                         SIZEOF_NXFFS_BLOCK_HDR;
+    }
+
+  /* The inodes have moved.  Rebuild the RAM inode index to match the
+   * re-packed FLASH.
+   */
+
+  nxffs_ixbuild(volume);
+
+  /* Any incremental packing pass in progress is now meaningless */
+
+  volume->pkstate = NXFFS_PACK_IDLE;
+  volume->pkstale = (ret != OK);
   return ret;
 }
+
+/****************************************************************************
+ * Name: nxffs_packstep
+ *
+ * Description:
+ *   Perform one step of an incremental packing pass.  If no pass is in
+ *   progress, then a new pass is started.  The caller must hold the volume
+ *   exclsem.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.  -EBUSY means that no step can be
+ *   performed until the file open for writing is closed.
+ *
+ ****************************************************************************/
+
+int nxffs_packstep(FAR struct nxffs_volume_s *volume)
+{
+  FAR struct nxffs_wrfile_s *wrfile;
+  off_t limit = 0;
+  off_t block;
+  int ret;
+
+  /* Data written by a file that is open for writing lies at the end of
+   * FLASH but has no inode header yet, so the packing logic can neither move
+   * it nor safely erase around it.  The inodes in front of it (everything
+   * before its reserved inode header) can still be moved.
+   *
+   * nxffs_packfinish() assures that no erase block had been erased when the
+   * file was opened, so any erasing can simply be deferred until the file
+   * is closed and its inode has been moved.
+   */
+
+  wrfile = nxffs_findwriter(volume);
+  if (wrfile)
+    {
+      limit = wrfile->ofile.entry.hoffset;
+      if (volume->pkstate == NXFFS_PACK_ERASING)
+        {
+          volume->pkstate = NXFFS_PACK_MOVING;
+        }
+    }
+
+  /* Start a new pass from the beginning of FLASH if necessary */
+
+  if (volume->pkstate == NXFFS_PACK_IDLE)
+    {
+      volume->pkstate  = NXFFS_PACK_MOVING;
+      volume->pkoffset = 0;
+      volume->pkstale  = false;
+    }
+
+  if (volume->pkstate == NXFFS_PACK_MOVING)
+    {
+      ret = nxffs_packmove(volume, limit);
+    }
+  else
+    {
+      ret = nxffs_packerase(volume);
+    }
+
+  volume->pksteps++;
+
+  /* Remember if the step was blocked by the writer.  Background steps are
+   * then not scheduled again until the file is closed.
+   */
+
+  volume->pkblocked = (ret == -EBUSY);
+
+  /* Abandon the pass on any failure.  The next step will start over. */
+
+  if (ret < 0 && ret != -EBUSY)
+    {
+      fdbg("Packing step failed: %d\n", -ret);
+      volume->pkstate = NXFFS_PACK_IDLE;
+      volume->pkstale = true;
+    }
+
+  /* The FLASH may have been re-written from the pack buffer and inodes may
+   * now lie before the old offset to the first inode.
+   */
+
+  volume->cblock = (off_t)-1;
+
+  block = 0;
+  if (nxffs_validblock(volume, &block) == OK)
+    {
+      volume->inoffset = block * volume->geo.blocksize +
+                         SIZEOF_NXFFS_BLOCK_HDR;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxffs_packfinish
+ *
+ * Description:
+ *   Inode searches stop at the first run of erased FLASH, so new data cannot
+ *   be written after FLASH that has only been partially erased by the
+ *   incremental packing logic.  This is called before a file is opened for
+ *   writing in order to finish erasing.  The caller must hold the volume
+ *   exclsem.
+ *
+ * Input Parameters:
+ *   volume - The volume being packed.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ ****************************************************************************/
+
+int nxffs_packfinish(FAR struct nxffs_volume_s *volume)
+{
+  int ret = OK;
+
+  /* Nothing needs to be done unless at least one erase block has been
+   * erased.  Otherwise, the new file will just be moved by the next step.
+   */
+
+  if (volume->pkstate == NXFFS_PACK_ERASING &&
+      volume->pkblock > volume->pkoffset / volume->geo.erasesize)
+    {
+      while (volume->pkstate == NXFFS_PACK_ERASING && ret == OK)
+        {
+          ret = nxffs_packstep(volume);
+        }
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxffs_packrecover
+ *
+ * Description:
+ *   Check if the volume was mounted while the incremental packing logic was
+ *   erasing the reclaimed FLASH (as after a power failure).  In that case,
+ *   old inode data may still follow the free FLASH region and that FLASH
+ *   must be erased before anything more can be written.
+ *
+ *   Erase blocks are erased in order and the data of every used R/W block
+ *   begins with an inode or data block header.  So it is sufficient to
+ *   check the first bytes after the block header of each erase block after
+ *   the free FLASH offset.
+ *
+ * Input Parameters:
+ *   volume - The volume to be checked.
+ *
+ * Returned Values:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ ****************************************************************************/
+
+int nxffs_packrecover(FAR struct nxffs_volume_s *volume)
+{
+  off_t neraseblocks = volume->nblocks / volume->blkper;
+  off_t lastblock = -1;
+  off_t eblock;
+  int ret;
+
+  /* Find the last erase block that still holds old data */
+
+  for (eblock = volume->froffset / volume->geo.erasesize;
+       eblock < neraseblocks;
+       eblock++)
+    {
+      /* Skip the erase block containing the free FLASH offset unless the
+       * offset lies at the very beginning of its data.
+       */
+
+      if (eblock * volume->geo.erasesize + SIZEOF_NXFFS_BLOCK_HDR <
+          volume->froffset)
+        {
+          continue;
+        }
+
+      ret = nxffs_rdcache(volume, eblock * volume->blkper);
+      if (ret < 0)
+        {
+          fdbg("Failed to read erase block %d: %d\n", eblock, -ret);
+          return ret;
+        }
+
+      if (nxffs_erased(&volume->cache[SIZEOF_NXFFS_BLOCK_HDR],
+                       NXFFS_MAGICSIZE) < NXFFS_MAGICSIZE)
+        {
+          lastblock = eblock;
+        }
+    }
+
+  if (lastblock < 0)
+    {
+      return OK;
+    }
+
+  /* Finish the interrupted erasing now.  The erase block containing the
+   * free FLASH offset is re-written too; data before the offset is kept.
+   */
+
+  fdbg("Erasing old data after offset %d\n", volume->froffset);
+
+  volume->pkstate  = NXFFS_PACK_ERASING;
+  volume->pkoffset = volume->froffset;
+  volume->pkblock  = volume->froffset / volume->geo.erasesize;
+  volume->pkend    = (lastblock + 1) * volume->geo.erasesize;
+  volume->froffset = volume->pkend;
+
+  do
+    {
+      ret = nxffs_packerase(volume);
+      if (ret < 0)
+        {
+          volume->pkstate  = NXFFS_PACK_IDLE;
+          volume->froffset = volume->pkoffset;
+          return ret;
+        }
+    }
+  while (volume->pkstate == NXFFS_PACK_ERASING);
+
+  volume->cblock = (off_t)-1;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_packcheck
+ *
+ * Description:
+ *   Check if fewer than CONFIG_NXFFS_PACKRESERVE bytes of FLASH remain free
+ *   and, if so, schedule incremental packing on the worker thread.  The
+ *   caller must hold the volume exclsem.
+ *
+ * Input Parameters:
+ *   volume - The volume to be checked.
+ *
+ * Returned Values:
+ *   None
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_PACKRESERVE > 0
+void nxffs_packcheck(FAR struct nxffs_volume_s *volume)
+{
+  off_t nfree = volume->nblocks * volume->geo.blocksize - volume->froffset;
+
+  /* If the last step found that nothing more can be done until the file
+   * open for writing is closed, then don't wake up the worker on every
+   * write.  nxffs_close() will clear the indication.
+   */
+
+  if (volume->pkblocked)
+    {
+      return;
+    }
+
+  /* Continue any pass in progress.  Otherwise, start a new pass only if
+   * the FLASH is nearly full and inodes have been deleted since the last
+   * pass (there would be nothing to recover otherwise).
+   */
+
+  if (volume->pkstate != NXFFS_PACK_IDLE ||
+      (volume->pkstale && nfree < CONFIG_NXFFS_PACKRESERVE))
+    {
+      /* Don't queue the work again if it is already queued */
+
+      if (volume->pkwork.worker == NULL)
+        {
+          (void)work_queue(LPWORK, &volume->pkwork, nxffs_packworker, volume,
+                           MSEC2TICK(CONFIG_NXFFS_PACKDELAY));
+        }
+    }
+}
+#endif
@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_reformat.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -256,6 +256,12 @@ int nxffs_reformat(FAR struct nxffs_volume_s *volume)
       return ret;
     }
 
+  /* There are no inodes on the re-formatted FLASH and nothing to pack */
+
+  nxffs_ixreset(volume);
+  volume->pkstate = NXFFS_PACK_IDLE;
+  volume->pkstale = false;
+
   /* Check for bad blocks */
 
   ret = nxffs_badblocks(volume);
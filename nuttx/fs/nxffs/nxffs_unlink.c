@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_unlink.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -143,6 +143,15 @@ int nxffs_rminode(FAR struct nxffs_volume_s *volume, FAR const char *name)
     {
       fdbg("Failed to read data into cache: %d\n", ret);
     }
+  else
+    {
+      /* And remove the inode from the RAM inode index.  There is now
+       * something for the packing logic to recover.
+       */
+
+      nxffs_ixremove(volume, name, entry.hoffset);
+      volume->pkstale = true;
+    }
 
 errout_with_entry:
   nxffs_freeentry(&entry);
@@ -180,7 +189,13 @@ int nxffs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   /* Then remove the NXFFS inode */
 
   ret = nxffs_rminode(volume, relpath);
-  
+  if (ret == OK)
+    {
+      /* Schedule incremental packing if the FLASH is nearly full */
+
+      nxffs_packcheck(volume);
+    }
+
   sem_post(&volume->exclsem);
 errout:
   return ret;
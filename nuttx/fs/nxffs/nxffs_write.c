@@ -1,7 +1,7 @@
 /****************************************************************************
  * fs/nxffs/nxffs_write.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * References: Linux/Documentation/filesystems/romfs.txt
@@ -508,9 +508,18 @@ ssize_t nxffs_write(FAR struct file *filep, FAR const char *buffer, size_t bufle
             }
         }
 
-      /* Seek to the FLASH block containing the data block */
+      /* Seek to the FLASH block containing the data block and make sure
+       * that it is in the cache.  Other logic may have used the cache
+       * since the last write.
+       */
 
       nxffs_ioseek(volume, wrfile->doffset);
+      ret = nxffs_rdcache(volume, volume->ioblock);
+      if (ret < 0)
+        {
+          fdbg("Failed to read data block %d: %d\n", volume->ioblock, -ret);
+          goto errout_with_semaphore;
+        }
 
       /* Verify that the FLASH data that was previously written is still intact */
 
@@ -542,6 +551,10 @@ ssize_t nxffs_write(FAR struct file *filep, FAR const char *buffer, size_t bufle
   ret           = total;
   filep->f_pos  = wrfile->datlen;
 
+  /* Schedule incremental packing if the FLASH is nearly full */
+
+  nxffs_packcheck(volume);
+
 errout_with_semaphore:
   sem_post(&volume->exclsem);
 errout:
@@ -729,8 +742,11 @@ int nxffs_wrverify(FAR struct nxffs_volume_s *volume, size_t size)
 
                    off_t offset = volume->ioblock * volume->geo.blocksize + iooffset;
 
-                   /* Update the free flash offset and return success */
+                   /* Update the I/O position and the free flash offset and
+                    * return success.
+                    */
 
+                   volume->iooffset = iooffset;
                    volume->froffset = offset + size;
                    return OK;
                 }
@@ -794,9 +810,21 @@ int nxffs_wrblkhdr(FAR struct nxffs_volume_s *volume,
   FAR struct nxffs_data_s *dathdr;
   int ret;
 
-  /* Write the data block header to memory */
+  /* Make sure that the FLASH block containing the data block is in the
+   * cache.  Other logic (such as incremental packing) may have used the
+   * cache since the data was written.
+   */
 
   nxffs_ioseek(volume, wrfile->doffset);
+  ret = nxffs_rdcache(volume, volume->ioblock);
+  if (ret < 0)
+    {
+      fdbg("Failed to read data block %d: %d\n", volume->ioblock, -ret);
+      goto errout;
+    }
+
+  /* Write the data block header to memory */
+
   dathdr = (FAR struct nxffs_data_s *)&volume->cache[volume->iooffset];
   memcpy(dathdr->magic, g_datamagic, NXFFS_MAGICSIZE);
   nxffs_wrle32(dathdr->crc, 0);
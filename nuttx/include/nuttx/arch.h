@@ -46,6 +46,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sched.h>
+#include <time.h>
 #include <arch/arch.h>
 
 /****************************************************************************
@@ -520,6 +521,60 @@ EXTERN void up_udelay(useconds_t microseconds);
 EXTERN void up_cxxinitialize(void);
 #endif
 
+/****************************************************************************
+ * Name: up_check_tcbstack
+ *
+ * Description:
+ *   Determine (approximately) how much of the stack of the task has been
+ *   used by searching the stack memory for a high water mark.  This is
+ *   only available in ports that support CONFIG_DEBUG_STACK (currently
+ *   ARM and AVR); those ports fill each new stack with a recognizable
+ *   pattern.  It is used by sched_cpuload() to report stack usage.
+ *
+ * Input Parameters:
+ *   tcb - The TCB of the task whose stack will be checked.
+ *
+ * Returned value:
+ *   The estimated amount of stack space used.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+EXTERN size_t up_check_tcbstack(FAR _TCB *tcb);
+#endif
+
+/****************************************************************************
+ * Name: up_timer_gettime, up_timer_start, up_timer_cancel
+ *
+ * Description:
+ *   If CONFIG_SCHED_TICKLESS is selected, then there is no periodic system
+ *   timer interrupt.  Instead, the platform-specific logic must provide a
+ *   free-running counter and a one-shot alarm:
+ *
+ *   up_timer_gettime - Return the time elapsed since the timer was
+ *     started (normally power-up) in 'ts'.  This is the source of the
+ *     system time and must be callable at any time, from any context,
+ *     including before up_initialize() has been called (in which case it
+ *     may simply return zero).
+ *   up_timer_start - Start (or restart) the one-shot alarm.  The alarm
+ *     will expire after the interval 'ts' has elapsed.  Any alarm that was
+ *     previously started is replaced.  When the alarm expires, the
+ *     platform-specific logic must call sched_timer_expiration() from the
+ *     interrupt level.
+ *   up_timer_cancel - Cancel any pending alarm.  If 'ts' is non-NULL,
+ *     the time that remained before the alarm would have expired is
+ *     returned in 'ts' (zero if no alarm was pending).
+ *
+ *   All return OK (0) on success or a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+EXTERN int up_timer_gettime(FAR struct timespec *ts);
+EXTERN int up_timer_start(FAR const struct timespec *ts);
+EXTERN int up_timer_cancel(FAR struct timespec *ts);
+#endif
+
 /****************************************************************************
  * These are standard interfaces that are exported by the OS
  * for use by the architecture specific logic
@@ -539,6 +594,23 @@ EXTERN void up_cxxinitialize(void);
 
 EXTERN void sched_process_timer(void);
 
+/****************************************************************************
+ * Name: sched_timer_expiration
+ *
+ * Description:
+ *   If CONFIG_SCHED_TICKLESS is selected, then sched_process_timer() is
+ *   not used.  Instead, the architecture specific logic must call this
+ *   function from the interrupt level when the one-shot alarm started by
+ *   up_timer_start() expires.  The OS will process any expired watchdogs
+ *   and round-robin timeslices, then restart the alarm for the next
+ *   event (if any).
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+EXTERN void sched_timer_expiration(void);
+#endif
+
 /****************************************************************************
  * Name: irq_dispatch
  *
@@ -1,7 +1,7 @@
 /****************************************************************************
  * include/nuttx/clock.h
  *
- *   Copyright (C) 2007-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -64,6 +64,19 @@
 #  define __HAVE_KERNEL_GLOBALS 0
 #endif
 
+/* The system timer counter, g_system_timer, exists only if there is a
+ * periodic system timer interrupt to increment it.  If CONFIG_SCHED_TICKLESS
+ * is selected, then the system time is derived from a free-running hardware
+ * counter and must always be obtained through clock_systimer().
+ */
+
+#undef __HAVE_SYSTEM_COUNTER
+#if __HAVE_KERNEL_GLOBALS && !defined(CONFIG_SCHED_TICKLESS)
+#  define __HAVE_SYSTEM_COUNTER 1
+#else
+#  define __HAVE_SYSTEM_COUNTER 0
+#endif
+
 /* If CONFIG_SYSTEM_TIME64 is selected and the CPU supports long long types,
  * then a 64-bit system time will be used.
  */
@@ -134,7 +147,7 @@
  * access to kernel global data
  */
 
-#if __HAVE_KERNEL_GLOBALS
+#if __HAVE_SYSTEM_COUNTER
 #  ifdef CONFIG_SYSTEM_TIME64
 
 extern volatile uint64_t g_system_timer;
@@ -167,7 +180,8 @@ extern "C" {
  *   Return the current value of the 32-bit system timer counter.  Indirect
  *   access to the system timer counter is required through this function if
  *   the execution environment does not have direct access to kernel global
- *   data
+ *   data or if the system time is provided by a free-running hardware
+ *   counter (CONFIG_SCHED_TICKLESS)
  *
  * Parameters:
  *   None
@@ -179,7 +193,7 @@ extern "C" {
  *
  ****************************************************************************/
 
-#if !__HAVE_KERNEL_GLOBALS
+#if !__HAVE_SYSTEM_COUNTER
 #  ifdef CONFIG_SYSTEM_TIME64
 #    define clock_systimer()  (uint32_t)(clock_systimer64() & 0x00000000ffffffff)
 #  else
@@ -206,7 +220,7 @@ EXTERN uint32_t clock_systimer(void);
  *
  ****************************************************************************/
 
-#if !__HAVE_KERNEL_GLOBALS && defined(CONFIG_SYSTEM_TIME64)
+#if !__HAVE_SYSTEM_COUNTER && defined(CONFIG_SYSTEM_TIME64)
 EXTERN uint64_t clock_systimer64(void);
 #endif
 
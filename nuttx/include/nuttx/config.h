@@ -188,7 +188,6 @@
 #define CONFIG_SDCLONE_DISABLE 1
 #undef CONFIG_SCHED_WORKQUEUE
 #define CONFIG_SCHED_WORKPRIORITY 50
-#define CONFIG_SCHED_WORKPERIOD (50*1000)
 #define CONFIG_SCHED_WORKSTACKSIZE 1024
 #define CONFIG_SIG_SIGWORK 4
 #define CONFIG_SCHED_WAITPID 1
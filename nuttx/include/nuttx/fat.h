@@ -1,7 +1,7 @@
 /****************************************************************************
  * include/nuttx/fat.h
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -64,6 +64,24 @@
 
 typedef uint8_t fat_attrib_t;
 
+/* Statistics returned by the FIOC_FATSTATS ioctl command.  The counts are
+ * accumulated for the mounted volume that holds the open file from the
+ * time that the volume was mounted.
+ */
+
+struct fat_stats_s
+{
+  uint32_t st_fathits;             /* Reads of FAT sectors found in the sector cache */
+  uint32_t st_fatmisses;           /* Reads of FAT sectors not found in the cache */
+  uint32_t st_dirhits;             /* Reads of other sectors found in the cache */
+  uint32_t st_dirmisses;           /* Reads of other sectors not found in the cache */
+  uint32_t st_writebacks;          /* Dirty sectors written back from the cache */
+  uint32_t st_hwreads;             /* Sectors read from the block driver */
+  uint32_t st_hwwrites;            /* Sectors written to the block driver */
+  uint32_t st_dcachehits;          /* Path segments found in the directory cache */
+  uint32_t st_dcachemisses;        /* Path segments not found in the cache */
+};
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
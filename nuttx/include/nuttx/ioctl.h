@@ -107,6 +107,25 @@
 #define FIOC_OPTIMIZE   _FIOC(0x0003)     /* IN:  None
                                            * OUT: None
                                            */
+#define FIOC_FATSTATS   _FIOC(0x0004)     /* IN:  Location to return FAT
+                                           *      statistics (struct
+                                           *      fat_stats_s *)
+                                           * OUT: Sector cache and block
+                                           *      driver statistics of the
+                                           *      FAT volume
+                                           */
+#define FIOC_PACKSTEP   _FIOC(0x0005)     /* IN:  Location to return NXFFS
+                                           *      packing status (struct
+                                           *      nxffs_packstatus_s *) or
+                                           *      NULL
+                                           * OUT: One incremental packing
+                                           *      step is performed
+                                           */
+#define FIOC_PACKSTATUS _FIOC(0x0006)     /* IN:  Location to return NXFFS
+                                           *      packing status (struct
+                                           *      nxffs_packstatus_s *)
+                                           * OUT: Incremental packing status
+                                           */
 
 /* NuttX file system ioctl definitions **************************************/
 
@@ -143,6 +162,20 @@
                                            * IN:  None
                                            * OUT: None (ioctl return value provides
                                            *      success/failure indication). */
+#define BIOC_FTLSTATS   _BIOC(0x0004)     /* Get wear-levelling FTL statistics
+                                           * IN:  Pointer to a struct ftl_stats_s
+                                           *      (see include/nuttx/mtd.h)
+                                           * OUT: Statistics returned in the
+                                           *      struct ftl_stats_s */
+#define BIOC_FLUSH      _BIOC(0x0005)     /* Write any cached data to the media
+                                           * IN:  None
+                                           * OUT: None (ioctl return value provides
+                                           *      success/failure indication). */
+#define BIOC_RWBSTATS   _BIOC(0x0006)     /* Get read-ahead/write buffer statistics
+                                           * IN:  Pointer to a struct rwb_stats_s
+                                           *      (see include/nuttx/rwbuffer.h)
+                                           * OUT: Statistics returned in the
+                                           *      struct rwb_stats_s */
 
 /* NuttX MTD driver ioctl definitions ***************************************/
 
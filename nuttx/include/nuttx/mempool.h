@@ -0,0 +1,210 @@
+/****************************************************************************
+ * include/nuttx/mempool.h
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_MEMPOOL_H
+#define __INCLUDE_NUTTX_MEMPOOL_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <queue.h>
+
+/****************************************************************************
+ * Pre-Processor Definitions
+ ****************************************************************************/
+
+/* Each free block holds the free list link so no block may be smaller than
+ * a pointer.  Block sizes are rounded up to a multiple of this size so that
+ * every block is suitably aligned.
+ */
+
+#define MEMPOOL_ALIGN        sizeof(FAR void *)
+#define MEMPOOL_ALIGN_UP(s)  (((s) + MEMPOOL_ALIGN - 1) & ~(MEMPOOL_ALIGN - 1))
+
+/* Size of the storage needed for 'n' blocks of size 's'.  This may be used
+ * to declare statically allocated storage for mempool_initialize().
+ */
+
+#define MEMPOOL_SIZE(s,n)    (MEMPOOL_ALIGN_UP(s) * (n))
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* This structure describes one pool of fixed size blocks.  It is normally
+ * statically allocated by the owner of the pool and should be treated as
+ * opaque.
+ */
+
+struct mempool_s
+{
+  sq_queue_t    freelist;   /* List of free blocks */
+  FAR uint8_t  *storage;    /* Start of the memory holding all blocks */
+  uint16_t      blocksize;  /* Size of one block (aligned) */
+  uint16_t      nblocks;    /* Total number of blocks in the pool */
+  uint16_t      nreserved;  /* Blocks reserved for interrupt handlers */
+  uint16_t      nfree;      /* Number of blocks in the free list */
+  uint16_t      minfree;    /* Smallest value of nfree ever seen */
+  uint16_t      nfailed;    /* Number of failed allocations */
+  bool          allocated;  /* True: storage was allocated by mempool_create */
+};
+
+/* Pool statistics returned by mempool_info() */
+
+struct mempoolinfo_s
+{
+  uint16_t      blocksize;  /* Size of one block (aligned) */
+  uint16_t      nblocks;    /* Total number of blocks in the pool */
+  uint16_t      nreserved;  /* Blocks reserved for interrupt handlers */
+  uint16_t      nfree;      /* Number of blocks currently free */
+  uint16_t      minfree;    /* Low-water mark of free blocks */
+  uint16_t      nfailed;    /* Number of failed allocations */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: mempool_initialize
+ *
+ * Description:
+ *   Initialize a pool of 'nblocks' blocks of 'blocksize' bytes using
+ *   caller-provided storage of at least MEMPOOL_SIZE(blocksize, nblocks)
+ *   bytes.  'nreserved' of the blocks may only be allocated from interrupt
+ *   handlers.
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+EXTERN int mempool_initialize(FAR struct mempool_s *pool, FAR void *storage,
+                              size_t blocksize, uint16_t nblocks,
+                              uint16_t nreserved);
+
+/****************************************************************************
+ * Name: mempool_create
+ *
+ * Description:
+ *   Same as mempool_initialize() except that storage for the blocks is
+ *   allocated from the kernel heap (once).
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+EXTERN int mempool_create(FAR struct mempool_s *pool, size_t blocksize,
+                          uint16_t nblocks, uint16_t nreserved);
+
+/****************************************************************************
+ * Name: mempool_release
+ *
+ * Description:
+ *   Release storage allocated by mempool_create().  All blocks must have
+ *   been returned to the pool.
+ *
+ ****************************************************************************/
+
+EXTERN void mempool_release(FAR struct mempool_s *pool);
+
+/****************************************************************************
+ * Name: mempool_alloc
+ *
+ * Description:
+ *   Remove one block from the pool in constant time.  This function may be
+ *   called from interrupt handlers.  Only interrupt handlers may take the
+ *   last 'nreserved' blocks.
+ *
+ * Returned Value:
+ *   The allocated block or NULL if the pool is exhausted.
+ *
+ ****************************************************************************/
+
+EXTERN FAR void *mempool_alloc(FAR struct mempool_s *pool);
+
+/****************************************************************************
+ * Name: mempool_free
+ *
+ * Description:
+ *   Return a block to the pool in constant time.  This function may be
+ *   called from interrupt handlers.
+ *
+ ****************************************************************************/
+
+EXTERN void mempool_free(FAR struct mempool_s *pool, FAR void *mem);
+
+/****************************************************************************
+ * Name: mempool_contains
+ *
+ * Description:
+ *   Return true if 'mem' is one of the blocks of the pool.  This is useful
+ *   for subsystems that fall back to the heap when the pool is exhausted.
+ *
+ ****************************************************************************/
+
+EXTERN bool mempool_contains(FAR struct mempool_s *pool, FAR void *mem);
+
+/****************************************************************************
+ * Name: mempool_info
+ *
+ * Description:
+ *   Return usage statistics for the pool.
+ *
+ ****************************************************************************/
+
+EXTERN void mempool_info(FAR struct mempool_s *pool,
+                         FAR struct mempoolinfo_s *info);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_MEMPOOL_H */
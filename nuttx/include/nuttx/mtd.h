@@ -2,7 +2,7 @@
  * include/nuttx/mtd.h
  * Memory Technology Device (MTD) interface
  *
- *   Copyright (C) 2009-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -115,6 +115,26 @@ struct mtd_dev_s
   int (*ioctl)(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg);
 };
 
+/* Statistics returned by the wear-levelling FTL in response to the
+ * BIOC_FTLSTATS ioctl command (CONFIG_FTL_WEARLEVEL).  Sector counts are in
+ * units of MTD read/write blocks.  Dividing st_nwritten + st_ncopied +
+ * st_nhdrwrites by st_nwritten gives the write amplification.
+ */
+
+struct ftl_stats_s
+{
+  uint32_t st_nread;      /* Sectors read on behalf of the caller */
+  uint32_t st_nwritten;   /* Sectors written on behalf of the caller */
+  uint32_t st_ncopied;    /* Valid sectors copied by garbage collection and
+                           * wear-levelling */
+  uint32_t st_nhdrwrites; /* Erase block header writes */
+  uint32_t st_nerased;    /* Erase blocks erased */
+  uint32_t st_ngc;        /* Garbage collections */
+  uint32_t st_nwlmoves;   /* Static wear-levelling moves */
+  uint32_t st_minecount;  /* Smallest erase count of any erase block */
+  uint32_t st_maxecount;  /* Largest erase count of any erase block */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
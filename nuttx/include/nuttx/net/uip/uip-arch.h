@@ -111,7 +111,9 @@ struct uip_driver_s
    * uIP will handle only a single buffer for both incoming and outgoing
    * packets.  However, the drive design may be concurrently send and
    * filling separate, break-off buffers if CONFIG_NET_MULTIBUFFER is
-   * defined.  That buffer management must be controlled by the driver.
+   * defined.  That buffer management must be controlled by the driver,
+   * possibly using the shared pool of I/O buffers (CONFIG_NET_IOB, see
+   * include/nuttx/net/uip/uip-iob.h).
    */
 
 #ifdef CONFIG_NET_MULTIBUFFER
@@ -165,6 +167,17 @@ struct uip_driver_s
 
   uint16_t d_sndlen;
 
+#ifdef CONFIG_NET_COPYCHKSUM
+  /* When uip_send() copies the application data into d_snddata, it also
+   * computes the checksum of the data.  The TCP and UDP checksum logic then
+   * only has to sum the headers.  d_sndsumlen is the number of bytes
+   * included in d_sndsum (zero if there is no valid partial checksum).
+   */
+
+  uint16_t d_sndsum;
+  uint16_t d_sndsumlen;
+#endif
+
   /* IGMP group list */
 
 #ifdef CONFIG_NET_IGMP
@@ -337,6 +350,25 @@ extern void uip_incr32(uint8_t *op32, uint16_t op16);
 
 extern uint16_t uip_chksum(uint16_t *buf, uint16_t len);
 
+/* Copy a buffer and calculate its Internet checksum in a single pass.
+ *
+ * dest - The destination of the copy.
+ *
+ * src - The data to be copied and checksummed.
+ *
+ * len - The number of bytes to copy.
+ *
+ * sum - An initial, partial checksum in host byte order (zero if none).
+ *
+ * Return:  The partial (not complemented) one's complement sum of 'sum'
+ * and all of the 16-bit words in the buffer, in host byte order.
+ */
+
+#ifdef CONFIG_NET_COPYCHKSUM
+extern uint16_t uip_copychksum(FAR void *dest, FAR const void *src,
+                               uint16_t len, uint16_t sum);
+#endif
+
 /* Calculate the IP header checksum of the packet header in d_buf.
  *
  * The IP header checksum is the Internet checksum of the 20 bytes of
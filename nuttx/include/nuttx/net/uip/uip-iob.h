@@ -0,0 +1,218 @@
+/****************************************************************************
+ * include/nuttx/net/uip/uip-iob.h
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_NET_UIP_UIP_IOB_H
+#define __INCLUDE_NUTTX_NET_UIP_UIP_IOB_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <queue.h>
+
+#include <nuttx/mempool.h>
+#include <nuttx/net/uip/uipopt.h>
+
+#ifdef CONFIG_NET_IOB
+
+/****************************************************************************
+ * Pre-Processor Definitions
+ ****************************************************************************/
+
+/* The I/O buffers replace the device's own d_buf array */
+
+#ifndef CONFIG_NET_MULTIBUFFER
+#  error "CONFIG_NET_IOB requires CONFIG_NET_MULTIBUFFER"
+#endif
+
+/* The number of I/O buffers in the shared pool.  Each holds one complete
+ * packet.
+ */
+
+#ifndef CONFIG_NET_IOB_NBUFFERS
+#  define CONFIG_NET_IOB_NBUFFERS 8
+#endif
+
+/* The number of I/O buffers that only interrupt handlers (i.e., packet
+ * reception) may take.  This keeps the send path from starving reception.
+ */
+
+#ifndef CONFIG_NET_IOB_NRESERVED
+#  define CONFIG_NET_IOB_NRESERVED 2
+#endif
+
+#if CONFIG_NET_IOB_NRESERVED >= CONFIG_NET_IOB_NBUFFERS
+#  error "CONFIG_NET_IOB_NRESERVED must be less than CONFIG_NET_IOB_NBUFFERS"
+#endif
+
+/* The size of the packet data in each I/O buffer */
+
+#define UIP_IOB_BUFSIZE (CONFIG_NET_BUFSIZE + CONFIG_NET_GUARDSIZE)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One I/O buffer.  io_data comes first so that it has the alignment of the
+ * structure; a driver may point its DMA hardware and dev->d_buf directly at
+ * io_data.  uip_iobcontainer() recovers the I/O buffer from dev->d_buf.
+ *
+ * I/O buffers may be linked into chains (sq_queue_t) through io_node.  A
+ * driver would typically keep a chain of received packets waiting for
+ * uip_input() and a chain of packets "in flight" in the transmitter.
+ */
+
+struct uip_iob_s
+{
+  uint8_t    io_data[UIP_IOB_BUFSIZE]; /* The packet data */
+  sq_entry_t io_node;                  /* Supports a singly linked chain */
+  uint16_t   io_len;                   /* Length of the packet in io_data */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+struct uip_driver_s; /* Forward reference */
+
+/****************************************************************************
+ * Name: uip_ioballoc
+ *
+ * Description:
+ *   Take one I/O buffer from the shared pool.  This function may be called
+ *   from interrupt handlers.
+ *
+ * Returned Value:
+ *   The I/O buffer or NULL if the pool is exhausted.
+ *
+ ****************************************************************************/
+
+EXTERN FAR struct uip_iob_s *uip_ioballoc(void);
+
+/****************************************************************************
+ * Name: uip_iobfree and uip_iobfreechain
+ *
+ * Description:
+ *   Return one I/O buffer, or every I/O buffer in a chain, to the shared
+ *   pool.  These functions may be called from interrupt handlers.
+ *
+ ****************************************************************************/
+
+EXTERN void uip_iobfree(FAR struct uip_iob_s *iob);
+EXTERN void uip_iobfreechain(FAR sq_queue_t *chain);
+
+/****************************************************************************
+ * Name: uip_iobenqueue and uip_iobdequeue
+ *
+ * Description:
+ *   Add an I/O buffer to the end of a chain or remove the I/O buffer at the
+ *   head of a chain.  The caller must prevent concurrent access to the
+ *   chain.
+ *
+ ****************************************************************************/
+
+EXTERN void uip_iobenqueue(FAR sq_queue_t *chain, FAR struct uip_iob_s *iob);
+EXTERN FAR struct uip_iob_s *uip_iobdequeue(FAR sq_queue_t *chain);
+
+/****************************************************************************
+ * Name: uip_iobcontainer
+ *
+ * Description:
+ *   Return the I/O buffer that contains the packet data at 'buffer' (as
+ *   from dev->d_buf) or NULL if 'buffer' is not the data of an I/O buffer.
+ *
+ ****************************************************************************/
+
+EXTERN FAR struct uip_iob_s *uip_iobcontainer(FAR uint8_t *buffer);
+
+/****************************************************************************
+ * Name: uip_iobattach
+ *
+ * Description:
+ *   Allocate an I/O buffer and make it the device's packet buffer
+ *   (dev->d_buf).  dev->d_buf must be NULL.  A driver calls this before
+ *   receiving a packet or before polling for packets to send.
+ *
+ * Returned Value:
+ *   OK on success; -ENOMEM if the pool is exhausted.
+ *
+ ****************************************************************************/
+
+EXTERN int uip_iobattach(FAR struct uip_driver_s *dev);
+
+/****************************************************************************
+ * Name: uip_iobdetach
+ *
+ * Description:
+ *   Take the I/O buffer holding the device's packet buffer away from the
+ *   device.  The packet length, dev->d_len, is saved in io_len and
+ *   dev->d_buf and dev->d_len are cleared.  The driver then owns the
+ *   I/O buffer; it may, for example, queue it for transmission and attach
+ *   a new I/O buffer in order to poll for the next packet to send.
+ *
+ * Returned Value:
+ *   The detached I/O buffer or NULL if the device has no packet buffer.
+ *
+ ****************************************************************************/
+
+EXTERN FAR struct uip_iob_s *uip_iobdetach(FAR struct uip_driver_s *dev);
+
+/****************************************************************************
+ * Name: uip_iobinfo
+ *
+ * Description:
+ *   Return usage statistics for the shared pool.
+ *
+ ****************************************************************************/
+
+EXTERN void uip_iobinfo(FAR struct mempoolinfo_s *info);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_NET_IOB */
+#endif /* __INCLUDE_NUTTX_NET_UIP_UIP_IOB_H */
@@ -124,6 +124,9 @@ struct uip_backlog_s;     /* Forward reference */
 struct uip_conn
 {
   dq_entry_t node;        /* Implements a doubly linked list */
+  FAR struct uip_conn *hnext; /* Next in address/port pair hash chain */
+  FAR struct uip_conn *pnext; /* Next in local port hash chain */
+  FAR struct uip_conn *lnext; /* Next in listener hash chain */
   uip_ipaddr_t ripaddr;   /* The IP address of the remote host */
   uint16_t lport;         /* The local TCP port, in network byte order */
   uint16_t rport;         /* The remoteTCP port, in network byte order */
@@ -135,6 +138,7 @@ struct uip_conn
                            * connection */
   uint16_t initialmss;    /* Initial maximum segment size for the
                            * connection */
+  uint16_t winsize;       /* Receive window last advertised by the peer */
   uint8_t  crefs;         /* Reference counts on this instance */
   uint8_t  sa;            /* Retransmission time-out calculation state
                            * variable */
@@ -150,10 +154,21 @@ struct uip_conn
    *
    * readahead - A singly linked list of type struct uip_readahead_s
    *   where the TCP/IP read-ahead data is retained.
+   * rhquota - The maximum number of read-ahead buffers that this connection
+   *   may hold (see SO_RCVBUF).
+   * rhcount - The number of read-ahead buffers now held.
+   * rcvwnd - The receive window last advertised to the peer.  This is the
+   *   amount of data that could be retained in read-ahead buffers.
+   * wndupdate - Non-zero if a window update should be sent to the peer
+   *   because read-ahead buffers have been freed.
    */
 
 #if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
   sq_queue_t readahead;   /* Read-ahead buffering */
+  uint16_t rhquota;       /* Maximum number of read-ahead buffers */
+  uint16_t rhcount;       /* Number of read-ahead buffers held */
+  uint16_t rcvwnd;        /* Last advertised receive window */
+  uint8_t  wndupdate;     /* A window update is pending */
 #endif
 
   /* Listen backlog support
@@ -261,6 +276,8 @@ struct uip_tcp_stats_s
   uip_stats_t syndrop;    /* Number of dropped SYNs due to too few
                              available connections */
   uip_stats_t synrst;     /* Number of SYNs for closed ports triggering a RST */
+  uip_stats_t rcvdrop;    /* Number of TCP segments dropped because there
+                             was no read-ahead buffer space */
 };
 #endif
 
@@ -382,8 +399,9 @@ extern int uip_unlisten(struct uip_conn *conn);
 /* Access to TCP read-ahead buffers */
 
 #if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
-extern struct uip_readahead_s *uip_tcpreadaheadalloc(void);
-extern void uip_tcpreadaheadrelease(struct uip_readahead_s *buf);
+extern struct uip_readahead_s *uip_tcpreadaheadalloc(struct uip_conn *conn);
+extern void uip_tcpreadaheadrelease(struct uip_conn *conn,
+                                    struct uip_readahead_s *buf);
 #endif /* CONFIG_NET_NTCP_READAHEAD_BUFFERS */
 
 /* Backlog support */
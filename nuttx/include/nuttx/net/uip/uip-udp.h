@@ -74,6 +74,7 @@ struct uip_callback_s;    /* Forward reference */
 struct uip_udp_conn
 {
   dq_entry_t node;        /* Supports a doubly linked list */
+  FAR struct uip_udp_conn *hnext; /* Next in local port hash chain */
   uip_ipaddr_t ripaddr;   /* The IP address of the remote peer */
   uint16_t lport;         /* The local port number in network byte order */
   uint16_t rport;         /* The remote port number in network byte order */
@@ -16,7 +16,7 @@
  * Note: Most of the configuration options in the uipopt.h should not
  * be changed, but rather the per-project defconfig file.
  *
- *   Copyright (C) 2007, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * This logic was leveraged from uIP which also has a BSD-style license:
@@ -170,6 +170,18 @@
 
 #define UIP_UDP_MSS (CONFIG_NET_BUFSIZE - UIP_LLH_LEN - UIP_IPUDPH_LEN)
 
+/* The number of buckets in the hash table used to find the UDP connection
+ * that receives an incoming datagram.  Must be a power of two.
+ */
+
+#ifndef CONFIG_NET_UDP_NHASH
+#  define CONFIG_NET_UDP_NHASH 8
+#endif
+
+#if (CONFIG_NET_UDP_NHASH & (CONFIG_NET_UDP_NHASH - 1)) != 0
+#  error "CONFIG_NET_UDP_NHASH must be a power of two"
+#endif
+
 /* TCP configuration options */
 
 /* The maximum number of simultaneously open TCP connections.
@@ -196,6 +208,19 @@
 # define CONFIG_NET_MAX_LISTENPORTS 20
 #endif
 
+/* The number of buckets in each of the hash tables used to find TCP
+ * connections (by remote address and port pair) and TCP listeners (by local
+ * port).  Must be a power of two.
+ */
+
+#ifndef CONFIG_NET_TCP_NHASH
+#  define CONFIG_NET_TCP_NHASH 16
+#endif
+
+#if (CONFIG_NET_TCP_NHASH & (CONFIG_NET_TCP_NHASH - 1)) != 0
+#  error "CONFIG_NET_TCP_NHASH must be a power of two"
+#endif
+
 /* Define the maximum number of concurrently active UDP and TCP
  * ports.  This number must be greater than the number of open
  * sockets in order to support multi-threaded read/write operations.
@@ -246,6 +271,20 @@
 # define CONFIG_NET_RECEIVE_WINDOW UIP_TCP_MSS
 #endif
 
+/* The maximum number of full-sized segments that send() may have sent but
+ * not yet had acknowledged.  The amount of unacknowledged data is also
+ * limited by the window advertised by the peer.  A value of one gives the
+ * traditional uIP behavior of one segment per round trip.
+ */
+
+#ifndef CONFIG_NET_TCP_SNDSEGS
+#  define CONFIG_NET_TCP_SNDSEGS 4
+#endif
+
+#if CONFIG_NET_TCP_SNDSEGS < 1
+#  error "CONFIG_NET_TCP_SNDSEGS must be at least one"
+#endif
+
 /* How long a connection should stay in the TIME_WAIT state.
  *
  * This configiration option has no real implication, and it should be
@@ -299,6 +338,19 @@
 # define CONFIG_NET_TCP_READAHEAD_BUFSIZE UIP_TCP_MSS
 #endif
 
+/* The default number of read-ahead buffers that one TCP connection may
+ * hold.  This may be changed for each socket with SO_RCVBUF.  By default,
+ * one connection may use all of the read-ahead buffers.
+ */
+
+#ifndef CONFIG_NET_TCP_READAHEAD_QUOTA
+# define CONFIG_NET_TCP_READAHEAD_QUOTA CONFIG_NET_NTCP_READAHEAD_BUFFERS
+#endif
+
+#if CONFIG_NET_TCP_READAHEAD_QUOTA > CONFIG_NET_NTCP_READAHEAD_BUFFERS
+#  error "CONFIG_NET_TCP_READAHEAD_QUOTA exceeds CONFIG_NET_NTCP_READAHEAD_BUFFERS"
+#endif
+
 /****************************************************************************
  * Public Type Definitions
  ****************************************************************************/
@@ -1,7 +1,7 @@
 /****************************************************************************
  * include/nuttx/nxffs.h
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -85,6 +85,44 @@
 #  define CONFIG_NXFFS_TAILTHRESHOLD (8*1024)
 #endif
 
+/* Normally, every open(), stat(), and unlink() must search the inode headers
+ * on FLASH, starting with the first inode, until the matching name is found.
+ * If CONFIG_NXFFS_NINDEX is non-zero, then an index of up to this many
+ * inodes is kept in RAM (8 bytes per inode) so that the matching inode
+ * header can be read directly.  If there are more inodes than this on the
+ * FLASH, then the index is abandoned and the FLASH is searched as before.
+ */
+
+#ifndef CONFIG_NXFFS_NINDEX
+#  define CONFIG_NXFFS_NINDEX 0
+#endif
+
+#if CONFIG_NXFFS_NINDEX > 65535
+#  error "CONFIG_NXFFS_NINDEX is too large"
+#endif
+
+/* Normally, the FLASH is packed only when it is completely full; the write
+ * that finds the FLASH full must then wait while the entire volume is
+ * packed.  If CONFIG_NXFFS_PACKRESERVE is non-zero and the work queue is
+ * enabled, then the volume will be packed incrementally on the worker
+ * thread, one erase block at a time, whenever fewer than this number of
+ * bytes remain free at the end of FLASH.  CONFIG_NXFFS_PACKDELAY is the
+ * delay in milliseconds between successive packing steps.
+ */
+
+#ifndef CONFIG_NXFFS_PACKRESERVE
+#  define CONFIG_NXFFS_PACKRESERVE 0
+#endif
+
+#ifndef CONFIG_SCHED_WORKQUEUE
+#  undef CONFIG_NXFFS_PACKRESERVE
+#  define CONFIG_NXFFS_PACKRESERVE 0
+#endif
+
+#ifndef CONFIG_NXFFS_PACKDELAY
+#  define CONFIG_NXFFS_PACKDELAY 10
+#endif
+
 /* At present, only a single pre-allocated NXFFS volume is supported.  This
  * is because here can be only a single NXFFS volume mounted at any time.
  * This has to do with the fact that we bind to an MTD driver (instead of a
@@ -94,6 +132,31 @@
 #undef CONFIG_NXFSS_PREALLOCATED
 #define CONFIG_NXFSS_PREALLOCATED 1
 
+/* Incremental packing states (see struct nxffs_packstatus_s) */
+
+#define NXFFS_PACK_IDLE     0 /* No incremental packing in progress */
+#define NXFFS_PACK_MOVING   1 /* Moving valid inodes toward the start of FLASH */
+#define NXFFS_PACK_ERASING  2 /* Erasing the reclaimed FLASH at the end */
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Incremental packing status returned by the FIOC_PACKSTEP and
+ * FIOC_PACKSTATUS ioctl commands.  The counts are accumulated from the time
+ * that the volume was mounted.
+ */
+
+struct nxffs_packstatus_s
+{
+  uint8_t  ps_state;               /* Packing state.  See NXFFS_PACK_* */
+  off_t    ps_offset;              /* FLASH before this offset has been packed */
+  off_t    ps_froffset;            /* Offset to the first free byte of FLASH */
+  off_t    ps_size;                /* Size of the FLASH volume in bytes */
+  uint32_t ps_nsteps;              /* Number of incremental packing steps */
+  uint32_t ps_npasses;             /* Number of completed packing passes */
+};
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
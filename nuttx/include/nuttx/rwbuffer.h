@@ -1,7 +1,7 @@
 /****************************************************************************
- * inlcude/nuttx/rwbuffer.h
+ * include/nuttx/rwbuffer.h
  *
- *   Copyright (C) 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -51,8 +51,6 @@
 #include <semaphore.h>
 #include <nuttx/wqueue.h>
 
-#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_READAHEAD)
-
 /**********************************************************************
  * Pre-processor Definitions
  **********************************************************************/
@@ -61,9 +59,37 @@
  * Public Types
  **********************************************************************/
 
+/* Buffer statistics returned by rwb_stats() (and by the BIOC_RWBSTATS
+ * ioctl command of block drivers that use these buffers).  These are
+ * defined unconditionally so that applications can use them without
+ * regard to the buffering configuration.
+ */
+
+struct rwb_stats_s
+{
+  uint32_t st_rhhits;      /* Blocks returned from the read-ahead buffer */
+  uint32_t st_rhmisses;    /* Blocks that had to be read from the media */
+  uint32_t st_rhahead;     /* Blocks read ahead of the caller's request */
+  uint32_t st_rhasync;     /* Asynchronous prefetches performed */
+  uint32_t st_rhwindow;    /* Current read-ahead window (blocks) */
+  uint32_t st_wrblocks;    /* Blocks written by the caller */
+  uint32_t st_wrcoalesced; /* Blocks absorbed by overwriting buffered blocks */
+  uint32_t st_wrflushes;   /* Write transfers to the media */
+  uint32_t st_wrflushed;   /* Blocks written to the media */
+};
+
+#if defined(CONFIG_FS_WRITEBUFFER) || defined(CONFIG_FS_READAHEAD)
+
 /* Data transfer callouts.  These must be provided by the block driver
  * logic in order to flush the write buffer when appropriate or to
  * reload the read-ahead buffer, when appropriate.
+ *
+ * The callouts are always called with the buffer semaphores held so
+ * that no two callouts for the same rwbuffer instance ever run at the
+ * same time.  But they may be called from the worker thread (when the
+ * write buffer times out or when an asynchronous read-ahead is
+ * performed) so they must not depend on any locks held by the caller of
+ * rwb_read() or rwb_write().
  */
 
 typedef ssize_t (*rwbreload_t)(FAR void *dev, FAR uint8_t *buffer,
@@ -91,9 +117,12 @@ typedef ssize_t (*rwbflush_t)(FAR void *dev, FAR const uint8_t *buffer,
  *
  *  struct foo_dev_s *priv;
  *  ...
- *  ... [Setup blocksize, nblocks, dev, wrmaxblocks, wrflush,
- *       rhmaxblocks, rhreload] ...
+ *  ... [Setup blocksize, nblocks, dev, rhreload, wrflush, wrmaxblocks,
+ *       rhmaxblocks] ...
  *  ret = rwb_initialize(&priv->rwbuffer);
+ *
+ * All reads and writes should then go through rwb_read() and rwb_write()
+ * so that the buffered data is always coherent with the media.
  */
 
 struct rwbuffer_s
@@ -103,30 +132,40 @@ struct rwbuffer_s
    * rwb_initialize()
    */
 
-  /* Supported geometry */
+  /* Supported geometry.  nblocks may be zero for removable media that is
+   * not yet present (and updated later).
+   */
 
   uint16_t      blocksize;       /* The size of one block */
   size_t        nblocks;         /* The total number blocks supported */
   FAR void     *dev;             /* Device state passed to callout functions */
 
+  /* Transfer callouts.  These are needed even if only one kind of
+   * buffering is enabled:  Unbuffered transfers are passed through.
+   * wrflush may be NULL for read-only media (then rwb_write() may not be
+   * used).
+   */
+
+  rwbreload_t   rhreload;        /* Callout to read blocks from the media */
+  rwbflush_t    wrflush;         /* Callout to write blocks to the media */
+
   /* Write buffer setup.  If CONFIG_FS_WRITEBUFFER is defined, but you
-   * want read-ahead-only operation, (1) set wrmaxblocks to zero and do
-   * not use rwb_write().
+   * want read-ahead-only operation, set wrmaxblocks to zero.
    */
 
 #ifdef CONFIG_FS_WRITEBUFFER
   uint16_t      wrmaxblocks;     /* The number of blocks to buffer in memory */
-  rwbflush_t    wrflush;         /* Callout to flush the write buffer */
 #endif
 
   /* Read-ahead buffer setup.  If CONFIG_FS_READAHEAD is defined but you
-   * want write-buffer-only operation, then (1) set rhmaxblocks to zero and
-   * do not use rwb_read().
+   * want write-buffer-only operation, then set rhmaxblocks to zero.
+   * rhmaxblocks is the largest read-ahead window;  the window actually
+   * used grows while the reads are sequential and shrinks when they are
+   * not.
    */
 
 #ifdef CONFIG_FS_READAHEAD
   uint16_t      rhmaxblocks;     /* The number of blocks to buffer in memory */
-  rwbreload_t   rhreload;        /* Callout to reload the read-ahead buffer */
 #endif
 
   /********************************************************************/
@@ -140,17 +179,26 @@ struct rwbuffer_s
   uint8_t      *wrbuffer;        /* Allocated write buffer */
   uint16_t      wrnblocks;       /* Number of blocks in write buffer */
   off_t         wrblockstart;    /* First block in write buffer */
-  off_t         wrexpectedblock; /* Next block expected */
 #endif
 
   /* This is the state of the read-ahead buffer */
 
 #ifdef CONFIG_FS_READAHEAD
-  sem_t         rhsem;           /* Enforces exclusive access to the write buffer */
+  sem_t         rhsem;           /* Enforces exclusive access to the read-ahead buffer */
   uint8_t      *rhbuffer;        /* Allocated read-ahead buffer */
   uint16_t      rhnblocks;       /* Number of blocks in read-ahead buffer */
+  uint16_t      rhwindow;        /* Current read-ahead window (blocks) */
   off_t         rhblockstart;    /* First block in read-ahead buffer */
+  off_t         rhexpected;      /* Next block if the reads are sequential */
+#ifdef CONFIG_FS_RHASYNC
+  struct work_s rhwork;          /* Asynchronous read-ahead */
+  off_t         rhprefetch;      /* First block of pending read-ahead (or -1) */
 #endif
+#endif
+
+  /* Buffer statistics */
+
+  struct rwb_stats_s stats;
 };
 
 /**********************************************************************
@@ -183,6 +231,11 @@ EXTERN ssize_t rwb_write(FAR struct rwbuffer_s *rwb,
                          FAR const uint8_t *wrbuffer);
 EXTERN int rwb_mediaremoved(FAR struct rwbuffer_s *rwb);
 
+/* Buffer statistics */
+
+EXTERN int rwb_stats(FAR struct rwbuffer_s *rwb,
+                     FAR struct rwb_stats_s *stats);
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -216,6 +216,10 @@ struct _TCB
 #if CONFIG_RR_INTERVAL > 0
   int      timeslice;                    /* RR timeslice interval remaining     */
 #endif
+#ifdef CONFIG_SCHED_CPULOAD
+  uint32_t cpu_time;                     /* Accumulated run time (usec)         */
+  uint32_t cpu_switches;                 /* Number of times switched in         */
+#endif
 
   /* Values needed to restart a task ********************************************/
 
@@ -316,6 +320,24 @@ typedef struct _TCB _TCB;
 
 typedef void (*sched_foreach_t)(FAR _TCB *tcb, FAR void *arg);
 
+/* This is the form of the CPU accounting information returned by
+ * sched_cpuload().  Times are in microseconds and wrap at 2**32 so only
+ * the difference between two samples is meaningful:  The percentage of
+ * CPU used by the task between two samples is the change in active
+ * divided by the change in total.
+ */
+
+#ifdef CONFIG_SCHED_CPULOAD
+struct cpuload_s
+{
+  uint32_t active;                       /* Time that the task has run          */
+  uint32_t total;                        /* Time base at the time of the sample */
+  uint32_t switches;                     /* Number of times switched in         */
+  size_t   stacksize;                    /* Size of the stack                   */
+  size_t   stackused;                    /* Stack high-water mark (0=unknown)   */
+};
+#endif
+
 #endif /* __ASSEMBLY__ */
 
 /********************************************************************************
@@ -355,6 +377,12 @@ EXTERN FAR struct socketlist *sched_getsockets(void);
 
 EXTERN void sched_foreach(sched_foreach_t handler, FAR void *arg);
 
+/* Return CPU accounting information for a task */
+
+#ifdef CONFIG_SCHED_CPULOAD
+EXTERN int sched_cpuload(pid_t pid, FAR struct cpuload_s *cpuload);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
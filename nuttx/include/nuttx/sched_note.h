@@ -0,0 +1,197 @@
+/****************************************************************************
+ * include/nuttx/sched_note.h
+ * Scheduler instrumentation note buffer
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_SCHED_NOTE_H
+#define __INCLUDE_NUTTX_SCHED_NOTE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <semaphore.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_SCHED_NOTE_BUFFER - Selects the built-in implementation of the
+ *   scheduler instrumentation interfaces.  Notes are time stamped and
+ *   saved in a circular RAM buffer from which they may be read with
+ *   sched_note_get() or through the /dev/note character driver.  Requires
+ *   CONFIG_SCHED_INSTRUMENTATION.
+ * CONFIG_SCHED_NOTE_BUFSIZE - The size of the circular buffer in bytes.
+ *   Default: 2048 (170 notes).
+ */
+
+#ifdef CONFIG_SCHED_NOTE_BUFFER
+#  ifndef CONFIG_SCHED_INSTRUMENTATION
+#    error "CONFIG_SCHED_NOTE_BUFFER requires CONFIG_SCHED_INSTRUMENTATION"
+#  endif
+#  ifndef CONFIG_SCHED_NOTE_BUFSIZE
+#    define CONFIG_SCHED_NOTE_BUFSIZE 2048
+#  endif
+#endif
+
+/* Note types.  The meaning of the PID and argument fields of the note
+ * depends upon the note type.
+ */
+
+#define NOTE_START          0  /* Task started:  pid = new task */
+#define NOTE_STOP           1  /* Task stopped:  pid = exiting task */
+#define NOTE_SWITCH         2  /* Context switch:  pid = new running task,
+                                * arg = PID of the task that was running */
+#define NOTE_NAME           3  /* Follows NOTE_START:  arg = up to 4 more
+                                * characters of the task name */
+#define NOTE_IRQ_ENTER      4  /* Interrupt handler entry:  arg = IRQ number */
+#define NOTE_IRQ_LEAVE      5  /* Interrupt handler exit:  arg = IRQ number */
+#define NOTE_SEM_WAIT       6  /* Task blocked on a semaphore:  arg = semaphore */
+#define NOTE_SEM_WAKE       7  /* Blocked task awakened:  pid = awakened task,
+                                * arg = semaphore */
+#define NOTE_SYSCALL_ENTER  8  /* System call entry:  arg = SYS call number */
+#define NOTE_SYSCALL_LEAVE  9  /* System call exit:  arg = SYS call number */
+#define NOTE_DROPPED       10  /* arg = Number of notes lost because the
+                                * buffer was full */
+
+/* The size of one note in bytes */
+
+#define NOTE_SIZE          12
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* This is the form of one note as it is saved in the buffer and as it is
+ * returned by sched_note_get() and by read() from /dev/note.  All multi-
+ * byte fields are little endian regardless of the byte order of the MCU so
+ * that the same host tool can decode notes from any target (see
+ * tools/notereport.c).
+ */
+
+struct note_s
+{
+  uint8_t nc_type;         /* Note type (see NOTE_* definitions) */
+  uint8_t nc_priority;     /* Priority of the task at the time of the note */
+  uint8_t nc_pid[2];       /* PID of the task */
+  uint8_t nc_arg[4];       /* Type-specific argument */
+  uint8_t nc_systime[4];   /* Time stamp in microseconds */
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifndef __ASSEMBLY__
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+/****************************************************************************
+ * Name: sched_note_irqhandler, sched_note_sem, sched_note_syscall
+ *
+ * Description:
+ *   Additional instrumentation hooks.  These are called from irq_dispatch(),
+ *   from the semaphore logic, and from the SYS call dispatcher.  They are
+ *   only recorded if the built-in note buffer is selected.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_NOTE_BUFFER
+EXTERN void sched_note_irqhandler(int irq, bool enter);
+EXTERN void sched_note_sem(FAR _TCB *tcb, FAR sem_t *sem, bool wait);
+EXTERN void sched_note_syscall(int nr, bool enter);
+#else
+#  define sched_note_irqhandler(i,e)
+#  define sched_note_sem(t,s,w)
+#  define sched_note_syscall(n,e)
+#endif
+
+/****************************************************************************
+ * Name: sched_note_get
+ *
+ * Description:
+ *   Remove the oldest notes from the buffer.  Only whole notes are
+ *   returned.  If notes were lost because the buffer was full, then the
+ *   first note returned is a NOTE_DROPPED note.
+ *
+ * Input Parameters:
+ *   buffer - Location to return the notes
+ *   buflen - The size of the buffer in bytes
+ *
+ * Returned Value:
+ *   The number of bytes returned (a multiple of NOTE_SIZE).  Zero is
+ *   returned if the buffer is empty.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_NOTE_BUFFER
+EXTERN ssize_t sched_note_get(FAR uint8_t *buffer, size_t buflen);
+#endif
+
+/****************************************************************************
+ * Name: note_register
+ *
+ * Description:
+ *   Register the /dev/note character driver.  Reading from /dev/note
+ *   removes notes from the buffer and returns end-of-file when the buffer
+ *   is empty, so the notes may be captured with, for example,
+ *   'cp /dev/note /mnt/note.dat'.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_SCHED_NOTE_BUFFER) && CONFIG_NFILE_DESCRIPTORS > 0
+EXTERN int note_register(void);
+#endif
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ASSEMBLY__ */
+#endif /* __INCLUDE_NUTTX_SCHED_NOTE_H */
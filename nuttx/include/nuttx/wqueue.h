@@ -1,7 +1,7 @@
 /****************************************************************************
  * include/nuttx/wqueue.h
  *
- *   Copyright (C) 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -51,6 +51,30 @@
  * Pre-Processor Definitions
  ****************************************************************************/
 
+/* Work queue IDs.  LPWORK is the general purpose work queue; its worker
+ * thread also performs garbage collection.  If CONFIG_SCHED_HPWORK is
+ * defined, there is also a high priority work queue, HPWORK, for latency
+ * sensitive work such as the "bottom half" of interrupt handling.
+ * Otherwise, HPWORK is the same as LPWORK.
+ */
+
+#define LPWORK          0
+#ifdef CONFIG_SCHED_HPWORK
+#  define HPWORK        1
+#  define NWORKERS      2
+#else
+#  define HPWORK        LPWORK
+#  define NWORKERS      1
+#endif
+
+/* The number of bins in the work latency histogram.  Bin 0 counts work that
+ * was started in the same clock tick in which it became due; bin n (n > 0)
+ * counts work that was started 2**(n-1) to 2**n - 1 ticks late, except that
+ * the last bin counts all later work.
+ */
+
+#define WORK_NHISTOGRAM 8
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -75,6 +99,19 @@ struct work_s
   uint32_t  delay;      /* Delay until work performed */
 };
 
+/* Latency statistics for one work queue.  The latency is the time from when
+ * the work became due until the worker was called.
+ */
+
+#ifdef CONFIG_SCHED_WORKSTATS
+struct work_stats_s
+{
+  uint32_t nworks;      /* Number of work items performed */
+  uint32_t maxlatency;  /* Maximum latency observed (clock ticks) */
+  uint32_t histogram[WORK_NHISTOGRAM]; /* Latency histogram */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -86,10 +123,6 @@ extern "C" {
 #define EXTERN extern
 #endif
 
-/* The task ID of the worker thread */
-
-EXTERN pid_t g_worker;
-
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -108,7 +141,11 @@ EXTERN pid_t g_worker;
  *   from the queue, or (2) work_cancel() has been called to cancel the work
  *   and remove it from the work queue.
  *
+ *   Work with no delay causes the worker thread to run immediately.  Delayed
+ *   work causes the worker thread to sleep until the work is due.
+ *
  * Input parameters:
+ *   qid    - The work queue ID (LPWORK or HPWORK)
  *   work   - The work structure to queue
  *   worker - The worker callback to be invoked.  The callback will invoked
  *            on the worker thread of execution.
@@ -122,7 +159,8 @@ EXTERN pid_t g_worker;
  *
  ****************************************************************************/
 
-EXTERN int work_queue(struct work_s *work, worker_t worker, FAR void *arg, uint32_t delay);
+EXTERN int work_queue(int qid, FAR struct work_s *work, worker_t worker,
+                      FAR void *arg, uint32_t delay);
 
 /****************************************************************************
  * Name: work_cancel
@@ -133,6 +171,7 @@ EXTERN int work_queue(struct work_s *work, worker_t worker, FAR void *arg, uint3
  *   again.
  *
  * Input parameters:
+ *   qid    - The work queue ID that the work was queued on
  *   work   - The previously queue work structure to cancel
  *
  * Returned Value:
@@ -140,7 +179,7 @@ EXTERN int work_queue(struct work_s *work, worker_t worker, FAR void *arg, uint3
  *
  ****************************************************************************/
 
-EXTERN int work_cancel(struct work_s *work);
+EXTERN int work_cancel(int qid, FAR struct work_s *work);
 
 /****************************************************************************
  * Name: work_signal
@@ -151,14 +190,35 @@ EXTERN int work_cancel(struct work_s *work);
  *   user to force an immediate re-assessment of pending work.
  *
  * Input parameters:
- *   None
+ *   qid    - The work queue ID
  *
  * Returned Value:
  *   Zero on success, a negated errno on failure
  *
  ****************************************************************************/
 
-#define work_signal() kill(g_worker, SIGWORK)
+EXTERN int work_signal(int qid);
+
+/****************************************************************************
+ * Name: work_stats
+ *
+ * Description:
+ *   Return a copy of the latency statistics for a work queue and optionally
+ *   reset them.
+ *
+ * Input parameters:
+ *   qid    - The work queue ID
+ *   stats  - The location to return the statistics
+ *   reset  - Non-zero: Clear the statistics after they have been copied
+ *
+ * Returned Value:
+ *   Zero on success, a negated errno on failure
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_WORKSTATS
+EXTERN int work_stats(int qid, FAR struct work_stats_s *stats, int reset);
+#endif
 
 #undef EXTERN
 #ifdef __cplusplus
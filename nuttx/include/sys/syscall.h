@@ -104,9 +104,16 @@
 
 #ifdef CONFIG_SCHED_WAITPID
 #  define SYS_waitpid                  __SYS_waitpaid
-#  define __SYS_signals               (__SYS_waitpaid+1)
+#  define __SYS_cpuload               (__SYS_waitpaid+1)
 #else
-#  define __SYS_signals                __SYS_waitpaid
+#  define __SYS_cpuload                __SYS_waitpaid
+#endif
+
+#ifdef CONFIG_SCHED_CPULOAD
+#  define SYS_sched_cpuload            __SYS_cpuload
+#  define __SYS_signals               (__SYS_cpuload+1)
+#else
+#  define __SYS_signals                __SYS_cpuload
 #endif
 
 /* The following are only defined is signals are supported in the NuttX
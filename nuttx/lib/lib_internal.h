@@ -43,6 +43,7 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <limits.h>
@@ -91,10 +92,50 @@
 
 #define LIB_BUFLEN_UNKNOWN INT_MAX
 
+/* The generic string functions in lib/string operate on whole machine words
+ * (lib_word_t) when the buffers are suitably aligned.  Words are only
+ * accessed at aligned addresses so that this is safe on architectures that
+ * do not support unaligned accesses.
+ */
+
+#define LIB_WORDSIZE       (sizeof(lib_word_t))
+#define LIB_WORDMASK       (LIB_WORDSIZE - 1)
+
+/* True if the pointer is word aligned */
+
+#define LIB_ALIGNED(p)     (((uintptr_t)(p) & LIB_WORDMASK) == 0)
+
+/* True if both pointers have the same offset from a word boundary.  Then
+ * both will become aligned after the same number of byte accesses.
+ */
+
+#define LIB_COALIGNED(a,b) ((((uintptr_t)(a) ^ (uintptr_t)(b)) & LIB_WORDMASK) == 0)
+
+/* LIB_ONES has 0x01 in every byte of a word and LIB_HIGHS has 0x80 in every
+ * byte.  LIB_HASZERO(w) is non-zero if any byte of the word w is zero:
+ * Subtracting one from a zero byte borrows into its high bit, and the
+ * "& ~(w)" discards bytes whose high bits were already set.  Multiplying a
+ * byte value by LIB_ONES replicates it into every byte of a word so that
+ * LIB_HASZERO(w ^ LIB_REPLICATE(c)) finds bytes equal to c.
+ *
+ * Aligned word reads may access up to LIB_WORDSIZE-1 bytes beyond the end
+ * of a string.  These bytes always lie in the same word (and hence the
+ * same memory page or MPU region) as the NUL terminator.
+ */
+
+#define LIB_ONES           ((lib_word_t)-1 / 0xff)
+#define LIB_HIGHS          (LIB_ONES << 7)
+#define LIB_HASZERO(w)     (((w) - LIB_ONES) & ~(w) & LIB_HIGHS)
+#define LIB_REPLICATE(c)   ((lib_word_t)((unsigned char)(c)) * LIB_ONES)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
+/* The native machine word used by the generic string functions */
+
+typedef uintptr_t lib_word_t;
+
 /****************************************************************************
  * Public Variables
  ****************************************************************************/
@@ -187,6 +228,11 @@ extern void lib_skipspace(const char **pptr);
 
 extern bool lib_isbasedigit(int ch, int base, int *value);
 
+/* Defined in lib_strsearch.c */
+
+extern FAR char *lib_strsearch(FAR const char *str, FAR const char *substr,
+                               bool nocase);
+
 /* Defined in lib_checkbase.c */
 
 extern int lib_checkbase(int base, const char **pptr);
@@ -1388,7 +1388,7 @@ int lib_vsprintf(FAR struct lib_outstream_s *obj, FAR const char *src, va_list a
 
       /* Handle integer conversions */
 
-      if (strchr("diuxXpob", FMT_CHAR))
+      if (FMT_CHAR && strchr("diuxXpob", FMT_CHAR))
         {
 #ifdef CONFIG_HAVE_LONG_LONG
           if (IS_LONGLONGPRECISION(flags) && FMT_CHAR != 'p')
@@ -1547,7 +1547,7 @@ int lib_vsprintf(FAR struct lib_outstream_s *obj, FAR const char *src, va_list a
       /* Handle floating point conversions */
 
 #ifdef CONFIG_LIBC_FLOATINGPOINT
-      else if (strchr("eEfgG", FMT_CHAR))
+      else if (FMT_CHAR && strchr("eEfgG", FMT_CHAR))
         {
           double dblval = va_arg(ap, double);
 
@@ -214,7 +214,7 @@ int vsscanf(char *buf, const char *s, va_list ap)
 
           /* Process %d, %o, %b, %x, %u:  Various integer conversions */
 
-          else if (strchr("dobxu", *s))
+          else if (*s && strchr("dobxu", *s))
             {
               lvdbg("vsscanf: Performing integer conversion\n");
 
@@ -1,7 +1,7 @@
 /************************************************************
  * lib/string/lib_memcmp.c
  *
- *   Copyright (C) 2007, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -45,6 +45,8 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /************************************************************
  * Global Functions
  ************************************************************/
@@ -55,6 +57,42 @@ int memcmp(const void *s1, const void *s2, size_t n)
   unsigned char *p1 = (unsigned char *)s1;
   unsigned char *p2 = (unsigned char *)s2;
 
+  /* If both buffers have the same alignment, skip over the leading, equal
+   * words.  The first word that differs (if any) is then examined a byte
+   * at a time below.
+   */
+
+  if (n >= 2*LIB_WORDSIZE && LIB_COALIGNED(p1, p2))
+    {
+      lib_word_t *w1;
+      lib_word_t *w2;
+
+      while (!LIB_ALIGNED(p1))
+        {
+          if (*p1 != *p2)
+            {
+              return *p1 < *p2 ? -1 : 1;
+            }
+
+          p1++;
+          p2++;
+          n--;
+        }
+
+      w1 = (lib_word_t *)p1;
+      w2 = (lib_word_t *)p2;
+
+      while (n >= LIB_WORDSIZE && *w1 == *w2)
+        {
+          w1++;
+          w2++;
+          n -= LIB_WORDSIZE;
+        }
+
+      p1 = (unsigned char *)w1;
+      p2 = (unsigned char *)w2;
+    }
+
   while (n-- > 0)
     {
       if (*p1 < *p2)
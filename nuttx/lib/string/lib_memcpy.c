@@ -1,7 +1,7 @@
 /************************************************************
  * lib/string/lib_memcpy.c
  *
- *   Copyright (C) 2007, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -45,6 +45,8 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /************************************************************
  * Global Functions
  ************************************************************/
@@ -52,8 +54,57 @@
 #ifndef CONFIG_ARCH_MEMCPY
 void *memcpy(void *dest, const void *src, size_t n)
 {
-  unsigned char *pout = (unsigned char*)dest;
-  unsigned char *pin  = (unsigned char*)src;
+  unsigned char       *pout = (unsigned char*)dest;
+  const unsigned char *pin  = (const unsigned char*)src;
+
+  /* Words can be copied only if the source and destination have the same
+   * alignment.  Otherwise, every word access to one of them would be
+   * unaligned.
+   */
+
+  if (n >= 2*LIB_WORDSIZE && LIB_COALIGNED(pout, pin))
+    {
+      lib_word_t       *wout;
+      const lib_word_t *win;
+
+      /* Copy bytes until the destination (and source) are word aligned */
+
+      while (!LIB_ALIGNED(pout))
+        {
+          *pout++ = *pin++;
+          n--;
+        }
+
+      wout = (lib_word_t*)pout;
+      win  = (const lib_word_t*)pin;
+
+      /* Copy four words at a time ... */
+
+      while (n >= 4*LIB_WORDSIZE)
+        {
+          wout[0] = win[0];
+          wout[1] = win[1];
+          wout[2] = win[2];
+          wout[3] = win[3];
+          wout   += 4;
+          win    += 4;
+          n      -= 4*LIB_WORDSIZE;
+        }
+
+      /* ... then one word at a time */
+
+      while (n >= LIB_WORDSIZE)
+        {
+          *wout++ = *win++;
+          n      -= LIB_WORDSIZE;
+        }
+
+      pout = (unsigned char*)wout;
+      pin  = (const unsigned char*)win;
+    }
+
+  /* Copy the trailing bytes (or everything if unaligned) */
+
   while (n-- > 0) *pout++ = *pin++;
   return dest;
 }
@@ -1,7 +1,7 @@
 /************************************************************
  * lib/string/lib_memmove.c
  *
- *   Copyright (C) 2007, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -45,6 +45,8 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /************************************************************
  * Global Functions
  ************************************************************/
@@ -52,18 +54,106 @@
 #ifndef CONFIG_ARCH_MEMMOVE
 void *memmove(void *dest, const void *src, size_t count)
 {
-  char *tmp, *s;
+  char       *tmp;
+  const char *s;
+  bool        words;
+
+  /* Words can be moved only if the source and destination have the same
+   * alignment.
+   */
+
+  words = (count >= 2*LIB_WORDSIZE && LIB_COALIGNED(dest, src));
+
   if (dest <= src)
     {
+      /* Copy forward, from the beginning of the buffers */
+
       tmp = (char*) dest;
-      s = (char*) src;
+      s = (const char*) src;
+
+      if (words)
+        {
+          lib_word_t       *wtmp;
+          const lib_word_t *ws;
+
+          while (!LIB_ALIGNED(tmp))
+            {
+              *tmp++ = *s++;
+              count--;
+            }
+
+          wtmp = (lib_word_t*)tmp;
+          ws   = (const lib_word_t*)s;
+
+          while (count >= 4*LIB_WORDSIZE)
+            {
+              wtmp[0] = ws[0];
+              wtmp[1] = ws[1];
+              wtmp[2] = ws[2];
+              wtmp[3] = ws[3];
+              wtmp   += 4;
+              ws     += 4;
+              count  -= 4*LIB_WORDSIZE;
+            }
+
+          while (count >= LIB_WORDSIZE)
+            {
+              *wtmp++ = *ws++;
+              count  -= LIB_WORDSIZE;
+            }
+
+          tmp = (char*)wtmp;
+          s   = (const char*)ws;
+        }
+
       while (count--)
 	*tmp++ = *s++;
     }
   else
     {
+      /* Copy backward, from the end of the buffers.  Each word is read
+       * before any overlapping destination word is written so this is
+       * safe for any overlap.
+       */
+
       tmp = (char*) dest + count;
-      s = (char*) src + count;
+      s = (const char*) src + count;
+
+      if (words)
+        {
+          lib_word_t       *wtmp;
+          const lib_word_t *ws;
+
+          while (!LIB_ALIGNED(tmp))
+            {
+              *--tmp = *--s;
+              count--;
+            }
+
+          wtmp = (lib_word_t*)tmp;
+          ws   = (const lib_word_t*)s;
+
+          while (count >= 4*LIB_WORDSIZE)
+            {
+              wtmp   -= 4;
+              ws     -= 4;
+              wtmp[3] = ws[3];
+              wtmp[2] = ws[2];
+              wtmp[1] = ws[1];
+              wtmp[0] = ws[0];
+              count  -= 4*LIB_WORDSIZE;
+            }
+
+          while (count >= LIB_WORDSIZE)
+            {
+              *--wtmp = *--ws;
+              count  -= LIB_WORDSIZE;
+            }
+
+          tmp = (char*)wtmp;
+          s   = (const char*)ws;
+        }
+
       while (count--)
 	*--tmp = *--s;
     }
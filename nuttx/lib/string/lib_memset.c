@@ -1,7 +1,7 @@
 /************************************************************
  * lib/string/lib_memset.c
  *
- *   Copyright (C) 2007, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -45,6 +45,8 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /************************************************************
  * Global Functions
  ************************************************************/
@@ -53,6 +55,50 @@
 void *memset(void *s, int c, size_t n)
 {
   unsigned char *p = (unsigned char*)s;
+
+  if (n >= 2*LIB_WORDSIZE)
+    {
+      lib_word_t *wp;
+      lib_word_t  val;
+
+      /* Set bytes until the pointer is word aligned */
+
+      while (!LIB_ALIGNED(p))
+        {
+          *p++ = c;
+          n--;
+        }
+
+      /* Replicate the byte value into every byte of a word */
+
+      val = LIB_REPLICATE(c);
+      wp  = (lib_word_t*)p;
+
+      /* Set four words at a time ... */
+
+      while (n >= 4*LIB_WORDSIZE)
+        {
+          wp[0] = val;
+          wp[1] = val;
+          wp[2] = val;
+          wp[3] = val;
+          wp   += 4;
+          n    -= 4*LIB_WORDSIZE;
+        }
+
+      /* ... then one word at a time */
+
+      while (n >= LIB_WORDSIZE)
+        {
+          *wp++ = val;
+          n    -= LIB_WORDSIZE;
+        }
+
+      p = (unsigned char*)wp;
+    }
+
+  /* Set the trailing bytes */
+
   while (n-- > 0) *p++ = c;
   return s;
 }
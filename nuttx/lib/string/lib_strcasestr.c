@@ -1,5 +1,5 @@
 /****************************************************************************
- * lib/string/lib_strstr.c
+ * lib/string/lib_strcasestr.c
  *
  *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
@@ -39,31 +39,10 @@
 
 #include <nuttx/config.h>
 
+#include <stdbool.h>
 #include <string.h>
-#include <ctype.h>
 
-/****************************************************************************
- * Private Functions
- ****************************************************************************/
-
-static FAR char *strcasechr(FAR const char *s, int uc)
-{
-  register char ch;
-
-  if (s)
-    {
-      for (; *s; s++)
-        {
-          ch = *s;
-          if (toupper(ch) == uc)
-            {
-              return (FAR char*)s;
-            }
-        }
-    }
-
-  return NULL;
-}
+#include "lib_internal.h"
 
 /****************************************************************************
  * Global Functions
@@ -71,64 +50,5 @@ static FAR char *strcasechr(FAR const char *s, int uc)
 
 FAR char *strcasestr(FAR const char *str, FAR const char *substr)
 {
-  const char *candidate;  /* Candidate in str with matching start character */
-  char         ch;        /* First character of the substring */
-  int          len;       /* The length of the substring */
-
-  /* Special case the empty substring */
-
-  len = strlen(substr);
-  ch  = *substr;
-
-  if (!ch)
-    {
-      /* We'll say that an empty substring matches at the beginning of
-       * the string
-       */
-
-      return (char*)str;
-    }
-
-  /* Search for the substring */
-
-  candidate = str;
-  ch        = toupper(ch);
-
-  for (;;)
-    {
-      /* strcasechr() will return a pointer to the next occurrence of the
-       * character ch in the string (ignoring case)
-       */
-
-      candidate = strcasechr(candidate, ch);
-      if (!candidate || strlen(candidate) < len)
-        {
-           /* First character of the substring does not appear in the string
-            * or the remainder of the string is not long enough to contain the
-            * substring.
-            */
-
-           return NULL;
-        }
-
-      /* Check if this is the beginning of a matching substring (ignoring case) */
-
-      if (strncasecmp(candidate, substr, len) == 0)
-        {
-           /* Yes.. return the pointer to the first occurrence of the matching
-            * substring.
-            */
-
-           return (char*)candidate;
-        }
-
-      /* No, find the next candidate after this one */
-
-      candidate++;
-    }
-
-  /* Won't get here, but some compilers might complain */
-
-  return NULL;
+  return lib_strsearch(str, substr, true);
 }
-
@@ -1,7 +1,7 @@
 /****************************************************************************
  * lib/string/lib_strchr.c
  *
- *   Copyright (C) 2007, 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -41,27 +41,68 @@
 
 #include <string.h>
 
+#include "lib_internal.h"
+
 /****************************************************************************
  * Global Functions
  ****************************************************************************/
 
 /* The strchr() function returns a pointer to the first
- * occurrence of the character c in the string s.
+ * occurrence of the character c in the string s.  The NUL
+ * terminator is considered part of the string.
  */
 
 char *strchr(const char *s, int c)
 {
+  const lib_word_t *ws;
+  lib_word_t        mask;
+  lib_word_t        w;
+  char              ch = (char)c;
+
   if (s)
     {
-      for (; *s; s++)
+      /* Examine bytes until the pointer is word aligned */
+
+      for (; !LIB_ALIGNED(s); s++)
         {
-          if (*s == c)
+          if (*s == ch)
             {
               return (char*)s;
             }
+          else if (*s == '\0')
+            {
+              return NULL;
+            }
+        }
+
+      /* Skip whole words that contain neither the character nor the NUL
+       * terminator.
+       */
+
+      mask = LIB_REPLICATE(ch);
+      for (ws = (const lib_word_t*)s; ; ws++)
+        {
+          w = *ws;
+          if (LIB_HASZERO(w) || LIB_HASZERO(w ^ mask))
+            {
+              break;
+            }
+        }
+
+      /* Then find which one it was */
+
+      for (s = (const char*)ws; ; s++)
+        {
+          if (*s == ch)
+            {
+              return (char*)s;
+            }
+          else if (*s == '\0')
+            {
+              break;
+            }
         }
     }
 
   return NULL;
 }
-
@@ -1,7 +1,7 @@
 /****************************************************************************
  * lib/string/lib_strcmp.c
  *
- *   Copyright (C) 2007-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -41,6 +41,8 @@
 
 #include <string.h>
 
+#include "lib_internal.h"
+
 /****************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -48,10 +50,42 @@
 #ifndef CONFIG_ARCH_STRCMP
 int strcmp(const char *cs, const char *ct)
 {
-  register signed char result;
+  register int result;
+
+  /* If both strings have the same alignment, skip over the leading, equal
+   * words.
+   */
+
+  if (LIB_COALIGNED(cs, ct))
+    {
+      while (!LIB_ALIGNED(cs) && *cs == *ct && *cs != '\0')
+        {
+          cs++;
+          ct++;
+        }
+
+      if (LIB_ALIGNED(cs))
+        {
+          const lib_word_t *wcs = (const lib_word_t*)cs;
+          const lib_word_t *wct = (const lib_word_t*)ct;
+
+          while (*wcs == *wct && !LIB_HASZERO(*wcs))
+            {
+              wcs++;
+              wct++;
+            }
+
+          cs = (const char*)wcs;
+          ct = (const char*)wct;
+        }
+    }
+
+  /* Then find the difference (or the terminator) a byte at a time */
+
   for (;;)
     {
-      if ((result = *cs - *ct++) != 0 || !*cs++)
+      if ((result = (int)*(const unsigned char*)cs -
+                    (int)*(const unsigned char*)ct++) != 0 || !*cs++)
 	break;
     }
   return result;
@@ -1,7 +1,7 @@
 /************************************************************************
  * lib/string/lib_strcpy.c
  *
- *   Copyright (C) 2007, 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -41,6 +41,8 @@
 
 #include <string.h>
 
+#include "lib_internal.h"
+
 /************************************************************************
  * Global Functions
  ************************************************************************/
@@ -49,6 +51,42 @@
 char *strcpy(char *dest, const char *src)
 {
   char *tmp = dest;
+
+  /* Words can be copied only if the source and destination have the same
+   * alignment.
+   */
+
+  if (LIB_COALIGNED(dest, src))
+    {
+      lib_word_t       *wdest;
+      const lib_word_t *wsrc;
+
+      /* Copy bytes until the pointers are word aligned */
+
+      for (; !LIB_ALIGNED(src); )
+        {
+          if ((*dest++ = *src++) == '\0')
+            {
+              return tmp;
+            }
+        }
+
+      /* Copy whole words that do not contain the NUL terminator */
+
+      wdest = (lib_word_t*)dest;
+      wsrc  = (const lib_word_t*)src;
+
+      while (!LIB_HASZERO(*wsrc))
+        {
+          *wdest++ = *wsrc++;
+        }
+
+      dest = (char*)wdest;
+      src  = (const char*)wsrc;
+    }
+
+  /* Copy the remaining bytes, including the terminator */
+
   while ((*dest++ = *src++) != '\0');
   return tmp;
 }
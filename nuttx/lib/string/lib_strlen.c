@@ -1,7 +1,7 @@
 /****************************************************************************
  * lib/string/lib_strlen.c
  *
- *   Copyright (C) 2007, 2008, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2008, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -41,6 +41,8 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /****************************************************************************
  * Global Functions
  ****************************************************************************/
@@ -48,8 +50,26 @@
 #ifndef CONFIG_ARCH_STRLEN
 size_t strlen(const char *s)
 {
-  const char *sc;
-  for (sc = s; *sc != '\0'; ++sc);
+  const char       *sc;
+  const lib_word_t *ws;
+
+  /* Examine bytes until the pointer is word aligned */
+
+  for (sc = s; !LIB_ALIGNED(sc); ++sc)
+    {
+      if (*sc == '\0')
+        {
+          return sc - s;
+        }
+    }
+
+  /* Then skip whole words until one contains the NUL terminator */
+
+  for (ws = (const lib_word_t*)sc; !LIB_HASZERO(*ws); ++ws);
+
+  /* And find the terminator within that word */
+
+  for (sc = (const char*)ws; *sc != '\0'; ++sc);
   return sc - s;
 }
 #endif
@@ -1,7 +1,7 @@
 /****************************************************************************
  * lib/lib_strncmp.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -45,6 +45,8 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /****************************************************************************
  * Global Functions
  *****************************************************************************/
@@ -53,9 +55,43 @@
 int strncmp(const char *cs, const char *ct, size_t nb)
 {
   int result = 0;
+
+  /* If both strings have the same alignment, skip over the leading, equal
+   * words.
+   */
+
+  if (LIB_COALIGNED(cs, ct))
+    {
+      while (nb > 0 && !LIB_ALIGNED(cs) && *cs == *ct && *cs != '\0')
+        {
+          cs++;
+          ct++;
+          nb--;
+        }
+
+      if (LIB_ALIGNED(cs))
+        {
+          const lib_word_t *wcs = (const lib_word_t*)cs;
+          const lib_word_t *wct = (const lib_word_t*)ct;
+
+          while (nb >= LIB_WORDSIZE && *wcs == *wct && !LIB_HASZERO(*wcs))
+            {
+              wcs++;
+              wct++;
+              nb -= LIB_WORDSIZE;
+            }
+
+          cs = (const char*)wcs;
+          ct = (const char*)wct;
+        }
+    }
+
+  /* Then find the difference (or the terminator) a byte at a time */
+
   for (; nb > 0; nb--)
     {
-      if ((result = (int)*cs - (int)*ct++) != 0 || !*cs++)
+      if ((result = (int)*(const unsigned char*)cs -
+                    (int)*(const unsigned char*)ct++) != 0 || !*cs++)
         {
           break;
         }
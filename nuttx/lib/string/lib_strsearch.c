@@ -0,0 +1,184 @@
+/****************************************************************************
+ * lib/string/lib_strsearch.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "lib_internal.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Entries in the shift table are bytes.  Shifts for substrings longer than
+ * this are clipped.  That is safe:  It only means that the search advances
+ * more slowly than it could.
+ */
+
+#define MAX_SHIFT 255
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline unsigned char lib_fold(unsigned char ch, bool nocase)
+{
+  return nocase ? (unsigned char)tolower(ch) : ch;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: lib_strsearch
+ *
+ * Description:
+ *   Find the first occurrence of 'substr' in 'str' (ignoring case if
+ *   'nocase' is true) using the Boyer-Moore-Horspool algorithm.  This is
+ *   the common logic of strstr() and strcasestr().
+ *
+ *   The candidate position is advanced by the distance from the last
+ *   occurrence (in all but the final character of the substring) of the
+ *   character under the end of the substring.  On typical text, this
+ *   skips most positions rather than examining every one of them.
+ *
+ *   A 256 byte shift table is allocated on the stack.
+ *
+ ****************************************************************************/
+
+FAR char *lib_strsearch(FAR const char *str, FAR const char *substr,
+                        bool nocase)
+{
+  FAR const unsigned char *hay = (FAR const unsigned char *)str;
+  FAR const unsigned char *pat = (FAR const unsigned char *)substr;
+  uint8_t shift[256];
+  size_t  slen;
+  size_t  len;
+  size_t  last;
+  size_t  pos;
+  size_t  i;
+
+  /* We'll say that an empty substring matches at the beginning of the
+   * string
+   */
+
+  len = strlen(substr);
+  if (len == 0)
+    {
+      return (FAR char *)str;
+    }
+
+  /* Skip to the first occurrence of the first character of the substring.
+   * This quickly disposes of strings that do not contain it at all (and
+   * finds single character substrings).
+   */
+
+  if (nocase)
+    {
+      unsigned char first = lib_fold(pat[0], true);
+
+      while (*hay != '\0' && lib_fold(*hay, true) != first)
+        {
+          hay++;
+        }
+
+      if (*hay == '\0')
+        {
+          return NULL;
+        }
+    }
+  else
+    {
+      hay = (FAR const unsigned char *)strchr(str, *substr);
+      if (!hay)
+        {
+          return NULL;
+        }
+    }
+
+  if (len == 1)
+    {
+      return (FAR char *)hay;
+    }
+
+  slen = strlen((FAR const char *)hay);
+  if (slen < len)
+    {
+      return NULL;
+    }
+
+  /* Build the shift table.  A character that does not appear in the
+   * substring (before its final character) shifts the whole length of the
+   * substring.
+   */
+
+  last = len - 1;
+  memset(shift, len > MAX_SHIFT ? MAX_SHIFT : len, sizeof(shift));
+
+  for (i = 0; i < last; i++)
+    {
+      size_t distance = last - i;
+      shift[lib_fold(pat[i], nocase)] =
+        distance > MAX_SHIFT ? MAX_SHIFT : distance;
+    }
+
+  /* Search.  Compare each candidate from its last character backward */
+
+  for (pos = 0; pos <= slen - len;
+       pos += shift[lib_fold(hay[pos + last], nocase)])
+    {
+      i = last;
+      while (lib_fold(hay[pos + i], nocase) == lib_fold(pat[i], nocase))
+        {
+          if (i == 0)
+            {
+              return (FAR char *)&hay[pos];
+            }
+
+          i--;
+        }
+    }
+
+  return NULL;
+}
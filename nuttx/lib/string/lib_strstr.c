@@ -1,7 +1,7 @@
 /****************************************************************************
  * lib/string/lib_strstr.c
  *
- *   Copyright (C) 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use str source and binary forms, with or without
@@ -39,66 +39,16 @@
 
 #include <nuttx/config.h>
 
+#include <stdbool.h>
 #include <string.h>
 
+#include "lib_internal.h"
+
 /****************************************************************************
  * Global Functions
  ****************************************************************************/
 
 char *strstr(const char *str, const char *substr)
 {
-  const char *candidate;  /* Candidate in str with matching start character */
-  char         ch;        /* First character of the substring */
-  int          len;       /* The length of the substring */
-
-  /* Special case the empty substring */
-
-  len = strlen(substr);
-  ch  = *substr;
-
-  if (!ch)
-    {
-      /* We'll say that an empty substring matches at the beginning of
-       * the string
-       */
-
-      return (char*)str;
-    }
-
-  /* Search for the substring */
-
-  candidate = str;
-  for (;;)
-    {
-      /* strchr() will return a pointer to the next occurrence of the
-       * character ch in the string
-       */
-
-      candidate = strchr(candidate, ch);
-      if (!candidate || strlen(candidate) < len)
-        {
-           /* First character of the substring does not appear in the string
-            * or the remainder of the string is not long enough to contain the
-            * substring.
-            */
-
-           return NULL;
-        }
-
-      /* Check if this is the beginning of a matching substring */
-
-      if (strncmp(candidate, substr, len) == 0)
-        {
-           return (char*)candidate;
-        }
-
-      /* No, find the next candidate after this one */
-
-      candidate++;
-    }
-
-  /* Won't get here, but some compilers might complain */
-
-  return NULL;
+  return lib_strsearch(str, substr, false);
 }
-
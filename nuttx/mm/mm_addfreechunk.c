@@ -70,11 +70,24 @@ void mm_addfreechunk(FAR struct mm_freenode_s *node)
 
   int ndx = mm_size2ndx(node->size);
 
+#ifdef CONFIG_MM_TLSF
+  /* Every chunk in a TLSF list is interchangeable so there is no need to
+   * keep the list ordered:  Just put the new node at the head of the list
+   * and mark the list as non-empty.
+   */
+
+  prev = &g_nodelist[ndx];
+  next = prev->flink;
+
+  g_slbitmap[ndx >> MM_SL_SHIFT] |= (uint32_t)1 << (ndx & (MM_NSLISTS - 1));
+  g_flbitmap                     |= (uint32_t)1 << (ndx >> MM_SL_SHIFT);
+#else
   /* Now put the new node int the next */
 
   for (prev = &g_nodelist[ndx], next = g_nodelist[ndx].flink;
        next && next->size && next->size < node->size;
        prev = next, next = next->flink);
+#endif
 
   /* Does it go in mid next or at the end? */
 
@@ -0,0 +1,95 @@
+/************************************************************************
+ * mm/mm_delfreechunk.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <assert.h>
+#include "mm_environment.h"
+#include "mm_internal.h"
+
+/************************************************************************
+ * Pre-processor Definitions
+ ************************************************************************/
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Global Functions
+ ************************************************************************/
+
+/************************************************************************
+ * mm_delfreechunk
+ *
+ * Description:
+ *   Remove a free chunk from the free list that it is a member of.
+ *   There must be a predecessor, but there may not be a successor node.
+ *   This must be called before the size of the chunk is modified.  It is
+ *   assumed that the caller holds the mm semaphore
+ *
+ ************************************************************************/
+
+void mm_delfreechunk(FAR struct mm_freenode_s *node)
+{
+  FAR struct mm_freenode_s *prev = node->blink;
+
+  DEBUGASSERT(prev);
+  prev->flink = node->flink;
+  if (node->flink)
+    {
+      node->flink->blink = prev;
+    }
+
+#ifdef CONFIG_MM_TLSF
+  /* If the predecessor is a list head and there is no successor, then
+   * the node was the last member of its list and the list is now empty.
+   */
+
+  if (!prev->flink && prev >= g_nodelist && prev < &g_nodelist[MM_NLISTS])
+    {
+      int ndx = prev - g_nodelist;
+      int fl  = ndx >> MM_SL_SHIFT;
+
+      g_slbitmap[fl] &= ~((uint32_t)1 << (ndx & (MM_NSLISTS - 1)));
+      if (!g_slbitmap[fl])
+        {
+          g_flbitmap &= ~((uint32_t)1 << fl);
+        }
+    }
+#endif
+}
@@ -57,6 +57,8 @@
 # include <nuttx/mm.h>
 #else
 # include <sys/types.h>
+# include <stdint.h>
+# include <stdio.h>
 # include <string.h>
 # include <assert.h>
 #endif
@@ -80,12 +82,28 @@
 # define CONFIG_CAN_PASS_STRUCTS 1  /* Normally in config.h */
 # undef  CONFIG_SMALL_MEMORY        /* Normally in config.h */
 
+extern void mm_initialize(FAR void *heapstart, size_t heapsize);
 extern void mm_addregion(FAR void *heapstart, size_t heapsize);
 
 /* Use the real system errno */
 
 # define mm_errno errno
 
+/* There are no interrupts in the host test environment */
+
+typedef unsigned int irqstate_t;
+
+# define irqsave()              (0)
+# define irqrestore(f)          ((void)(f))
+# define up_interrupt_context() (0)
+
+# ifndef OK
+#   define OK 0
+# endif
+# ifndef ERROR
+#   define ERROR -1
+# endif
+
 /* When built for the test harness, we change the names of the
  * exported functions so that they do not collide with the
  * host libc names.
@@ -105,14 +123,21 @@ extern void mm_addregion(FAR void *heapstart, size_t heapsize);
 # undef DEBUGASSERT
 # define DEBUGASSERT(e) assert(e)
 
-/* Debug macros are always on */
+/* Debug macros are always on (but verbose output may be suppressed at
+ * run time by the test harness when it is measuring timing).
+ */
 
 # define CONFIG_DEBUG
 
+extern int g_mmverbose;
+
 # undef mdbg
 # define mdbg(format, arg...) printf(format, ##arg)
+# undef mlldbg
+# define mlldbg(format, arg...) printf(format, ##arg)
 # undef mvdg
-# define mvdbg(format, arg...) printf(format, ##arg)
+# define mvdbg(format, arg...) \
+  do { if (g_mmverbose) printf(format, ##arg); } while (0)
 
 #else
 # define mm_errno get_errno()
@@ -0,0 +1,211 @@
+/************************************************************************
+ * mm/mm_findfreechunk.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <assert.h>
+#include "mm_environment.h"
+#include "mm_internal.h"
+
+#ifdef CONFIG_MM_TLSF
+
+/************************************************************************
+ * Pre-processor Definitions
+ ************************************************************************/
+
+#ifndef NULL
+#  define NULL ((void*)0)
+#endif
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * mm_ffs
+ *
+ * Description:
+ *   Return the index of the least significant bit set in the non-zero
+ *   bitmap 'map' using a fixed number of steps.
+ *
+ ************************************************************************/
+
+static inline int mm_ffs(uint32_t map)
+{
+  int ndx = 0;
+
+  if ((map & 0x0000ffff) == 0)
+    {
+      map >>= 16;
+      ndx  += 16;
+    }
+
+  if ((map & 0x000000ff) == 0)
+    {
+      map >>= 8;
+      ndx  += 8;
+    }
+
+  if ((map & 0x0000000f) == 0)
+    {
+      map >>= 4;
+      ndx  += 4;
+    }
+
+  if ((map & 0x00000003) == 0)
+    {
+      map >>= 2;
+      ndx  += 2;
+    }
+
+  if ((map & 0x00000001) == 0)
+    {
+      ndx  += 1;
+    }
+
+  return ndx;
+}
+
+/************************************************************************
+ * mm_searchlist
+ *
+ * Description:
+ *   Walk one free list and return the first chunk that is at least
+ *   'size' bytes in size.  This is only needed for the list of very
+ *   large (>= MM_MAX_CHUNK) chunks and when the heap is nearly
+ *   exhausted.
+ *
+ ************************************************************************/
+
+static FAR struct mm_freenode_s *mm_searchlist(int ndx, size_t size)
+{
+  FAR struct mm_freenode_s *node;
+
+  for (node = g_nodelist[ndx].flink;
+       node && node->size < size;
+       node = node->flink);
+
+  return node;
+}
+
+/************************************************************************
+ * Global Functions
+ ************************************************************************/
+
+/************************************************************************
+ * mm_findfreechunk
+ *
+ * Description:
+ *   Find a free chunk of at least 'size' bytes (which must include the
+ *   allocation overhead and be aligned to MM_MIN_CHUNK).  The chunk is
+ *   not removed from the free list.  It is assumed that the caller holds
+ *   the mm semaphore.
+ *
+ *   The request size is first rounded up to the next second level list
+ *   boundary so that every chunk in the selected list, or in any larger
+ *   list, is guaranteed to be big enough.  The smallest non-empty such
+ *   list is then found with two bitmap searches.
+ *
+ * Return Value:
+ *   The free chunk or NULL if no chunk of sufficient size is available.
+ *
+ ************************************************************************/
+
+FAR struct mm_freenode_s *mm_findfreechunk(size_t size)
+{
+  FAR struct mm_freenode_s *node;
+  uint32_t map;
+  int reqndx;
+  int ndx;
+  int fl;
+  int sl;
+
+  /* Very large requests are taken first-fit from the last list */
+
+  reqndx = mm_size2ndx(size);
+  if (reqndx == MM_NLISTS-1)
+    {
+      return mm_searchlist(reqndx, size);
+    }
+
+  /* Round the size up to the next second level list boundary.  Each
+   * second level list of first level class 'fl' spans
+   * 2**(fl + MM_MIN_SHIFT - MM_SL_SHIFT) bytes.
+   */
+
+  fl  = reqndx >> MM_SL_SHIFT;
+  ndx = mm_size2ndx(size + ((size_t)1 << (fl + MM_MIN_SHIFT - MM_SL_SHIFT)) - 1);
+
+  /* Look for a non-empty list at or above the rounded up list in the same
+   * first level class.
+   */
+
+  fl  = ndx >> MM_SL_SHIFT;
+  sl  = ndx & (MM_NSLISTS - 1);
+  map = g_slbitmap[fl] & ((uint32_t)0xffffffff << sl);
+
+  if (!map)
+    {
+      /* None.. look for the next larger, non-empty first level class */
+
+      map = 0;
+      if (fl + 1 < MM_NNODES)
+        {
+          map = g_flbitmap & ((uint32_t)0xffffffff << (fl + 1));
+        }
+
+      if (!map)
+        {
+          /* The rounding may have skipped over a chunk in the request's
+           * own list that is large enough.  Check that list before
+           * giving up.
+           */
+
+          return mm_searchlist(reqndx, size);
+        }
+
+      fl  = mm_ffs(map);
+      map = g_slbitmap[fl];
+    }
+
+  sl   = mm_ffs(map);
+  node = g_nodelist[(fl << MM_SL_SHIFT) + sl].flink;
+  DEBUGASSERT(node && node->size >= size);
+  return node;
+}
+
+#endif /* CONFIG_MM_TLSF */
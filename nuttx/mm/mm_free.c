@@ -41,48 +41,65 @@
 #include "mm_environment.h"
 #include "mm_internal.h"
 
+#ifdef MM_DELAYFREE
+#  ifndef MM_TEST
+#    include <arch/irq.h>
+#    include <nuttx/arch.h>
+#  endif
+#endif
+
 /************************************************************************
  * Pre-processor Definitions
  ************************************************************************/
 
 /************************************************************************
- * Private Functions
+ * Private Types
  ************************************************************************/
 
+#ifdef MM_DELAYFREE
+/* A chunk whose release has been deferred.  This structure overlays the
+ * user payload of the chunk which is always large enough to hold it.
+ */
+
+struct mm_delaynode_s
+{
+  FAR struct mm_delaynode_s *flink;
+};
+#endif
+
 /************************************************************************
- * Public Functions
+ * Private Data
  ************************************************************************/
 
+#ifdef MM_DELAYFREE
+/* This is a list of chunks that were freed from interrupt handlers or
+ * while another thread held the MM semaphore.  They are returned to the
+ * heap by the next holder of the semaphore (see mm_freedelayed()).
+ */
+
+static FAR struct mm_delaynode_s *g_delaylist;
+#endif
+
 /************************************************************************
- * free
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * mm_freechunk
  *
  * Description:
- *   Returns a chunk of memory into the list of free nodes,
- *   merging with adjacent free chunks if possible.
+ *   Return a chunk of memory into the list of free nodes, merging with
+ *   adjacent free chunks if possible.  The caller holds the MM
+ *   semaphore.
  *
  ************************************************************************/
 
-void free(FAR void *mem)
+static void mm_freechunk(FAR void *mem)
 {
   FAR struct mm_freenode_s *node;
   FAR struct mm_freenode_s *prev;
   FAR struct mm_freenode_s *next;
 
-  mvdbg("Freeing %p\n", mem);
-
-  /* Protect against attempts to free a NULL reference */
-
-  if (!mem)
-    {
-      return;
-    }
-
-  /* We need to hold the MM semaphore while we muck with the
-   * nodelist.
-   */
-
-  mm_takesemaphore();
-
   /* Map the memory chunk into a free node */
 
   node = (FAR struct mm_freenode_s *)((char*)mem - SIZEOF_MM_ALLOCNODE);
@@ -106,12 +123,7 @@ void free(FAR void *mem)
        * but there may not be a successor node.
        */
 
-      DEBUGASSERT(next->blink);
-      next->blink->flink = next->flink;
-      if (next->flink)
-        {
-          next->flink->blink = next->blink;
-        }
+      mm_delfreechunk(next);
 
       /* Then merge the two chunks */
 
@@ -131,12 +143,7 @@ void free(FAR void *mem)
        * not be a successor node.
        */
 
-      DEBUGASSERT(prev->blink);
-      prev->blink->flink = prev->flink;
-      if (prev->flink)
-        {
-          prev->flink->blink = prev->blink;
-        }
+      mm_delfreechunk(prev);
 
       /* Then merge the two chunks */
 
@@ -148,5 +155,119 @@ void free(FAR void *mem)
   /* Add the merged node to the nodelist */
 
   mm_addfreechunk(node);
+}
+
+/************************************************************************
+ * mm_delayfree
+ *
+ * Description:
+ *   Queue a chunk of memory to be freed later by the holder of the MM
+ *   semaphore.  Only interrupts are disabled so this may be called from
+ *   interrupt handlers.
+ *
+ ************************************************************************/
+
+#ifdef MM_DELAYFREE
+static void mm_delayfree(FAR void *mem)
+{
+  FAR struct mm_delaynode_s *delay = (FAR struct mm_delaynode_s *)mem;
+  irqstate_t flags;
+
+  flags        = irqsave();
+  delay->flink = g_delaylist;
+  g_delaylist  = delay;
+  irqrestore(flags);
+}
+#endif
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * mm_freedelayed
+ *
+ * Description:
+ *   Release all chunks whose free was deferred by mm_delayfree().  The
+ *   caller holds the MM semaphore.
+ *
+ ************************************************************************/
+
+#ifdef MM_DELAYFREE
+void mm_freedelayed(void)
+{
+  FAR struct mm_delaynode_s *delay;
+  irqstate_t flags;
+
+  /* Quick, unlocked check:  Usually there is nothing to do */
+
+  while (g_delaylist)
+    {
+      /* Detach the whole list with interrupts disabled */
+
+      flags       = irqsave();
+      delay       = g_delaylist;
+      g_delaylist = NULL;
+      irqrestore(flags);
+
+      /* Then free each chunk with interrupts enabled */
+
+      while (delay)
+        {
+          FAR struct mm_delaynode_s *next = delay->flink;
+          mm_freechunk(delay);
+          delay = next;
+        }
+    }
+}
+#endif
+
+/************************************************************************
+ * free
+ *
+ * Description:
+ *   Returns a chunk of memory into the list of free nodes,
+ *   merging with adjacent free chunks if possible.
+ *
+ *   If MM_DELAYFREE is defined, free() may also be called from interrupt
+ *   handlers:  If called from an interrupt handler
+ *   or if the semaphore is held by another thread, the chunk is queued
+ *   and released later by the holder of the semaphore.  free() never
+ *   waits.
+ *
+ ************************************************************************/
+
+void free(FAR void *mem)
+{
+  mvdbg("Freeing %p\n", mem);
+
+  /* Protect against attempts to free a NULL reference */
+
+  if (!mem)
+    {
+      return;
+    }
+
+#ifndef MM_DELAYFREE
+  /* With CONFIG_MM_IRQLOCK, the MM "semaphore" just disables interrupts
+   * and never waits.  In the kernel build, we may have to wait.
+   */
+
+  mm_takesemaphore();
+#else
+  /* We need to hold the MM semaphore while we muck with the nodelist.
+   * But we cannot wait for the semaphore from an interrupt handler and
+   * there is no reason for a task to wait for it either:  The current
+   * holder will release the chunk when it gives up the semaphore.
+   */
+
+  if (up_interrupt_context() || mm_trysemaphore() != OK)
+    {
+      mm_delayfree(mem);
+      return;
+    }
+#endif
+
+  mm_freechunk(mem);
   mm_givesemaphore();
 }
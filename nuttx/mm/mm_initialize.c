@@ -66,7 +66,14 @@ int g_nregions;
  * speed searches for free nodes.
  */
 
-FAR struct mm_freenode_s g_nodelist[MM_NNODES];
+FAR struct mm_freenode_s g_nodelist[MM_NLISTS];
+
+#ifdef CONFIG_MM_TLSF
+/* These bitmaps indicate which of the free lists are non-empty */
+
+uint32_t g_flbitmap;
+uint32_t g_slbitmap[MM_NNODES];
+#endif
 
 /****************************************************************************
  * Public Functions
@@ -92,7 +99,9 @@ FAR struct mm_freenode_s g_nodelist[MM_NNODES];
 
 void mm_initialize(FAR void *heapstart, size_t heapsize)
 {
+#ifndef CONFIG_MM_TLSF
   int i;
+#endif
 
   mlldbg("Heap: start=%p size=%u\n", heapstart, heapsize);
 
@@ -116,12 +125,19 @@ void mm_initialize(FAR void *heapstart, size_t heapsize)
 
   /* Initialize the node array */
 
-  memset(g_nodelist, 0, sizeof(struct mm_freenode_s) * MM_NNODES);
+  memset(g_nodelist, 0, sizeof(struct mm_freenode_s) * MM_NLISTS);
+#ifdef CONFIG_MM_TLSF
+  /* Each list head begins empty and unlinked from the others */
+
+  g_flbitmap = 0;
+  memset(g_slbitmap, 0, sizeof(uint32_t) * MM_NNODES);
+#else
   for (i = 1; i < MM_NNODES; i++)
     {
       g_nodelist[i-1].flink = &g_nodelist[i];
       g_nodelist[i].blink   = &g_nodelist[i-1];
     }
+#endif
 
   /* Initialize the malloc semaphore to one (to support one-at-
    * a-time access to private data sets).
@@ -81,6 +81,9 @@
 #ifdef CONFIG_MM_SMALL
 # define MM_MIN_SHIFT      4  /* 16 bytes */
 # define MM_MAX_SHIFT     15  /* 32 Kb */
+#elif defined(MM_TEST) && defined(__LP64__)
+# define MM_MIN_SHIFT      5  /* 32 bytes (64-bit host test harness) */
+# define MM_MAX_SHIFT     22  /*  4 Mb */
 #else
 # define MM_MIN_SHIFT      4  /* 16 bytes */
 # define MM_MAX_SHIFT     22  /*  4 Mb */
@@ -96,6 +99,56 @@
 #define MM_ALIGN_UP(a)   (((a) + MM_GRAN_MASK) & ~MM_GRAN_MASK)
 #define MM_ALIGN_DOWN(a) ((a) & ~MM_GRAN_MASK)
 
+/* Two-level segregated fit (TLSF) definitions.  If CONFIG_MM_TLSF is
+ * selected, then each of the MM_NNODES power-of-two size classes (the
+ * "first level") is further divided into MM_NSLISTS linearly spaced
+ * sub-classes (the "second level").  Each (first, second) pair has its
+ * own free list and one bit in a two-level bitmap that indicates whether
+ * that list is empty.  A suitable free chunk can then be found with a
+ * constant number of bit operations rather than by walking the free
+ * list.
+ *
+ * CONFIG_MM_TLSF_SLSHIFT - Log2 of the number of second level lists
+ *   per first level size class.  Default: 3 (8 lists per class).  Larger
+ *   values reduce internal fragmentation at the cost of more RAM for
+ *   list heads.  It may not exceed MM_MIN_SHIFT.
+ */
+
+#ifdef CONFIG_MM_TLSF
+#  ifndef CONFIG_MM_TLSF_SLSHIFT
+#    define CONFIG_MM_TLSF_SLSHIFT 3
+#  endif
+#  if CONFIG_MM_TLSF_SLSHIFT > MM_MIN_SHIFT
+#    error "CONFIG_MM_TLSF_SLSHIFT may not exceed MM_MIN_SHIFT"
+#  endif
+#  define MM_SL_SHIFT    CONFIG_MM_TLSF_SLSHIFT
+#  define MM_NSLISTS     (1 << MM_SL_SHIFT)
+#  define MM_NLISTS      (MM_NNODES * MM_NSLISTS)
+#else
+#  define MM_NLISTS      MM_NNODES
+#endif
+
+/* Heap locking.  Normally the heap is protected by a semaphore and free()
+ * queues chunks that it cannot release immediately (from interrupt
+ * handlers or when the semaphore is held by another thread).  The queue
+ * is protected by disabling interrupts.
+ *
+ * CONFIG_MM_IRQLOCK - Protect the heap by disabling interrupts instead of
+ *   with the semaphore.  No queue is needed in this case.
+ *
+ * In the kernel build, the heap lives in user space where interrupts
+ * cannot be disabled.  Then neither option is available and free() waits
+ * for the semaphore.
+ */
+
+#if defined(CONFIG_NUTTX_KERNEL) && !defined(__KERNEL__)
+#  ifdef CONFIG_MM_IRQLOCK
+#    error "CONFIG_MM_IRQLOCK cannot be used with CONFIG_NUTTX_KERNEL"
+#  endif
+#elif !defined(CONFIG_MM_IRQLOCK)
+#  define MM_DELAYFREE 1
+#endif
+
 /* An allocated chunk is distinguished from a free chunk by
  * bit 31 of the 'preceding' chunk size.  If set, then this is
  * an allocated chunk.
@@ -138,6 +191,8 @@ struct mm_allocnode_s
 
 #ifdef CONFIG_MM_SMALL
 # define SIZEOF_MM_ALLOCNODE   4
+#elif defined(MM_TEST) && defined(__LP64__)
+# define SIZEOF_MM_ALLOCNODE   16
 #else
 # define SIZEOF_MM_ALLOCNODE   8
 #endif
@@ -163,6 +218,8 @@ struct mm_freenode_s
 #  else
 #     define SIZEOF_MM_FREENODE 12
 #  endif
+#elif defined(MM_TEST) && defined(__LP64__)
+# define SIZEOF_MM_FREENODE     32
 #else
 # define SIZEOF_MM_FREENODE     16
 #endif
@@ -207,10 +264,21 @@ extern int g_nregions;
 
 /* All free nodes are maintained in a doubly linked list.  This
  * array provides some hooks into the list at various points to
- * speed searches for free nodes.
+ * speed searches for free nodes.  In the TLSF configuration, each
+ * entry is instead the head of a separate, NULL-terminated free list.
  */
 
-extern FAR struct mm_freenode_s g_nodelist[MM_NNODES];
+extern FAR struct mm_freenode_s g_nodelist[MM_NLISTS];
+
+#ifdef CONFIG_MM_TLSF
+/* Bit n of g_flbitmap is set if any of the second level lists of first
+ * level class n are non-empty.  Bit m of g_slbitmap[n] is set if the
+ * free list g_nodelist[n * MM_NSLISTS + m] is non-empty.
+ */
+
+extern uint32_t g_flbitmap;
+extern uint32_t g_slbitmap[MM_NNODES];
+#endif
 
 /************************************************************************
  * Public Function Prototypes
@@ -235,12 +303,20 @@ extern FAR struct mm_freenode_s g_nodelist[MM_NNODES];
 extern void       mm_shrinkchunk(FAR struct mm_allocnode_s *node,
                                  size_t size);
 extern void       mm_addfreechunk(FAR struct mm_freenode_s *node);
+extern void       mm_delfreechunk(FAR struct mm_freenode_s *node);
 extern int        mm_size2ndx(size_t size);
+#ifdef CONFIG_MM_TLSF
+extern FAR struct mm_freenode_s *mm_findfreechunk(size_t size);
+#endif
 extern void       mm_seminitialize(void);
 extern void       mm_takesemaphore(void);
 extern void       mm_givesemaphore(void);
 #ifdef MM_TEST
+ extern int       mm_trysemaphore(void);
  extern int       mm_getsemaphore(void);
 #endif
+#ifdef MM_DELAYFREE
+extern void       mm_freedelayed(void);
+#endif
 
 #endif /* __MM_MM_INTERNAL_H */
@@ -89,7 +89,9 @@ FAR void *malloc(size_t size)
 {
   FAR struct mm_freenode_s *node;
   void *ret = NULL;
+#ifndef CONFIG_MM_TLSF
   int ndx;
+#endif
 
   /* Handle bad sizes */
 
@@ -111,6 +113,13 @@ FAR void *malloc(size_t size)
 
   mm_takesemaphore();
 
+#ifdef CONFIG_MM_TLSF
+  /* Find the smallest free list that is guaranteed to hold a large
+   * enough chunk by searching the free list bitmaps.
+   */
+
+  node = mm_findfreechunk(size);
+#else
   /* Get the location in the node list to start the search.
    * Special case really big alloctions
    */
@@ -139,6 +148,7 @@ FAR void *malloc(size_t size)
    * to use. Since the list is ordered, we know that is must be
    * best fitting chunk available.
    */
+#endif
 
   if (node)
     {
@@ -150,12 +160,7 @@ FAR void *malloc(size_t size)
        * not be a successor node.
        */
 
-      DEBUGASSERT(node->blink);
-      node->blink->flink = node->flink;
-      if (node->flink)
-        {
-          node->flink->blink = node->blink;
-        }
+      mm_delfreechunk(node);
 
       /* Check if we have to split the free node into one of the
        * allocated size and another smaller freenode.  In some
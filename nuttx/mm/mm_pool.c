@@ -0,0 +1,284 @@
+/****************************************************************************
+ * mm/mm_pool.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <queue.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <arch/irq.h>
+#include <nuttx/arch.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/mempool.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mempool_initialize
+ *
+ * Description:
+ *   Initialize a pool of 'nblocks' blocks of 'blocksize' bytes using
+ *   caller-provided storage of at least MEMPOOL_SIZE(blocksize, nblocks)
+ *   bytes.  'nreserved' of the blocks may only be allocated from interrupt
+ *   handlers.
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int mempool_initialize(FAR struct mempool_s *pool, FAR void *storage,
+                       size_t blocksize, uint16_t nblocks,
+                       uint16_t nreserved)
+{
+  FAR uint8_t *block;
+  int i;
+
+  DEBUGASSERT(pool);
+
+  blocksize = MEMPOOL_ALIGN_UP(blocksize);
+  if (!storage || blocksize > UINT16_MAX || nreserved > nblocks)
+    {
+      return -EINVAL;
+    }
+
+  /* Thread every block onto the free list */
+
+  sq_init(&pool->freelist);
+  for (i = 0, block = (FAR uint8_t *)storage; i < nblocks; i++, block += blocksize)
+    {
+      sq_addlast((FAR sq_entry_t *)block, &pool->freelist);
+    }
+
+  pool->storage   = (FAR uint8_t *)storage;
+  pool->blocksize = (uint16_t)blocksize;
+  pool->nblocks   = nblocks;
+  pool->nreserved = nreserved;
+  pool->nfree     = nblocks;
+  pool->minfree   = nblocks;
+  pool->nfailed   = 0;
+  pool->allocated = false;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mempool_create
+ *
+ * Description:
+ *   Same as mempool_initialize() except that storage for the blocks is
+ *   allocated from the kernel heap (once).
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int mempool_create(FAR struct mempool_s *pool, size_t blocksize,
+                   uint16_t nblocks, uint16_t nreserved)
+{
+  FAR void *storage;
+  int ret;
+
+  storage = kmalloc(MEMPOOL_SIZE(blocksize, nblocks));
+  if (!storage)
+    {
+      mdbg("Failed to allocate %d blocks of size %d\n", nblocks, blocksize);
+      return -ENOMEM;
+    }
+
+  ret = mempool_initialize(pool, storage, blocksize, nblocks, nreserved);
+  if (ret < 0)
+    {
+      kfree(storage);
+      return ret;
+    }
+
+  pool->allocated = true;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mempool_release
+ *
+ * Description:
+ *   Release storage allocated by mempool_create().  All blocks must have
+ *   been returned to the pool.
+ *
+ ****************************************************************************/
+
+void mempool_release(FAR struct mempool_s *pool)
+{
+  DEBUGASSERT(pool && pool->nfree == pool->nblocks);
+
+  if (pool->allocated)
+    {
+      kfree(pool->storage);
+    }
+
+  sq_init(&pool->freelist);
+  pool->storage   = NULL;
+  pool->nblocks   = 0;
+  pool->nfree     = 0;
+  pool->allocated = false;
+}
+
+/****************************************************************************
+ * Name: mempool_alloc
+ *
+ * Description:
+ *   Remove one block from the pool in constant time.  This function may be
+ *   called from interrupt handlers.  Only interrupt handlers may take the
+ *   last 'nreserved' blocks.
+ *
+ * Returned Value:
+ *   The allocated block or NULL if the pool is exhausted.
+ *
+ ****************************************************************************/
+
+FAR void *mempool_alloc(FAR struct mempool_s *pool)
+{
+  FAR void  *mem = NULL;
+  irqstate_t flags;
+
+  DEBUGASSERT(pool);
+
+  /* The free list is shared with interrupt handlers */
+
+  flags = irqsave();
+  if (pool->nfree > pool->nreserved ||
+      (pool->nfree > 0 && up_interrupt_context()))
+    {
+      mem = (FAR void *)sq_remfirst(&pool->freelist);
+      DEBUGASSERT(mem);
+
+      pool->nfree--;
+      if (pool->nfree < pool->minfree)
+        {
+          pool->minfree = pool->nfree;
+        }
+    }
+  else if (pool->nfailed < UINT16_MAX)
+    {
+      pool->nfailed++;
+    }
+
+  irqrestore(flags);
+  return mem;
+}
+
+/****************************************************************************
+ * Name: mempool_free
+ *
+ * Description:
+ *   Return a block to the pool in constant time.  This function may be
+ *   called from interrupt handlers.
+ *
+ ****************************************************************************/
+
+void mempool_free(FAR struct mempool_s *pool, FAR void *mem)
+{
+  irqstate_t flags;
+
+  DEBUGASSERT(pool && mempool_contains(pool, mem));
+
+  /* Blocks are re-used in LIFO order so that recently used (and possibly
+   * cached) blocks are handed out first.
+   */
+
+  flags = irqsave();
+  sq_addfirst((FAR sq_entry_t *)mem, &pool->freelist);
+  pool->nfree++;
+  irqrestore(flags);
+}
+
+/****************************************************************************
+ * Name: mempool_contains
+ *
+ * Description:
+ *   Return true if 'mem' is one of the blocks of the pool.  This is useful
+ *   for subsystems that fall back to the heap when the pool is exhausted.
+ *
+ ****************************************************************************/
+
+bool mempool_contains(FAR struct mempool_s *pool, FAR void *mem)
+{
+  FAR uint8_t *block = (FAR uint8_t *)mem;
+
+  return block >= pool->storage &&
+         block <  pool->storage + (size_t)pool->blocksize * pool->nblocks &&
+         ((size_t)(block - pool->storage) % pool->blocksize) == 0;
+}
+
+/****************************************************************************
+ * Name: mempool_info
+ *
+ * Description:
+ *   Return usage statistics for the pool.
+ *
+ ****************************************************************************/
+
+void mempool_info(FAR struct mempool_s *pool, FAR struct mempoolinfo_s *info)
+{
+  irqstate_t flags;
+
+  DEBUGASSERT(pool && info);
+
+  flags           = irqsave();
+  info->blocksize = pool->blocksize;
+  info->nblocks   = pool->nblocks;
+  info->nreserved = pool->nreserved;
+  info->nfree     = pool->nfree;
+  info->minfree   = pool->minfree;
+  info->nfailed   = pool->nfailed;
+  irqrestore(flags);
+}
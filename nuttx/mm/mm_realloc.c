@@ -224,12 +224,7 @@ FAR void *realloc(FAR void *oldmem, size_t size)
             * but there may not be a successor node.
             */
 
-           DEBUGASSERT(prev->blink);
-           prev->blink->flink = prev->flink;
-           if (prev->flink)
-             {
-               prev->flink->blink = prev->blink;
-             }
+           mm_delfreechunk(prev);
 
            /* Extend the node into the previous free chunk */
 
@@ -291,12 +286,7 @@ FAR void *realloc(FAR void *oldmem, size_t size)
            * but there may not be a successor node.
            */
 
-          DEBUGASSERT(next->blink);
-          next->blink->flink = next->flink;
-          if (next->flink)
-            {
-              next->flink->blink = next->blink;
-            }
+          mm_delfreechunk(next);
 
           /* Extend the node into the next chunk */
 
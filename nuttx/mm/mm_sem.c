@@ -44,6 +44,12 @@
 #include <assert.h>
 #include "mm_internal.h"
 
+#ifdef CONFIG_MM_IRQLOCK
+#  ifndef MM_TEST
+#    include <arch/irq.h>
+#  endif
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -70,17 +76,121 @@
  * Private Data
  ****************************************************************************/
 
+#ifdef CONFIG_MM_IRQLOCK
+/* With CONFIG_MM_IRQLOCK, mutually exclusive access to this data set is
+ * enforced by disabling interrupts.  g_mm_flags holds the interrupt state
+ * saved by the outermost mm_takesemaphore() and g_counts_held is the
+ * nesting depth.
+ */
+
+static  irqstate_t g_mm_flags;
+static  int        g_counts_held;
+
+#else
 /* Mutually exclusive access to this data set is enforced with
  * the following (un-named) semaphore. */
 
 static  sem_t g_mm_semaphore;
 static  pid_t g_holder;
 static  int   g_counts_held;
+#endif
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+#ifdef CONFIG_MM_IRQLOCK
+
+/****************************************************************************
+ * Name: mm_seminitialize
+ *
+ * Description:
+ *   Initialize the MM "mutex".  Nothing needs to be done other than to
+ *   reset the nesting count.
+ *
+ ****************************************************************************/
+
+void mm_seminitialize(void)
+{
+  g_counts_held = 0;
+}
+
+/****************************************************************************
+ * Name: mm_takesemaphore
+ *
+ * Description:
+ *   Take the MM "mutex" by disabling interrupts.  Since the heap is never
+ *   held across a context switch, this is safe from tasks and from
+ *   interrupt handlers and it never waits.  Nested calls are supported.
+ *
+ ****************************************************************************/
+
+void mm_takesemaphore(void)
+{
+  irqstate_t flags = irqsave();
+
+  if (g_counts_held++ == 0)
+    {
+      /* This is the outermost reference.  Remember the interrupt state
+       * that must be restored when the last reference is released.
+       */
+
+      g_mm_flags = flags;
+    }
+}
+
+/****************************************************************************
+ * Name: mm_trysemaphore
+ *
+ * Description:
+ *   Take the MM "mutex" without waiting.  With CONFIG_MM_IRQLOCK this
+ *   always succeeds.
+ *
+ ****************************************************************************/
+
+int mm_trysemaphore(void)
+{
+  mm_takesemaphore();
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mm_givesemaphore
+ *
+ * Description:
+ *   Release one reference to the MM "mutex", restoring the interrupt
+ *   state when the last reference is released.
+ *
+ ****************************************************************************/
+
+void mm_givesemaphore(void)
+{
+  DEBUGASSERT(g_counts_held > 0);
+
+  if (--g_counts_held == 0)
+    {
+      irqrestore(g_mm_flags);
+    }
+}
+
+/****************************************************************************
+ * Name: mm_getsemaphore
+ *
+ * Description:
+ *   Return the equivalent of the MM semaphore count (for test purposes
+ *   only)
+ *
+ ****************************************************************************/
+
+#ifdef MM_TEST
+int mm_getsemaphore(void)
+{
+  return g_counts_held > 0 ? 0 : 1;
+}
+#endif
+
+#else /* CONFIG_MM_IRQLOCK */
+
 /****************************************************************************
  * Name: mm_seminitialize
  *
@@ -105,15 +215,15 @@ void mm_seminitialize(void)
  * Name: mm_trysemaphore
  *
  * Description:
- *   Try to take the MM mutex.  This is called only from the
- *   OS in certain conditions when it is necessary to have
- *   exclusive access to the memory manager but it is
- *   impossible to wait on a semaphore (e.g., the idle process
- *   when it performs its background memory cleanup).
+ *   Try to take the MM mutex.  This is called from the OS in
+ *   certain conditions when it is necessary to have exclusive
+ *   access to the memory manager but it is impossible to wait
+ *   on a semaphore (e.g., the idle process when it performs its
+ *   background memory cleanup).  It is also used by free() so
+ *   that a contended free is queued rather than waiting.
  *
  ****************************************************************************/
 
-#ifndef MM_TEST
 int mm_trysemaphore(void)
 {
   pid_t my_pid = getpid();
@@ -140,10 +250,17 @@ int mm_trysemaphore(void)
 
       g_holder      = my_pid;
       g_counts_held = 1;
+
+#ifdef MM_DELAYFREE
+      /* Release any memory that was freed while the semaphore was
+       * unavailable.
+       */
+
+      mm_freedelayed();
+#endif
       return OK;
     }
 }
-#endif
 
 /****************************************************************************
  * Name: mm_takesemaphore
@@ -184,6 +301,14 @@ void mm_takesemaphore(void)
 
       g_holder      = my_pid;
       g_counts_held = 1;
+
+#ifdef MM_DELAYFREE
+      /* Release any memory that was freed while the semaphore was
+       * unavailable.
+       */
+
+      mm_freedelayed();
+#endif
     }
 
   msemdbg("Holder=%d count=%d\n",
@@ -220,7 +345,15 @@ void mm_givesemaphore(void)
     }
   else
     {
-      /* Nope, this is the last reference I have */
+      /* Nope, this is the last reference I have.  Release any memory that
+       * was freed by other threads of execution while I held the
+       * semaphore.  Blocks freed after this point (but before the
+       * semaphore is posted) will be released by the next holder.
+       */
+
+#ifdef MM_DELAYFREE
+      mm_freedelayed();
+#endif
 
       msemdbg("PID=%d giving\n", my_pid);
       g_holder      = -1;
@@ -247,3 +380,4 @@ int mm_getsemaphore(void)
 }
 #endif
 
+#endif /* CONFIG_MM_IRQLOCK */
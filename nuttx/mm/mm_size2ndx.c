@@ -44,27 +44,94 @@
  * Pre-processor Definitions
  ************************************************************************/
 
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * mm_log2
+ *
+ * Description:
+ *   Return the index of the most significant bit set in 'size' using a
+ *   fixed number of steps (rather than one step per bit).  'size' must
+ *   be non-zero and less than MM_MAX_CHUNK.
+ *
+ ************************************************************************/
+
+static inline int mm_log2(size_t size)
+{
+  int log2 = 0;
+
+#if MM_MAX_SHIFT > 16
+  if (size >= ((size_t)1 << 16))
+    {
+      size >>= 16;
+      log2  += 16;
+    }
+#endif
+
+  if (size >= ((size_t)1 << 8))
+    {
+      size >>= 8;
+      log2  += 8;
+    }
+
+  if (size >= ((size_t)1 << 4))
+    {
+      size >>= 4;
+      log2  += 4;
+    }
+
+  if (size >= ((size_t)1 << 2))
+    {
+      size >>= 2;
+      log2  += 2;
+    }
+
+  if (size >= ((size_t)1 << 1))
+    {
+      log2  += 1;
+    }
+
+  return log2;
+}
+
 /************************************************************************
  * Public Functions
  ************************************************************************/
 
-/* Convert the size to a nodelist index */
+/************************************************************************
+ * mm_size2ndx
+ *
+ * Description:
+ *   Convert the size to a nodelist index.  Normally, this is the index
+ *   of the power-of-two size class containing 'size'.  In the TLSF
+ *   configuration, it is the index of the second level free list:
+ *   The first level class selects a group of MM_NSLISTS lists and the
+ *   MM_SL_SHIFT bits just below the most significant bit select the
+ *   list within that group.
+ *
+ ************************************************************************/
 
 int mm_size2ndx(size_t size)
 {
-  int ndx = 0;
+  int log2;
 
   if (size >= MM_MAX_CHUNK)
     {
-       return MM_NNODES-1;
+       return MM_NLISTS-1;
     }
-
-  size >>= MM_MIN_SHIFT;
-  while (size > 1)
+  else if (size < MM_MIN_CHUNK)
     {
-      ndx++;
-      size >>= 1;
+       return 0;
     }
 
-  return ndx;
+  log2 = mm_log2(size);
+
+#ifdef CONFIG_MM_TLSF
+  return ((log2 - MM_MIN_SHIFT) << MM_SL_SHIFT) +
+         (int)((size >> (log2 - MM_SL_SHIFT)) & (MM_NSLISTS - 1));
+#else
+  return log2 - MM_MIN_SHIFT;
+#endif
 }
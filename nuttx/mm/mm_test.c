@@ -33,9 +33,11 @@
  *
  ************************************************************************/
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /* Fake NuttX dependencies */
 
@@ -47,12 +49,23 @@
 
 #include "mm_internal.h"
 
+extern void mm_initialize(FAR void *heapstart, size_t heapsize);
+extern void mm_addregion(FAR void *heapstart, size_t heapsize);
+
 /* Pre-processor Definitions */
 
 #define TEST_HEAP1_SIZE 0x00080000
 #define TEST_HEAP2_SIZE 0x00080000
 #define NTEST_ALLOCS 32
 
+/* Latency test:  NLATENCY_OPS random malloc/free operations are performed
+ * on NLATENCY_SLOTS outstanding allocations of up to LATENCY_MAXSIZE bytes.
+ */
+
+#define NLATENCY_SLOTS  512
+#define NLATENCY_OPS    200000
+#define LATENCY_MAXSIZE 4096
+
 /* #define STOP_ON_ERRORS do{}while(0) */
 #define STOP_ON_ERRORS exit(1)
 
@@ -99,10 +112,15 @@ static const int alignment[NTEST_ALLOCS/2] =
     512,  4096,  65536,      8,     64,  1024,    16,       4
 };
 static void        *allocs[NTEST_ALLOCS];
+static void        *latency_allocs[NLATENCY_SLOTS];
 static struct       mallinfo alloc_info;
 static unsigned int g_reportedheapsize = 0;
 static unsigned int g_actualheapsize = 0;
 
+/* Verbose memory manager debug output (cleared for timing measurements) */
+
+int g_mmverbose = 1;
+
 /************************************************************************
  * mm_showchunkinfo
  ************************************************************************/
@@ -110,7 +128,24 @@ static unsigned int g_actualheapsize = 0;
 static int mm_findinfreelist(struct mm_freenode_s *node)
 {
   struct mm_freenode_s *list;
+#ifdef CONFIG_MM_TLSF
+  int ndx;
+
+  /* Each TLSF list is separate, NULL-terminated list */
 
+  for (ndx = 0; ndx < MM_NLISTS; ndx++)
+    {
+      for(list = g_nodelist[ndx].flink;
+          list;
+          list = list->flink)
+        {
+          if (list == node)
+            {
+              return 1;
+            }
+        }
+    }
+#else
   for(list = &g_nodelist[0];
       list;
       list = list->flink)
@@ -120,6 +155,7 @@ static int mm_findinfreelist(struct mm_freenode_s *node)
           return 1;
         }
     }
+#endif
   return 0;
 }
 
@@ -148,7 +184,8 @@ static void mm_showchunkinfo(void)
            node = (struct mm_allocnode_s *)((char*)node + node->size))
          {
            printf("       %p 0x%08x 0x%08x %s",
-                 node, node->size, node->preceding & ~MM_ALLOC_BIT,
+                 node, (unsigned int)node->size,
+                 (unsigned int)(node->preceding & ~MM_ALLOC_BIT),
                  node->preceding & MM_ALLOC_BIT ? "Allocated" : "Free     ");
           found = mm_findinfreelist((struct mm_freenode_s *)node);
           if (found && (node->preceding & MM_ALLOC_BIT) != 0)
@@ -168,6 +205,68 @@ static void mm_showchunkinfo(void)
 #undef region
 }
 
+#ifdef CONFIG_MM_TLSF
+static void mm_showfreelist(void)
+{
+  struct mm_freenode_s *prev;
+  struct mm_freenode_s *node;
+  int nonempty;
+  int ndx;
+  int fl;
+  int sl;
+
+  printf("     FREE NODE LIST:\n");
+  for (ndx = 0; ndx < MM_NLISTS; ndx++)
+    {
+      fl       = ndx >> MM_SL_SHIFT;
+      sl       = ndx & (MM_NSLISTS - 1);
+      nonempty = (g_nodelist[ndx].flink != NULL);
+
+      /* Verify that the bitmaps agree with the state of the list */
+
+      if (nonempty != ((g_slbitmap[fl] >> sl) & 1) ||
+          (nonempty && ((g_flbitmap >> fl) & 1) == 0))
+        {
+          fprintf(stderr, "Bitmap is wrong for list %d:  fl=%08x sl=%08x\n",
+                  ndx, (unsigned int)g_flbitmap, (unsigned int)g_slbitmap[fl]);
+          STOP_ON_ERRORS;
+        }
+
+      if (!nonempty)
+        {
+          continue;
+        }
+
+      printf("       [LIST %3d]\n", ndx);
+      for(prev = &g_nodelist[ndx], node = g_nodelist[ndx].flink;
+          node;
+          prev = node, node = node->flink)
+        {
+          printf("       %p %08x %08x %p %p\n",
+                 node, (unsigned int)node->size, (unsigned int)node->preceding,
+                 node->flink, node->blink);
+
+          /* Verify all backward links and that the node is in the
+           * right list.
+           */
+
+          if (node->blink != prev)
+            {
+              fprintf(stderr, "Backward link is wrong:  Is %p, should be %p\n",
+                      node->blink, prev);
+              STOP_ON_ERRORS;
+            }
+
+          if (mm_size2ndx(node->size) != ndx)
+            {
+              fprintf(stderr, "Node %p of size %u is in list %d, should be %d\n",
+                      node, (unsigned int)node->size, ndx, mm_size2ndx(node->size));
+              STOP_ON_ERRORS;
+            }
+        }
+    }
+}
+#else
 static void mm_showfreelist(void)
 {
   struct mm_freenode_s *prev;
@@ -183,14 +282,15 @@ static void mm_showfreelist(void)
 
       if (node->size == 0)
         {
-          printf("       [NODE %2d]         %08x %08x %08x\n",
-                 i, node->preceding, (int)node->flink, (int)node->blink);
+          printf("       [NODE %2d]         %08x %p %p\n",
+                 i, (unsigned int)node->preceding, node->flink, node->blink);
           i++;
         }
       else
         {
-          printf("       %08x %08x %08x %08x %08x\n",
-                 (int)node, node->size, node->preceding, (int)node->flink, (int)node->blink);
+          printf("       %p %08x %08x %p %p\n",
+                 node, (unsigned int)node->size, (unsigned int)node->preceding,
+                 node->flink, node->blink);
         }
 
       /* Verify all backward links */
@@ -203,6 +303,7 @@ static void mm_showfreelist(void)
         }
     }
 }
+#endif
 
 static void mm_showmallinfo(void)
 {
@@ -233,8 +334,8 @@ static void mm_showmallinfo(void)
   if (!g_reportedheapsize)
     {
       g_reportedheapsize = alloc_info.uordblks + alloc_info.fordblks;
-      if (g_reportedheapsize > g_actualheapsize + 16*CONFIG_MM_REGIONS ||
-          g_reportedheapsize < g_actualheapsize -16*CONFIG_MM_REGIONS)
+      if (g_reportedheapsize > g_actualheapsize + 2*MM_MIN_CHUNK*CONFIG_MM_REGIONS ||
+          g_reportedheapsize < g_actualheapsize - 2*MM_MIN_CHUNK*CONFIG_MM_REGIONS)
         {
           fprintf(stderr, "Total memory %d not close to uordlbks=%d + fordblks=%d = %d\n",
                  g_actualheapsize, alloc_info.uordblks, alloc_info.fordblks, g_reportedheapsize);
@@ -405,6 +506,108 @@ static void do_frees(void **mem, const int *size, const int *rand, int n)
     }
 }
 
+static unsigned long elapsed_ns(const struct timespec *start,
+                                const struct timespec *end)
+{
+  return (unsigned long)(end->tv_sec - start->tv_sec) * 1000000000UL +
+         (unsigned long)end->tv_nsec - (unsigned long)start->tv_nsec;
+}
+
+static void do_latency(void)
+{
+  struct timespec start;
+  struct timespec end;
+  unsigned long long malloc_total = 0;
+  unsigned long long free_total = 0;
+  unsigned long malloc_max = 0;
+  unsigned long free_max = 0;
+  unsigned long nmallocs = 0;
+  unsigned long nfrees = 0;
+  unsigned long nfailed = 0;
+  unsigned long ns;
+  unsigned int seed = 1;
+  size_t size;
+  int slot;
+  int i;
+
+  printf("Latency test: %d random operations on %d slots\n",
+         NLATENCY_OPS, NLATENCY_SLOTS);
+
+  g_mmverbose = 0;
+
+  for (i = 0; i < NLATENCY_OPS; i++)
+    {
+      /* A simple linear congruential generator gives the same sequence
+       * of sizes and slots on every run.
+       */
+
+      seed = seed * 1103515245 + 12345;
+      slot = (seed >> 16) % NLATENCY_SLOTS;
+      seed = seed * 1103515245 + 12345;
+      size = ((seed >> 16) % LATENCY_MAXSIZE) + 1;
+
+      if (latency_allocs[slot])
+        {
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          mm_free(latency_allocs[slot]);
+          clock_gettime(CLOCK_MONOTONIC, &end);
+
+          latency_allocs[slot] = NULL;
+          ns          = elapsed_ns(&start, &end);
+          free_total += ns;
+          nfrees++;
+          if (ns > free_max)
+            {
+              free_max = ns;
+            }
+        }
+      else
+        {
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          latency_allocs[slot] = mm_malloc(size);
+          clock_gettime(CLOCK_MONOTONIC, &end);
+
+          ns            = elapsed_ns(&start, &end);
+          malloc_total += ns;
+          nmallocs++;
+          if (ns > malloc_max)
+            {
+              malloc_max = ns;
+            }
+
+          if (latency_allocs[slot])
+            {
+              memset(latency_allocs[slot], 0x77, size);
+            }
+          else
+            {
+              nfailed++;
+            }
+        }
+    }
+
+  /* Report fragmentation with all slots still allocated, then release
+   * everything.
+   */
+
+  g_mmverbose = 1;
+  mm_showmallinfo();
+
+  for (slot = 0; slot < NLATENCY_SLOTS; slot++)
+    {
+      mm_free(latency_allocs[slot]);
+      latency_allocs[slot] = NULL;
+    }
+
+  printf("     malloc: %lu calls, %lu failed, avg %llu ns, max %lu ns\n",
+         nmallocs, nfailed, nmallocs ? malloc_total / nmallocs : 0,
+         malloc_max);
+  printf("     free:   %lu calls, avg %llu ns, max %lu ns\n",
+         nfrees, nfrees ? free_total / nfrees : 0, free_max);
+
+  mm_showmallinfo();
+}
+
 int main(int argc, char **argv, char **envp)
 {
   void *heap1_base;
@@ -463,6 +666,10 @@ int main(int argc, char **argv, char **envp)
 
   do_frees(allocs, alloc_sizes, random1, NTEST_ALLOCS);
 
+  /* Measure allocation latency under fragmentation */
+
+  do_latency();
+
   /* Clean up and exit */
 
   free(heap1_base);
@@ -203,12 +203,48 @@ int psock_getsockopt(FAR struct socket *psock, int level, int option,
         break;
 #endif
 
+      /* The receive buffer size is the number of TCP read-ahead buffers that
+       * the connection may hold.
+       */
+
+#if defined(CONFIG_NET_TCP) && CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
+      case SO_RCVBUF:     /* Reports receive buffer size */
+        {
+          FAR struct uip_conn *conn;
+
+          /* Verify that option is the size of an 'int'.  Should also check
+           * that 'value' is properly aligned for an 'int'
+           */
+
+          if (*value_len < sizeof(int))
+            {
+              err = EINVAL;
+              goto errout;
+            }
+
+          /* Only TCP sockets have read-ahead buffering */
+
+          if (psock->s_type != SOCK_STREAM || !psock->s_conn)
+            {
+              err = ENOPROTOOPT;
+              goto errout;
+            }
+
+          conn         = (FAR struct uip_conn *)psock->s_conn;
+          *(int*)value = conn->rhquota * CONFIG_NET_TCP_READAHEAD_BUFSIZE;
+          *value_len   = sizeof(int);
+        }
+        break;
+#endif
+
       /* The following are not yet implemented */
 
       case SO_ACCEPTCONN: /* Reports whether socket listening is enabled */
       case SO_LINGER:
       case SO_SNDBUF:     /* Sets send buffer size */
+#if !defined(CONFIG_NET_TCP) || CONFIG_NET_NTCP_READAHEAD_BUFFERS <= 0
       case SO_RCVBUF:     /* Sets receive buffer size */
+#endif
       case SO_ERROR:      /* Reports and clears error status. */
       case SO_RCVLOWAT:   /* Sets the minimum number of bytes to input */
       case SO_SNDLOWAT:   /* Sets the minimum number of bytes to output */
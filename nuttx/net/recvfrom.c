@@ -194,12 +194,13 @@ static inline void recvfrom_newtcpdata(FAR struct uip_driver_s *dev,
        * partial packet in this context.
        */
 
-#ifdef CONFIG_DEBUG_NET
       if (nsaved < buflen)
         {
           ndbg("ERROR: packet data not saved (%d bytes)\n", buflen - nsaved);
-        }
+#ifdef CONFIG_NET_STATISTICS
+          uip_stat.tcp.rcvdrop++;
 #endif
+        }
 #else
       ndbg("ERROR: packet data lost (%d bytes)\n", dev->d_len - recvlen);
 #endif
@@ -322,11 +323,20 @@ static inline void recvfrom_readahead(struct recvfrom_s *pstate)
             }
           else
             {
-              uip_tcpreadaheadrelease(readahead);
+              uip_tcpreadaheadrelease(conn, readahead);
             }
         }
     }
   while (readahead && pstate->rf_buflen > 0);
+
+  /* If freeing read-ahead buffers has opened the receive window, then let
+   * the peer know so that it does not wait for its persist timer.
+   */
+
+  if (uip_tcpwndupdate(conn))
+    {
+      netdev_txnotify(&conn->ripaddr);
+    }
 }
 #endif /* CONFIG_NET_UDP || CONFIG_NET_TCP */
 
@@ -43,6 +43,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <errno.h>
 #include <debug.h>
@@ -64,6 +65,12 @@
 
 #define TCPBUF ((struct uip_tcpip_hdr *)&dev->d_buf[UIP_LLH_LEN])
 
+/* The number of duplicate ACKs that will trigger a fast retransmission of
+ * the first unacknowledged segment.
+ */
+
+#define SEND_DUPACK_THRESHOLD 3
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -82,6 +89,7 @@ struct send_s
   ssize_t                    snd_sent;    /* The number of bytes sent */
   uint32_t                   snd_isn;     /* Initial sequence number */
   uint32_t                   snd_acked;   /* The number of bytes acked */
+  uint8_t                    snd_dupacks; /* Count of duplicate ACKs received */
 #if defined(CONFIG_NET_SOCKOPTS) && !defined(CONFIG_DISABLE_CLOCK)
   uint32_t                   snd_time;    /* last send time for determining timeout */
 #endif
@@ -157,6 +165,8 @@ static uint16_t send_interrupt(struct uip_driver_s *dev, void *pvconn,
   struct uip_conn *conn = (struct uip_conn*)pvconn;
   struct send_s *pstate = (struct send_s *)pvpriv;
 
+  bool fastrexmit = false;
+
   nllvdbg("flags: %04x acked: %d sent: %d\n",
           flags, pstate->snd_acked, pstate->snd_sent);
 
@@ -166,13 +176,49 @@ static uint16_t send_interrupt(struct uip_driver_s *dev, void *pvconn,
 
   if ((flags & UIP_ACKDATA) != 0)
     {
+      uint32_t acked;
+
       /* The current acknowledgement number number is the (relative) offset
        * of the of the next byte needed by the receiver.  The snd_isn is the
        * offset of the first byte to send to the receiver.  The difference
        * is the number of bytes to be acknowledged.
        */
 
-      pstate->snd_acked = uip_tcpgetsequence(TCPBUF->ackno) - pstate->snd_isn;
+      acked = uip_tcpgetsequence(TCPBUF->ackno) - pstate->snd_isn;
+      if ((int32_t)(acked - pstate->snd_acked) > 0)
+        {
+          /* New data has been acknowledged */
+
+          pstate->snd_acked   = acked;
+          pstate->snd_dupacks = 0;
+
+          /* A retransmission may have been acknowledged beyond the point
+           * where we last resumed sending.
+           */
+
+          if (pstate->snd_acked > pstate->snd_sent)
+            {
+              pstate->snd_sent = pstate->snd_acked;
+            }
+        }
+
+      /* An ACK that carries no data and does not advance the acknowledged
+       * sequence number while there is outstanding data is a duplicate ACK.
+       * Several of them in a row means that the first unacknowledged segment
+       * was probably lost, but that the segments following it are still
+       * being received.  Don't wait for the retransmission timeout.
+       */
+
+      else if ((flags & UIP_NEWDATA) == 0 &&
+               pstate->snd_sent > pstate->snd_acked)
+        {
+          if (++pstate->snd_dupacks == SEND_DUPACK_THRESHOLD)
+            {
+              nllvdbg("Fast retransmit: acked=%d\n", pstate->snd_acked);
+              fastrexmit = true;
+            }
+        }
+
       nllvdbg("ACK: acked=%d sent=%d buflen=%d\n",
               pstate->snd_acked, pstate->snd_sent, pstate->snd_buflen);
 
@@ -195,10 +241,12 @@ static uint16_t send_interrupt(struct uip_driver_s *dev, void *pvconn,
   else if ((flags & UIP_REXMIT) != 0)
     {
       /* Yes.. in this case, reset the number of bytes that have been sent
-       * to the number of bytes that have been ACKed.
+       * to the number of bytes that have been ACKed.  Everything after
+       * that will be sent again as the window re-opens.
        */
 
-      pstate->snd_sent = pstate->snd_acked;
+      pstate->snd_sent    = pstate->snd_acked;
+      pstate->snd_dupacks = 0;
 
       /* Fall through to re-send data from the last that was ACKed */
     }
@@ -235,72 +283,142 @@ static uint16_t send_interrupt(struct uip_driver_s *dev, void *pvconn,
    * next polling cycle.
    */
 
-  if ((flags & UIP_NEWDATA) == 0 && pstate->snd_sent < pstate->snd_buflen)
+  if ((flags & UIP_NEWDATA) == 0 &&
+      (fastrexmit || pstate->snd_sent < pstate->snd_buflen))
     {
+      uint32_t inflight = pstate->snd_sent - pstate->snd_acked;
+      uint32_t seqoff;
+      uint32_t newsent;
+      uint32_t sndlen;
       uint32_t seqno;
 
-      /* Get the amount of data that we can send in the next packet */
+      if (fastrexmit)
+        {
+          /* Re-send the first unacknowledged segment.  This does not change
+           * the amount of data that has been sent.
+           */
+
+          seqoff  = pstate->snd_acked;
+          sndlen  = inflight;
+          if (sndlen > uip_mss(conn))
+            {
+              sndlen = uip_mss(conn);
+            }
 
-      uint32_t sndlen = pstate->snd_buflen - pstate->snd_sent;
-      if (sndlen > uip_mss(conn))
+          newsent = pstate->snd_sent;
+        }
+      else
         {
-          sndlen = uip_mss(conn);
+          uint32_t window;
+
+          /* The amount of unacknowledged data is limited by the receive
+           * window advertised by the peer and by CONFIG_NET_TCP_SNDSEGS.
+           */
+
+          window = (uint32_t)CONFIG_NET_TCP_SNDSEGS * uip_mss(conn);
+          if (window > conn->winsize)
+            {
+              window = conn->winsize;
+            }
+
+          /* Get the amount of data that we can send in the next packet */
+
+          seqoff = pstate->snd_sent;
+          sndlen = pstate->snd_buflen - pstate->snd_sent;
+          if (sndlen > uip_mss(conn))
+            {
+              sndlen = uip_mss(conn);
+            }
+
+          /* Always permit one segment when nothing is outstanding.  That is
+           * the old stop-and-wait behavior and also serves to probe a
+           * closed window.
+           */
+
+          if (inflight > 0)
+            {
+              if (inflight >= window)
+                {
+                  sndlen = 0;
+                }
+              else if (sndlen > window - inflight)
+                {
+                  sndlen = window - inflight;
+                }
+            }
+
+          newsent = seqoff + sndlen;
         }
 
-      /* Set the sequence number for this packet.  NOTE:  uIP updates
-       * sndseq on recept of ACK *before* this function is called.  In that
-       * case sndseq will point to the next unacknowledge byte (which might
-       * have already been sent).  We will overwrite the value of sndseq
-       * here before the packet is sent.
-       */
+      if (sndlen > 0)
+        {
+          /* Set the sequence number for this packet.  NOTE:  uIP updates
+           * sndseq on recept of ACK *before* this function is called.  In
+           * that case sndseq will point to the next unacknowledge byte
+           * (which might have already been sent).  We will overwrite the
+           * value of sndseq here before the packet is sent.
+           */
 
-      seqno = pstate->snd_sent + pstate->snd_isn;
-      nllvdbg("SEND: sndseq %08x->%08x\n", conn->sndseq, seqno);
-      uip_tcpsetsequence(conn->sndseq, seqno);
+          seqno = pstate->snd_isn + seqoff;
+          nllvdbg("SEND: sndseq %08x->%08x\n", conn->sndseq, seqno);
+          uip_tcpsetsequence(conn->sndseq, seqno);
 
-      /* Then set-up to send that amount of data. (this won't actually
-       * happen until the polling cycle completes).
-       */
+          /* uIP expects sndseq + unacked to be the sequence number of the
+           * next byte to be sent.  uip_tcpappsend() will add the length of
+           * this packet to unacked, but the retransmission path does not.
+           */
 
-      uip_send(dev, &pstate->snd_buffer[pstate->snd_sent], sndlen);
-
-      /* Check if the destination IP address is in the ARP table.  If not,
-       * then the send won't actually make it out... it will be replaced with
-       * an ARP request.
-       *
-       * NOTE 1: This could an expensive check if there are a lot of entries
-       * in the ARP table.  Hence, we only check on the first packet -- when
-       * snd_sent is zero.
-       *
-       * NOTE 2: If we are actually harvesting IP addresses on incomming IP
-       * packets, then this check should not be necessary; the MAC mapping
-       * should already be in the ARP table.
-       */
+          conn->unacked = newsent - seqoff;
+          if ((flags & UIP_REXMIT) == 0)
+            {
+              conn->unacked -= sndlen;
+            }
+
+          /* Then set-up to send that amount of data. (this won't actually
+           * happen until the polling cycle completes).
+           */
+
+          uip_send(dev, &pstate->snd_buffer[seqoff], sndlen);
+
+          /* Check if the destination IP address is in the ARP table.  If
+           * not, then the send won't actually make it out... it will be
+           * replaced with an ARP request.
+           *
+           * NOTE 1: This could an expensive check if there are a lot of
+           * entries in the ARP table.  Hence, we only check on the first
+           * packet -- when snd_sent is zero.
+           *
+           * NOTE 2: If we are actually harvesting IP addresses on incomming
+           * IP packets, then this check should not be necessary; the MAC
+           * mapping should already be in the ARP table.
+           */
 
 #if defined(CONFIG_NET_ETHERNET) && defined (CONFIG_NET_ARP_IPIN)
-      if (pstate->snd_sent != 0 || uip_arp_find(conn->ripaddr) != NULL)
+          if (pstate->snd_sent != 0 || uip_arp_find(conn->ripaddr) != NULL)
 #endif
-        {
-          /* Update the amount of data sent (but not necessarily ACKed) */
+            {
+              /* Update the amount of data sent (but not necessarily ACKed) */
 
-          pstate->snd_sent += sndlen;
-          nllvdbg("SEND: acked=%d sent=%d buflen=%d\n",
-                  pstate->snd_acked, pstate->snd_sent, pstate->snd_buflen);
+              pstate->snd_sent = newsent;
+              nllvdbg("SEND: acked=%d sent=%d buflen=%d\n",
+                      pstate->snd_acked, pstate->snd_sent, pstate->snd_buflen);
 
-          /* Update the send time */
+              /* Update the send time */
 
 #if defined(CONFIG_NET_SOCKOPTS) && !defined(CONFIG_DISABLE_CLOCK)
-          pstate->snd_time = clock_systimer();
+              pstate->snd_time = clock_systimer();
 #endif
+            }
         }
     }
 
-  /* All data has been send and we are just waiting for ACK or re-transmit
-   * indications to complete the send.  Check for a timeout.
+  /* All data has been send (or the window is full) and we are just waiting
+   * for ACK or re-transmit indications to complete the send.  Check for a
+   * timeout.
    */
 
 #if defined(CONFIG_NET_SOCKOPTS) && !defined(CONFIG_DISABLE_CLOCK)
-  else if (send_timeout(pstate))
+  if (dev->d_sndlen == 0 && send_timeout(pstate))
     {
       /* Yes.. report the timeout */
 
@@ -208,11 +208,73 @@ int psock_setsockopt(FAR struct socket *psock, int level, int option,
         break;
 #endif
 
+      /* The receive buffer size sets the number of TCP read-ahead buffers
+       * that the connection may hold.
+       */
+
+#if defined(CONFIG_NET_TCP) && CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
+      case SO_RCVBUF:     /* Sets receive buffer size */
+        {
+          FAR struct uip_conn *conn;
+          int bufsize;
+          int nbuffers;
+
+          /* Verify that option is the size of an 'int'.  Should also check
+           * that 'value' is properly aligned for an 'int'
+           */
+
+          if (value_len != sizeof(int))
+            {
+              err = EINVAL;
+              goto errout;
+            }
+
+          /* Only TCP sockets have read-ahead buffering */
+
+          if (psock->s_type != SOCK_STREAM || !psock->s_conn)
+            {
+              err = ENOPROTOOPT;
+              goto errout;
+            }
+
+          bufsize = *(int*)value;
+          if (bufsize < 0)
+            {
+              err = EINVAL;
+              goto errout;
+            }
+
+          /* Convert the size to a number of read-ahead buffers, rounding
+           * up.  The connection may always hold at least one buffer and
+           * never more than there are.
+           */
+
+          nbuffers = (bufsize + CONFIG_NET_TCP_READAHEAD_BUFSIZE - 1) /
+                     CONFIG_NET_TCP_READAHEAD_BUFSIZE;
+          if (nbuffers < 1)
+            {
+              nbuffers = 1;
+            }
+          else if (nbuffers > CONFIG_NET_NTCP_READAHEAD_BUFFERS)
+            {
+              nbuffers = CONFIG_NET_NTCP_READAHEAD_BUFFERS;
+            }
+
+          flags = uip_lock();
+          conn = (FAR struct uip_conn *)psock->s_conn;
+          conn->rhquota = nbuffers;
+          uip_unlock(flags);
+        }
+        break;
+#endif
+
       /* The following are not yet implemented */
 
       case SO_LINGER:
       case SO_SNDBUF:     /* Sets send buffer size */
+#if !defined(CONFIG_NET_TCP) || CONFIG_NET_NTCP_READAHEAD_BUFFERS <= 0
       case SO_RCVBUF:     /* Sets receive buffer size */
+#endif
       case SO_RCVLOWAT:   /* Sets the minimum number of bytes to input */
       case SO_SNDLOWAT:   /* Sets the minimum number of bytes to output */
 
@@ -41,6 +41,7 @@
 #ifdef CONFIG_NET
 
 #include <stdint.h>
+#include <string.h>
 #include <debug.h>
 
 #include <nuttx/net/uip/uipopt.h>
@@ -56,6 +57,20 @@
 #define BUF ((struct uip_ip_hdr *)&dev->d_buf[UIP_LLH_LEN])
 #define ICMPBUF ((struct uip_icmpip_hdr *)&dev->d_buf[UIP_LLH_LEN])
 
+/* CHKSUM_NATIVE converts a 16-bit sum between host (big endian, network)
+ * order and the order in which native 16-bit loads from the buffer sum the
+ * bytes.  CHKSUM_ODDBYTE gives the native word value of a final odd byte
+ * padded with zero.
+ */
+
+#ifdef CONFIG_ENDIAN_BIG
+#  define CHKSUM_NATIVE(s)   (s)
+#  define CHKSUM_ODDBYTE(b)  ((uint32_t)(b) << 8)
+#else
+#  define CHKSUM_NATIVE(s)   ((uint16_t)(((s) >> 8) | ((s) << 8)))
+#  define CHKSUM_ODDBYTE(b)  ((uint32_t)(b))
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -65,41 +80,111 @@
  ****************************************************************************/
 
 #if !UIP_ARCH_CHKSUM
-static uint16_t chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+
+/****************************************************************************
+ * Name: chksum_fold
+ *
+ * Description:
+ *   Fold the carries out of a 32-bit one's complement accumulator.
+ *
+ ****************************************************************************/
+
+static inline uint16_t chksum_fold(uint32_t acc)
 {
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
+  acc = (acc >> 16) + (acc & 0xffff);
+  acc += acc >> 16;
+  return (uint16_t)acc;
+}
 
-  dataptr = data;
-  last_byte = data + len - 1;
+/****************************************************************************
+ * Name: chksum
+ *
+ * Description:
+ *   Add the 16-bit words of a buffer to a partial Internet checksum.
+ *
+ *   The words are accumulated in a 32-bit sum and the carries are folded
+ *   back into the low 16 bits only once at the end (see RFC1071).  A
+ *   packet is at most 64Kb so the accumulator cannot overflow.  If the
+ *   buffer is 16-bit aligned, the words are read in native byte order
+ *   (the one's complement sum is byte order independent) and the result
+ *   is swapped to host order once at the end.
+ *
+ * Input Parameters:
+ *   sum  - The partial checksum in host byte order
+ *   data - The data to be summed
+ *   len  - The length of the data in bytes
+ *
+ * Returned Value:
+ *   The new partial checksum in host byte order
+ *
+ ****************************************************************************/
+
+static uint16_t chksum(uint16_t sum, FAR const uint8_t *data, uint16_t len)
+{
+  uint32_t acc;
 
-  while(dataptr < last_byte)
+  if (((uintptr_t)data & 1) == 0)
     {
-      /* At least two more bytes */
+      FAR const uint16_t *wptr = (FAR const uint16_t *)data;
 
-      t = (dataptr[0] << 8) + dataptr[1];
-      sum += t;
-      if (sum < t)
+      acc = CHKSUM_NATIVE(sum);
+
+      /* Sum 16 bytes per iteration ... */
+
+      while (len >= 16)
         {
-          sum++; /* carry */
+          acc += (uint32_t)wptr[0] + wptr[1] + wptr[2] + wptr[3] +
+                 wptr[4] + wptr[5] + wptr[6] + wptr[7];
+          wptr += 8;
+          len  -= 16;
         }
-      dataptr += 2;
-    }
 
-  if (dataptr == last_byte)
-    {
-      t = (dataptr[0] << 8) + 0;
-      sum += t;
-      if (sum < t)
+      /* ... then the remaining words ... */
+
+      while (len >= 2)
+        {
+          acc += *wptr++;
+          len -= 2;
+        }
+
+      /* ... and a final odd byte, padded with zero */
+
+      if (len > 0)
         {
-          sum++; /* carry */
+          acc += CHKSUM_ODDBYTE(*(FAR const uint8_t *)wptr);
         }
+
+      return CHKSUM_NATIVE(chksum_fold(acc));
     }
+  else
+    {
+      /* Unaligned data must be assembled into words a byte at a time */
+
+      acc = sum;
+      while (len >= 8)
+        {
+          acc += ((uint32_t)data[0] << 8) + data[1] +
+                 ((uint32_t)data[2] << 8) + data[3] +
+                 ((uint32_t)data[4] << 8) + data[5] +
+                 ((uint32_t)data[6] << 8) + data[7];
+          data += 8;
+          len  -= 8;
+        }
+
+      while (len >= 2)
+        {
+          acc  += ((uint32_t)data[0] << 8) + data[1];
+          data += 2;
+          len  -= 2;
+        }
 
-  /* Return sum in host byte order. */
+      if (len > 0)
+        {
+          acc += (uint32_t)data[0] << 8;
+        }
 
-  return sum;
+      return chksum_fold(acc);
+    }
 }
 
 static uint16_t upper_layer_chksum(struct uip_driver_s *dev, uint8_t proto)
@@ -124,6 +209,41 @@ static uint16_t upper_layer_chksum(struct uip_driver_s *dev, uint8_t proto)
 
   sum = chksum(sum, (uint8_t *)&pbuf->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
+#ifdef CONFIG_NET_COPYCHKSUM
+  /* If uip_send() has already summed the data at the end of the packet,
+   * then only the upper layer header needs to be summed here.  The partial
+   * sum is used only once.
+   */
+
+  if (dev->d_sndsumlen > 0)
+    {
+      FAR uint8_t *hdr = &dev->d_buf[UIP_IPH_LEN + UIP_LLH_LEN];
+      uint16_t hdrlen  = dev->d_snddata - hdr;
+      uint16_t datasum = dev->d_sndsum;
+
+      if (dev->d_sndsumlen == dev->d_sndlen &&
+          hdrlen + dev->d_sndsumlen == upper_layer_len)
+        {
+          dev->d_sndsumlen = 0;
+
+          /* Sum the header, then add the data sum.  If the data starts at
+           * an odd offset, its bytes were summed in the opposite lanes.
+           */
+
+          sum = chksum(sum, hdr, hdrlen);
+          if ((hdrlen & 1) != 0)
+            {
+              datasum = (datasum >> 8) | (datasum << 8);
+            }
+
+          sum = chksum_fold((uint32_t)sum + datasum);
+          return (sum == 0) ? 0xffff : htons(sum);
+        }
+
+      dev->d_sndsumlen = 0;
+    }
+#endif
+
   /* Sum TCP header and data. */
 
   sum = chksum(sum, &dev->d_buf[UIP_IPH_LEN + UIP_LLH_LEN], upper_layer_len);
@@ -187,6 +307,65 @@ uint16_t uip_chksum(uint16_t *data, uint16_t len)
   return htons(chksum(0, (uint8_t *)data, len));
 }
 
+/* Copy a buffer and calculate its checksum in a single pass. */
+
+#ifdef CONFIG_NET_COPYCHKSUM
+uint16_t uip_copychksum(FAR void *dest, FAR const void *src, uint16_t len,
+                        uint16_t sum)
+{
+  /* Combine the copy and the checksum if both buffers are 16-bit aligned.
+   * Otherwise, just copy and then checksum the (cached) destination.
+   */
+
+  if ((((uintptr_t)dest | (uintptr_t)src) & 1) == 0)
+    {
+      FAR uint16_t       *wdest = (FAR uint16_t *)dest;
+      FAR const uint16_t *wsrc  = (FAR const uint16_t *)src;
+      uint32_t            acc   = CHKSUM_NATIVE(sum);
+      uint16_t            w0;
+      uint16_t            w1;
+      uint16_t            w2;
+      uint16_t            w3;
+
+      while (len >= 8)
+        {
+          w0       = wsrc[0];
+          w1       = wsrc[1];
+          w2       = wsrc[2];
+          w3       = wsrc[3];
+          wdest[0] = w0;
+          wdest[1] = w1;
+          wdest[2] = w2;
+          wdest[3] = w3;
+          acc     += (uint32_t)w0 + w1 + w2 + w3;
+          wdest   += 4;
+          wsrc    += 4;
+          len     -= 8;
+        }
+
+      while (len >= 2)
+        {
+          w0       = *wsrc++;
+          *wdest++ = w0;
+          acc     += w0;
+          len     -= 2;
+        }
+
+      if (len > 0)
+        {
+          uint8_t b = *(FAR const uint8_t *)wsrc;
+          *(FAR uint8_t *)wdest = b;
+          acc += CHKSUM_ODDBYTE(b);
+        }
+
+      return CHKSUM_NATIVE(chksum_fold(acc));
+    }
+
+  memcpy(dest, src, len);
+  return chksum(sum, (FAR const uint8_t *)dest, len);
+}
+#endif
+
 /* Calculate the IP header checksum of the packet header in d_buf. */
 
 #ifndef UIP_ARCH_IPCHKSUM
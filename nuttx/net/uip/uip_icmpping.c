@@ -245,6 +245,7 @@ static uint16_t ping_interrupt(struct uip_driver_s *dev, void *conn,
               nlldbg("Send ECHO request: seqno=%d\n", pstate->png_seqno);
 
               dev->d_sndlen = pstate->png_datlen + 4;
+              uip_sndsumreset(dev);
               uip_icmpsend(dev, &pstate->png_addr);
               pstate->png_sent = true;
               return flags;
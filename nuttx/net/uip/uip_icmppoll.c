@@ -94,6 +94,7 @@ void uip_icmppoll(struct uip_driver_s *dev)
 
   dev->d_len     = 0;
   dev->d_sndlen  = 0;
+  uip_sndsumreset(dev);
 
   /* Perform the application callback */
 
@@ -153,6 +153,7 @@ void uip_igmppoll(FAR struct uip_driver_s *dev)
 
   dev->d_len     = 0;
   dev->d_sndlen  = 0;
+  uip_sndsumreset(dev);
 
   /* Check each member of the group */
 
@@ -132,6 +132,7 @@ void uip_igmpsend(FAR struct uip_driver_s *dev, FAR struct igmp_group_s *group,
   /* The total size of the data is the size of the IGMP header */
 
   dev->d_sndlen        = UIP_IGMPH_LEN;
+  uip_sndsumreset(dev);
 
   /* Add the router alert option */
 
@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_initialize.c
  *
- *   Copyright (C) 2007-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Adapted for NuttX from logic in uIP which also has a BSD-like license:
@@ -119,6 +119,12 @@ void uip_initialize(void)
 
   uip_lockinit();
 
+  /* Initialize the shared pool of I/O buffers */
+
+#ifdef CONFIG_NET_IOB
+  uip_iobinit();
+#endif
+
   /* Initialize callback support */
 
   uip_callbackinit();
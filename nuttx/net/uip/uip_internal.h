@@ -56,6 +56,26 @@
  * Public Macro Definitions
  ****************************************************************************/
 
+/* Fold a 32-bit lookup key (such as a port number in network order, or a
+ * port pair XOR'ed with an IPv4 address) into an index into a hash table
+ * with n buckets.  n must be a power of two.
+ */
+
+#define uip_hash(key,n) \
+  ((unsigned int)(((key) >> 16) ^ ((key) >> 8) ^ (key)) & ((n) - 1))
+
+/* Discard the partial checksum of the send data computed by uip_send().
+ * This must be done wherever d_sndlen is set or the data after d_snddata
+ * may be rewritten without uip_send(), so that a stale sum is never used
+ * for a new or retransmitted packet.
+ */
+
+#ifdef CONFIG_NET_COPYCHKSUM
+#  define uip_sndsumreset(dev) ((dev)->d_sndsumlen = 0)
+#else
+#  define uip_sndsumreset(dev)
+#endif
+
 /****************************************************************************
  * Public Type Definitions
  ****************************************************************************/
@@ -94,6 +114,12 @@ extern "C" {
 #define EXTERN extern
 #endif
 
+/* Defined in uip_iob.c *****************************************************/
+
+#ifdef CONFIG_NET_IOB
+EXTERN void uip_iobinit(void);
+#endif
+
 /* Defined in uip_callback.c ************************************************/
 
 EXTERN void uip_callbackinit(void);
@@ -165,8 +191,11 @@ EXTERN uint16_t uip_datahandler(FAR struct uip_conn *conn,
 
 #if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
 EXTERN void uip_tcpreadaheadinit(void);
-EXTERN struct uip_readahead_s *uip_tcpreadaheadalloc(void);
-EXTERN void uip_tcpreadaheadrelease(struct uip_readahead_s *buf);
+EXTERN struct uip_readahead_s *uip_tcpreadaheadalloc(FAR struct uip_conn *conn);
+EXTERN void uip_tcpreadaheadrelease(FAR struct uip_conn *conn,
+                                    FAR struct uip_readahead_s *buf);
+EXTERN uint16_t uip_tcprcvwindow(FAR struct uip_conn *conn);
+EXTERN bool uip_tcpwndupdate(FAR struct uip_conn *conn);
 #endif /* CONFIG_NET_NTCP_READAHEAD_BUFFERS */
 
 #endif /* CONFIG_NET_TCP */
@@ -0,0 +1,249 @@
+/****************************************************************************
+ * net/uip/uip_iob.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_IOB)
+
+#include <stdint.h>
+#include <queue.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/mempool.h>
+#include <nuttx/net/uip/uip-arch.h>
+#include <nuttx/net/uip/uip-iob.h>
+
+#include "uip_internal.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The offset of the chain link within struct uip_iob_s.  io_data is the
+ * first field, so the packet data is at the same address as the I/O buffer.
+ */
+
+#define IOB_NODE_OFFSET ((size_t)&((FAR struct uip_iob_s *)0)->io_node)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The shared pool of I/O buffers and the storage that backs it */
+
+static struct mempool_s g_iobpool;
+static struct uip_iob_s g_iobs[CONFIG_NET_IOB_NBUFFERS];
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: uip_iobinit
+ *
+ * Description:
+ *   Set up the shared pool of I/O buffers.  Called once from
+ *   uip_initialize().
+ *
+ ****************************************************************************/
+
+void uip_iobinit(void)
+{
+  if (mempool_initialize(&g_iobpool, g_iobs, sizeof(struct uip_iob_s),
+                         CONFIG_NET_IOB_NBUFFERS, CONFIG_NET_IOB_NRESERVED) != OK)
+    {
+      ndbg("Failed to initialize the I/O buffer pool\n");
+    }
+}
+
+/****************************************************************************
+ * Name: uip_ioballoc
+ *
+ * Description:
+ *   Take one I/O buffer from the shared pool.  This function may be called
+ *   from interrupt handlers.
+ *
+ ****************************************************************************/
+
+FAR struct uip_iob_s *uip_ioballoc(void)
+{
+  FAR struct uip_iob_s *iob = (FAR struct uip_iob_s *)mempool_alloc(&g_iobpool);
+  if (iob)
+    {
+      iob->io_node.flink = NULL;
+      iob->io_len        = 0;
+    }
+
+  return iob;
+}
+
+/****************************************************************************
+ * Name: uip_iobfree and uip_iobfreechain
+ *
+ * Description:
+ *   Return one I/O buffer, or every I/O buffer in a chain, to the shared
+ *   pool.
+ *
+ ****************************************************************************/
+
+void uip_iobfree(FAR struct uip_iob_s *iob)
+{
+  DEBUGASSERT(mempool_contains(&g_iobpool, iob));
+  mempool_free(&g_iobpool, iob);
+}
+
+void uip_iobfreechain(FAR sq_queue_t *chain)
+{
+  FAR struct uip_iob_s *iob;
+
+  while ((iob = uip_iobdequeue(chain)) != NULL)
+    {
+      uip_iobfree(iob);
+    }
+}
+
+/****************************************************************************
+ * Name: uip_iobenqueue and uip_iobdequeue
+ *
+ * Description:
+ *   Add an I/O buffer to the end of a chain or remove the I/O buffer at the
+ *   head of a chain.
+ *
+ ****************************************************************************/
+
+void uip_iobenqueue(FAR sq_queue_t *chain, FAR struct uip_iob_s *iob)
+{
+  sq_addlast(&iob->io_node, chain);
+}
+
+FAR struct uip_iob_s *uip_iobdequeue(FAR sq_queue_t *chain)
+{
+  FAR sq_entry_t *node = sq_remfirst(chain);
+  if (node)
+    {
+      return (FAR struct uip_iob_s *)
+        ((FAR uint8_t *)node - IOB_NODE_OFFSET);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: uip_iobcontainer
+ *
+ * Description:
+ *   Return the I/O buffer that contains the packet data at 'buffer' or NULL
+ *   if 'buffer' is not the data of an I/O buffer.
+ *
+ ****************************************************************************/
+
+FAR struct uip_iob_s *uip_iobcontainer(FAR uint8_t *buffer)
+{
+  FAR struct uip_iob_s *iob = (FAR struct uip_iob_s *)buffer;
+
+  return mempool_contains(&g_iobpool, iob) ? iob : NULL;
+}
+
+/****************************************************************************
+ * Name: uip_iobattach
+ *
+ * Description:
+ *   Allocate an I/O buffer and make it the device's packet buffer.
+ *
+ ****************************************************************************/
+
+int uip_iobattach(FAR struct uip_driver_s *dev)
+{
+  FAR struct uip_iob_s *iob;
+
+  DEBUGASSERT(dev->d_buf == NULL);
+
+  iob = uip_ioballoc();
+  if (!iob)
+    {
+      return -ENOMEM;
+    }
+
+  dev->d_buf = iob->io_data;
+  dev->d_len = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: uip_iobdetach
+ *
+ * Description:
+ *   Take the I/O buffer holding the device's packet buffer away from the
+ *   device, saving the packet length in io_len.
+ *
+ ****************************************************************************/
+
+FAR struct uip_iob_s *uip_iobdetach(FAR struct uip_driver_s *dev)
+{
+  FAR struct uip_iob_s *iob;
+
+  if (!dev->d_buf)
+    {
+      return NULL;
+    }
+
+  iob = uip_iobcontainer(dev->d_buf);
+  DEBUGASSERT(iob != NULL);
+
+  iob->io_len = dev->d_len;
+  dev->d_buf  = NULL;
+  dev->d_len  = 0;
+  return iob;
+}
+
+/****************************************************************************
+ * Name: uip_iobinfo
+ *
+ * Description:
+ *   Return usage statistics for the shared pool.
+ *
+ ****************************************************************************/
+
+void uip_iobinfo(FAR struct mempoolinfo_s *info)
+{
+  mempool_info(&g_iobpool, info);
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_IOB */
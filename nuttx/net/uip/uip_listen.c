@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_listen.c
  *
- *   Copyright (C) 2007-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * A direct leverage of logic from uIP which also has b BSD style license
@@ -56,9 +56,13 @@
  * Private Data
  ****************************************************************************/
 
-/* The uip_listenports list all currently listening ports. */
+/* The uip_listenports hash table holds all currently listening connections,
+ * hashed by local port number and chained through lnext.  uip_nlisteners is
+ * the number of connections in the table.
+ */
 
-static struct uip_conn *uip_listenports[CONFIG_NET_MAX_LISTENPORTS];
+static FAR struct uip_conn *uip_listenports[CONFIG_NET_TCP_NHASH];
+static unsigned int uip_nlisteners;
 
 /****************************************************************************
  * Private Functions
@@ -77,18 +81,17 @@ static struct uip_conn *uip_listenports[CONFIG_NET_MAX_LISTENPORTS];
 
 struct uip_conn *uip_findlistener(uint16_t portno)
 {
-  int ndx;
+  struct uip_conn *conn;
 
-  /* Examine each connection structure in each slot of the listener list */
+  /* Examine each connection structure in the hash chain for this port */
 
-  for (ndx = 0; ndx < CONFIG_NET_MAX_LISTENPORTS; ndx++)
+  for (conn = uip_listenports[uip_hash((uint32_t)portno, CONFIG_NET_TCP_NHASH)];
+       conn;
+       conn = conn->lnext)
     {
-      /* Is this slot assigned?  If so, does the connection have the same
-       * local port number?
-       */
+      /* Does the connection have the same local port number? */
 
-      struct uip_conn *conn = uip_listenports[ndx];
-      if (conn && conn->lport == portno)
+      if (conn->lport == portno)
         {
           /* Yes.. we found a listener on this port */
 
@@ -120,10 +123,12 @@ struct uip_conn *uip_findlistener(uint16_t portno)
 void uip_listeninit(void)
 {
   int ndx;
-  for (ndx = 0; ndx < CONFIG_NET_MAX_LISTENPORTS; ndx++)
+  for (ndx = 0; ndx < CONFIG_NET_TCP_NHASH; ndx++)
     {
       uip_listenports[ndx] = NULL;
     }
+
+  uip_nlisteners = 0;
 }
 
 /****************************************************************************
@@ -139,16 +144,19 @@ void uip_listeninit(void)
 
 int uip_unlisten(struct uip_conn *conn)
 {
+  FAR struct uip_conn **pprev;
   uip_lock_t flags;
-  int ndx;
   int ret = -EINVAL;
 
   flags = uip_lock();
-  for (ndx = 0; ndx < CONFIG_NET_MAX_LISTENPORTS; ndx++)
+  for (pprev = &uip_listenports[uip_hash((uint32_t)conn->lport, CONFIG_NET_TCP_NHASH)];
+       *pprev;
+       pprev = &(*pprev)->lnext)
     {
-      if (uip_listenports[ndx] == conn)
+      if (*pprev == conn)
         {
-          uip_listenports[ndx] = NULL;
+          *pprev = conn->lnext;
+          uip_nlisteners--;
           ret = OK;
           break;
         }
@@ -197,20 +205,17 @@ int uip_listen(struct uip_conn *conn)
 
       ret = -ENOBUFS; /* Assume failure */
 
-      /* Search all slots until an available slot is found */
+      /* Is there room for another listener? */
 
-      for (ndx = 0; ndx < CONFIG_NET_MAX_LISTENPORTS; ndx++)
+      if (uip_nlisteners < CONFIG_NET_MAX_LISTENPORTS)
         {
-          /* Is the next slot available? */
+          /* Yes.. add the connection to the hash chain for its port */
 
-          if (!uip_listenports[ndx])
-            {
-              /* Yes.. we found it */
-
-              uip_listenports[ndx] = conn;
-              ret = OK;
-              break;
-            }
+          ndx                  = uip_hash((uint32_t)conn->lport, CONFIG_NET_TCP_NHASH);
+          conn->lnext          = uip_listenports[ndx];
+          uip_listenports[ndx] = conn;
+          uip_nlisteners++;
+          ret                  = OK;
         }
     }
 
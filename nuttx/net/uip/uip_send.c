@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_send.c
  *
- *   Copyright (C) 2007i, 2008 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2008, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Based in part on uIP which also has a BSD stylie license:
@@ -41,6 +41,8 @@
  * Included Files
  ****************************************************************************/
 
+#include <nuttx/config.h>
+
 #include <string.h>
 #include <debug.h>
 
@@ -100,7 +102,16 @@ void uip_send(struct uip_driver_s *dev, const void *buf, int len)
 
   if (dev && len > 0 && len < CONFIG_NET_BUFSIZE)
     {
+#ifdef CONFIG_NET_COPYCHKSUM
+      /* Copy the data and compute its checksum in the same pass.  The TCP
+       * or UDP send logic will then only need to sum the headers.
+       */
+
+      dev->d_sndsum    = uip_copychksum(dev->d_snddata, buf, len, 0);
+      dev->d_sndsumlen = len;
+#else
       memcpy(dev->d_snddata, buf, len);
+#endif
       dev->d_sndlen = len;
    }
 }
@@ -108,6 +108,7 @@ void uip_tcpappsend(struct uip_driver_s *dev, struct uip_conn *conn,
   if ((result & UIP_ABORT) != 0)
     {
       dev->d_sndlen = 0;
+      uip_sndsumreset(dev);
       conn->tcpstateflags = UIP_CLOSED;
       nllvdbg("TCP state: UIP_CLOSED\n");
 
@@ -124,6 +125,7 @@ void uip_tcpappsend(struct uip_driver_s *dev, struct uip_conn *conn,
       nllvdbg("TCP state: UIP_FIN_WAIT_1\n");
 
       dev->d_sndlen  = 0;
+      uip_sndsumreset(dev);
       uip_tcpsend(dev, conn, TCP_FIN | TCP_ACK, UIP_IPTCPH_LEN);
     }
 
@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_tcpcallback.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -159,8 +159,8 @@ uip_dataevent(FAR struct uip_driver_s *dev, FAR struct uip_conn *conn,
 
          nllvdbg("Dropped %d bytes\n", dev->d_len);
 
- #ifdef CONFIG_NET_STATISTICS
-          uip_stat.tcp.syndrop++;
+#ifdef CONFIG_NET_STATISTICS
+          uip_stat.tcp.rcvdrop++;
           uip_stat.tcp.drop++;
 #endif
           /* Clear the UIP_SNDACK bit so that no ACK will be sent */
@@ -299,7 +299,7 @@ uint16_t uip_datahandler(FAR struct uip_conn *conn, FAR uint8_t *buffer,
   readahead1 = (FAR struct uip_readahead_s*)conn->readahead.tail;
   if ((readahead1 &&
       (CONFIG_NET_TCP_READAHEAD_BUFSIZE - readahead1->rh_nbytes) > buflen) ||
-      (readahead2 = uip_tcpreadaheadalloc()) != NULL)
+      (readahead2 = uip_tcpreadaheadalloc(conn)) != NULL)
     {
       /* We have buffer space.  Now try to append add as much data as possible
        * to the last readahead buffer attached to this connection.
@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_tcpconn.c
  *
- *   Copyright (C) 2007-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Large parts of this file were leveraged from uIP logic:
@@ -61,6 +61,22 @@
 
 #include "uip_internal.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The key used to find a connection in the address/port pair hash table.
+ * With IPv6, only the port pair is used.
+ */
+
+#ifdef CONFIG_NET_IPv6
+#  define UIP_TCPKEY(addr,lport,rport) \
+     (((uint32_t)(lport) << 16) | (uint32_t)(rport))
+#else
+#  define UIP_TCPKEY(addr,lport,rport) \
+     ((((uint32_t)(lport) << 16) | (uint32_t)(rport)) ^ (uint32_t)(addr))
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -81,6 +97,19 @@ static dq_queue_t g_free_tcp_connections;
 
 static dq_queue_t g_active_tcp_connections;
 
+/* The active connections hashed by remote address and port pair (chained
+ * through hnext) so that uip_tcpactive() does not have to search the whole
+ * active list for each incoming segment.
+ */
+
+static FAR struct uip_conn *g_tcp_hash[CONFIG_NET_TCP_NHASH];
+
+/* All connections with an assigned local port hashed by that port (chained
+ * through pnext).  Used to determine if a local port is in use.
+ */
+
+static FAR struct uip_conn *g_tcp_porthash[CONFIG_NET_TCP_NHASH];
+
 /* Last port used by a TCP connection connection. */
 
 static uint16_t g_last_tcp_port;
@@ -89,6 +118,79 @@ static uint16_t g_last_tcp_port;
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: uip_tcphashadd() and uip_tcphashrem()
+ *
+ * Description:
+ *   Add a connection to, or remove a connection from, the address/port pair
+ *   hash table.  The connection's ripaddr, lport, and rport must not change
+ *   while it is in the table.
+ *
+ * Assumptions:
+ *   Interrupts are disabled
+ *
+ ****************************************************************************/
+
+static inline void uip_tcphashadd(FAR struct uip_conn *conn)
+{
+  unsigned int ndx = uip_hash(UIP_TCPKEY(conn->ripaddr, conn->lport, conn->rport),
+                              CONFIG_NET_TCP_NHASH);
+
+  conn->hnext     = g_tcp_hash[ndx];
+  g_tcp_hash[ndx] = conn;
+}
+
+static void uip_tcphashrem(FAR struct uip_conn *conn)
+{
+  FAR struct uip_conn **pprev;
+  unsigned int ndx = uip_hash(UIP_TCPKEY(conn->ripaddr, conn->lport, conn->rport),
+                              CONFIG_NET_TCP_NHASH);
+
+  for (pprev = &g_tcp_hash[ndx]; *pprev; pprev = &(*pprev)->hnext)
+    {
+      if (*pprev == conn)
+        {
+          *pprev = conn->hnext;
+          break;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: uip_porthashadd() and uip_porthashrem()
+ *
+ * Description:
+ *   Add a connection to, or remove a connection from, the local port hash
+ *   table.  Removing a connection that is not in the table does nothing.
+ *
+ * Assumptions:
+ *   Interrupts are disabled
+ *
+ ****************************************************************************/
+
+static inline void uip_porthashadd(FAR struct uip_conn *conn)
+{
+  unsigned int ndx = uip_hash((uint32_t)conn->lport, CONFIG_NET_TCP_NHASH);
+
+  conn->pnext         = g_tcp_porthash[ndx];
+  g_tcp_porthash[ndx] = conn;
+}
+
+static void uip_porthashrem(FAR struct uip_conn *conn)
+{
+  FAR struct uip_conn **pprev;
+  unsigned int ndx = uip_hash((uint32_t)conn->lport, CONFIG_NET_TCP_NHASH);
+
+  for (pprev = &g_tcp_porthash[ndx]; *pprev; pprev = &(*pprev)->pnext)
+    {
+      if (*pprev == conn)
+        {
+          *pprev = conn->pnext;
+          break;
+        }
+    }
+}
+
 /****************************************************************************
  * Name: uip_selectport()
  *
@@ -181,6 +283,14 @@ void uip_tcpinit(void)
   dq_init(&g_free_tcp_connections);
   dq_init(&g_active_tcp_connections);
 
+  /* Initialize the hash tables */
+
+  for (i = 0; i < CONFIG_NET_TCP_NHASH; i++)
+    {
+      g_tcp_hash[i]     = NULL;
+      g_tcp_porthash[i] = NULL;
+    }
+
   /* Now initialize each connection structure */
 
   for (i = 0; i < CONFIG_NET_TCP_CONNS; i++)
@@ -255,6 +365,8 @@ struct uip_conn *uip_tcpalloc(void)
       /* If we found one, remove it from the active connection list */
 
       dq_rem(&conn->node, &g_active_tcp_connections);
+      uip_tcphashrem(conn);
+      uip_porthashrem(conn);
     }
 #endif
 
@@ -265,6 +377,17 @@ struct uip_conn *uip_tcpalloc(void)
   if (conn)
     {
       conn->tcpstateflags = UIP_ALLOCATED;
+
+      /* Set the default read-ahead buffer quota.  This may be changed with
+       * SO_RCVBUF before the connection is established.
+       */
+
+#if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
+      conn->rhquota   = CONFIG_NET_TCP_READAHEAD_QUOTA;
+      conn->rhcount   = 0;
+      conn->rcvwnd    = 0;
+      conn->wndupdate = 0;
+#endif
     }
 
   return conn;
@@ -303,14 +426,19 @@ void uip_tcpfree(struct uip_conn *conn)
       /* Remove the connection from the active list */
 
       dq_rem(&conn->node, &g_active_tcp_connections);
+      uip_tcphashrem(conn);
     }
 
+  /* Release the local port, if one was bound */
+
+  uip_porthashrem(conn);
+
   /* Release any read-ahead buffers attached to the connection */
 
 #if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
   while ((readahead = (struct uip_readahead_s *)sq_remfirst(&conn->readahead)) != NULL)
     {
-      uip_tcpreadaheadrelease(readahead);
+      uip_tcpreadaheadrelease(conn, readahead);
     }
 #endif
 
@@ -353,9 +481,15 @@ void uip_tcpfree(struct uip_conn *conn)
 
 struct uip_conn *uip_tcpactive(struct uip_tcpip_hdr *buf)
 {
-  struct uip_conn *conn      = (struct uip_conn *)g_active_tcp_connections.head;
-  in_addr_t        srcipaddr = uip_ip4addr_conv(buf->srcipaddr);  
+  struct uip_conn *conn;
+  in_addr_t        srcipaddr = uip_ip4addr_conv(buf->srcipaddr);
+
+  /* Only the connections in the hash chain for this address/port pair
+   * need to be examined.
+   */
 
+  conn = g_tcp_hash[uip_hash(UIP_TCPKEY(srcipaddr, buf->destport, buf->srcport),
+                             CONFIG_NET_TCP_NHASH)];
   while (conn)
     {
       /* Find an open connection matching the tcp input */
@@ -371,9 +505,9 @@ struct uip_conn *uip_tcpactive(struct uip_tcpip_hdr *buf)
           break;
         }
 
-      /* Look at the next active connection */
+      /* Look at the next connection in the hash chain */
 
-      conn = (struct uip_conn *)conn->node.flink;
+      conn = conn->hnext;
     }
 
   return conn;
@@ -413,18 +547,23 @@ struct uip_conn *uip_nexttcpconn(struct uip_conn *conn)
  *   Primary uses: (1) to determine if a port number is available, (2) to
  *   To idenfity the socket that will accept new connections on a local port.
  *
+ * Assumptions:
+ *   Interrupts are disabled
+ *
  ****************************************************************************/
 
 struct uip_conn *uip_tcplistener(uint16_t portno)
 {
   struct uip_conn *conn;
-  int i;
 
-  /* Check if this port number is in use by any active UIP TCP connection */
- 
-  for (i = 0; i < CONFIG_NET_TCP_CONNS; i++)
+  /* Check if this port number is in use by any active UIP TCP connection.
+   * Only connections in the hash chain for this port need to be examined.
+   */
+
+  for (conn = g_tcp_porthash[uip_hash((uint32_t)portno, CONFIG_NET_TCP_NHASH)];
+       conn;
+       conn = conn->pnext)
     {
-      conn = &g_tcp_connections[i];
       if (conn->tcpstateflags != UIP_CLOSED && conn->lport == portno)
         {
           /* The portnumber is in use, return the connection */
@@ -432,6 +571,7 @@ struct uip_conn *uip_tcplistener(uint16_t portno)
           return conn;
         }
     }
+
   return NULL;
 }
 
@@ -460,6 +600,7 @@ struct uip_conn *uip_tcpaccept(struct uip_tcpip_hdr *buf)
       conn->sa            = 0;
       conn->sv            = 4;
       conn->nrtx          = 0;
+      conn->winsize       = 0;
       conn->lport         = buf->destport;
       conn->rport         = buf->srcport;
       uip_ipaddr_copy(conn->ripaddr, uip_ip4addr_conv(buf->srcipaddr));
@@ -478,11 +619,14 @@ struct uip_conn *uip_tcpaccept(struct uip_tcpip_hdr *buf)
       sq_init(&conn->readahead);
 #endif
 
-      /* And, finally, put the connection structure into the active list.
-       * Interrupts should already be disabled in this context.
+      /* And, finally, put the connection structure into the active list
+       * and hash tables.  Interrupts should already be disabled in this
+       * context.
        */
 
       dq_addlast(&conn->node, &g_active_tcp_connections);
+      uip_tcphashadd(conn);
+      uip_porthashadd(conn);
     }
   return conn;
 }
@@ -515,19 +659,26 @@ int uip_tcpbind(struct uip_conn *conn, const struct sockaddr_in *addr)
 
   flags = uip_lock();
   port = uip_selectport(ntohs(addr->sin_port));
-  uip_unlock(flags);
-
   if (port < 0)
     {
+      uip_unlock(flags);
       return port;
     }
 
-  /* Save the local address in the connection structure.  Note that the requested
-   * local IP address is saved but not used.  At present, only a single network
-   * interface is supported, the IP address is not of importance.
+  /* Save the local address in the connection structure and claim the port.
+   * Note that the requested local IP address is saved but not used.  At
+   * present, only a single network interface is supported, the IP address
+   * is not of importance.
    */
 
+  uip_porthashrem(conn);
   conn->lport = addr->sin_port;
+  if (conn->lport != 0)
+    {
+      uip_porthashadd(conn);
+    }
+
+  uip_unlock(flags);
 
 #if 0 /* Not used */
 #ifdef CONFIG_NET_IPv6
@@ -600,6 +751,7 @@ int uip_tcpconnect(struct uip_conn *conn, const struct sockaddr_in *addr)
   conn->initialmss = conn->mss = UIP_TCP_MSS;
   conn->unacked    = 1;    /* TCP length of the SYN is one. */
   conn->nrtx       = 0;
+  conn->winsize    = 0;    /* Set when the SYNACK is received */
   conn->timer      = 1;    /* Send the SYN next time around. */
   conn->rto        = UIP_RTO;
   conn->sa         = 0;
@@ -621,13 +773,21 @@ int uip_tcpconnect(struct uip_conn *conn, const struct sockaddr_in *addr)
 #endif
 
   /* And, finally, put the connection structure into the active
-   * list. Because g_active_tcp_connections is accessed from user level and
+   * list and hash tables. Because these are accessed from user level and
    * interrupt level, code, it is necessary to keep interrupts disabled during
    * this operation.
    */
 
   flags = uip_lock();
   dq_addlast(&conn->node, &g_active_tcp_connections);
+  uip_tcphashadd(conn);
+
+  /* If the connection was bound, uip_tcpbind() has already added it to the
+   * local port hash table (under the same port).
+   */
+
+  uip_porthashrem(conn);
+  uip_porthashadd(conn);
   uip_unlock(flags);
 
   return OK;
@@ -436,6 +436,15 @@ found:
        conn->timer = conn->rto;
     }
 
+  /* Remember the receive window advertised by the peer.  This limits the
+   * amount of data that send() may have outstanding.
+   */
+
+  if ((pbuf->flags & TCP_ACK) != 0)
+    {
+      conn->winsize = ((uint16_t)pbuf->wnd[0] << 8) | (uint16_t)pbuf->wnd[1];
+    }
+
   /* Do different things depending on in what state the connection is. */
 
   switch (conn->tcpstateflags & UIP_TS_MASK)
@@ -468,6 +477,7 @@ found:
               }
 
             dev->d_sndlen       = 0;
+            uip_sndsumreset(dev);
             result              = uip_tcpcallback(dev, conn, flags);
             uip_tcpappsend(dev, conn, result);
             return;
@@ -553,6 +563,7 @@ found:
             conn->unacked       = 0;
             dev->d_len          = 0;
             dev->d_sndlen       = 0;
+            uip_sndsumreset(dev);
             result = uip_tcpcallback(dev, conn, UIP_CONNECTED | UIP_NEWDATA);
             uip_tcpappsend(dev, conn, result);
             return;
@@ -705,6 +716,7 @@ found:
              */
 
             dev->d_sndlen = 0;
+            uip_sndsumreset(dev);
             len           = dev->d_len;
 
             /* Provide the packet to the application */
@@ -2,7 +2,7 @@
  * net/uip/uip_tcppoll.c
  * Poll for the availability of TCP TX data
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Adapted for NuttX from logic in uIP which also has a BSD-like license:
@@ -107,11 +107,24 @@ void uip_tcppoll(struct uip_driver_s *dev, struct uip_conn *conn)
 
       dev->d_len     = 0;
       dev->d_sndlen  = 0;
+      uip_sndsumreset(dev);
 
       /* Perfom the callback */
 
       result = uip_tcpcallback(dev, conn, UIP_POLL);
 
+      /* If read-ahead buffers were freed since the last window was
+       * advertised, send a window update (an ACK) if there is no data to
+       * carry it.
+       */
+
+#if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
+      if (conn->wndupdate)
+        {
+          result |= UIP_SNDACK;
+        }
+#endif
+
       /* Handle the callback response */
 
       uip_tcpappsend(dev, conn, result);
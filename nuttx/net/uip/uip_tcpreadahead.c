@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_tcpreadahead.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -40,7 +40,10 @@
 #include <nuttx/net/uip/uipopt.h>
 #if defined(CONFIG_NET) && defined(CONFIG_NET_TCP) && (CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0)
 
+#include <stdint.h>
+#include <stdbool.h>
 #include <queue.h>
+#include <assert.h>
 #include <debug.h>
 
 #include <nuttx/net/uip/uip.h>
@@ -59,6 +62,10 @@ static struct uip_readahead_s g_buffers[CONFIG_NET_NTCP_READAHEAD_BUFFERS];
 
 static sq_queue_t g_freebuffers;
 
+/* This is the number of buffers in g_freebuffers */
+
+static uint16_t g_nfreebuffers;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -87,6 +94,8 @@ void uip_tcpreadaheadinit(void)
     {
       sq_addfirst(&g_buffers[i].rh_node, &g_freebuffers);
     }
+
+  g_nfreebuffers = CONFIG_NET_NTCP_READAHEAD_BUFFERS;
 }
 
 /****************************************************************************
@@ -99,14 +108,29 @@ void uip_tcpreadaheadinit(void)
  *   the data.  Note: malloc() cannot be used because this function is
  *   called from interrupt level.
  *
+ *   NULL is returned if there are no free buffers or if the connection
+ *   already holds as many buffers as its quota permits.
+ *
  * Assumptions:
  *   Called from interrupt level with interrupts disabled.
  *
  ****************************************************************************/
 
-struct uip_readahead_s *uip_tcpreadaheadalloc(void)
+struct uip_readahead_s *uip_tcpreadaheadalloc(FAR struct uip_conn *conn)
 {
-  return (struct uip_readahead_s*)sq_remfirst(&g_freebuffers);
+  FAR struct uip_readahead_s *buf = NULL;
+
+  if (conn->rhcount < conn->rhquota)
+    {
+      buf = (struct uip_readahead_s*)sq_remfirst(&g_freebuffers);
+      if (buf)
+        {
+          g_nfreebuffers--;
+          conn->rhcount++;
+        }
+    }
+
+  return buf;
 }
 
 /****************************************************************************
@@ -122,9 +146,97 @@ struct uip_readahead_s *uip_tcpreadaheadalloc(void)
  *
  ****************************************************************************/
 
-void uip_tcpreadaheadrelease(struct uip_readahead_s *buf)
+void uip_tcpreadaheadrelease(FAR struct uip_conn *conn,
+                             FAR struct uip_readahead_s *buf)
 {
+  DEBUGASSERT(conn->rhcount > 0);
+  conn->rhcount--;
+
   sq_addfirst(&buf->rh_node, &g_freebuffers);
+  g_nfreebuffers++;
+}
+
+/****************************************************************************
+ * Function: uip_tcprcvwindow
+ *
+ * Description:
+ *   Return the receive window to be advertised for this connection:  The
+ *   amount of incoming data that could be retained in read-ahead buffers
+ *   now.  That is the space remaining in the last buffer held by the
+ *   connection plus the free buffers that the connection could still
+ *   claim.  The window is never larger than CONFIG_NET_RECEIVE_WINDOW.
+ *
+ * Assumptions:
+ *   Called from interrupt level with interrupts disabled.
+ *
+ ****************************************************************************/
+
+uint16_t uip_tcprcvwindow(FAR struct uip_conn *conn)
+{
+  FAR struct uip_readahead_s *tail;
+  uint32_t window = 0;
+  uint16_t nbuffers;
+
+  /* Free buffers that this connection may still allocate */
+
+  if (conn->rhquota > conn->rhcount)
+    {
+      nbuffers = conn->rhquota - conn->rhcount;
+      if (nbuffers > g_nfreebuffers)
+        {
+          nbuffers = g_nfreebuffers;
+        }
+
+      window = (uint32_t)nbuffers * CONFIG_NET_TCP_READAHEAD_BUFSIZE;
+    }
+
+  /* Plus the unused space at the end of the last buffer */
+
+  tail = (FAR struct uip_readahead_s *)conn->readahead.tail;
+  if (tail)
+    {
+      window += CONFIG_NET_TCP_READAHEAD_BUFSIZE - tail->rh_nbytes;
+    }
+
+  if (window > CONFIG_NET_RECEIVE_WINDOW)
+    {
+      window = CONFIG_NET_RECEIVE_WINDOW;
+    }
+
+  return (uint16_t)window;
+}
+
+/****************************************************************************
+ * Function: uip_tcpwndupdate
+ *
+ * Description:
+ *   Called after read-ahead data has been consumed by recv().  If the
+ *   receive window has opened by at least one buffer since it was last
+ *   advertised, mark the connection so that the next poll will send a
+ *   window update to the peer.
+ *
+ * Returned Value:
+ *   true if a window update is needed.  The caller should then notify the
+ *   driver that there is TX data.
+ *
+ * Assumptions:
+ *   Called from user logic BUT with interrupts disabled.
+ *
+ ****************************************************************************/
+
+bool uip_tcpwndupdate(FAR struct uip_conn *conn)
+{
+  uint16_t window = uip_tcprcvwindow(conn);
+
+  if (window >= conn->rcvwnd + CONFIG_NET_TCP_READAHEAD_BUFSIZE ||
+      (conn->rcvwnd == 0 && window > 0))
+    {
+      nllvdbg("Window update: %d->%d\n", conn->rcvwnd, window);
+      conn->wndupdate = 1;
+      return true;
+    }
+
+  return false;
 }
 
 #endif /* CONFIG_NET && CONFIG_NET_TCP && CONFIG_NET_NTCP_READAHEAD_BUFFERS*/
@@ -196,8 +196,22 @@ static void uip_tcpsendcommon(struct uip_driver_s *dev, struct uip_conn *conn)
     }
   else
     {
+#if CONFIG_NET_NTCP_READAHEAD_BUFFERS > 0
+      /* Advertise only as much as could be retained in read-ahead buffers
+       * so that the peer does not send data that would have to be dropped.
+       * Any pending window update is satisfied by this segment.
+       */
+
+      uint16_t window = uip_tcprcvwindow(conn);
+
+      conn->rcvwnd    = window;
+      conn->wndupdate = 0;
+      pbuf->wnd[0]    = (window >> 8);
+      pbuf->wnd[1]    = (window & 0xff);
+#else
       pbuf->wnd[0] = ((CONFIG_NET_RECEIVE_WINDOW) >> 8);
       pbuf->wnd[1] = ((CONFIG_NET_RECEIVE_WINDOW) & 0xff);
+#endif
     }
 
   /* Finish the IP portion of the message, calculate checksums and send
@@ -108,6 +108,7 @@ void uip_tcptimer(struct uip_driver_s *dev, struct uip_conn *conn, int hsec)
 
   dev->d_len    = 0;
   dev->d_sndlen = 0;
+  uip_sndsumreset(dev);
 
   /* Check if the connection is in a state in which we simply wait
    * for the connection to time out. If so, we increase the
@@ -1,7 +1,7 @@
 /****************************************************************************
  * net/uip/uip_udpconn.c
  *
- *   Copyright (C) 2007-2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Large parts of this file were leveraged from uIP logic:
@@ -48,6 +48,7 @@
 #if defined(CONFIG_NET) && defined(CONFIG_NET_UDP)
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <semaphore.h>
 #include <assert.h>
@@ -79,6 +80,14 @@ static sem_t g_free_sem;
 
 static dq_queue_t g_active_udp_connections;
 
+/* The active connections hashed by local port number (chained through
+ * hnext) so that uip_udpactive() does not have to search the whole active
+ * list for each incoming datagram.  Within a chain, connections are kept in
+ * the order in which they were enabled.
+ */
+
+static FAR struct uip_udp_conn *g_udp_hash[CONFIG_NET_UDP_NHASH];
+
 /* Last port used by a UDP connection connection. */
 
 static uint16_t g_last_udp_port;
@@ -137,6 +146,76 @@ static struct uip_udp_conn *uip_find_conn(uint16_t portno)
   return NULL;
 }
 
+/****************************************************************************
+ * Name: uip_udphashadd() and uip_udphashrem()
+ *
+ * Description:
+ *   Add a connection to the tail of the hash chain for its local port, or
+ *   remove it from that chain.  uip_udphashrem() returns true if the
+ *   connection was found in the hash table.
+ *
+ * Assumptions:
+ *   Interrupts are disabled
+ *
+ ****************************************************************************/
+
+static void uip_udphashadd(FAR struct uip_udp_conn *conn)
+{
+  FAR struct uip_udp_conn **pprev;
+
+  pprev = &g_udp_hash[uip_hash((uint32_t)conn->lport, CONFIG_NET_UDP_NHASH)];
+  while (*pprev)
+    {
+      pprev = &(*pprev)->hnext;
+    }
+
+  conn->hnext = NULL;
+  *pprev      = conn;
+}
+
+static bool uip_udphashrem(FAR struct uip_udp_conn *conn)
+{
+  FAR struct uip_udp_conn **pprev;
+
+  for (pprev = &g_udp_hash[uip_hash((uint32_t)conn->lport, CONFIG_NET_UDP_NHASH)];
+       *pprev;
+       pprev = &(*pprev)->hnext)
+    {
+      if (*pprev == conn)
+        {
+          *pprev = conn->hnext;
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: uip_udpsetport()
+ *
+ * Description:
+ *   Set the local port number of the connection, moving the connection to
+ *   the correct hash chain if it is enabled.
+ *
+ * Assumptions:
+ *   Interrupts are disabled
+ *
+ ****************************************************************************/
+
+static void uip_udpsetport(FAR struct uip_udp_conn *conn, uint16_t portno)
+{
+  if (uip_udphashrem(conn))
+    {
+      conn->lport = portno;
+      uip_udphashadd(conn);
+    }
+  else
+    {
+      conn->lport = portno;
+    }
+}
+
 /****************************************************************************
  * Name: uip_selectport()
  *
@@ -216,6 +295,11 @@ void uip_udpinit(void)
   dq_init(&g_active_udp_connections);
   sem_init(&g_free_sem, 0, 1);
 
+  for (i = 0; i < CONFIG_NET_UDP_NHASH; i++)
+    {
+      g_udp_hash[i] = NULL;
+    }
+
   for (i = 0; i < CONFIG_NET_UDP_CONNS; i++)
     {
       /* Mark the connection closed and move it to the free list */
@@ -293,8 +377,13 @@ void uip_udpfree(struct uip_udp_conn *conn)
 
 struct uip_udp_conn *uip_udpactive(struct uip_udpip_hdr *buf)
 {
-  struct uip_udp_conn *conn = (struct uip_udp_conn *)g_active_udp_connections.head;
+  struct uip_udp_conn *conn;
+
+  /* Only the connections in the hash chain for the destination port need
+   * to be examined.
+   */
 
+  conn = g_udp_hash[uip_hash((uint32_t)buf->destport, CONFIG_NET_UDP_NHASH)];
   while (conn)
     {
       /* If the local UDP port is non-zero, the connection is considered
@@ -316,9 +405,9 @@ struct uip_udp_conn *uip_udpactive(struct uip_udpip_hdr *buf)
           break;
         }
 
-      /* Look at the next active connection */
+      /* Look at the next connection in the hash chain */
 
-      conn = (struct uip_udp_conn *)conn->node.flink;
+      conn = conn->hnext;
     }
 
   return conn;
@@ -368,6 +457,7 @@ int uip_udpbind(struct uip_udp_conn *conn, const struct sockaddr_in *addr)
 {
   int ret = -EADDRINUSE;
   uip_lock_t flags;
+  uint16_t portno;
 
   /* Is the user requesting to bind to any port? */
 
@@ -375,8 +465,12 @@ int uip_udpbind(struct uip_udp_conn *conn, const struct sockaddr_in *addr)
     {
       /* Yes.. Find an unused local port number */
 
-      conn->lport = htons(uip_selectport());
-      ret         = OK;
+      portno = htons(uip_selectport());
+
+      flags = uip_lock();
+      uip_udpsetport(conn, portno);
+      uip_unlock(flags);
+      ret   = OK;
     }
   else
     {
@@ -390,8 +484,8 @@ int uip_udpbind(struct uip_udp_conn *conn, const struct sockaddr_in *addr)
         {
           /* No.. then bind the socket to the port */
 
-          conn->lport = addr->sin_port;
-          ret         = OK;
+          uip_udpsetport(conn, addr->sin_port);
+          ret = OK;
         }
 
       uip_unlock(flags);
@@ -425,6 +519,9 @@ int uip_udpconnect(struct uip_udp_conn *conn, const struct sockaddr_in6 *addr)
 int uip_udpconnect(struct uip_udp_conn *conn, const struct sockaddr_in *addr)
 #endif
 {
+  uip_lock_t flags;
+  uint16_t portno;
+
   /* Has this address already been bound to a local port (lport)? */
 
   if (!conn->lport)
@@ -433,7 +530,11 @@ int uip_udpconnect(struct uip_udp_conn *conn, const struct sockaddr_in *addr)
        * connection structure.
        */
 
-      conn->lport = htons(uip_selectport());
+      portno = htons(uip_selectport());
+
+      flags = uip_lock();
+      uip_udpsetport(conn, portno);
+      uip_unlock(flags);
     }
 
   /* Is there a remote port (rport) */
@@ -473,6 +574,7 @@ void uip_udpenable(struct uip_udp_conn *conn)
 
   uip_lock_t flags = uip_lock();
   dq_addlast(&conn->node, &g_active_udp_connections);
+  uip_udphashadd(conn);
   uip_unlock(flags);
 }
 
@@ -485,6 +587,7 @@ void uip_udpdisable(struct uip_udp_conn *conn)
 
   uip_lock_t flags = uip_lock();
   dq_rem(&conn->node, &g_active_udp_connections);
+  (void)uip_udphashrem(conn);
   uip_unlock(flags);
 }
 
@@ -131,6 +131,7 @@ void uip_udpinput(struct uip_driver_s *dev)
           dev->d_appdata = &dev->d_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
           dev->d_snddata = &dev->d_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
           dev->d_sndlen  = 0;
+          uip_sndsumreset(dev);
 
           /* Perform the application callback */
 
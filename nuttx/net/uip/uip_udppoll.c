@@ -104,6 +104,7 @@ void uip_udppoll(struct uip_driver_s *dev, struct uip_udp_conn *conn)
 
       dev->d_len     = 0;
       dev->d_sndlen  = 0;
+      uip_sndsumreset(dev);
 
       /* Perform the application callback */
 
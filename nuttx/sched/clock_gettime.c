@@ -1,7 +1,7 @@
 /************************************************************************
  * sched/clock_gettime.c
  *
- *   Copyright (C) 2007, 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -132,7 +132,11 @@ int clock_gettime(clockid_t clock_id, struct timespec *tp)
            * as appropriate.
            */
 
-          msecs = MSEC_PER_TICK * (g_system_timer - g_tickbias);
+#ifdef CONFIG_SYSTEM_TIME64
+          msecs = MSEC_PER_TICK * (clock_systimer64() - g_tickbias);
+#else
+          msecs = MSEC_PER_TICK * (clock_systimer() - g_tickbias);
+#endif
 
           sdbg("msecs = %d g_tickbias=%d\n",
                (int)msecs, (int)g_tickbias);
@@ -1,7 +1,7 @@
 /************************************************************************
  * sched/clock_settime.c
  *
- *   Copyright (C) 2007, 2009, 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -122,7 +122,11 @@ int clock_settime(clockid_t clock_id, FAR const struct timespec *tp)
        * as appropriate.
        */
 
-      g_tickbias = g_system_timer;
+#ifdef CONFIG_SYSTEM_TIME64
+      g_tickbias = clock_systimer64();
+#else
+      g_tickbias = clock_systimer();
+#endif
 
       /* Setup the RTC (lo- or high-res) */
 
@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/clock_systimer.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -40,7 +40,9 @@
 #include <nuttx/config.h>
 
 #include <stdint.h>
+#include <time.h>
 
+#include <nuttx/arch.h>
 #include <nuttx/clock.h>
 
 #include "clock_internal.h"
@@ -53,6 +55,44 @@
  * Private Data
  ****************************************************************************/
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Function:  clock_hwticks
+ *
+ * Description:
+ *   In the tickless mode, there is no periodic interrupt to increment
+ *   g_system_timer.  Instead, the system time is derived from the free-
+ *   running counter provided by the platform-specific logic.  The time is
+ *   truncated (not rounded) to whole ticks so that it increments
+ *   monotonically at the tick boundaries.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+#ifdef CONFIG_SYSTEM_TIME64
+static inline uint64_t clock_hwticks(void)
+{
+  struct timespec ts;
+
+  (void)up_timer_gettime(&ts);
+  return (uint64_t)ts.tv_sec * TICK_PER_SEC +
+         (uint64_t)ts.tv_nsec / NSEC_PER_TICK;
+}
+#else
+static inline uint32_t clock_hwticks(void)
+{
+  struct timespec ts;
+
+  (void)up_timer_gettime(&ts);
+  return (uint32_t)ts.tv_sec * TICK_PER_SEC +
+         (uint32_t)ts.tv_nsec / NSEC_PER_TICK;
+}
+#endif
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -76,7 +116,9 @@
 #if !defined(clock_systimer) /* See nuttx/clock.h */
 uint32_t clock_systimer(void)
 {
-#ifdef CONFIG_SYSTEM_TIME64
+#if defined(CONFIG_SCHED_TICKLESS)
+  return (uint32_t)clock_hwticks();
+#elif defined(CONFIG_SYSTEM_TIME64)
   return (uint32_t)(g_system_timer & 0x00000000ffffffff);
 #else
   return g_system_timer;
@@ -100,11 +142,13 @@ uint32_t clock_systimer(void)
  *
  ****************************************************************************/
 
-#if !defined(clock_systimer) /* See nuttx/clock.h */
-#ifdef CONFIG_SYSTEM_TIME64
+#if defined(CONFIG_SYSTEM_TIME64) && !defined(clock_systimer64) /* See nuttx/clock.h */
 uint64_t clock_systimer64(void)
 {
+#ifdef CONFIG_SCHED_TICKLESS
+  return clock_hwticks();
+#else
   return g_system_timer;
-}
 #endif
+}
 #endif
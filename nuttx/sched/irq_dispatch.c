@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/irq_dispatch.c
  *
- *   Copyright (C) 2007, 2008 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2008, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -42,6 +42,7 @@
 #include <debug.h>
 #include <nuttx/arch.h>
 #include <nuttx/irq.h>
+#include <nuttx/sched_note.h>
 
 #include "irq_internal.h"
 
@@ -100,6 +101,8 @@ void irq_dispatch(int irq, FAR void *context)
 
   /* Then dispatch to the interrupt handler */
 
+  sched_note_irqhandler(irq, true);
   vector(irq, context);
+  sched_note_irqhandler(irq, false);
 }
 
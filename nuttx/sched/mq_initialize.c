@@ -43,6 +43,7 @@
 #include <queue.h>
 #include <nuttx/kmalloc.h>
 
+#include "os_internal.h"
 #include "mq_internal.h"
 
 /************************************************************************
@@ -71,18 +72,13 @@ struct mq_des_block_s
 
 sq_queue_t  g_msgqueues;
 
-/* The g_msgfree is a list of messages that are available
- * for general use.  The number of messages in this list is a
- * system configuration item.
- */
-
-sq_queue_t  g_msgfree;
-
-/* The g_msgfreeInt is a list of messages that are reserved
+/* The g_msgpool is the pool of pre-allocated messages.  The
+ * number of messages for general use is a system configuration
+ * item;  an additional NUM_INTERRUPT_MSGS messages are reserved
  * for use by interrupt handlers.
  */
 
-sq_queue_t  g_msgfreeirq;
+struct mempool_s g_msgpool;
 
 /* The g_desfree data structure is a list of message
  * descriptors available to the operating system for general use.
@@ -95,18 +91,6 @@ sq_queue_t  g_desfree;
  * Private Variables
  ************************************************************************/
 
-/* g_msgalloc is a pointer to the start of the allocated
- * block of messages.
- */
-
-static mqmsg_t    *g_msgalloc;
-
-/* g_msgfreeirqalloc is a pointer to the start of the
- * allocated block of messages.
- */
-
-static mqmsg_t    *g_msgfreeirqalloc;
-
 /* g_desalloc is a list of allocated block of message queue
  * descriptors.
  */
@@ -117,43 +101,6 @@ static sq_queue_t  g_desalloc;
  * Private Functions
  ************************************************************************/
 
-/************************************************************************
- * Function: mq_msgblockalloc
- *
- * Description:
- *   Allocate a block of messages and place them on the free
- *   list.
- *
- *
- * Inputs:
- *  queue
- ************************************************************************/
-
-static mqmsg_t *mq_msgblockalloc(sq_queue_t *queue, uint16_t nmsgs,
-                                 uint8_t alloc_type)
-{
-  mqmsg_t *mqmsgblock;
-
-  /* The g_msgfree must be loaded at initialization time to hold the
-   * configured number of messages.
-   */
-
-  mqmsgblock = (mqmsg_t*)kmalloc(sizeof(mqmsg_t) * nmsgs);
-  if (mqmsgblock)
-    {
-      mqmsg_t *mqmsg = mqmsgblock;
-      int      i;
-
-      for (i = 0; i < nmsgs; i++)
-        {
-          mqmsg->type = alloc_type;
-          sq_addlast((FAR sq_entry_t*)mqmsg++, queue);
-        }
-    }
-
-  return mqmsgblock;
-}
-
 /************************************************************************
  * Public Functions
  ************************************************************************/
@@ -181,25 +128,20 @@ void mq_initialize(void)
 
   sq_init(&g_msgqueues);
 
-  /* Initialize the message free lists */
+  /* Initialize the list of allocated message descriptor blocks */
 
-  sq_init(&g_msgfree);
-  sq_init(&g_msgfreeirq);
   sq_init(&g_desalloc);
 
-  /* Allocate a block of messages for general use */
-
-  g_msgalloc =
-    mq_msgblockalloc(&g_msgfree, CONFIG_PREALLOC_MQ_MSGS,
-                     MQ_ALLOC_FIXED);
-
-  /* Allocate a block of messages for use exclusively by
-   * interrupt handlers
+  /* Allocate a pool of messages for general use plus a reserve of
+   * messages for use exclusively by interrupt handlers
    */
 
-  g_msgfreeirqalloc =
-    mq_msgblockalloc(&g_msgfreeirq, NUM_INTERRUPT_MSGS,
-                     MQ_ALLOC_IRQ);
+  if (mempool_create(&g_msgpool, sizeof(mqmsg_t),
+                     CONFIG_PREALLOC_MQ_MSGS + NUM_INTERRUPT_MSGS,
+                     NUM_INTERRUPT_MSGS) < 0)
+    {
+      PANIC(OSERR_OUTOFMEMORY);
+    }
 
   /* Allocate a block of message queue descriptors */
 
@@ -87,36 +87,14 @@
 
 void mq_msgfree(FAR mqmsg_t *mqmsg)
 {
-  irqstate_t saved_state;
-
-  /* If this is a generally available pre-allocated message,
-   * then just put it back in the free list.
+  /* If this is a pre-allocated message, then just put it back in the
+   * pool.  The pool protects itself from concurrent access by interrupt
+   * handlers.
    */
 
   if (mqmsg->type == MQ_ALLOC_FIXED)
     {
-      /* Make sure we avoid concurrent access to the free
-       * list from interrupt handlers.
-       */
-
-      saved_state = irqsave();
-      sq_addlast((FAR sq_entry_t*)mqmsg, &g_msgfree);
-      irqrestore(saved_state);
-    }
-
-  /* If this is a message pre-allocated for interrupts,
-   * then put it back in the correct  free list.
-   */
-
-  else if (mqmsg->type == MQ_ALLOC_IRQ)
-    {
-      /* Make sure we avoid concurrent access to the free
-       * list from interrupt handlers.
-       */
-
-      saved_state = irqsave();
-      sq_addlast((FAR sq_entry_t*)mqmsg, &g_msgfreeirq);
-      irqrestore(saved_state);
+      mempool_free(&g_msgpool, mqmsg);
     }
 
   /* Otherwise, deallocate it.  Note:  interrupt handlers
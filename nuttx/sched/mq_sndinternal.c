@@ -138,16 +138,16 @@ int mq_verifysend(mqd_t mqdes, const void *msg, size_t msglen, int prio)
  *
  * Description:
  *   The mq_msgalloc function will get a free message for use by the
- *   operating system.  The message will be allocated from the g_msgfree list.
+ *   operating system.  The message will be allocated from the g_msgpool.
  *
- *   If the list is empty AND the message is NOT being allocated from the
+ *   If the pool is empty AND the message is NOT being allocated from the
  *   interrupt level, then the message will be allocated.  If a message
  *   cannot be obtained, the operating system is dead and therefore cannot
  *   continue.
  *
- *   If the list is empty AND the message IS being allocated from the
- *   interrupt level.  This function will attempt to get a message from 
- *   the g_msgfreeirq list.  If this is unsuccessful, the calling interrupt
+ *   If the message IS being allocated from the interrupt level, then the
+ *   pool will also provide messages from the reserve set aside for
+ *   interrupt handlers.  If this is unsuccessful, the calling interrupt
  *   handler will be notified.
  *
  * Inputs:
@@ -162,58 +162,39 @@ int mq_verifysend(mqd_t mqdes, const void *msg, size_t msglen, int prio)
 FAR mqmsg_t *mq_msgalloc(void)
 {
   FAR mqmsg_t *mqmsg;
-  irqstate_t   saved_state;
 
-  /* If we were called from an interrupt handler, then try to get the message
-   * from generally available list of messages. If this fails, then try the
-   * list of messages reserved for interrupt handlers
+  /* Try to get the message from the pool of pre-allocated messages.  If we
+   * were called from an interrupt handler, then the pool will also provide
+   * messages from the reserve set aside for interrupt handlers.
    */
 
-  if (up_interrupt_context())
+  mqmsg = (FAR mqmsg_t*)mempool_alloc(&g_msgpool);
+  if (mqmsg)
     {
-      /* Try the general free list */
-
-      mqmsg = (FAR mqmsg_t*)sq_remfirst(&g_msgfree);
-      if (!mqmsg)
-        {
-          /* Try the free list reserved for interrupt handlers */
-
-          mqmsg = (FAR mqmsg_t*)sq_remfirst(&g_msgfreeirq);
-        }
+      mqmsg->type = MQ_ALLOC_FIXED;
     }
 
-  /* We were not called from an interrupt handler. */
+  /* If we cannot get a message from the pool and we were not called from an
+   * interrupt handler, then we will have to allocate one.
+   */
 
-  else
+  else if (!up_interrupt_context())
     {
-      /* Try to get the message from the generally available free list.
-       * Disable interrupts -- we might be called from an interrupt handler.
-       */
-
-      saved_state = irqsave();
-      mqmsg = (FAR mqmsg_t*)sq_remfirst(&g_msgfree);
-      irqrestore(saved_state);
+      mqmsg = (FAR mqmsg_t *)kmalloc((sizeof (mqmsg_t)));
 
-      /* If we cannot a message from the free list, then we will have to allocate one. */
+      /* Check if we got an allocated message */
 
-      if (!mqmsg)
+      if (mqmsg)
         {
-          mqmsg = (FAR mqmsg_t *)kmalloc((sizeof (mqmsg_t)));
-
-          /* Check if we got an allocated message */
-
-          if (mqmsg)
-            {
-              mqmsg->type = MQ_ALLOC_DYN;
-            }
+          mqmsg->type = MQ_ALLOC_DYN;
+        }
 
-          /* No?  We are dead */
+      /* No?  We are dead */
 
-          else
-            {
-              sdbg("Out of messages\n");
-              PANIC((uint32_t)OSERR_OUTOFMESSAGES);
-            }
+      else
+        {
+          sdbg("Out of messages\n");
+          PANIC((uint32_t)OSERR_OUTOFMESSAGES);
         }
     }
 
@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/os_bringup.c
  *
- *   Copyright (C) 2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2011-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * With extensions by:
@@ -111,10 +111,13 @@
  *
  *   - pg_worker:   The page-fault worker thread (only if CONFIG_PAGING is
  *                  defined.
- *   - work_thread: The work thread.  This general thread can be used to
+ *   - work_lpthread: The work thread.  This general thread can be used to
  *                  perform most any kind of queued work.  Its primary
  *                  function is to serve as the "bottom half" of device
  *                  drivers.
+ *   - work_hpthread: The high priority work thread (only if
+ *                  CONFIG_SCHED_HPWORK is defined).  This serves the
+ *                  latency sensitive "bottom halves" of device drivers.
  *
  *   And the main application entry point.  This may be one of two different
  *   symbols:
@@ -155,10 +158,21 @@ int os_bringup(void)
 #ifdef CONFIG_SCHED_WORKQUEUE
   svdbg("Starting worker thread\n");
 
-  g_worker = KERNEL_THREAD("work", CONFIG_SCHED_WORKPRIORITY,
-                           CONFIG_SCHED_WORKSTACKSIZE,
-                           (main_t)work_thread, (const char **)NULL);
-  ASSERT(g_worker != ERROR);
+  g_work[LPWORK].pid = KERNEL_THREAD("work", CONFIG_SCHED_WORKPRIORITY,
+                                     CONFIG_SCHED_WORKSTACKSIZE,
+                                     (main_t)work_lpthread, (const char **)NULL);
+  ASSERT(g_work[LPWORK].pid != ERROR);
+
+  /* Start the high priority worker thread for latency sensitive work */
+
+#ifdef CONFIG_SCHED_HPWORK
+  svdbg("Starting high priority worker thread\n");
+
+  g_work[HPWORK].pid = KERNEL_THREAD("hpwork", CONFIG_SCHED_HPWORKPRIORITY,
+                                     CONFIG_SCHED_HPWORKSTACKSIZE,
+                                     (main_t)work_hpthread, (const char **)NULL);
+  ASSERT(g_work[HPWORK].pid != ERROR);
+#endif
 #endif
 
   /* Once the operating system has been initialized, the system must be
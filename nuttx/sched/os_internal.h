@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/os_internal.h
  *
- *   Copyright (C) 2007-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -43,6 +43,7 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <queue.h>
 #include <sched.h>
@@ -98,6 +99,24 @@ enum os_crash_codes_e
 #define MAX_TASKS_MASK      (CONFIG_MAX_TASKS-1)
 #define PIDHASH(pid)        ((pid) & MAX_TASKS_MASK)
 
+/* If CONFIG_SCHED_PRIOINDEX is selected, then the g_readytorun and
+ * g_pendingtasks lists are each indexed by a bitmap of the priorities
+ * present in the list and the last TCB at each priority.  NPRIORITIES
+ * includes priority zero (the IDLE task).
+ */
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+#  define NPRIORITIES       (SCHED_PRIORITY_MAX + 1)
+#  define PRIOINDEX_NWORDS  ((NPRIORITIES + 31) >> 5)
+
+/* Return the index associated with a task list (NULL if not indexed) */
+
+#  define sched_prioindex(l) \
+     ((FAR void*)(l) == (FAR void*)&g_readytorun ? &g_rtrindex : \
+      (FAR void*)(l) == (FAR void*)&g_pendingtasks ? &g_pndindex : \
+      (FAR struct prioindex_s *)NULL)
+#endif
+
 /* Stubs used when there are no file descriptors */
 
 #if CONFIG_NFILE_DESCRIPTORS <= 0 && CONFIG_NSOCKET_DESCRIPTORS <= 0
@@ -155,6 +174,20 @@ struct tasklist_s
 };
 typedef struct tasklist_s tasklist_t;
 
+/* This structure indexes a prioritized task list so that the insertion
+ * point for a new TCB can be found without traversing the list:  The
+ * new TCB goes just after the last TCB of the lowest priority that is
+ * greater than or equal to its own priority.
+ */
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+struct prioindex_s
+{
+  uint32_t  bitmap[PRIOINDEX_NWORDS]; /* One bit for each priority in the list */
+  FAR _TCB *tail[NPRIORITIES];        /* Last TCB at each priority */
+};
+#endif
+
 /****************************************************************************
  * Global Variables
  ****************************************************************************/
@@ -186,6 +219,15 @@ extern volatile dq_queue_t g_readytorun;
 
 extern volatile dq_queue_t g_pendingtasks;
 
+/* These are the priority indices of the g_readytorun and g_pendingtasks
+ * lists.
+ */
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+extern struct prioindex_s g_rtrindex;
+extern struct prioindex_s g_pndindex;
+#endif
+
 /* This is the list of all tasks that are blocked waiting for a semaphore */
 
 extern volatile dq_queue_t g_waitingforsemaphore;
@@ -278,6 +320,14 @@ extern int  kernel_thread(const char *name, int priority,
 extern bool sched_addreadytorun(FAR _TCB *rtrtcb);
 extern bool sched_removereadytorun(FAR _TCB *rtrtcb);
 extern bool sched_addprioritized(FAR _TCB *newTcb, DSEG dq_queue_t *list);
+#ifdef CONFIG_SCHED_PRIOINDEX
+extern void sched_removeprioritized(FAR _TCB *tcb, DSEG dq_queue_t *list);
+#else
+#  define sched_removeprioritized(t,l) dq_rem((FAR dq_entry_t*)(t),(l))
+#endif
+#if defined(CONFIG_SCHED_PRIOINDEX) || defined(CONFIG_WDOG_WHEEL)
+extern int  sched_lsbit(uint32_t word);
+#endif
 extern bool sched_mergepending(void);
 extern void sched_addblocked(FAR _TCB *btcb, tstate_t task_state);
 extern void sched_removeblocked(FAR _TCB *btcb);
@@ -290,6 +340,26 @@ extern int  sched_reprioritize(FAR _TCB *tcb, int sched_priority);
 extern FAR _TCB *sched_gettcb(pid_t pid);
 extern bool sched_verifytcb(FAR _TCB *tcb);
 
+#ifdef CONFIG_SCHED_TICKLESS
+extern void sched_timer_sync(void);
+extern void sched_timer_reassess(void);
+#else
+#  define sched_timer_sync()
+#  define sched_timer_reassess()
+#endif
+
+#ifdef CONFIG_SCHED_CPULOAD
+extern void sched_cpuload_switch(FAR _TCB *fromtcb, FAR _TCB *totcb);
+#  ifndef CONFIG_SCHED_TICKLESS
+extern void sched_cpuload_tick(void);
+#  else
+#    define sched_cpuload_tick()
+#  endif
+#else
+#  define sched_cpuload_switch(fromtcb,totcb)
+#  define sched_cpuload_tick()
+#endif
+
 #if CONFIG_NFILE_DESCRIPTORS > 0 || CONFIG_NSOCKET_DESCRIPTORS > 0
 extern int  sched_setupidlefiles(FAR _TCB *tcb);
 extern int  sched_setuptaskfiles(FAR _TCB *tcb);
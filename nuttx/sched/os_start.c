@@ -102,6 +102,15 @@ volatile dq_queue_t g_readytorun;
 
 volatile dq_queue_t g_pendingtasks;
 
+/* These are the priority indices of the g_readytorun and g_pendingtasks
+ * lists.
+ */
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+struct prioindex_s g_rtrindex;
+struct prioindex_s g_pndindex;
+#endif
+
 /* This is the list of all tasks that are blocked waiting for a semaphore */
 
 volatile dq_queue_t g_waitingforsemaphore;
@@ -285,6 +294,15 @@ void os_start(void)
 
   dq_addfirst((FAR dq_entry_t*)&g_idletcb, (FAR dq_queue_t*)&g_readytorun);
 
+#ifdef CONFIG_SCHED_PRIOINDEX
+  /* The idle task is the only TCB at priority zero and it never leaves the
+   * ready-to-run list.
+   */
+
+  g_rtrindex.bitmap[0] = 1;
+  g_rtrindex.tail[0]   = &g_idletcb;
+#endif
+
   /* Initialize the processor-specific portion of the TCB */
 
   g_idletcb.flags = TCB_FLAG_TTYPE_KERNEL;
@@ -1,7 +1,7 @@
 /************************************************************************
  * sched/sched_addprioritized.c
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -63,9 +63,78 @@
  ************************************************************************/
 
 /************************************************************************
- * Private Function Prototypes
+ * Private Functions
  ************************************************************************/
 
+/************************************************************************
+ * Function: sched_addindexed
+ *
+ * Description:
+ *   Add a TCB to a prioritized list that has a priority index.  The new
+ *   TCB goes just after the last TCB of the lowest priority in the list
+ *   that is greater than or equal to its own priority.  If there is no
+ *   such priority, then it goes at the head of the list.  The priority
+ *   bitmap is searched one 32-bit word at a time so the cost does not
+ *   depend upon the length of the list.
+ *
+ ************************************************************************/
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+static bool sched_addindexed(FAR _TCB *tcb, DSEG dq_queue_t *list,
+                             FAR struct prioindex_s *index)
+{
+  FAR _TCB *prev = NULL;
+  uint8_t sched_priority = tcb->sched_priority;
+  uint32_t word;
+  int ndx;
+
+  /* Find the lowest priority >= sched_priority that is in the list */
+
+  ndx  = sched_priority >> 5;
+  word = index->bitmap[ndx] & ((uint32_t)0xffffffff << (sched_priority & 31));
+
+  while (word == 0 && ++ndx < PRIOINDEX_NWORDS)
+    {
+      word = index->bitmap[ndx];
+    }
+
+  if (word != 0)
+    {
+      prev = index->tail[(ndx << 5) + sched_lsbit(word)];
+    }
+
+  /* The new TCB is now the last TCB at its priority */
+
+  index->tail[sched_priority] = tcb;
+  index->bitmap[sched_priority >> 5] |= (uint32_t)1 << (sched_priority & 31);
+
+  /* Insert the TCB after prev (or at the head of the list) */
+
+  tcb->blink = prev;
+  if (!prev)
+    {
+      tcb->flink = (FAR _TCB*)list->head;
+      list->head = (FAR dq_entry_t*)tcb;
+    }
+  else
+    {
+      tcb->flink  = prev->flink;
+      prev->flink = tcb;
+    }
+
+  if (!tcb->flink)
+    {
+      list->tail = (FAR dq_entry_t*)tcb;
+    }
+  else
+    {
+      tcb->flink->blink = tcb;
+    }
+
+  return prev == NULL;
+}
+#endif
+
 /************************************************************************
  * Public Functions
  ************************************************************************/
@@ -106,6 +175,18 @@ bool sched_addprioritized(FAR _TCB *tcb, DSEG dq_queue_t *list)
 
   ASSERT(sched_priority >= SCHED_PRIORITY_MIN);
 
+#ifdef CONFIG_SCHED_PRIOINDEX
+  /* Use the priority index, if the list has one */
+
+  {
+    FAR struct prioindex_s *index = sched_prioindex(list);
+    if (index)
+      {
+        return sched_addindexed(tcb, list, index);
+      }
+  }
+#endif
+
   /* Search the list to find the location to insert the new Tcb.
    * Each is list is maintained in ascending sched_priority order.
    */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/sched_addreadytorun.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -103,6 +103,12 @@ bool sched_addreadytorun(FAR _TCB *btcb)
   FAR _TCB *rtcb = (FAR _TCB*)g_readytorun.head;
   bool ret;
 
+  /* In the tickless mode, charge the elapsed time to the current task
+   * before it can be preempted.
+   */
+
+  sched_timer_sync();
+
   /* Check if pre-emption is disabled for the current running
    * task and if the new ready-to-run task  would cause the
    * current running task to be preempted.
@@ -126,6 +132,7 @@ bool sched_addreadytorun(FAR _TCB *btcb)
       /* Information the instrumentation logic that we are switching tasks */
 
       sched_note_switch(rtcb, btcb);
+      sched_cpuload_switch(rtcb, btcb);
 
       /* The new btcb was added at the head of the g_readytorun list.  It
        * is now to new active task!
@@ -135,6 +142,10 @@ bool sched_addreadytorun(FAR _TCB *btcb)
 
       btcb->task_state = TSTATE_TASK_RUNNING;
       btcb->flink->task_state = TSTATE_TASK_READYTORUN;
+
+      /* The new task may need a round-robin timeslice alarm */
+
+      sched_timer_reassess();
       ret = true;
     }
   else
@@ -0,0 +1,248 @@
+/************************************************************************
+ * sched/sched_cpuload.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <errno.h>
+
+#include <arch/irq.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+
+#include "os_internal.h"
+#include "clock_internal.h"
+
+#ifdef CONFIG_SCHED_CPULOAD
+
+/************************************************************************
+ * Definitions
+ ************************************************************************/
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+/* In the tickless mode, this is the time (in microseconds) of the last
+ * context switch.  The time since then belongs to the running task.
+ */
+
+#ifdef CONFIG_SCHED_TICKLESS
+static uint32_t g_cpuload_switchtime;
+#endif
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  sched_cpuload_now
+ *
+ * Description:
+ *   Return the current time in microseconds (modulo 2**32).  In the
+ *   tickless mode, this comes from the free-running counter that the
+ *   platform provides and has the resolution of that counter.
+ *   Otherwise, the resolution is one system timer tick.
+ *
+ ************************************************************************/
+
+static inline uint32_t sched_cpuload_now(void)
+{
+#ifdef CONFIG_SCHED_TICKLESS
+  struct timespec ts;
+
+  (void)up_timer_gettime(&ts);
+  return (uint32_t)ts.tv_sec * USEC_PER_SEC +
+         (uint32_t)ts.tv_nsec / NSEC_PER_USEC;
+#else
+  return TICK2USEC(clock_systimer());
+#endif
+}
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  sched_cpuload_switch
+ *
+ * Description:
+ *   Called with interrupts disabled when the task at the head of the
+ *   g_readytorun list is about to change.  In the tickless mode, the
+ *   time since the last context switch is charged to the task that was
+ *   running.  Otherwise, run time is sampled by sched_cpuload_tick() and
+ *   only the switch is counted here.
+ *
+ * Inputs:
+ *   fromtcb - The task that was running
+ *   totcb   - The task that will run next
+ *
+ * Return Value:
+ *   None
+ *
+ ************************************************************************/
+
+void sched_cpuload_switch(FAR _TCB *fromtcb, FAR _TCB *totcb)
+{
+#ifdef CONFIG_SCHED_TICKLESS
+  uint32_t now = sched_cpuload_now();
+
+  fromtcb->cpu_time    += now - g_cpuload_switchtime;
+  g_cpuload_switchtime  = now;
+#endif
+
+  totcb->cpu_switches++;
+}
+
+/************************************************************************
+ * Name:  sched_cpuload_tick
+ *
+ * Description:
+ *   Called from sched_process_timer() on each system timer tick.  The
+ *   whole tick is charged to the task that was running when the timer
+ *   interrupt occurred.
+ *
+ ************************************************************************/
+
+#ifndef CONFIG_SCHED_TICKLESS
+void sched_cpuload_tick(void)
+{
+  FAR _TCB *rtcb = (FAR _TCB*)g_readytorun.head;
+  rtcb->cpu_time += USEC_PER_TICK;
+}
+#endif
+
+/************************************************************************
+ * Name:  sched_cpuload
+ *
+ * Description:
+ *   Return the CPU accounting information for a task.  The percentage of
+ *   the CPU used by the task over an interval can be determined by
+ *   calling sched_cpuload() at the beginning and end of the interval:
+ *
+ *     load = 100 * (active2 - active1) / (total2 - total1)
+ *
+ * Inputs:
+ *   pid - The ID of the task.  Zero is the IDLE task.
+ *   cpuload - The location to return the accounting information.
+ *
+ * Return Value:
+ *   On success, sched_cpuload() returns OK.  On failure, ERROR is
+ *   returned and errno is set to:
+ *
+ *   EFAULT - cpuload is NULL
+ *   ESRCH  - No task with this pid was found
+ *
+ ************************************************************************/
+
+int sched_cpuload(pid_t pid, FAR struct cpuload_s *cpuload)
+{
+  FAR _TCB *tcb;
+  irqstate_t flags;
+
+  if (!cpuload)
+    {
+      errno = EFAULT;
+      return ERROR;
+    }
+
+  /* Pre-emption is disabled so that the task cannot exit while it is
+   * examined.
+   */
+
+  sched_lock();
+  tcb = sched_gettcb(pid);
+  if (!tcb)
+    {
+      sched_unlock();
+      errno = ESRCH;
+      return ERROR;
+    }
+
+  /* Interrupts are disabled only while the counters are sampled */
+
+  flags = irqsave();
+  cpuload->total    = sched_cpuload_now();
+  cpuload->active   = tcb->cpu_time;
+  cpuload->switches = tcb->cpu_switches;
+
+  /* In the tickless mode, the running task has not yet been charged for
+   * the time since the last context switch.
+   */
+
+#ifdef CONFIG_SCHED_TICKLESS
+  if (tcb == (FAR _TCB*)g_readytorun.head)
+    {
+      cpuload->active += cpuload->total - g_cpuload_switchtime;
+    }
+#endif
+
+  irqrestore(flags);
+
+  /* The stack high-water mark is only available if the port supports
+   * stack monitoring.
+   */
+
+#ifndef CONFIG_CUSTOM_STACK
+  cpuload->stacksize = tcb->adj_stack_size;
+#  if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+  cpuload->stackused = tcb->stack_alloc_ptr ? up_check_tcbstack(tcb) : 0;
+#  else
+  cpuload->stackused = 0;
+#  endif
+#else
+  cpuload->stacksize = 0;
+  cpuload->stackused = 0;
+#endif
+
+  sched_unlock();
+  return OK;
+}
+
+#endif /* CONFIG_SCHED_CPULOAD */
@@ -0,0 +1,120 @@
+/************************************************************************
+ * sched/sched_lsbit.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+#include "os_internal.h"
+
+/************************************************************************
+ * Pre-processor Definitions
+ ************************************************************************/
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Function: sched_lsbit
+ *
+ * Description:
+ *   Return the bit number of the least significant bit that is set in
+ *   a non-zero 32-bit word.  This is used to search the bitmaps of the
+ *   ready-to-run priority index and of the watchdog timer wheel.
+ *
+ * Inputs:
+ *   word - The 32-bit word to examine.  Must not be zero.
+ *
+ * Return Value:
+ *   The bit number (0-31) of the least significant bit that is set.
+ *
+ ************************************************************************/
+
+int sched_lsbit(uint32_t word)
+{
+  int bit = 0;
+
+  if ((word & 0x0000ffff) == 0)
+    {
+      bit   += 16;
+      word >>= 16;
+    }
+
+  if ((word & 0x000000ff) == 0)
+    {
+      bit   += 8;
+      word >>= 8;
+    }
+
+  if ((word & 0x0000000f) == 0)
+    {
+      bit   += 4;
+      word >>= 4;
+    }
+
+  if ((word & 0x00000003) == 0)
+    {
+      bit   += 2;
+      word >>= 2;
+    }
+
+  if ((word & 0x00000001) == 0)
+    {
+      bit   += 1;
+    }
+
+  return bit;
+}
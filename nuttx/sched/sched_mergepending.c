@@ -1,7 +1,7 @@
 /************************************************************************
  * sched/sched_mergepending.c
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -40,6 +40,7 @@
 #include <nuttx/config.h>
 
 #include <stdbool.h>
+#include <string.h>
 #include <queue.h>
 #include <assert.h>
 
@@ -93,12 +94,51 @@
 
 bool sched_mergepending(void)
 {
+#if defined(CONFIG_SCHED_INSTRUMENTATION) || defined(CONFIG_SCHED_CPULOAD)
+  FAR _TCB *rtcb = (FAR _TCB*)g_readytorun.head;
+#endif
   FAR _TCB *pndtcb;
   FAR _TCB *pndnext;
+#ifndef CONFIG_SCHED_PRIOINDEX
   FAR _TCB *rtrtcb;
   FAR _TCB *rtrprev;
+#endif
   bool ret = false;
 
+  /* In the tickless mode, charge the elapsed time to the current task
+   * before it can be preempted.
+   */
+
+  sched_timer_sync();
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+  /* With the priority index, each pending task can be added to the
+   * g_readytorun list directly.  The pending tasks are taken in priority
+   * order, so FIFO order is preserved among tasks of equal priority.
+   */
+
+  for (pndtcb = (FAR _TCB*)g_pendingtasks.head; pndtcb; pndtcb = pndnext)
+    {
+      pndnext = pndtcb->flink;
+
+      if (sched_addprioritized(pndtcb, (FAR dq_queue_t*)&g_readytorun))
+        {
+          /* The pndtcb is now at the head of the g_readytorun list */
+
+          pndtcb->flink->task_state = TSTATE_TASK_READYTORUN;
+          pndtcb->task_state = TSTATE_TASK_RUNNING;
+          ret = true;
+        }
+      else
+        {
+          pndtcb->task_state = TSTATE_TASK_READYTORUN;
+        }
+    }
+
+  /* The g_pendingtasks index is now empty too */
+
+  memset(g_pndindex.bitmap, 0, sizeof(g_pndindex.bitmap));
+#else
   /* Initialize the inner search loop */
 
   rtrtcb = (FAR _TCB*)g_readytorun.head;
@@ -161,11 +201,23 @@ bool sched_mergepending(void)
 
       rtrtcb = pndtcb;
     }
+#endif
 
   /* Mark the input list empty */
 
   g_pendingtasks.head = NULL;
   g_pendingtasks.tail = NULL;
 
+  /* The new task may need a round-robin timeslice alarm */
+
+  if (ret)
+    {
+      /* Inform the instrumentation layer that we are switching tasks */
+
+      sched_note_switch(rtcb, (FAR _TCB*)g_readytorun.head);
+      sched_cpuload_switch(rtcb, (FAR _TCB*)g_readytorun.head);
+      sched_timer_reassess();
+    }
+
   return ret;
 }
@@ -0,0 +1,361 @@
+/************************************************************************
+ * sched/sched_note.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#include <arch/irq.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/sched_note.h>
+
+#include "os_internal.h"
+
+#ifdef CONFIG_SCHED_NOTE_BUFFER
+
+/************************************************************************
+ * Definitions
+ ************************************************************************/
+
+/* The number of notes that fit in the buffer.  One slot is always left
+ * empty to distinguish a full buffer from an empty one.
+ */
+
+#define NOTE_NSLOTS (CONFIG_SCHED_NOTE_BUFSIZE / NOTE_SIZE)
+
+#if NOTE_NSLOTS < 2
+#  error "CONFIG_SCHED_NOTE_BUFSIZE is too small"
+#endif
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+struct note_info_s
+{
+  volatile unsigned int ni_head;     /* Index of the next note to write */
+  volatile unsigned int ni_tail;     /* Index of the next note to read */
+  uint32_t              ni_dropped;  /* Notes overwritten before read */
+  struct note_s         ni_buffer[NOTE_NSLOTS];
+};
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+static struct note_info_s g_note_info;
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name: note_next
+ *
+ * Description:
+ *   Return the index of the slot that follows 'ndx'
+ *
+ ************************************************************************/
+
+static inline unsigned int note_next(unsigned int ndx)
+{
+  return ++ndx >= NOTE_NSLOTS ? 0 : ndx;
+}
+
+/************************************************************************
+ * Name: note_put16, note_put32
+ *
+ * Description:
+ *   Save a value in little endian byte order
+ *
+ ************************************************************************/
+
+static inline void note_put16(FAR uint8_t *dest, uint16_t value)
+{
+  dest[0] = (uint8_t)value;
+  dest[1] = (uint8_t)(value >> 8);
+}
+
+static inline void note_put32(FAR uint8_t *dest, uint32_t value)
+{
+  dest[0] = (uint8_t)value;
+  dest[1] = (uint8_t)(value >> 8);
+  dest[2] = (uint8_t)(value >> 16);
+  dest[3] = (uint8_t)(value >> 24);
+}
+
+/************************************************************************
+ * Name: note_systime
+ *
+ * Description:
+ *   Return the time stamp for a note in microseconds.  In the tickless
+ *   mode, this comes directly from the free-running timer.  Otherwise,
+ *   the resolution is only MSEC_PER_TICK.
+ *
+ ************************************************************************/
+
+static inline uint32_t note_systime(void)
+{
+#ifdef CONFIG_SCHED_TICKLESS
+  struct timespec ts;
+
+  (void)up_timer_gettime(&ts);
+  return (uint32_t)ts.tv_sec * USEC_PER_SEC +
+         (uint32_t)ts.tv_nsec / NSEC_PER_USEC;
+#else
+  return TICK2USEC(clock_systimer());
+#endif
+}
+
+/************************************************************************
+ * Name: note_add
+ *
+ * Description:
+ *   Add a note to the circular buffer.  If the buffer is full, the oldest
+ *   note is discarded.  Notes may be added from interrupt handlers so
+ *   interrupts are disabled (only) while the slot is claimed and filled;
+ *   no semaphore is ever taken.
+ *
+ ************************************************************************/
+
+static void note_add(uint8_t type, FAR _TCB *tcb, uint32_t arg)
+{
+  FAR struct note_s *note;
+  irqstate_t flags;
+  unsigned int head;
+
+  flags = irqsave();
+
+  head = g_note_info.ni_head;
+  note = &g_note_info.ni_buffer[head];
+
+  note->nc_type     = type;
+  note->nc_priority = tcb ? tcb->sched_priority : 0;
+  note_put16(note->nc_pid, tcb ? (uint16_t)tcb->pid : 0);
+  note_put32(note->nc_arg, arg);
+  note_put32(note->nc_systime, note_systime());
+
+  /* Advance the head.  If the buffer is now full, discard the oldest
+   * note.
+   */
+
+  head = note_next(head);
+  if (head == g_note_info.ni_tail)
+    {
+      g_note_info.ni_tail = note_next(head);
+      g_note_info.ni_dropped++;
+    }
+
+  g_note_info.ni_head = head;
+  irqrestore(flags);
+}
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name: sched_note_start, sched_note_stop, sched_note_switch
+ *
+ * Description:
+ *   These are the standard scheduler instrumentation interfaces (see
+ *   include/sched.h).  If CONFIG_SCHED_NOTE_BUFFER is selected, they are
+ *   provided here rather than by board-specific logic.
+ *
+ ************************************************************************/
+
+void sched_note_start(FAR _TCB *tcb)
+{
+  note_add(NOTE_START, tcb, 0);
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  /* Follow the start note with the task name, four characters at a time */
+
+  {
+    FAR const char *name = tcb->name;
+    int len = strlen(name);
+    int i;
+
+    for (i = 0; i < len; i += 4)
+      {
+        uint8_t chars[4] = {0, 0, 0, 0};
+        int j;
+
+        for (j = 0; j < 4 && i + j < len; j++)
+          {
+            chars[j] = (uint8_t)name[i + j];
+          }
+
+        note_add(NOTE_NAME, tcb,
+                 (uint32_t)chars[0]         | (uint32_t)chars[1] << 8 |
+                 (uint32_t)chars[2] << 16   | (uint32_t)chars[3] << 24);
+      }
+  }
+#endif
+}
+
+void sched_note_stop(FAR _TCB *tcb)
+{
+  note_add(NOTE_STOP, tcb, 0);
+}
+
+void sched_note_switch(FAR _TCB *pFromTcb, FAR _TCB *pToTcb)
+{
+  note_add(NOTE_SWITCH, pToTcb, (uint32_t)pFromTcb->pid);
+}
+
+/************************************************************************
+ * Name: sched_note_irqhandler
+ *
+ * Description:
+ *   Record entry into and exit from an interrupt handler.  The task is
+ *   the one that was interrupted.
+ *
+ ************************************************************************/
+
+void sched_note_irqhandler(int irq, bool enter)
+{
+  note_add(enter ? NOTE_IRQ_ENTER : NOTE_IRQ_LEAVE,
+           (FAR _TCB*)g_readytorun.head, (uint32_t)irq);
+}
+
+/************************************************************************
+ * Name: sched_note_sem
+ *
+ * Description:
+ *   Record that a task is about to block waiting for a semaphore
+ *   (wait == true) or that a task waiting for a semaphore has been
+ *   awakened (wait == false).
+ *
+ ************************************************************************/
+
+void sched_note_sem(FAR _TCB *tcb, FAR sem_t *sem, bool wait)
+{
+  note_add(wait ? NOTE_SEM_WAIT : NOTE_SEM_WAKE, tcb, (uint32_t)(uintptr_t)sem);
+}
+
+/************************************************************************
+ * Name: sched_note_syscall
+ *
+ * Description:
+ *   Record entry into and exit from a SYS call.
+ *
+ ************************************************************************/
+
+void sched_note_syscall(int nr, bool enter)
+{
+  note_add(enter ? NOTE_SYSCALL_ENTER : NOTE_SYSCALL_LEAVE,
+           (FAR _TCB*)g_readytorun.head, (uint32_t)nr);
+}
+
+/************************************************************************
+ * Name: sched_note_get
+ *
+ * Description:
+ *   Remove the oldest notes from the buffer.  Only whole notes are
+ *   returned.  If notes were lost because the buffer was full, then the
+ *   first note returned is a NOTE_DROPPED note.
+ *
+ * Input Parameters:
+ *   buffer - Location to return the notes
+ *   buflen - The size of the buffer in bytes
+ *
+ * Returned Value:
+ *   The number of bytes returned (a multiple of NOTE_SIZE).  Zero is
+ *   returned if the buffer is empty.
+ *
+ ************************************************************************/
+
+ssize_t sched_note_get(FAR uint8_t *buffer, size_t buflen)
+{
+  FAR struct note_s *note;
+  irqstate_t flags;
+  ssize_t nread = 0;
+
+  while (buflen - nread >= NOTE_SIZE)
+    {
+      note = (FAR struct note_s *)&buffer[nread];
+
+      /* Each note is removed with interrupts disabled; notes may be added
+       * from interrupt handlers at any time.
+       */
+
+      flags = irqsave();
+      if (g_note_info.ni_dropped > 0)
+        {
+          /* Report the lost notes first */
+
+          memset(note, 0, NOTE_SIZE);
+          note->nc_type = NOTE_DROPPED;
+          note_put32(note->nc_arg, g_note_info.ni_dropped);
+          note_put32(note->nc_systime, note_systime());
+          g_note_info.ni_dropped = 0;
+        }
+      else if (g_note_info.ni_tail != g_note_info.ni_head)
+        {
+          memcpy(note, &g_note_info.ni_buffer[g_note_info.ni_tail],
+                 NOTE_SIZE);
+          g_note_info.ni_tail = note_next(g_note_info.ni_tail);
+        }
+      else
+        {
+          /* The buffer is empty */
+
+          irqrestore(flags);
+          break;
+        }
+
+      irqrestore(flags);
+      nread += NOTE_SIZE;
+    }
+
+  return nread;
+}
+
+#endif /* CONFIG_SCHED_NOTE_BUFFER */
@@ -1,7 +1,7 @@
 /************************************************************************
  * sched/sched_processtimer.c
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -188,4 +188,8 @@ void sched_process_timer(void)
    */
 
    sched_process_timeslice();
+
+  /* Charge the tick to the currently executing task */
+
+  sched_cpuload_tick();
 }
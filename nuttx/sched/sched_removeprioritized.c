@@ -0,0 +1,125 @@
+/************************************************************************
+ * sched/sched_removeprioritized.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <queue.h>
+
+#include "os_internal.h"
+
+#ifdef CONFIG_SCHED_PRIOINDEX
+
+/************************************************************************
+ * Pre-processor Definitions
+ ************************************************************************/
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Function Prototypes
+ ************************************************************************/
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Function: sched_removeprioritized
+ *
+ * Description:
+ *  This function removes a TCB from a prioritized TCB list, keeping the
+ *  priority index of the list (if any) up to date.  It may also be used
+ *  with lists that are not indexed (or not prioritized); then it is the
+ *  same as dq_rem().
+ *
+ * Inputs:
+ *   tcb - Points to the TCB to remove from the list
+ *   list - Points to the list that currently holds the TCB
+ *
+ * Return Value:
+ *   None
+ *
+ * Assumptions:
+ * - The caller has established a critical section before
+ *   calling this function.
+ * - The priority of the TCB has not been changed since it
+ *   was added to the list.
+ ************************************************************************/
+
+void sched_removeprioritized(FAR _TCB *tcb, DSEG dq_queue_t *list)
+{
+  FAR struct prioindex_s *index = sched_prioindex(list);
+  uint8_t sched_priority = tcb->sched_priority;
+
+  /* If the TCB is the last at its priority, then the one before it
+   * becomes the last.  If there is none, then the priority is no longer
+   * in the list.
+   */
+
+  if (index && index->tail[sched_priority] == tcb)
+    {
+      FAR _TCB *prev = tcb->blink;
+
+      if (prev && prev->sched_priority == sched_priority)
+        {
+          index->tail[sched_priority] = prev;
+        }
+      else
+        {
+          index->tail[sched_priority] = NULL;
+          index->bitmap[sched_priority >> 5] &=
+            ~((uint32_t)1 << (sched_priority & 31));
+        }
+    }
+
+  dq_rem((FAR dq_entry_t*)tcb, list);
+}
+
+#endif /* CONFIG_SCHED_PRIOINDEX */
@@ -106,9 +106,14 @@ bool sched_removereadytorun(FAR _TCB *rtcb)
 
       ASSERT(rtcb->flink != NULL);
 
+      /* In the tickless mode, charge the elapsed time to the current task */
+
+      sched_timer_sync();
+
       /* Inform the instrumentation layer that we are switching tasks */
 
       sched_note_switch(rtcb, rtcb->flink);
+      sched_cpuload_switch(rtcb, rtcb->flink);
 
       rtcb->flink->task_state = TSTATE_TASK_RUNNING;
       ret = true;
@@ -116,8 +121,16 @@ bool sched_removereadytorun(FAR _TCB *rtcb)
 
   /* Remove the TCB from the ready-to-run list */
 
-  dq_rem((FAR dq_entry_t*)rtcb, (dq_queue_t*)&g_readytorun);
+  sched_removeprioritized(rtcb, (dq_queue_t*)&g_readytorun);
 
   rtcb->task_state = TSTATE_TASK_INVALID;
+
+  /* The new task may need a round-robin timeslice alarm */
+
+  if (ret)
+    {
+      sched_timer_reassess();
+    }
+
   return ret;
 }
@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/sched_setpriority.c
  *
- *   Copyright (C) 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -149,9 +149,19 @@ int sched_setpriority(FAR _TCB *tcb, int sched_priority)
 
          else
            {
+#ifdef CONFIG_SCHED_PRIOINDEX
+             /* Change the task priority.  The task remains at the head of
+              * the ready-to-run list, but it must be re-indexed.
+              */
+
+             sched_removeprioritized(tcb, (FAR dq_queue_t*)&g_readytorun);
+             tcb->sched_priority = (uint8_t)sched_priority;
+             (void)sched_addprioritized(tcb, (FAR dq_queue_t*)&g_readytorun);
+#else
              /* Change the task priority */
 
              tcb->sched_priority = (uint8_t)sched_priority;
+#endif
            }
          break;
 
@@ -203,7 +213,7 @@ int sched_setpriority(FAR _TCB *tcb, int sched_priority)
           {
             /* Remove the TCB from the prioritized task list */
 
-            dq_rem((FAR dq_entry_t*)tcb, (FAR dq_queue_t*)g_tasklisttable[task_state].list);
+            sched_removeprioritized(tcb, (FAR dq_queue_t*)g_tasklisttable[task_state].list);
 
             /* Change the task priority */
 
@@ -0,0 +1,342 @@
+/************************************************************************
+ * sched/sched_timerexpiration.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <sched.h>
+
+#include <arch/irq.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+
+#include "os_internal.h"
+#include "wd_internal.h"
+#include "clock_internal.h"
+
+#ifdef CONFIG_SCHED_TICKLESS
+
+/************************************************************************
+ * Definitions
+ ************************************************************************/
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+/* This is the value of the system timer when the watchdog list and the
+ * round-robin timeslice were last brought up to date.
+ */
+
+static uint32_t g_timer_base;
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  sched_timer_start
+ *
+ * Description:
+ *   Start the one-shot alarm so that it expires after 'ticks' system
+ *   timer ticks.
+ *
+ ************************************************************************/
+
+static inline void sched_timer_start(unsigned int ticks)
+{
+  struct timespec ts;
+
+  ts.tv_sec  = ticks / TICK_PER_SEC;
+  ts.tv_nsec = (ticks % TICK_PER_SEC) * NSEC_PER_TICK;
+  (void)up_timer_start(&ts);
+}
+
+/************************************************************************
+ * Name:  sched_timer_timeslice
+ *
+ * Description:
+ *   Check if the currently executing round-robin task has used up its
+ *   timeslice.  The elapsed time has already been charged to the task by
+ *   sched_timer_sync().
+ *
+ ************************************************************************/
+
+static inline void sched_timer_timeslice(void)
+{
+#if CONFIG_RR_INTERVAL > 0
+  FAR _TCB *rtcb = (FAR _TCB*)g_readytorun.head;
+
+  /* Check if the currently executing task uses round robin scheduling
+   * and has exhausted its timeslice.  If pre-emption is disabled, then
+   * the expired timeslice is left as is and will be checked again on the
+   * next alarm (see sched_timer_reassess()).
+   */
+
+  if ((rtcb->flags & TCB_FLAG_ROUND_ROBIN) != 0 &&
+      rtcb->timeslice <= 0 && !rtcb->lockcount)
+    {
+      /* Reset the timeslice in any case. */
+
+      rtcb->timeslice = CONFIG_RR_INTERVAL / MSEC_PER_TICK;
+
+      /* If the next task in the ready-to-run list is the same priority,
+       * then relinquish the CPU and give that task a shot.
+       */
+
+      if (rtcb->flink &&
+          rtcb->flink->sched_priority >= rtcb->sched_priority)
+        {
+          up_reprioritize_rtr(rtcb, rtcb->sched_priority);
+        }
+    }
+#endif
+}
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  sched_timer_sync
+ *
+ * Description:
+ *   Bring the timer state up to date with the current system time:  The
+ *   time elapsed since the last call is passed to the queue of active
+ *   watchdogs (wd_elapse()) and is charged against the timeslice of the
+ *   currently executing round-robin task.
+ *
+ *   No watchdogs are executed and no context switches are performed
+ *   here.  Watchdogs that are already due will be processed by the next
+ *   sched_timer_expiration().
+ *
+ *   This must be called before the watchdog list is modified and before
+ *   the currently executing task is changed.
+ *
+ * Inputs:
+ *   None
+ *
+ * Return Value:
+ *   None
+ *
+ ************************************************************************/
+
+void sched_timer_sync(void)
+{
+#if CONFIG_RR_INTERVAL > 0
+  FAR _TCB   *rtcb;
+#endif
+  irqstate_t  flags;
+  uint32_t    now;
+  uint32_t    elapsed;
+
+  flags   = irqsave();
+  now     = clock_systimer();
+  elapsed = now - g_timer_base;
+  g_timer_base = now;
+
+  if (elapsed > 0)
+    {
+      /* The lags and timeslices are signed integers */
+
+      if (elapsed > INT_MAX)
+        {
+          elapsed = INT_MAX;
+        }
+
+      /* Account for the elapsed time in the queue of active watchdogs */
+
+      wd_elapse(elapsed);
+
+#if CONFIG_RR_INTERVAL > 0
+      /* Charge the elapsed time to the currently executing task */
+
+      rtcb = (FAR _TCB*)g_readytorun.head;
+      if (rtcb && (rtcb->flags & TCB_FLAG_ROUND_ROBIN) != 0)
+        {
+          if (rtcb->timeslice > (int)elapsed)
+            {
+              rtcb->timeslice -= (int)elapsed;
+            }
+          else
+            {
+              rtcb->timeslice = 0;
+            }
+        }
+#endif
+    }
+
+  irqrestore(flags);
+}
+
+/************************************************************************
+ * Name:  sched_timer_reassess
+ *
+ * Description:
+ *   Restart the one-shot alarm so that it will expire at the time of
+ *   the next event:  Either the expiration of the watchdog at the head of
+ *   the active list or the end of the timeslice of the currently
+ *   executing round-robin task.  If there is no such event, then the
+ *   alarm is cancelled and the system will not be interrupted.
+ *
+ *   This must be called after the head of the watchdog list or the
+ *   currently executing task has changed.
+ *
+ * Inputs:
+ *   None
+ *
+ * Return Value:
+ *   None
+ *
+ ************************************************************************/
+
+void sched_timer_reassess(void)
+{
+#if CONFIG_RR_INTERVAL > 0
+  FAR _TCB    *rtcb;
+#endif
+  irqstate_t   flags;
+  unsigned int delay;
+
+  flags = irqsave();
+  sched_timer_sync();
+
+  /* Get the delay until the first watchdog expires (zero if there are
+   * no active watchdogs).
+   */
+
+  delay = wd_nextexpiry();
+
+#if CONFIG_RR_INTERVAL > 0
+  /* The timeslice only matters if there is another task at the same
+   * priority that is waiting for the CPU.
+   */
+
+  rtcb = (FAR _TCB*)g_readytorun.head;
+  if (rtcb && (rtcb->flags & TCB_FLAG_ROUND_ROBIN) != 0 &&
+      rtcb->flink && rtcb->flink->sched_priority >= rtcb->sched_priority)
+    {
+      unsigned int slice = rtcb->timeslice > 0 ?
+                           (unsigned int)rtcb->timeslice : 1;
+
+      if (delay == 0 || slice < delay)
+        {
+          delay = slice;
+        }
+    }
+#endif
+
+  /* Start or cancel the alarm */
+
+  if (delay > 0)
+    {
+      sched_timer_start(delay);
+    }
+  else
+    {
+      (void)up_timer_cancel(NULL);
+    }
+
+  irqrestore(flags);
+}
+
+/************************************************************************
+ * System Timer Hooks
+ *
+ * These are standard interfaces that are exported by the OS
+ * for use by the architecture specific logic
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  sched_timer_expiration
+ *
+ * Description:
+ *   If CONFIG_SCHED_TICKLESS is selected, then there is no periodic
+ *   timer interrupt and sched_process_timer() is not used.  Instead, the
+ *   architecture specific logic must call this function from the
+ *   interrupt level when the one-shot alarm started by up_timer_start()
+ *   expires.
+ *
+ * Inputs:
+ *   None
+ *
+ * Return Value:
+ *   None
+ *
+ ************************************************************************/
+
+void sched_timer_expiration(void)
+{
+  /* Charge the elapsed time to the watchdogs and to the current task */
+
+  sched_timer_sync();
+
+  /* Process watchdogs (if in the link) */
+
+#ifdef CONFIG_HAVE_WEAKFUNCTIONS
+  if (wd_timer != NULL)
+#endif
+    {
+      wd_timer();
+    }
+
+  /* Check if the currently executing task has exceeded its
+   * timeslice.
+   */
+
+  sched_timer_timeslice();
+
+  /* And set up the alarm for the next event */
+
+  sched_timer_reassess();
+}
+
+#endif /* CONFIG_SCHED_TICKLESS */
@@ -44,6 +44,7 @@
 #include <assert.h>
 #include <debug.h>
 #include <nuttx/arch.h>
+#include <nuttx/mempool.h>
 
 #include "os_internal.h"
 #include "sem_internal.h"
@@ -78,7 +79,7 @@ typedef int (*holderhandler_t)(FAR struct semholder_s *pholder, FAR sem_t *sem,
 
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
 static struct semholder_s g_holderalloc[CONFIG_SEM_PREALLOCHOLDERS];
-static FAR struct semholder_s *g_freeholders;
+static struct mempool_s g_holderpool;
 #endif
 
 /****************************************************************************
@@ -106,12 +107,11 @@ static inline FAR struct semholder_s *sem_allocholder(sem_t *sem)
   else
     {
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
-      pholder = g_freeholders;
+      pholder = (FAR struct semholder_s *)mempool_alloc(&g_holderpool);
       if (pholder)
         {
-          /* Remove the holder from the free list an put it into the semaphore's holder list */
+          /* Put the holder from the pool into the semaphore's holder list */
 
-          g_freeholders    = pholder->flink;
           pholder->flink   = sem->hlist.flink;
           sem->hlist.flink = pholder;
 
@@ -203,10 +203,9 @@ static inline void sem_freeholder(sem_t *sem, FAR struct semholder_s *pholder)
 
           prev->flink = pholder->flink;
 
-          /* And put it in the free list */
+          /* And return it to the pool */
 
-          pholder->flink = g_freeholders;
-          g_freeholders  = pholder;
+          mempool_free(&g_holderpool, pholder);
         }
     }
 #endif
@@ -569,16 +568,11 @@ static int sem_restoreholderprioB(FAR struct semholder_s *pholder, FAR sem_t *se
 void sem_initholders(void)
 {
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
- int i;
+  /* Put all of the pre-allocated holder structures into the pool */
 
-  /* Put all of the pre-allocated holder structures into  free list */
-
-  g_freeholders = g_holderalloc;
-  for (i = 0; i < (CONFIG_SEM_PREALLOCHOLDERS-1); i++)
-    {
-      g_holderalloc[i].flink = &g_holderalloc[i+1];
-    }
-  g_holderalloc[CONFIG_SEM_PREALLOCHOLDERS-1].flink = NULL;
+  (void)mempool_initialize(&g_holderpool, g_holderalloc,
+                           sizeof(struct semholder_s),
+                           CONFIG_SEM_PREALLOCHOLDERS, 0);
 #endif
 }
 
@@ -891,11 +885,10 @@ void sem_enumholders(FAR sem_t *sem)
 int sem_nfreeholders(void)
 {
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
-  FAR struct semholder_s *pholder;
-  int n;
-  
-  for (pholder = g_freeholders, n = 0; pholder; pholder = pholder->flink) n++;
-  return n;
+  struct mempoolinfo_s info;
+
+  mempool_info(&g_holderpool, &info);
+  return info.nfree;
 #else
   return 0;
 #endif
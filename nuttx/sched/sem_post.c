@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/sem_post.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -43,6 +43,7 @@
 #include <semaphore.h>
 #include <sched.h>
 #include <nuttx/arch.h>
+#include <nuttx/sched_note.h>
 
 #include "os_internal.h"
 #include "sem_internal.h"
@@ -154,6 +155,7 @@ int sem_post(FAR sem_t *sem)
 
               /* Restart the waiting task. */
 
+              sched_note_sem(stcb, sem, false);
               up_unblock_task(stcb);
             }
         }
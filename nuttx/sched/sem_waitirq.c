@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/sem_waitirq.c
  *
- *   Copyright (C) 2007-2010 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2010, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -42,6 +42,7 @@
 #include <sched.h>
 #include <errno.h>
 #include <nuttx/arch.h>
+#include <nuttx/sched_note.h>
 
 #include "sem_internal.h"
 
@@ -135,6 +136,7 @@ void sem_waitirq(FAR _TCB *wtcb, int errcode)
 
       /* Restart the task. */
 
+      sched_note_sem(wtcb, sem, false);
       up_unblock_task(wtcb);
     }
 
@@ -79,58 +79,33 @@
 
 FAR sigq_t *sig_allocatependingsigaction(void)
 {
-  FAR sigq_t    *sigq;
-  irqstate_t saved_state;
+  FAR sigq_t *sigq;
 
-  /* Check if we were called from an interrupt handler. */
+  /* Try to get the pending signal action structure from the pool.  If we
+   * were called from an interrupt handler, then the pool will also provide
+   * structures from the reserve set aside for interrupt handlers.
+   */
 
-  if (up_interrupt_context())
+  sigq = (FAR sigq_t*)mempool_alloc(&g_sigpendingaction);
+  if (sigq)
     {
-      /* Try to get the pending signal action structure from the free list */
-
-      sigq = (FAR sigq_t*)sq_remfirst(&g_sigpendingaction);
-
-      /* If so, then try the special list of structures reserved for
-       * interrupt handlers
-       */
-
-      if (!sigq)
-        {
-          sigq = (FAR sigq_t*)sq_remfirst(&g_sigpendingirqaction);
-        }
+      sigq->type = SIG_ALLOC_FIXED;
     }
 
   /* If we were not called from an interrupt handler, then we are
    * free to allocate pending signal action structures if necessary. */
 
-  else
+  else if (!up_interrupt_context())
     {
-      /* Try to get the pending signal action structure from the free list */
+      sigq = (FAR sigq_t *)kmalloc((sizeof (sigq_t)));
 
-      saved_state = irqsave();
-      sigq = (FAR sigq_t*)sq_remfirst(&g_sigpendingaction);
-      irqrestore(saved_state);
+      /* Check if we got an allocated message */
 
-      /* Check if we got one. */
-
-      if (!sigq)
+      if (sigq)
         {
-          /* No...Try the resource pool */
-
-          if (!sigq)
-            {
-              sigq = (FAR sigq_t *)kmalloc((sizeof (sigq_t)));
-            }
-
-          /* Check if we got an allocated message */
-
-          if (sigq)
-            {
-              sigq->type = SIG_ALLOC_DYN;
-            }
+          sigq->type = SIG_ALLOC_DYN;
         }
     }
 
   return sigq;
 }
-
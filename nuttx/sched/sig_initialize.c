@@ -42,6 +42,7 @@
 #include <stdint.h>
 #include <queue.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/mempool.h>
 
 #include "os_internal.h"
 #include "sig_internal.h"
@@ -63,31 +64,19 @@
 
 sq_queue_t  g_sigfreeaction;
 
-/* The g_sigpendingaction data structure is a list of available
- * pending signal action structures.
+/* The g_sigpendingaction data structure is a pool of available
+ * pending signal action structures.  Some are reserved for use
+ * by interrupt handlers.
  */
 
-sq_queue_t  g_sigpendingaction;
+struct mempool_s g_sigpendingaction;
 
-/* The g_sigpendingirqaction is a list of available
- * pending signal actions that are reserved for use by
+/* The g_sigpendingsignal data structure is a pool of available
+ * pending signal structures.  Some are reserved for use by
  * interrupt handlers.
  */
 
-sq_queue_t  g_sigpendingirqaction;
-
-/* The g_sigpendingsignal data structure is a list of
- * available pending signal structures.
- */
-
-sq_queue_t  g_sigpendingsignal;
-
-/* The g_sigpendingirqsignal data structure is a list
- * of available pending signal structures that are reserved
- * for use by interrupt handlers.
- */
-
-sq_queue_t  g_sigpendingirqsignal;
+struct mempool_s g_sigpendingsignal;
 
 /************************************************************************
  * Private Variables
@@ -99,103 +88,14 @@ sq_queue_t  g_sigpendingirqsignal;
 
 static sigactq_t  *g_sigactionalloc;
 
-/* g_sigpendingactionalloc is a pointer to the start of the
- * allocated blocks of pending signal actions.
- */
-
-static sigq_t     *g_sigpendingactionalloc;
-
-/* g_sigpendingirqactionalloc is a pointer to the start of
- * the allocated block of pending signal actions.
- */
-
-static sigq_t     *g_sigpendingirqactionalloc;
-
-/* g_sigpendingsignalalloc is a pointer to the start of the
- * allocated blocks of pending signals.
- */
-
-static sigpendq_t *g_sigpendingsignalalloc;
-
-/* g_sigpendingirqsignalalloc is a pointer to the start of
- * the allocated blocks of pending signals.
- */
-
-static sigpendq_t *g_sigpendingirqsignalalloc;
-
 /************************************************************************
  * Private Function Prototypes
  ************************************************************************/
 
-static sigq_t     *sig_allocateblock(sq_queue_t *siglist, uint16_t nsigs,
-                                     uint8_t sigtype);
-static sigpendq_t *sig_allocatependingsignalblock(sq_queue_t *siglist,
-                                                  uint16_t nsigs, uint8_t sigtype);
-
 /************************************************************************
  * Private Functions
  ************************************************************************/
 
-/************************************************************************
- * Function: sig_allocateblock
- *
- * Description:
- *   Allocate a block of pending signal actions and place them
- *   on the free list.
- *
- ************************************************************************/
-
-static sigq_t *sig_allocateblock(sq_queue_t *siglist, uint16_t nsigs,
-                                 uint8_t sigtype)
-{
-  sigq_t *sigqalloc;
-  sigq_t *sigq;
-  int     i;
-
-  /* Allocate a block of pending signal actions */
-
-  sigqalloc = (sigq_t*)kmalloc((sizeof(sigq_t)) * nsigs);
-
-  sigq = sigqalloc;
-  for (i = 0; i < nsigs; i++)
-    {
-      sigq->type = sigtype;
-      sq_addlast((FAR sq_entry_t*)sigq++, siglist);
-    }
-
-  return sigqalloc;
-}
-
-/************************************************************************
- * Function:  sig_allocatependingsignalblock
- *
- * Description:
- * Allocate a block of pending signal structures  and place them
- * on the free list.
- ************************************************************************/
-
-static sigpendq_t *sig_allocatependingsignalblock(sq_queue_t *siglist,
-                                           uint16_t nsigs, uint8_t sigtype)
-{
-  sigpendq_t *sigpendalloc;
-  sigpendq_t *sigpend;
-  int i;
-
-  /* Allocate a block of pending signal structures  */
-
-  sigpendalloc =
-     (sigpendq_t*)kmalloc((sizeof(sigpendq_t)) * nsigs);
-
-  sigpend = sigpendalloc;
-  for (i = 0; i < nsigs; i++)
-    {
-      sigpend->type = sigtype;
-      sq_addlast((FAR sq_entry_t*)sigpend++, siglist);
-    }
-
-  return sigpendalloc;
-}
-
 /************************************************************************
  * Public Functions
  ************************************************************************/
@@ -212,29 +112,22 @@ void sig_initialize(void)
   /* Initialize free lists */
 
   sq_init(&g_sigfreeaction);
-  sq_init(&g_sigpendingaction);
-  sq_init(&g_sigpendingirqaction);
-  sq_init(&g_sigpendingsignal);
-  sq_init(&g_sigpendingirqsignal);
-
-  /* Add a block of signal structures to each list */
-  g_sigpendingactionalloc =
-     sig_allocateblock(&g_sigpendingaction,
-                       NUM_PENDING_ACTIONS,
-                       SIG_ALLOC_FIXED);
-  g_sigpendingirqactionalloc =
-     sig_allocateblock(&g_sigpendingirqaction,
-                       NUM_PENDING_INT_ACTIONS,
-                       SIG_ALLOC_IRQ);
+
+  /* Create the pools of pending signal structures.  Each includes a
+   * reserve for use by interrupt handlers.
+   */
+
+  if (mempool_create(&g_sigpendingaction, sizeof(sigq_t),
+                     NUM_PENDING_ACTIONS + NUM_PENDING_INT_ACTIONS,
+                     NUM_PENDING_INT_ACTIONS) < 0 ||
+      mempool_create(&g_sigpendingsignal, sizeof(sigpendq_t),
+                     NUM_SIGNALS_PENDING + NUM_INT_SIGNALS_PENDING,
+                     NUM_INT_SIGNALS_PENDING) < 0)
+    {
+      PANIC(OSERR_OUTOFMEMORY);
+    }
+
   sig_allocateactionblock();
-  g_sigpendingsignalalloc =
-     sig_allocatependingsignalblock(&g_sigpendingsignal,
-                             NUM_SIGNALS_PENDING,
-                             SIG_ALLOC_FIXED);
-  g_sigpendingirqsignalalloc =
-     sig_allocatependingsignalblock(&g_sigpendingirqsignal,
-                             NUM_INT_SIGNALS_PENDING,
-                             SIG_ALLOC_IRQ);
 }
 
 /************************************************************************
@@ -47,6 +47,7 @@
 #include <sched.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/mempool.h>
 
 /****************************************************************************
  * Definitions
@@ -69,8 +70,7 @@
 enum sigalloc_e
 {
   SIG_ALLOC_FIXED = 0,  /* pre-allocated; never freed */
-  SIG_ALLOC_DYN,        /* dynamically allocated; free when unused */
-  SIG_ALLOC_IRQ         /* Preallocated, reserved for interrupt handling */
+  SIG_ALLOC_DYN         /* dynamically allocated; free when unused */
 };
 typedef enum sigalloc_e sigalloc_t;
 
@@ -126,29 +126,19 @@ typedef struct sigq_s sigq_t;
 
 extern sq_queue_t  g_sigfreeaction;
 
-/* The g_sigpendingaction data structure is a list of available pending
- * signal action structures.
+/* The g_sigpendingaction data structure is a pool of available pending
+ * signal action structures.  NUM_PENDING_INT_ACTIONS of these are reserved
+ * for use by interrupt handlers.
  */
 
-extern sq_queue_t  g_sigpendingaction;
+extern struct mempool_s g_sigpendingaction;
 
-/* The g_sigpendingirqaction is a list of available pending signal actions
- * that are reserved for use by interrupt handlers.
+/* The g_sigpendingsignal data structure is a pool of available pending
+ * signal structures.  NUM_INT_SIGNALS_PENDING of these are reserved for
+ * use by interrupt handlers.
  */
 
-extern sq_queue_t  g_sigpendingirqaction;
-
-/* The g_sigpendingsignal data structure is a list of available pending
- * signal structures.
- */
-
-extern sq_queue_t  g_sigpendingsignal;
-
-/* The g_sigpendingirqsignal data structure is a list of available pending
- * signal structures that are reserved for use by interrupt handlers.
- */
-
-extern sq_queue_t  g_sigpendingirqsignal;
+extern struct mempool_s g_sigpendingsignal;
 
 /****************************************************************************
  * Public Function Prototypes
@@ -169,54 +169,30 @@ static FAR sigpendq_t *sig_findpendingsignal(FAR _TCB *stcb, int signo)
 static FAR sigpendq_t *sig_allocatependingsignal(void)
 {
   FAR sigpendq_t *sigpend;
-  irqstate_t      saved_state;
 
-  /* Check if we were called from an interrupt handler. */
+  /* Try to get the pending signal structure from the pool.  If we were
+   * called from an interrupt handler, then the pool will also provide
+   * structures from the reserve set aside for interrupt handlers.
+   */
 
-  if (up_interrupt_context())
+  sigpend = (FAR sigpendq_t*)mempool_alloc(&g_sigpendingsignal);
+  if (sigpend)
     {
-      /* Try to get the pending signal structure from the free list */
-
-      sigpend = (FAR sigpendq_t*)sq_remfirst(&g_sigpendingsignal);
-      if (!sigpend)
-        {
-          /* If no pending signal structure is available in the free list,
-           * then try the special list of structures reserved for
-           * interrupt handlers
-           */
-
-          sigpend = (FAR sigpendq_t*)sq_remfirst(&g_sigpendingirqsignal);
-        }
+      sigpend->type = SIG_ALLOC_FIXED;
     }
 
   /* If we were not called from an interrupt handler, then we are
    * free to allocate pending action structures if necessary. */
 
-  else
+  else if (!up_interrupt_context())
     {
-      /* Try to get the pending signal structure from the free list */
-
-      saved_state = irqsave();
-      sigpend = (FAR sigpendq_t*)sq_remfirst(&g_sigpendingsignal);
-      irqrestore(saved_state);
+      sigpend = (FAR sigpendq_t *)kmalloc((sizeof (sigpendq_t)));
 
-      /* Check if we got one. */
+      /* Check if we got an allocated message */
 
-      if (!sigpend)
+      if (sigpend)
         {
-          /* No... Allocate the pending signal */
-
-          if (!sigpend)
-            {
-              sigpend = (FAR sigpendq_t *)kmalloc((sizeof (sigpendq_t)));
-            }
-
-          /* Check if we got an allocated message */
-
-          if (sigpend)
-            {
-              sigpend->type = SIG_ALLOC_DYN;
-            }
+          sigpend->type = SIG_ALLOC_DYN;
         }
     }
 
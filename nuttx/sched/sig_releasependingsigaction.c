@@ -78,35 +78,15 @@
 
 void sig_releasependingsigaction(FAR sigq_t *sigq)
 {
-  irqstate_t saved_state;
-
-  /* If this is a generally available pre-allocated structyre,
-   * then just put it back in the free list.
+  /* If this is a pre-allocated structure, then just put it back in the
+   * pool.  The pool protects itself from concurrent access by interrupt
+   * handlers.
    */
 
   if (sigq->type == SIG_ALLOC_FIXED)
     {
-      /* Make sure we avoid concurrent access to the free
-       * list from interrupt handlers. */
-
-      saved_state = irqsave();
-      sq_addlast((FAR sq_entry_t*)sigq, &g_sigpendingaction);
-      irqrestore(saved_state);
-   }
-
-  /* If this is a message pre-allocated for interrupts,
-   * then put it back in the correct  free list.
-   */
-
-  else if (sigq->type == SIG_ALLOC_IRQ)
-    {
-      /* Make sure we avoid concurrent access to the free
-       * list from interrupt handlers. */
-
-      saved_state = irqsave();
-      sq_addlast((FAR sq_entry_t*)sigq, &g_sigpendingirqaction);
-      irqrestore(saved_state);
-   }
+      mempool_free(&g_sigpendingaction, sigq);
+    }
 
   /* Otherwise, deallocate it.  Note:  interrupt handlers
    * will never deallocate signals because they will not
@@ -84,37 +84,16 @@
 
 void sig_releasependingsignal(FAR sigpendq_t *sigpend)
 {
-  irqstate_t saved_state;
-
-  /* If this is a generally available pre-allocated structyre,
-   * then just put it back in the free list.
+  /* If this is a pre-allocated structure, then just put it back in the
+   * pool.  The pool protects itself from concurrent access by interrupt
+   * handlers.
    */
 
   if (sigpend->type == SIG_ALLOC_FIXED)
     {
-      /* Make sure we avoid concurrent access to the free
-       * list from interrupt handlers. */
-
-      saved_state = irqsave();
-      sq_addlast((FAR sq_entry_t*)sigpend, &g_sigpendingsignal);
-      irqrestore(saved_state);
+      mempool_free(&g_sigpendingsignal, sigpend);
     }
 
-  /* If this is a message pre-allocated for interrupts,
-   * then put it back in the correct free list.
-   */
-
-  else if (sigpend->type == SIG_ALLOC_IRQ)
-    {
-      /* Make sure we avoid concurrent access to the free
-       * list from interrupt handlers.
-       */
-
-      saved_state = irqsave();
-      sq_addlast((FAR sq_entry_t*)sigpend, &g_sigpendingirqsignal);
-      irqrestore(saved_state);
-   }
-
   /* Otherwise, deallocate it.  Note:  interrupt handlers
    * will never deallocate signals because they will not
    * receive them. */
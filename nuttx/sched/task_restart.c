@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/task_restart.c
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -138,7 +138,7 @@ int task_restart(pid_t pid)
         */
 
        state = irqsave();
-       dq_rem((FAR dq_entry_t*)tcb, (dq_queue_t*)g_tasklisttable[tcb->task_state].list);
+       sched_removeprioritized(tcb, (dq_queue_t*)g_tasklisttable[tcb->task_state].list);
        tcb->task_state = TSTATE_TASK_INVALID;
        irqrestore(state);
 
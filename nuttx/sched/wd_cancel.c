@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/wd_cancel.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -90,8 +90,6 @@
 
 int wd_cancel (WDOG_ID wdid)
 {
-  wdog_t    *curr;
-  wdog_t    *prev;
   irqstate_t saved_state;
   int        ret = ERROR;
 
@@ -105,55 +103,10 @@ int wd_cancel (WDOG_ID wdid)
 
   if (wdid && wdid->active)
     {
-      /* Search the g_wdactivelist for the target FCB.  We can't use sq_rem
-       * to do this because there are additional operations that need to be
-       * done.
-       */
-
-      prev = NULL;
-      curr = (wdog_t*)g_wdactivelist.head;
-
-      while((curr) && (curr != wdid))
-        {
-          prev = curr;
-          curr = curr->next;
-        }
-
-      /* Check if the watchdog was found in the list.  If not, then an OS
-       * error has occurred because the watchdog is marked active!
-       */
-
-      if (!curr)
-        {
-          PANIC(OSERR_WDOGNOTFOUND);
-        }
-      else
-        {
-          /* If there is a watchdog in the timer queue after the one that
-           * is being canceled, then it inherits the remaining ticks.
-           */
-
-          if (curr->next)
-            {
-              curr->next->lag += curr->lag;
-            }
-
-          /* Now, remove the watchdog from the timer queue */
-
-          if (prev)
-            {
-              (void)sq_remafter((FAR sq_entry_t*)prev, &g_wdactivelist);
-            }
-          else
-            {
-              (void)sq_remfirst(&g_wdactivelist);
-            }
-          wdid->next = NULL;
-
-          /* Return success */
-
-          ret = OK;
-        }
+      /* Remove the watchdog from the queue of active watchdogs */
+
+      wd_remove(wdid);
+      ret = OK;
 
       /* Mark the watchdog inactive */
 
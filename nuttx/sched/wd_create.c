@@ -91,11 +91,8 @@
 WDOG_ID wd_create (void)
 {
   FAR wdog_t *wdog;
-  irqstate_t saved_state;
 
-  saved_state = irqsave();
-  wdog = (FAR wdog_t*)sq_remfirst(&g_wdfreelist);
-  irqrestore(saved_state);
+  wdog = (FAR wdog_t*)mempool_alloc(&g_wdpool);
 
   /* Indicate that the watchdog is not actively timing */
 
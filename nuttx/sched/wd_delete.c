@@ -116,9 +116,9 @@ int wd_delete(WDOG_ID wdId)
       wd_cancel(wdId);
     }
 
-  /* Put the watchdog back on the free list */
+  /* Put the watchdog back in the pool */
 
-  sq_addlast((FAR sq_entry_t*)wdId, &g_wdfreelist);
+  mempool_free(&g_wdpool, wdId);
   irqrestore(saved_state);
 
   /* Return success */
@@ -1,7 +1,7 @@
 /********************************************************************************
  * sched/wd_gettime.c
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -95,22 +95,16 @@ int wd_gettime(WDOG_ID wdog)
   flags = irqsave();
   if (wdog && wdog->active)
     {
-      /* Traverse the watchdog list accumulating lag times until we find the wdog
-       * that we are looking for
+      int delay;
+
+      /* In the tickless mode, first account for the time elapsed since
+       * the watchdog list was last updated.
        */
 
-      wdog_t *curr;
-      int delay = 0;
-
-      for (curr = (wdog_t*)g_wdactivelist.head; curr; curr = curr->next)
-        {
-          delay += curr->lag;
-          if (curr == wdog)
-            {
-              irqrestore(flags);
-              return delay;
-            }
-        }
+      sched_timer_sync();
+      delay = wd_remaining(wdog);
+      irqrestore(flags);
+      return delay;
     }
 
   irqrestore(flags);
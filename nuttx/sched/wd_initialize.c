@@ -1,7 +1,7 @@
 /************************************************************************
  * sched/wd_initialize.c
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -40,7 +40,7 @@
 #include <nuttx/config.h>
 
 #include <queue.h>
-#include <nuttx/kmalloc.h>
+#include <nuttx/mempool.h>
 
 #include "os_internal.h"
 #include "wd_internal.h"
@@ -57,19 +57,12 @@
  * Global Variables
  ************************************************************************/
 
-/* The g_wdfreelist data structure is a singly linked list
- * of watchdogs available to the system for delayed function
- * use.
+/* g_wdpool is the pool of pre-allocated watchdogs available to
+ * the system for delayed function use.  The number of watchdogs
+ * in the pool is a configuration item.
  */
 
-sq_queue_t g_wdfreelist;
-
-/* g_wdpool is a pointer to a list of pre-allocated watchdogs.
- * The number of watchdogs in the pool is a configuration
- * item.
- */
-
-FAR wdog_t *g_wdpool;
+struct mempool_s g_wdpool;
 
 /* The g_wdactivelist data structure is a singly linked list
  * ordered by watchdog expiration time. When watchdog timers
@@ -77,7 +70,9 @@ FAR wdog_t *g_wdpool;
  * the function is called.
  */
 
+#ifndef CONFIG_WDOG_WHEEL
 sq_queue_t g_wdactivelist;
+#endif
 
 /************************************************************************
  * Private Variables
@@ -112,27 +107,20 @@ sq_queue_t g_wdactivelist;
 
 void wd_initialize(void)
 {
-  /* Initialize the free watchdog list */
-
-  sq_init(&g_wdfreelist);
-
-  /* The g_wdfreelist must be loaded at initialization time to hold the
+  /* The g_wdpool must be loaded at initialization time to hold the
    * configured number of watchdogs.
    */
 
-  g_wdpool = (FAR wdog_t*)kmalloc(sizeof(wdog_t) * CONFIG_PREALLOC_WDOGS);
-  if (g_wdpool)
+  if (mempool_create(&g_wdpool, sizeof(wdog_t), CONFIG_PREALLOC_WDOGS, 0) < 0)
     {
-      FAR wdog_t *wdog = g_wdpool;
-      int i;
-
-      for (i = 0; i < CONFIG_PREALLOC_WDOGS; i++)
-        {
-          sq_addlast((FAR sq_entry_t*)wdog++, &g_wdfreelist);
-        }
+      PANIC(OSERR_OUTOFMEMORY);
     }
 
-  /* The g_wdactivelist queue must be reset at initialization time. */
+  /* The g_wdactivelist queue must be reset at initialization time.  The
+   * timer wheel is initially empty.
+   */
 
+#ifndef CONFIG_WDOG_WHEEL
   sq_init(&g_wdactivelist);
+#endif
 }
@@ -1,7 +1,7 @@
 /************************************************************************
- * sched/d_internal.h
+ * sched/wd_internal.h
  *
- *   Copyright (C) 2007, 2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007, 2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -46,11 +46,20 @@
 #include <stdbool.h>
 #include <wdog.h>
 #include <nuttx/compiler.h>
+#include <nuttx/mempool.h>
 
 /************************************************************************
  * Pre-processor Definitions
  ************************************************************************/
 
+/* CONFIG_WDOG_WHEEL - Select the hierarchical timer wheel implementation
+ *   of the active watchdog queue.  By default, active watchdogs are kept
+ *   in a single list ordered by expiration time (see wd_list.c):  That
+ *   list costs no RAM but starting a watchdog is O(n) in the number of
+ *   active watchdogs.  The timer wheel (see wd_wheel.c) makes starting and
+ *   cancelling a watchdog O(1) at the cost of about 2Kb of RAM.
+ */
+
 /************************************************************************
  * Public Type Declarations
  ************************************************************************/
@@ -62,11 +71,19 @@
 struct wdog_s
 {
   FAR struct wdog_s *next;       /* Support for singly linked lists. */
+#ifdef CONFIG_WDOG_WHEEL
+  FAR struct wdog_s *prev;       /* Doubly linked in the timer wheel */
+  FAR struct wdog_s **slot;      /* The timer wheel slot that holds the wdog */
+#endif
   wdentry_t          func;       /* Function to execute when delay expires */
 #ifdef CONFIG_PIC
   FAR void          *picbase;    /* PIC base address */
 #endif
+#ifdef CONFIG_WDOG_WHEEL
+  uint32_t           expiry;     /* Timer wheel tick when the delay expires */
+#else
   int                lag;        /* Timer associated with the delay */
+#endif
   bool               active;     /* true if the watchdog is actively timing */
   uint8_t            argc;       /* The number of parameters to pass */
   uint32_t           parm[CONFIG_MAX_WDOGPARMS];
@@ -77,19 +94,12 @@ typedef struct wdog_s wdog_t;
  * Public Variables
  ************************************************************************/
 
-/* The g_wdfreelist data structure is a singly linked list
- * of watchdogs available to the system for delayed function
- * use.
- */
-
-extern sq_queue_t g_wdfreelist;
-
-/* g_wdpool is a pointer to a list of pre-allocated watchdogs.
- * The number of watchdogs in the pool is a configuration
- * item.
+/* g_wdpool is the pool of pre-allocated watchdogs available to
+ * the system for delayed function use.  The number of watchdogs
+ * in the pool is a configuration item.
  */
 
-extern FAR wdog_t *g_wdpool;
+extern struct mempool_s g_wdpool;
 
 /* The g_wdactivelist data structure is a singly linked list
  * ordered by watchdog expiration time. When watchdog timers
@@ -97,7 +107,9 @@ extern FAR wdog_t *g_wdpool;
  * the function is called.
  */
 
+#ifndef CONFIG_WDOG_WHEEL
 extern sq_queue_t g_wdactivelist;
+#endif
 
 /************************************************************************
  * Public Function Prototypes
@@ -113,6 +125,34 @@ extern "C" {
 EXTERN void weak_function wd_initialize(void);
 EXTERN void weak_function wd_timer(void);
 
+/* These are the operations on the queue of active watchdogs.  They are
+ * implemented by wd_list.c or by wd_wheel.c and must be called with
+ * interrupts disabled.
+ *
+ * wd_insert     - Add an inactive watchdog that will expire after 'lag'
+ *                 (>= 1) more ticks.  Returns true if the watchdog may
+ *                 now be the first to expire.
+ * wd_remove     - Remove an active watchdog from the queue.
+ * wd_remaining  - Return the number of ticks before an active watchdog
+ *                 expires.
+ * wd_elapse     - Account for the passage of 'ticks' system timer ticks.
+ *                 No watchdogs are executed.
+ * wd_expired    - Remove and return the next watchdog whose delay has
+ *                 elapsed or NULL if there is none.
+ * wd_nextexpiry - Return the number of ticks (>= 1) until the next
+ *                 watchdog expiration or zero if there are no active
+ *                 watchdogs.  The result may be early but never late.
+ */
+
+EXTERN bool wd_insert(FAR wdog_t *wdog, int lag);
+EXTERN void wd_remove(FAR wdog_t *wdog);
+EXTERN int  wd_remaining(FAR wdog_t *wdog);
+EXTERN void wd_elapse(unsigned int ticks);
+EXTERN FAR wdog_t *wd_expired(void);
+#ifdef CONFIG_SCHED_TICKLESS
+EXTERN unsigned int wd_nextexpiry(void);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -0,0 +1,348 @@
+/************************************************************************
+ * sched/wd_list.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <queue.h>
+#include <wdog.h>
+
+#include "os_internal.h"
+#include "wd_internal.h"
+
+#ifndef CONFIG_WDOG_WHEEL
+
+/************************************************************************
+ * Definitions
+ ************************************************************************/
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  wd_insert
+ *
+ * Description:
+ *   Insert a watchdog into g_wdactivelist.  The list is ordered by
+ *   expiration time and the lag of each watchdog is relative to the
+ *   watchdog before it, so the list must be searched for the insertion
+ *   point.
+ *
+ * Inputs:
+ *   wdog - The watchdog to insert
+ *   lag  - The number of ticks until the watchdog expires (>= 1)
+ *
+ * Return Value:
+ *   true if the watchdog is now at the head of the list
+ *
+ ************************************************************************/
+
+bool wd_insert(FAR wdog_t *wdog, int lag)
+{
+  FAR wdog_t *curr;
+  FAR wdog_t *prev;
+  FAR wdog_t *next;
+  int32_t     now;
+
+  /* Do the easy case first -- when the watchdog timer queue is empty. */
+
+  if (g_wdactivelist.head == NULL)
+    {
+      sq_addlast((FAR sq_entry_t*)wdog,&g_wdactivelist);
+    }
+
+  /* There are other active watchdogs in the timer queue */
+
+  else
+    {
+      now = 0;
+      prev = curr = (FAR wdog_t*)g_wdactivelist.head;
+
+      /* Advance to positive time */
+
+      while ((now += curr->lag) < 0 && curr->next)
+        {
+          prev = curr;
+          curr = curr->next;
+        }
+
+      /* Advance past shorter delays */
+
+      while (now <= lag && curr->next)
+       {
+         prev = curr;
+         curr = curr->next;
+         now += curr->lag;
+       }
+
+      /* Check if the new wdog must be inserted before the curr. */
+
+      if (lag < now)
+        {
+          /* The relative delay time is smaller or equal to the current delay
+           * time, so decrement the current delay time by the new relative
+           * delay time.
+           */
+
+          lag -= (now - curr->lag);
+          curr->lag -= lag;
+
+          /* Insert the new watchdog in the list */
+
+          if (curr == (FAR wdog_t*)g_wdactivelist.head)
+            {
+              sq_addfirst((FAR sq_entry_t*)wdog, &g_wdactivelist);
+            }
+          else
+            {
+              sq_addafter((FAR sq_entry_t*)prev, (FAR sq_entry_t*)wdog,
+                          &g_wdactivelist);
+            }
+        }
+
+      /* The new watchdog delay time is greater than the curr delay time,
+       * so the new wdog must be inserted after the curr. This only occurs
+       * if the wdog is to be added to the end of the list.
+       */
+
+      else
+        {
+          lag -= now;
+          if (!curr->next)
+            {
+              sq_addlast((FAR sq_entry_t*)wdog, &g_wdactivelist);
+            }
+          else
+            {
+              next = curr->next;
+              next->lag -= lag;
+              sq_addafter((FAR sq_entry_t*)curr, (FAR sq_entry_t*)wdog,
+                          &g_wdactivelist);
+            }
+        }
+    }
+
+  /* Put the lag into the watchdog structure */
+
+  wdog->lag = lag;
+  return wdog == (FAR wdog_t*)g_wdactivelist.head;
+}
+
+/************************************************************************
+ * Name:  wd_remove
+ *
+ * Description:
+ *   Remove a watchdog from g_wdactivelist.  The watchdog after the one
+ *   that is removed inherits its remaining ticks.
+ *
+ ************************************************************************/
+
+void wd_remove(FAR wdog_t *wdog)
+{
+  FAR wdog_t *curr;
+  FAR wdog_t *prev;
+
+  /* Search the g_wdactivelist for the target FCB.  We can't use sq_rem
+   * to do this because there are additional operations that need to be
+   * done.
+   */
+
+  prev = NULL;
+  curr = (FAR wdog_t*)g_wdactivelist.head;
+
+  while((curr) && (curr != wdog))
+    {
+      prev = curr;
+      curr = curr->next;
+    }
+
+  /* Check if the watchdog was found in the list.  If not, then an OS
+   * error has occurred because the watchdog is marked active!
+   */
+
+  if (!curr)
+    {
+      PANIC(OSERR_WDOGNOTFOUND);
+    }
+  else
+    {
+      /* If there is a watchdog in the timer queue after the one that
+       * is being canceled, then it inherits the remaining ticks.
+       */
+
+      if (curr->next)
+        {
+          curr->next->lag += curr->lag;
+        }
+
+      /* Now, remove the watchdog from the timer queue */
+
+      if (prev)
+        {
+          (void)sq_remafter((FAR sq_entry_t*)prev, &g_wdactivelist);
+        }
+      else
+        {
+          (void)sq_remfirst(&g_wdactivelist);
+        }
+      wdog->next = NULL;
+    }
+}
+
+/************************************************************************
+ * Name:  wd_remaining
+ *
+ * Description:
+ *   Return the number of ticks before the watchdog expires by
+ *   accumulating the lags of all of the watchdogs before it.
+ *
+ ************************************************************************/
+
+int wd_remaining(FAR wdog_t *wdog)
+{
+  FAR wdog_t *curr;
+  int delay = 0;
+
+  for (curr = (FAR wdog_t*)g_wdactivelist.head; curr; curr = curr->next)
+    {
+      delay += curr->lag;
+      if (curr == wdog)
+        {
+          return delay;
+        }
+    }
+
+  return 0;
+}
+
+/************************************************************************
+ * Name:  wd_elapse
+ *
+ * Description:
+ *   Only the lag of the first watchdog is relative to the current time;
+ *   all others are relative to their predecessor.  So the passage of
+ *   time only affects the first watchdog.  Its lag may go negative.
+ *
+ ************************************************************************/
+
+void wd_elapse(unsigned int ticks)
+{
+  FAR wdog_t *wdog = (FAR wdog_t*)g_wdactivelist.head;
+  if (wdog)
+    {
+      wdog->lag -= (int)ticks;
+    }
+}
+
+/************************************************************************
+ * Name:  wd_expired
+ *
+ * Description:
+ *   Remove the watchdog at the head of the list if its delay has
+ *   elapsed.
+ *
+ ************************************************************************/
+
+FAR wdog_t *wd_expired(void)
+{
+  FAR wdog_t *wdog = (FAR wdog_t*)g_wdactivelist.head;
+
+  if (wdog && wdog->lag <= 0)
+    {
+      /* Remove the watchdog from the head of the list */
+
+      (void)sq_remfirst(&g_wdactivelist);
+
+      /* If there is another watchdog behind this one, update its
+       * its lag (this shouldn't be necessary).
+       */
+
+      if (g_wdactivelist.head)
+        {
+          ((FAR wdog_t*)g_wdactivelist.head)->lag += wdog->lag;
+        }
+
+      return wdog;
+    }
+
+  return NULL;
+}
+
+/************************************************************************
+ * Name:  wd_nextexpiry
+ *
+ * Description:
+ *   Return the number of ticks until the watchdog at the head of the
+ *   list expires.  A lag of zero or less means that the watchdog is
+ *   already due.
+ *
+ ************************************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+unsigned int wd_nextexpiry(void)
+{
+  FAR wdog_t *wdog = (FAR wdog_t*)g_wdactivelist.head;
+  if (wdog)
+    {
+      return wdog->lag > 0 ? (unsigned int)wdog->lag : 1;
+    }
+
+  return 0;
+}
+#endif
+
+#endif /* !CONFIG_WDOG_WHEEL */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/wd_start.c
  *
- *   Copyright (C) 2007-2009 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2007-2009, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -130,11 +130,8 @@ typedef void (*wdentry4_t)(int argc, uint32_t arg1, uint32_t arg2,
 int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
 {
   va_list    ap;
-  FAR wdog_t *curr;
-  FAR wdog_t *prev;
-  FAR wdog_t *next;
-  int32_t    now;
   irqstate_t saved_state;
+  bool       first;
   int        i;
 
   /* Verify the wdog */
@@ -157,6 +154,13 @@ int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
       wd_cancel(wdog);
     }
 
+  /* In the tickless mode, account for the time elapsed since the queue
+   * of active watchdogs was last updated so that the new delay is relative
+   * to the current time.
+   */
+
+  sched_timer_sync();
+
   /* Save the data in the watchdog structure */
 
   wdog->func = wdentry;         /* Function to execute when delay expires */
@@ -187,89 +191,22 @@ int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
       delay--;
     }
 
-  /* Do the easy case first -- when the watchdog timer queue is empty. */
+  /* Add the watchdog to the queue of active watchdogs and mark it as
+   * active.
+   */
 
-  if (g_wdactivelist.head == NULL)
-    {
-      sq_addlast((FAR sq_entry_t*)wdog,&g_wdactivelist);
-    }
+  first = wd_insert(wdog, delay);
+  wdog->active = true;
 
-  /* There are other active watchdogs in the timer queue */
+  /* If the new watchdog may now be the first to expire, then the one-shot
+   * alarm must be restarted (tickless mode only).
+   */
 
-  else
+  if (first)
     {
-      now = 0;
-      prev = curr = (FAR wdog_t*)g_wdactivelist.head;
-
-      /* Advance to positive time */
-
-      while ((now += curr->lag) < 0 && curr->next)
-        {
-          prev = curr;
-          curr = curr->next;
-        }
-
-      /* Advance past shorter delays */
-
-      while (now <= delay && curr->next)
-       {
-         prev = curr;
-         curr = curr->next;
-         now += curr->lag;
-       }
-
-      /* Check if the new wdog must be inserted before the curr. */
-
-      if (delay < now)
-        {
-          /* The relative delay time is smaller or equal to the current delay
-           * time, so decrement the current delay time by the new relative
-           * delay time.
-           */
-
-          delay -= (now - curr->lag);
-          curr->lag -= delay;
-
-          /* Insert the new watchdog in the list */
-
-          if (curr == (FAR wdog_t*)g_wdactivelist.head)
-            {
-              sq_addfirst((FAR sq_entry_t*)wdog, &g_wdactivelist);
-            }
-          else
-            {
-              sq_addafter((FAR sq_entry_t*)prev, (FAR sq_entry_t*)wdog,
-                          &g_wdactivelist);
-            }
-        }
-
-      /* The new watchdog delay time is greater than the curr delay time,
-       * so the new wdog must be inserted after the curr. This only occurs
-       * if the wdog is to be added to the end of the list.
-       */
-
-      else
-        {
-          delay -= now;
-          if (!curr->next)
-            {
-              sq_addlast((FAR sq_entry_t*)wdog, &g_wdactivelist);
-            }
-          else
-            {
-              next = curr->next;
-              next->lag -= delay;
-              sq_addafter((FAR sq_entry_t*)curr, (FAR sq_entry_t*)wdog,
-                          &g_wdactivelist);
-            }
-        }
+      sched_timer_reassess();
     }
 
-  /* Put the lag into the watchdog structure and mark it as active. */
-
-  wdog->lag = delay;
-  wdog->active = true;
-
   irqrestore(saved_state);
   return OK;
 }
@@ -282,6 +219,11 @@ int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
  *   if it is time to execute a watchdog function.  If so, the watchdog
  *   function will be executed in the context of the timer interrupt handler.
  *
+ *   In the tickless mode, this is called when the one-shot alarm expires.
+ *   The elapsed time has already been passed to wd_elapse() by
+ *   sched_timer_sync() and only the expired watchdogs need to be
+ *   processed.
+ *
  * Parameters:
  *   None
  *
@@ -297,88 +239,64 @@ void wd_timer(void)
   pid_t       pid;
   FAR wdog_t *wdog;
 
-  /* Check if there are any active watchdogs to process */
-
-  if (g_wdactivelist.head)
-    {
-      /* There are.  Decrement the lag counter */
-
-      --(((FAR wdog_t*)g_wdactivelist.head)->lag);
+#ifndef CONFIG_SCHED_TICKLESS
+  /* Account for one more tick */
 
-      /* Check if the watchdog at the head of the list is ready to run */
-
-      if (((FAR wdog_t*)g_wdactivelist.head)->lag <= 0)
-        {
-          /* Process the watchdog at the head of the list as well as any
-           * other watchdogs that became ready to run at this time
-           */
-
-          while (g_wdactivelist.head &&
-                 ((FAR wdog_t*)g_wdactivelist.head)->lag <= 0)
-            {
-              /* Remove the watchdog from the head of the list */
-
-              wdog = (FAR wdog_t*)sq_remfirst(&g_wdactivelist);
-
-              /* If there is another watchdog behind this one, update its
-               * its lag (this shouldn't be necessary).
-               */
+  wd_elapse(1);
+#endif
 
-              if (g_wdactivelist.head)
-                {
-                  ((FAR wdog_t*)g_wdactivelist.head)->lag += wdog->lag;
-                }
+  /* Process each watchdog whose delay has elapsed */
 
-              /* Indicate that the watchdog is no longer active. */
+  while ((wdog = wd_expired()) != NULL)
+    {
+      /* Indicate that the watchdog is no longer active. */
 
-              wdog->active = false;
+      wdog->active = false;
 
-              /* Get the current task's process ID.  We'll need this later to
-               * see if the watchdog function caused a context switch.
-               */
+      /* Get the current task's process ID.  We'll need this later to
+       * see if the watchdog function caused a context switch.
+       */
 
-              pid = getpid();
+      pid = getpid();
 
-              /* Execute the watchdog function */
+      /* Execute the watchdog function */
 
-              up_setpicbase(wdog->picbase);
-              switch (wdog->argc)
-                {
-                  default:
+      up_setpicbase(wdog->picbase);
+      switch (wdog->argc)
+        {
+          default:
 #ifdef CONFIG_DEBUG
-                    PANIC(OSERR_INTERNAL);
+            PANIC(OSERR_INTERNAL);
 #endif
-                  case 0:
-                    (*((wdentry0_t)(wdog->func)))(0);
-                    break;
+          case 0:
+            (*((wdentry0_t)(wdog->func)))(0);
+            break;
 
 #if CONFIG_MAX_WDOGPARMS > 0
-                  case 1:
-                    (*((wdentry1_t)(wdog->func)))(1, wdog->parm[0]);
-                    break;
+          case 1:
+            (*((wdentry1_t)(wdog->func)))(1, wdog->parm[0]);
+            break;
 #endif
 #if CONFIG_MAX_WDOGPARMS > 1
-                  case 2:
-                    (*((wdentry2_t)(wdog->func)))(2,
-                                    wdog->parm[0], wdog->parm[1]);
-                    break;
+          case 2:
+            (*((wdentry2_t)(wdog->func)))(2,
+                            wdog->parm[0], wdog->parm[1]);
+            break;
 #endif
 #if CONFIG_MAX_WDOGPARMS > 2
-                  case 3:
-                    (*((wdentry3_t)(wdog->func)))(3,
-                                    wdog->parm[0], wdog->parm[1],
-                                    wdog->parm[2]);
-                    break;
+          case 3:
+            (*((wdentry3_t)(wdog->func)))(3,
+                            wdog->parm[0], wdog->parm[1],
+                            wdog->parm[2]);
+            break;
 #endif
 #if CONFIG_MAX_WDOGPARMS > 3
-                  case 4:
-                    (*((wdentry4_t)(wdog->func)))(4,
-                                    wdog->parm[0], wdog->parm[1],
-                                    wdog->parm[2] ,wdog->parm[3]);
-                    break;
+          case 4:
+            (*((wdentry4_t)(wdog->func)))(4,
+                            wdog->parm[0], wdog->parm[1],
+                            wdog->parm[2] ,wdog->parm[3]);
+            break;
 #endif
-                }
-            }
         }
     }
 }
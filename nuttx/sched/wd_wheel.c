@@ -0,0 +1,628 @@
+/************************************************************************
+ * sched/wd_wheel.c
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ************************************************************************/
+
+/************************************************************************
+ * Included Files
+ ************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wdog.h>
+
+#include "os_internal.h"
+#include "wd_internal.h"
+
+#ifdef CONFIG_WDOG_WHEEL
+
+/************************************************************************
+ * Definitions
+ ************************************************************************/
+
+/* The timer wheel has five levels.  Level 0 has 256 slots of one tick
+ * each.  Each of levels 1-4 has 64 slots; each slot of level n spans one
+ * full rotation of level n-1.  Together the levels cover all 32 bits of
+ * the tick count.
+ *
+ * A watchdog is kept in the slot of the lowest level that can hold its
+ * expiration time.  The watchdogs in a slot of level n >= 1 are moved
+ * down ("cascaded") to the lower levels when level n-1 wraps around.
+ * All of the slots are kept in one array with level 0 first.
+ */
+
+#define WHEEL_L0BITS     8
+#define WHEEL_LNBITS     6
+#define WHEEL_NLEVELS    5
+
+#define WHEEL_L0SIZE     (1 << WHEEL_L0BITS)
+#define WHEEL_LNSIZE     (1 << WHEEL_LNBITS)
+#define WHEEL_L0MASK     (WHEEL_L0SIZE - 1)
+#define WHEEL_LNMASK     (WHEEL_LNSIZE - 1)
+#define WHEEL_NSLOTS     (WHEEL_L0SIZE + (WHEEL_NLEVELS - 1) * WHEEL_LNSIZE)
+#define WHEEL_NWORDS     (WHEEL_NSLOTS >> 5)
+
+/* The tick count is shifted right by WHEEL_SHIFT(n) to get the slot
+ * index of level n (n >= 1).  WHEEL_BASE(n) is the index of the first slot
+ * of level n in g_wheel[].
+ */
+
+#define WHEEL_SHIFT(n)   (WHEEL_L0BITS + ((n) - 1) * WHEEL_LNBITS)
+#define WHEEL_BASE(n)    (WHEEL_L0SIZE + ((n) - 1) * WHEEL_LNSIZE)
+
+/************************************************************************
+ * Private Type Declarations
+ ************************************************************************/
+
+/************************************************************************
+ * Global Variables
+ ************************************************************************/
+
+/************************************************************************
+ * Private Variables
+ ************************************************************************/
+
+/* The slots of the timer wheel.  Each is a doubly linked list of the
+ * watchdogs in the slot.  g_wheelmap has a bit set for each slot that
+ * is not empty.
+ */
+
+static FAR wdog_t *g_wheel[WHEEL_NSLOTS];
+static uint32_t    g_wheelmap[WHEEL_NWORDS];
+
+/* Watchdogs whose delay has elapsed but that have not yet been executed */
+
+static FAR wdog_t *g_wdexpired;
+
+/* g_wdtick is the next tick of the wheel to be processed:  All watchdogs
+ * that expire before g_wdtick have been moved to g_wdexpired.  g_wdpending
+ * is the number of ticks that have elapsed but have not yet been
+ * processed; the current time is g_wdtick + g_wdpending.
+ */
+
+static uint32_t    g_wdtick;
+static uint32_t    g_wdpending;
+
+/************************************************************************
+ * Private Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  wd_findslot
+ *
+ * Description:
+ *   Return the index of the first non-empty slot in the range
+ *   [first, last) of g_wheel[] or 'last' if those slots are all empty.
+ *
+ ************************************************************************/
+
+static int wd_findslot(int first, int last)
+{
+  uint32_t word;
+  int ndx;
+
+  while (first < last)
+    {
+      /* Ignore the bits below 'first' in this word */
+
+      ndx  = first >> 5;
+      word = g_wheelmap[ndx] & ~(((uint32_t)1 << (first & 31)) - 1);
+      if (word != 0)
+        {
+          first = (ndx << 5) + sched_lsbit(word);
+          return first < last ? first : last;
+        }
+
+      first = (ndx + 1) << 5;
+    }
+
+  return last;
+}
+
+/************************************************************************
+ * Name:  wd_findnext
+ *
+ * Description:
+ *   Return the distance (1..size) from slot 'cur' to the next non-empty
+ *   slot of one level of the wheel, searching forward and wrapping
+ *   around.  'cur' itself is the last slot searched.  Zero is returned
+ *   if every slot of the level is empty.
+ *
+ ************************************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+static unsigned int wd_findnext(int base, int size, int cur)
+{
+  int slot;
+
+  slot = wd_findslot(base + cur + 1, base + size);
+  if (slot < base + size)
+    {
+      return slot - base - cur;
+    }
+
+  slot = wd_findslot(base, base + cur + 1);
+  if (slot < base + cur + 1)
+    {
+      return slot - base + size - cur;
+    }
+
+  return 0;
+}
+#endif
+
+/************************************************************************
+ * Name:  wd_link and wd_unlink
+ *
+ * Description:
+ *   Add a watchdog to the head of a list or remove it from the list that
+ *   contains it.  The bit in g_wheelmap is kept up to date if the list is
+ *   a slot of the wheel.
+ *
+ ************************************************************************/
+
+static inline void wd_link(FAR wdog_t **slot, FAR wdog_t *wdog)
+{
+  int ndx;
+
+  wdog->prev = NULL;
+  wdog->next = *slot;
+  wdog->slot = slot;
+  if (*slot)
+    {
+      (*slot)->prev = wdog;
+    }
+
+  *slot = wdog;
+
+  if (slot != &g_wdexpired)
+    {
+      ndx = slot - g_wheel;
+      g_wheelmap[ndx >> 5] |= (uint32_t)1 << (ndx & 31);
+    }
+}
+
+static inline void wd_unlink(FAR wdog_t *wdog)
+{
+  FAR wdog_t **slot = wdog->slot;
+  int ndx;
+
+  if (wdog->prev)
+    {
+      wdog->prev->next = wdog->next;
+    }
+  else
+    {
+      *slot = wdog->next;
+    }
+
+  if (wdog->next)
+    {
+      wdog->next->prev = wdog->prev;
+    }
+
+  if (*slot == NULL && slot != &g_wdexpired)
+    {
+      ndx = slot - g_wheel;
+      g_wheelmap[ndx >> 5] &= ~((uint32_t)1 << (ndx & 31));
+    }
+
+  wdog->next = NULL;
+  wdog->prev = NULL;
+  wdog->slot = NULL;
+}
+
+/************************************************************************
+ * Name:  wd_addwheel
+ *
+ * Description:
+ *   Put a watchdog into the slot of the lowest level of the wheel that can
+ *   hold its expiration time.  A watchdog that is already due goes into
+ *   the level 0 slot for g_wdtick.
+ *
+ ************************************************************************/
+
+static void wd_addwheel(FAR wdog_t *wdog)
+{
+  uint32_t expiry = wdog->expiry;
+  uint32_t delta  = expiry - g_wdtick;
+  int ndx;
+
+  if ((int32_t)delta < 0)
+    {
+      ndx = g_wdtick & WHEEL_L0MASK;
+    }
+  else if (delta < ((uint32_t)1 << WHEEL_SHIFT(1)))
+    {
+      ndx = expiry & WHEEL_L0MASK;
+    }
+  else if (delta < ((uint32_t)1 << WHEEL_SHIFT(2)))
+    {
+      ndx = WHEEL_BASE(1) + ((expiry >> WHEEL_SHIFT(1)) & WHEEL_LNMASK);
+    }
+  else if (delta < ((uint32_t)1 << WHEEL_SHIFT(3)))
+    {
+      ndx = WHEEL_BASE(2) + ((expiry >> WHEEL_SHIFT(2)) & WHEEL_LNMASK);
+    }
+  else if (delta < ((uint32_t)1 << WHEEL_SHIFT(4)))
+    {
+      ndx = WHEEL_BASE(3) + ((expiry >> WHEEL_SHIFT(3)) & WHEEL_LNMASK);
+    }
+  else
+    {
+      ndx = WHEEL_BASE(4) + ((expiry >> WHEEL_SHIFT(4)) & WHEEL_LNMASK);
+    }
+
+  wd_link(&g_wheel[ndx], wdog);
+}
+
+/************************************************************************
+ * Name:  wd_cascade
+ *
+ * Description:
+ *   Move the watchdogs in the current slot of one level of the wheel
+ *   down to the lower levels.  Returns the index of that slot within the
+ *   level.
+ *
+ ************************************************************************/
+
+static int wd_cascade(int level)
+{
+  FAR wdog_t **slot;
+  FAR wdog_t *wdog;
+  int ndx;
+
+  ndx  = (g_wdtick >> WHEEL_SHIFT(level)) & WHEEL_LNMASK;
+  slot = &g_wheel[WHEEL_BASE(level) + ndx];
+
+  while ((wdog = *slot) != NULL)
+    {
+      wd_unlink(wdog);
+      wd_addwheel(wdog);
+    }
+
+  return ndx;
+}
+
+/************************************************************************
+ * Name:  wd_tick
+ *
+ * Description:
+ *   Process one tick of the wheel:  Cascade the higher levels if level 0
+ *   has wrapped around, then move every watchdog in the level 0 slot for
+ *   this tick to g_wdexpired.
+ *
+ ************************************************************************/
+
+static void wd_tick(void)
+{
+  FAR wdog_t **slot;
+  FAR wdog_t *wdog;
+  int level;
+  int ndx;
+
+  ndx = g_wdtick & WHEEL_L0MASK;
+  if (ndx == 0)
+    {
+      for (level = 1; level < WHEEL_NLEVELS; level++)
+        {
+          if (wd_cascade(level) != 0)
+            {
+              break;
+            }
+        }
+    }
+
+  g_wdtick++;
+  g_wdpending--;
+
+  slot = &g_wheel[ndx];
+  while ((wdog = *slot) != NULL)
+    {
+      wd_unlink(wdog);
+      wd_link(&g_wdexpired, wdog);
+    }
+}
+
+/************************************************************************
+ * Name:  wd_wheelempty
+ *
+ * Description:
+ *   Return true if there are no watchdogs in the wheel at or above
+ *   'level'.
+ *
+ ************************************************************************/
+
+static inline bool wd_wheelempty(int level)
+{
+  int ndx;
+
+  for (ndx = (level == 0 ? 0 : WHEEL_BASE(level)) >> 5;
+       ndx < WHEEL_NWORDS; ndx++)
+    {
+      if (g_wheelmap[ndx] != 0)
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/************************************************************************
+ * Public Functions
+ ************************************************************************/
+
+/************************************************************************
+ * Name:  wd_insert
+ *
+ * Description:
+ *   Put a watchdog into the timer wheel.  The expiration time is
+ *   absolute, so no other watchdog is affected.
+ *
+ * Inputs:
+ *   wdog - The watchdog to insert
+ *   lag  - The number of ticks until the watchdog expires (>= 1)
+ *
+ * Return Value:
+ *   true if the watchdog may now be the first to expire
+ *
+ ************************************************************************/
+
+bool wd_insert(FAR wdog_t *wdog, int lag)
+{
+  uint32_t ticks;
+#ifdef CONFIG_SCHED_TICKLESS
+  unsigned int next = wd_nextexpiry();
+#endif
+
+  /* The watchdog expires on the lag'th tick after the current time.  The
+   * current time is g_wdpending ticks ahead of the wheel.
+   */
+
+  ticks = g_wdpending + (uint32_t)lag - 1;
+  if (ticks > INT32_MAX)
+    {
+      ticks = INT32_MAX;
+    }
+
+  wdog->expiry = g_wdtick + ticks;
+  wd_addwheel(wdog);
+
+#ifdef CONFIG_SCHED_TICKLESS
+  return next == 0 || (unsigned int)lag < next;
+#else
+  return true;
+#endif
+}
+
+/************************************************************************
+ * Name:  wd_remove
+ *
+ * Description:
+ *   Remove a watchdog from the timer wheel (or from the list of expired
+ *   watchdogs).
+ *
+ ************************************************************************/
+
+void wd_remove(FAR wdog_t *wdog)
+{
+  if (!wdog->slot)
+    {
+      PANIC(OSERR_WDOGNOTFOUND);
+    }
+
+  wd_unlink(wdog);
+}
+
+/************************************************************************
+ * Name:  wd_remaining
+ *
+ * Description:
+ *   Return the number of ticks before the watchdog expires.
+ *
+ ************************************************************************/
+
+int wd_remaining(FAR wdog_t *wdog)
+{
+  int32_t delay = (int32_t)(wdog->expiry - g_wdtick - g_wdpending) + 1;
+  return delay > 0 ? (int)delay : 0;
+}
+
+/************************************************************************
+ * Name:  wd_elapse
+ *
+ * Description:
+ *   Account for elapsed ticks.  The wheel is advanced later by
+ *   wd_expired().
+ *
+ ************************************************************************/
+
+void wd_elapse(unsigned int ticks)
+{
+  g_wdpending += ticks;
+}
+
+/************************************************************************
+ * Name:  wd_expired
+ *
+ * Description:
+ *   Return the next watchdog whose delay has elapsed, advancing the wheel
+ *   through the elapsed ticks as needed.  Runs of empty level 0 slots are
+ *   skipped using g_wheelmap.
+ *
+ ************************************************************************/
+
+FAR wdog_t *wd_expired(void)
+{
+  FAR wdog_t *wdog;
+  uint32_t limit;
+  int ndx;
+  int slot;
+
+  while (!g_wdexpired && g_wdpending > 0)
+    {
+      /* If the wheel is empty, then just catch up */
+
+      if (wd_wheelempty(0))
+        {
+          g_wdtick   += g_wdpending;
+          g_wdpending = 0;
+          break;
+        }
+
+      /* Skip empty level 0 slots, but stop at the wrap-around of level 0
+       * if there is anything to cascade.
+       */
+
+      ndx = g_wdtick & WHEEL_L0MASK;
+      if (ndx != 0 || wd_wheelempty(1))
+        {
+          limit = WHEEL_L0SIZE - ndx;
+          if (limit > g_wdpending)
+            {
+              limit = g_wdpending;
+            }
+
+          slot         = wd_findslot(ndx, ndx + (int)limit);
+          g_wdtick    += slot - ndx;
+          g_wdpending -= slot - ndx;
+
+          if (slot == ndx + (int)limit)
+            {
+              continue;
+            }
+        }
+
+      wd_tick();
+    }
+
+  wdog = g_wdexpired;
+  if (wdog)
+    {
+      wd_unlink(wdog);
+    }
+
+  return wdog;
+}
+
+/************************************************************************
+ * Name:  wd_nextexpiry
+ *
+ * Description:
+ *   Return the number of ticks until the next event of the wheel:  The
+ *   expiration of the watchdogs in the next non-empty level 0 slot or the
+ *   cascade of the next non-empty slot of a higher level, whichever comes
+ *   first.  A cascade does not expire any watchdog, so this may be early.
+ *
+ ************************************************************************/
+
+#ifdef CONFIG_SCHED_TICKLESS
+unsigned int wd_nextexpiry(void)
+{
+  uint32_t best = UINT32_MAX;
+  uint32_t mask;
+  uint32_t dist;
+  unsigned int next;
+  int level;
+  int cur;
+
+  if (g_wdexpired)
+    {
+      return 1;
+    }
+
+  /* Level 0:  The slot for g_wdtick itself is processed first */
+
+  cur = g_wdtick & WHEEL_L0MASK;
+  if (g_wheel[cur] != NULL)
+    {
+      best = 0;
+    }
+  else
+    {
+      next = wd_findnext(0, WHEEL_L0SIZE, cur);
+      if (next > 0)
+        {
+          best = next;
+        }
+    }
+
+  /* Levels 1-4:  The current slot of a level is cascaded on the next
+   * wrap-around of the level below it or right now if g_wdtick is exactly
+   * at a wrap-around.
+   */
+
+  for (level = 1; level < WHEEL_NLEVELS; level++)
+    {
+      cur  = (g_wdtick >> WHEEL_SHIFT(level)) & WHEEL_LNMASK;
+      mask = ((uint32_t)1 << WHEEL_SHIFT(level)) - 1;
+      if ((g_wdtick & mask) == 0 && g_wheel[WHEEL_BASE(level) + cur] != NULL)
+        {
+          best = 0;
+          break;
+        }
+
+      next = wd_findnext(WHEEL_BASE(level), WHEEL_LNSIZE, cur);
+      if (next > 0)
+        {
+          dist = ((uint32_t)next << WHEEL_SHIFT(level)) - (g_wdtick & mask);
+          if (dist < best)
+            {
+              best = dist;
+            }
+        }
+    }
+
+  if (best == UINT32_MAX)
+    {
+      return 0;
+    }
+
+  /* The event at tick g_wdtick + best is processed by the (best+1)th tick
+   * of the wheel.  g_wdpending of those ticks have already elapsed.
+   */
+
+  if (best < g_wdpending)
+    {
+      return 1;
+    }
+
+  best -= g_wdpending;
+  return best < INT32_MAX ? (unsigned int)best + 1 : INT32_MAX;
+}
+#endif
+
+#endif /* CONFIG_WDOG_WHEEL */
@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/work_cancel.c
  *
- *   Copyright (C) 2009-2010 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009-2010, 2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -83,6 +83,7 @@
  *   again.
  *
  * Input parameters:
+ *   qid    - The work queue ID that the work was queued on
  *   work   - The previously queue work structure to cancel
  *
  * Returned Value:
@@ -90,11 +91,18 @@
  *
  ****************************************************************************/
 
-int work_cancel(struct work_s *work)
+int work_cancel(int qid, FAR struct work_s *work)
 {
+  FAR struct wqueue_s *wqueue;
   irqstate_t flags;
 
   DEBUGASSERT(work != NULL);
+  if ((unsigned)qid >= NWORKERS)
+    {
+      return -EINVAL;
+    }
+
+  wqueue = &g_work[qid];
 
   /* Cancelling the work is simply a matter of removing the work structure
    * from the work queue.  This must be done with interrupts disabled because
@@ -104,9 +112,9 @@ int work_cancel(struct work_s *work)
   flags = irqsave();
   if (work->worker != NULL)
     {
-      DEBUGASSERT(work->dq.flink || (FAR dq_entry_t *)work == g_work.head);
-      DEBUGASSERT(work->dq.blink || (FAR dq_entry_t *)work == g_work.tail);
-      dq_rem((FAR dq_entry_t *)work, &g_work);
+      DEBUGASSERT(work->dq.flink || (FAR dq_entry_t *)work == wqueue->q.head);
+      DEBUGASSERT(work->dq.blink || (FAR dq_entry_t *)work == wqueue->q.tail);
+      dq_rem((FAR dq_entry_t *)work, &wqueue->q);
 
       work->worker = NULL;
     }
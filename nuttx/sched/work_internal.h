@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/work_internal.h
  *
- *   Copyright (C) 2009-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -41,8 +41,12 @@
  ****************************************************************************/
  
 #include <nuttx/config.h>
+
+#include <sys/types.h>
 #include <queue.h>
 
+#include <nuttx/wqueue.h>
+
 #ifdef CONFIG_SCHED_WORKQUEUE
 
 /****************************************************************************
@@ -55,14 +59,20 @@
 #  define CONFIG_SCHED_WORKPRIORITY 50
 #endif
 
-#ifndef CONFIG_SCHED_WORKPERIOD
-#  define CONFIG_SCHED_WORKPERIOD (50*1000) /* 50 milliseconds */
-#endif
-
 #ifndef CONFIG_SCHED_WORKSTACKSIZE
 #  define CONFIG_SCHED_WORKSTACKSIZE CONFIG_IDLETHREAD_STACKSIZE
 #endif
 
+#ifdef CONFIG_SCHED_HPWORK
+#  ifndef CONFIG_SCHED_HPWORKPRIORITY
+#    define CONFIG_SCHED_HPWORKPRIORITY 192
+#  endif
+
+#  ifndef CONFIG_SCHED_HPWORKSTACKSIZE
+#    define CONFIG_SCHED_HPWORKSTACKSIZE CONFIG_IDLETHREAD_STACKSIZE
+#  endif
+#endif
+
 #ifdef CONFIG_DISABLE_SIGNALS
 #  warning "Worker thread support requires signals"
 #endif
@@ -73,29 +83,37 @@
 
 #ifndef __ASSEMBLY__
 
+/* This structure describes one work queue and its worker thread */
+
+struct wqueue_s
+{
+  pid_t             pid;   /* The task ID of the worker thread */
+  struct dq_queue_s q;     /* The queue of pending work */
+#ifdef CONFIG_SCHED_WORKSTATS
+  struct work_stats_s stats; /* Latency statistics */
+#endif
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
 
-/* The queue of pending work */
+/* The work queues, indexed by the work queue ID */
 
-extern struct dq_queue_s g_work;
-
-/* The task ID of the worker thread */
-
-extern pid_t g_worker;
+extern struct wqueue_s g_work[NWORKERS];
 
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
 
 /****************************************************************************
- * Name: work_thread
+ * Name: work_lpthread and work_hpthread
  *
  * Description:
- *   This is the main worker thread that performs actions placed on the work
- *   queue.  It also performs periodic garbage collection (that is performed
- *   by the idle thread if CONFIG_SCHED_WORKQUEUE is not defined).
+ *   These are the main worker threads that perform actions placed on the
+ *   work queues.  The low priority worker thread also performs garbage
+ *   collection (that is performed by the idle thread if
+ *   CONFIG_SCHED_WORKQUEUE is not defined).
  *
  * Input parameters:
  *   argc, argv (not used)
@@ -105,7 +123,10 @@ extern pid_t g_worker;
  *
  ****************************************************************************/
 
-extern int work_thread(int argc, char *argv[]);
+extern int work_lpthread(int argc, char *argv[]);
+#ifdef CONFIG_SCHED_HPWORK
+extern int work_hpthread(int argc, char *argv[]);
+#endif
 
 #endif /* __ASSEMBLY__ */
 #endif /* CONFIG_SCHED_WORKQUEUE */
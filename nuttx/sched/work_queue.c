@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/work_queue.c
  *
- *   Copyright (C) 2009-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -90,7 +90,12 @@
  *   from the queue, or (2) work_cancel() has been called to cancel the work
  *   and remove it from the work queue.
  *
+ *   The worker thread is signalled so that it will perform work with no
+ *   delay immediately and will re-calculate the time until it must wake up
+ *   for delayed work.
+ *
  * Input parameters:
+ *   qid    - The work queue ID (LPWORK or HPWORK)
  *   work   - The work structure to queue
  *   worker - The worker callback to be invoked.  The callback will invoked
  *            on the worker thread of execution.
@@ -104,11 +109,19 @@
  *
  ****************************************************************************/
 
-int work_queue(struct work_s *work, worker_t worker, FAR void *arg, uint32_t delay)
+int work_queue(int qid, FAR struct work_s *work, worker_t worker,
+               FAR void *arg, uint32_t delay)
 {
+  FAR struct wqueue_s *wqueue;
   irqstate_t flags;
 
   DEBUGASSERT(work != NULL);
+  if ((unsigned)qid >= NWORKERS)
+    {
+      return -EINVAL;
+    }
+
+  wqueue = &g_work[qid];
 
   /* First, initialize the work structure */
 
@@ -123,8 +136,8 @@ int work_queue(struct work_s *work, worker_t worker, FAR void *arg, uint32_t del
 
   flags        = irqsave();
   work->qtime  = clock_systimer(); /* Time work queued */
-  dq_addlast((FAR dq_entry_t *)work, &g_work);
-  work_signal();                   /* Wake up the worker thread */
+  dq_addlast((FAR dq_entry_t *)work, &wqueue->q);
+  work_signal(qid);                /* Wake up the worker thread */
   irqrestore(flags);
   return OK;
 }
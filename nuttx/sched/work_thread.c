@@ -1,7 +1,7 @@
 /****************************************************************************
  * sched/work_thread.c
  *
- *   Copyright (C) 2009-2011 Gregory Nutt. All rights reserved.
+ *   Copyright (C) 2009-2012 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <spudmonkey@racsa.co.cr>
  *
  * Redistribution and use in source and binary forms, with or without
@@ -40,7 +40,8 @@
 #include <nuttx/config.h>
 
 #include <stdint.h>
-#include <unistd.h>
+#include <signal.h>
+#include <time.h>
 #include <queue.h>
 #include <assert.h>
 #include <errno.h>
@@ -59,6 +60,10 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* work_process() returns this value if there is no delayed work pending */
+
+#define WORK_NODELAY  UINT32_MAX
+
 /****************************************************************************
  * Private Type Declarations
  ****************************************************************************/
@@ -67,15 +72,9 @@
  * Public Variables
  ****************************************************************************/
 
-/* The queue of pending work */
-
-struct dq_queue_s g_work;
+/* The work queues */
 
-/* The task ID of the worker thread */
-
-#ifdef CONFIG_SCHED_WORKQUEUE
-pid_t g_worker;
-#endif
+struct wqueue_s g_work[NWORKERS];
 
 /****************************************************************************
  * Private Variables
@@ -86,25 +85,65 @@ pid_t g_worker;
  ****************************************************************************/
 
 /****************************************************************************
- * Public Functions
+ * Name: work_latency
+ *
+ * Description:
+ *   Add the latency of one work item to the work queue statistics.
+ *
+ * Input parameters:
+ *   wqueue  - The work queue
+ *   latency - Clock ticks from when the work became due until it started
+ *
+ * Returned Value:
+ *   None
+ *
  ****************************************************************************/
+
+#ifdef CONFIG_SCHED_WORKSTATS
+static inline void work_latency(FAR struct wqueue_s *wqueue, uint32_t latency)
+{
+  FAR struct work_stats_s *stats = &wqueue->stats;
+  int bin;
+
+  stats->nworks++;
+  if (latency > stats->maxlatency)
+    {
+      stats->maxlatency = latency;
+    }
+
+  /* Bin n holds latencies in the range 2**(n-1) through 2**n - 1 */
+
+  for (bin = 0; latency != 0 && bin < WORK_NHISTOGRAM - 1; bin++)
+    {
+      latency >>= 1;
+    }
+
+  stats->histogram[bin]++;
+}
+#else
+#  define work_latency(w,l)
+#endif
+
 /****************************************************************************
- * Name: work_thread
+ * Name: work_process
  *
  * Description:
- *   This is the main worker thread that performs actions placed on the work
- *   list.  It also performs periodic garbage collection (that is performed
- *   by the idle thread if CONFIG_SCHED_WORKQUEUE is not defined).
+ *   Perform all of the work in the queue that is due.
  *
  * Input parameters:
- *   argc, argv (not used)
+ *   wqueue - The work queue to process
  *
  * Returned Value:
- *   Does not return
+ *   The number of clock ticks until the next delayed work is due, or
+ *   WORK_NODELAY if there is no work pending.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.  Interrupts are re-enabled while each
+ *   worker runs but will be disabled again on return.
  *
  ****************************************************************************/
 
-int work_thread(int argc, char *argv[])
+static uint32_t work_process(FAR struct wqueue_s *wqueue)
 {
   volatile FAR struct work_s *work;
   worker_t  worker;
@@ -112,104 +151,224 @@ int work_thread(int argc, char *argv[])
   uint32_t elapsed;
   uint32_t remaining;
   uint32_t next;
-  int usec;
   irqstate_t flags;
 
-  /* Loop forever */
+  /* Process queued work.  We need to keep interrupts disabled while we
+   * process items in the work list.
+   */
 
-  usec = CONFIG_SCHED_WORKPERIOD;
+  next  = WORK_NODELAY;
   flags = irqsave();
-  for (;;)
+  work  = (FAR struct work_s *)wqueue->q.head;
+  while (work)
     {
-      /* Wait awhile to check the work list.  We will wait here until either
-       * the time elapses or until we are awakened by a signal.
+      /* Is this work ready?  It is ready if there is no delay or if
+       * the delay has elapsed. qtime is the time that the work was added
+       * to the work queue.  It will always be greater than or equal to
+       * zero.  Therefore a delay of zero will always execute immediately.
        */
 
-      usleep(usec);
-      irqrestore(flags);
+      elapsed = clock_systimer() - work->qtime;
+      if (elapsed >= work->delay)
+        {
+          /* Remove the ready-to-execute work from the list */
 
-      /* First, perform garbage collection.  This cleans-up memory de-allocations
-       * that were queued because they could not be freed in that execution
-       * context (for example, if the memory was freed from an interrupt handler).
-       * NOTE: If the work thread is disabled, this clean-up is performed by
-       * the IDLE thread (at a very, very lower priority).
-       */
+          (void)dq_rem((struct dq_entry_s *)work, &wqueue->q);
 
-      sched_garbagecollection();
+          /* Extract the work description from the entry (in case the work
+           * instance by the re-used after it has been de-queued).
+           */
 
-      /* Then process queued work.  We need to keep interrupts disabled while
-       * we process items in the work list.
-       */
+          worker = work->worker;
+          arg    = work->arg;
+
+          /* Mark the work as no longer being queued */
+
+          work->worker = NULL;
+          work_latency(wqueue, elapsed - work->delay);
 
-      next  = CONFIG_SCHED_WORKPERIOD / USEC_PER_TICK;
-      flags = irqsave();
-      work  = (FAR struct work_s *)g_work.head;
-      while (work)
+          /* Do the work.  Re-enable interrupts while the work is being
+           * performed... we don't have any idea how long that will take!
+           */
+
+          irqrestore(flags);
+          worker(arg);
+
+          /* Now, unfortunately, since we re-enabled interrupts we don't
+           * know the state of the work list and we will have to start
+           * back at the head of the list.
+           */
+
+          flags = irqsave();
+          work  = (FAR struct work_s *)wqueue->q.head;
+          next  = WORK_NODELAY;
+        }
+      else
         {
-          /* Is this work ready?  It is ready if there is no delay or if
-           * the delay has elapsed. qtime is the time that the work was added
-           * to the work queue.  It will always be greater than or equal to
-           * zero.  Therefore a delay of zero will always execute immediately.
+          /* This one is not ready.. will it be ready before the earliest
+           * deadline that we have seen so far?
            */
 
-          elapsed = clock_systimer() - work->qtime;
-          if (elapsed >= work->delay)
+          remaining = work->delay - elapsed;
+          if (remaining < next)
             {
-              /* Remove the ready-to-execute work from the list */
+              /* Yes.. Then schedule to wake up when the work is ready */
 
-              (void)dq_rem((struct dq_entry_s *)work, &g_work);
+              next = remaining;
+            }
 
-              /* Extract the work description from the entry (in case the work
-               * instance by the re-used after it has been de-queued).
-               */
+          /* Then try the next in the list. */
 
-              worker = work->worker;
-              arg    = work->arg;
+          work = (FAR struct work_s *)work->dq.flink;
+        }
+    }
 
-              /* Mark the work as no longer being queued */
+  irqrestore(flags);
+  return next;
+}
 
-              work->worker = NULL;
+/****************************************************************************
+ * Name: work_wait
+ *
+ * Description:
+ *   Wait until the next delayed work is due or until the worker thread is
+ *   signalled by work_queue() or work_signal().  SIGWORK is blocked in the
+ *   worker threads so that a signal sent while the worker is busy remains
+ *   pending and ends the next wait immediately.
+ *
+ * Input parameters:
+ *   next - The number of clock ticks to wait or WORK_NODELAY to wait only
+ *          for a signal.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
 
-              /* Do the work.  Re-enable interrupts while the work is being
-               * performed... we don't have any idea how long that will take!
-               */
+static void work_wait(uint32_t next)
+{
+  struct siginfo value;
+  struct timespec ts;
+  sigset_t set;
 
-              irqrestore(flags);
-              worker(arg);
+  (void)sigemptyset(&set);
+  (void)sigaddset(&set, SIGWORK);
 
-              /* Now, unfortunately, since we re-enabled interrupts we don't
-               * know the state of the work list and we will have to start
-               * back at the head of the list.
-               */
+  if (next == WORK_NODELAY)
+    {
+      /* Nothing is pending.  Sleep until we are signalled. */
 
-              flags = irqsave();
-              work  = (FAR struct work_s *)g_work.head;
-            }
-          else
-            {
-              /* This one is not ready.. will it be ready before the next
-               * scheduled wakeup interval?
-               */
+      (void)sigwaitinfo(&set, &value);
+    }
+  else
+    {
+      /* Sleep until the earliest work is due */
 
-              remaining = elapsed - work->delay;
-              if (remaining < next)
-                {
-                  /* Yes.. Then schedule to wake up when the work is ready */
+      ts.tv_sec  = next / TICK_PER_SEC;
+      ts.tv_nsec = (next % TICK_PER_SEC) * NSEC_PER_TICK;
+      (void)sigtimedwait(&set, &value, &ts);
+    }
+}
 
-                  next = remaining;
-                }
-              
-              /* Then try the next in the list. */
+/****************************************************************************
+ * Name: work_blocksignal
+ *
+ * Description:
+ *   Block SIGWORK in the calling worker thread (see work_wait()).
+ *
+ ****************************************************************************/
 
-              work = (FAR struct work_s *)work->dq.flink;
-            }
-        }
+static void work_blocksignal(void)
+{
+  sigset_t set;
 
-      /* Now calculate the microsecond delay we should wait */
+  (void)sigemptyset(&set);
+  (void)sigaddset(&set, SIGWORK);
+  (void)sigprocmask(SIG_BLOCK, &set, NULL);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: work_lpthread
+ *
+ * Description:
+ *   This is the main worker thread that performs actions placed on the low
+ *   priority work queue.  It also performs garbage collection (that is
+ *   performed by the idle thread if CONFIG_SCHED_WORKQUEUE is not defined).
+ *
+ *   The thread sleeps until the earliest queued work is due or until it is
+ *   signalled because new work was queued or memory must be reclaimed.
+ *
+ * Input parameters:
+ *   argc, argv (not used)
+ *
+ * Returned Value:
+ *   Does not return
+ *
+ ****************************************************************************/
+
+int work_lpthread(int argc, char *argv[])
+{
+  work_blocksignal();
+
+  /* Loop forever */
+
+  for (;;)
+    {
+      /* First, perform garbage collection.  This cleans-up memory de-allocations
+       * that were queued because they could not be freed in that execution
+       * context (for example, if the memory was freed from an interrupt handler).
+       * NOTE: If the work thread is disabled, this clean-up is performed by
+       * the IDLE thread (at a very, very lower priority).
+       */
+
+      sched_garbagecollection();
+
+      /* Then process queued work and wait until the next work is due or
+       * until we are signalled.
+       */
+
+      work_wait(work_process(&g_work[LPWORK]));
+    }
+
+  return OK; /* To keep some compilers happy */
+}
+
+/****************************************************************************
+ * Name: work_hpthread
+ *
+ * Description:
+ *   This is the main worker thread that performs actions placed on the high
+ *   priority work queue.
+ *
+ * Input parameters:
+ *   argc, argv (not used)
+ *
+ * Returned Value:
+ *   Does not return
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_HPWORK
+int work_hpthread(int argc, char *argv[])
+{
+  work_blocksignal();
+
+  /* Loop forever */
+
+  for (;;)
+    {
+      /* Process queued work and wait until the next work is due or until
+       * we are signalled.
+       */
 
-      usec = next * USEC_PER_TICK;
+      work_wait(work_process(&g_work[HPWORK]));
     }
 
   return OK; /* To keep some compilers happy */
 }
+#endif /* CONFIG_SCHED_HPWORK */
 #endif /* CONFIG_SCHED_WORKQUEUE */
@@ -87,6 +87,7 @@ extern uintptr_t STUB_up_assert_code(uintptr_t parm1, uintptr_t parm2, uintptr_t
 
 extern uintptr_t STUB_atexit(uintptr_t parm1);
 extern uintptr_t STUB_waitpid(uintptr_t parm1, uintptr_t parm2, uintptr_t parm3);
+extern uintptr_t STUB_sched_cpuload(uintptr_t parm1, uintptr_t parm2);
 
 /* The following are only defined is signals are supported in the NuttX
  * configuration.
@@ -80,6 +80,10 @@ STUB_LOOKUP(3, STUB_up_assert_code)             /* SYS_up_assert_code */
   STUB_LOOKUP(3, STUB_waitpid)                  /* SYS_waitpid */
 #endif
 
+#ifdef CONFIG_SCHED_CPULOAD
+  STUB_LOOKUP(2, STUB_sched_cpuload)            /* SYS_sched_cpuload */
+#endif
+
 /* The following are only defined is signals are supported in the NuttX
  * configuration.
  */
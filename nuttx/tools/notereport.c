@@ -0,0 +1,576 @@
+/****************************************************************************
+ * tools/notereport.c
+ * Decode and summarize scheduler instrumentation notes
+ *
+ *   Copyright (C) 2012 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/* These must agree with include/nuttx/sched_note.h.  That header file
+ * cannot be included here because it depends on the target configuration.
+ */
+
+#define NOTE_START          0
+#define NOTE_STOP           1
+#define NOTE_SWITCH         2
+#define NOTE_NAME           3
+#define NOTE_IRQ_ENTER      4
+#define NOTE_IRQ_LEAVE      5
+#define NOTE_SEM_WAIT       6
+#define NOTE_SEM_WAKE       7
+#define NOTE_SYSCALL_ENTER  8
+#define NOTE_SYSCALL_LEAVE  9
+#define NOTE_DROPPED       10
+#define NOTE_NTYPES        11
+
+#define NOTE_SIZE          12
+
+#define MAX_TASKS          65536
+#define MAX_IRQS           256
+#define MAX_SYSCALLS       256
+#define MAX_NESTING        16
+#define MAX_NAMESIZE       32
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One decoded note */
+
+struct note_s
+{
+  uint8_t  type;
+  uint8_t  priority;
+  uint16_t pid;
+  uint32_t arg;
+  uint32_t systime;
+};
+
+/* Per-task statistics */
+
+struct task_s
+{
+  bool     seen;                /* True: Task appeared in the trace */
+  bool     waking;              /* True: Awakened but not yet running */
+  uint8_t  priority;            /* Last priority seen */
+  int      namelen;             /* Length of the name so far */
+  char     name[MAX_NAMESIZE];  /* Task name from NOTE_NAME notes */
+  uint32_t wakets;              /* Time that the task was awakened */
+  uint64_t runtime;             /* Total time running (usec) */
+  unsigned long nswitches;      /* Number of times switched in */
+  unsigned long nwakeups;       /* Number of wake-to-run latencies measured */
+  uint64_t wakesum;             /* Sum of the wake-to-run latencies */
+  uint32_t wakemax;             /* Maximum wake-to-run latency */
+};
+
+/* Per-IRQ statistics */
+
+struct irq_s
+{
+  unsigned long count;          /* Number of times the handler ran */
+  uint64_t total;               /* Total time in the handler (usec) */
+  uint32_t max;                 /* Longest time in the handler (usec) */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char *g_typenames[NOTE_NTYPES] =
+{
+  "START", "STOP", "SWITCH", "NAME", "IRQ_ENTER", "IRQ_LEAVE",
+  "SEM_WAIT", "SEM_WAKE", "SYSCALL_ENTER", "SYSCALL_LEAVE", "DROPPED"
+};
+
+static struct task_s *g_tasks;
+static struct irq_s g_irqs[MAX_IRQS];
+static unsigned long g_syscalls[MAX_SYSCALLS];
+static unsigned long g_ntypes[NOTE_NTYPES];
+static unsigned long g_nnotes;
+static unsigned long g_ndropped;
+static unsigned long g_nbad;
+
+/* Interrupt nesting stack */
+
+static int      g_irqstack[MAX_NESTING];
+static uint32_t g_irqstart[MAX_NESTING];
+static int      g_irqdepth;
+
+/* The currently running task and when it started to run */
+
+static int      g_running = -1;
+static uint32_t g_runstart;
+
+static bool     g_havetime;
+static uint32_t g_firsttime;
+static uint32_t g_lasttime;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static uint32_t get32(const uint8_t *src)
+{
+  return (uint32_t)src[0] | (uint32_t)src[1] << 8 |
+         (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+static void decode(const uint8_t *raw, struct note_s *note)
+{
+  note->type     = raw[0];
+  note->priority = raw[1];
+  note->pid      = (uint16_t)raw[2] | (uint16_t)raw[3] << 8;
+  note->arg      = get32(&raw[4]);
+  note->systime  = get32(&raw[8]);
+}
+
+/* Time stamps are 32-bit microsecond counts that may wrap.  Unsigned
+ * subtraction gives the correct interval as long as the interval is less
+ * than about 71 minutes.
+ */
+
+static uint32_t elapsed(uint32_t start, uint32_t end)
+{
+  return end - start;
+}
+
+static const char *task_name(int pid)
+{
+  static char buffer[16];
+
+  if (g_tasks[pid].namelen > 0)
+    {
+      return g_tasks[pid].name;
+    }
+
+  snprintf(buffer, 16, "<pid %d>", pid);
+  return buffer;
+}
+
+static void print_timeline(const struct note_s *note)
+{
+  printf("%10lu.%06lu %-13s pid=%-5u pri=%-3u",
+         (unsigned long)(note->systime / 1000000),
+         (unsigned long)(note->systime % 1000000),
+         note->type < NOTE_NTYPES ? g_typenames[note->type] : "???",
+         note->pid, note->priority);
+
+  switch (note->type)
+    {
+      case NOTE_SWITCH:
+        printf(" from=%lu", (unsigned long)note->arg);
+        break;
+
+      case NOTE_NAME:
+        printf(" \"%c%c%c%c\"",
+               (int)(note->arg & 0xff) ? (int)(note->arg & 0xff) : ' ',
+               (int)(note->arg >> 8 & 0xff) ? (int)(note->arg >> 8 & 0xff) : ' ',
+               (int)(note->arg >> 16 & 0xff) ? (int)(note->arg >> 16 & 0xff) : ' ',
+               (int)(note->arg >> 24) ? (int)(note->arg >> 24) : ' ');
+        break;
+
+      case NOTE_IRQ_ENTER:
+      case NOTE_IRQ_LEAVE:
+        printf(" irq=%lu", (unsigned long)note->arg);
+        break;
+
+      case NOTE_SEM_WAIT:
+      case NOTE_SEM_WAKE:
+        printf(" sem=0x%08lx", (unsigned long)note->arg);
+        break;
+
+      case NOTE_SYSCALL_ENTER:
+      case NOTE_SYSCALL_LEAVE:
+        printf(" nr=%lu", (unsigned long)note->arg);
+        break;
+
+      case NOTE_DROPPED:
+        printf(" count=%lu", (unsigned long)note->arg);
+        break;
+
+      default:
+        break;
+    }
+
+  putchar('\n');
+}
+
+/* Charge the time since the last context switch to the running task */
+
+static void charge_running(uint32_t now)
+{
+  if (g_running >= 0)
+    {
+      g_tasks[g_running].runtime += elapsed(g_runstart, now);
+    }
+
+  g_runstart = now;
+}
+
+static void process_note(const struct note_s *note)
+{
+  struct task_s *task = &g_tasks[note->pid];
+  uint32_t delay;
+  int i;
+
+  g_nnotes++;
+  if (note->type >= NOTE_NTYPES)
+    {
+      g_nbad++;
+      return;
+    }
+
+  g_ntypes[note->type]++;
+
+  if (!g_havetime)
+    {
+      g_firsttime = note->systime;
+      g_runstart  = note->systime;
+      g_havetime  = true;
+    }
+
+  g_lasttime = note->systime;
+
+  if (note->type != NOTE_DROPPED)
+    {
+      task->seen     = true;
+      task->priority = note->priority;
+    }
+
+  switch (note->type)
+    {
+      case NOTE_START:
+        task->namelen = 0;
+        task->name[0] = '\0';
+        break;
+
+      case NOTE_NAME:
+        for (i = 0; i < 4 && task->namelen < MAX_NAMESIZE - 1; i++)
+          {
+            char ch = (char)(note->arg >> (8 * i));
+            if (ch == '\0')
+              {
+                break;
+              }
+
+            task->name[task->namelen++] = ch;
+          }
+
+        task->name[task->namelen] = '\0';
+        break;
+
+      case NOTE_STOP:
+        if (g_running == note->pid)
+          {
+            charge_running(note->systime);
+            g_running = -1;
+          }
+        break;
+
+      case NOTE_SWITCH:
+        charge_running(note->systime);
+        g_running = note->pid;
+        task->nswitches++;
+
+        if (task->waking)
+          {
+            delay = elapsed(task->wakets, note->systime);
+            task->wakesum += delay;
+            task->nwakeups++;
+            if (delay > task->wakemax)
+              {
+                task->wakemax = delay;
+              }
+
+            task->waking = false;
+          }
+        break;
+
+      case NOTE_SEM_WAKE:
+        task->waking = true;
+        task->wakets = note->systime;
+        break;
+
+      case NOTE_IRQ_ENTER:
+        if (g_irqdepth < MAX_NESTING)
+          {
+            g_irqstack[g_irqdepth] = (int)note->arg;
+            g_irqstart[g_irqdepth] = note->systime;
+          }
+
+        g_irqdepth++;
+        break;
+
+      case NOTE_IRQ_LEAVE:
+        /* Ignore an unmatched exit (the entry may have been overwritten) */
+
+        if (g_irqdepth > 0)
+          {
+            g_irqdepth--;
+            if (g_irqdepth < MAX_NESTING &&
+                g_irqstack[g_irqdepth] == (int)note->arg &&
+                note->arg < MAX_IRQS)
+              {
+                struct irq_s *irq = &g_irqs[note->arg];
+
+                delay = elapsed(g_irqstart[g_irqdepth], note->systime);
+                irq->count++;
+                irq->total += delay;
+                if (delay > irq->max)
+                  {
+                    irq->max = delay;
+                  }
+              }
+          }
+        break;
+
+      case NOTE_SYSCALL_ENTER:
+        if (note->arg < MAX_SYSCALLS)
+          {
+            g_syscalls[note->arg]++;
+          }
+        break;
+
+      case NOTE_DROPPED:
+        /* Lost notes invalidate any state that spans the gap */
+
+        g_ndropped += note->arg;
+        g_irqdepth  = 0;
+        for (i = 0; i < MAX_TASKS; i++)
+          {
+            g_tasks[i].waking = false;
+          }
+        break;
+
+      default:
+        break;
+    }
+}
+
+static void print_report(void)
+{
+  uint32_t total;
+  int i;
+
+  charge_running(g_lasttime);
+  total = elapsed(g_firsttime, g_lasttime);
+
+  printf("\nNotes: %lu  Dropped: %lu  Invalid: %lu  Interval: %lu usec\n",
+         g_nnotes, g_ndropped, g_nbad, (unsigned long)total);
+
+  if (g_ndropped > 0)
+    {
+      printf("WARNING: Notes were lost.  Statistics spanning the gap are "
+             "incomplete.\n");
+    }
+
+  printf("\n%-5s %-20s %4s %12s %6s %9s %9s %9s\n",
+         "PID", "NAME", "PRI", "RUN(usec)", "CPU%", "SWITCHES",
+         "WAKE(avg)", "WAKE(max)");
+
+  for (i = 0; i < MAX_TASKS; i++)
+    {
+      struct task_s *task = &g_tasks[i];
+      if (task->seen)
+        {
+          printf("%-5d %-20s %4u %12llu %5.1f%% %9lu",
+                 i, task_name(i), task->priority,
+                 (unsigned long long)task->runtime,
+                 total ? 100.0 * (double)task->runtime / (double)total : 0.0,
+                 task->nswitches);
+
+          if (task->nwakeups > 0)
+            {
+              printf(" %9llu %9lu\n",
+                     (unsigned long long)(task->wakesum / task->nwakeups),
+                     (unsigned long)task->wakemax);
+            }
+          else
+            {
+              printf(" %9s %9s\n", "-", "-");
+            }
+        }
+    }
+
+  if (g_ntypes[NOTE_IRQ_LEAVE] > 0)
+    {
+      printf("\n%-5s %9s %12s %9s %9s\n",
+             "IRQ", "COUNT", "TOTAL(usec)", "AVG", "MAX");
+
+      for (i = 0; i < MAX_IRQS; i++)
+        {
+          struct irq_s *irq = &g_irqs[i];
+          if (irq->count > 0)
+            {
+              printf("%-5d %9lu %12llu %9llu %9lu\n", i, irq->count,
+                     (unsigned long long)irq->total,
+                     (unsigned long long)(irq->total / irq->count),
+                     (unsigned long)irq->max);
+            }
+        }
+    }
+
+  if (g_ntypes[NOTE_SYSCALL_ENTER] > 0)
+    {
+      printf("\n%-5s %9s\n", "SYS", "COUNT");
+      for (i = 0; i < MAX_SYSCALLS; i++)
+        {
+          if (g_syscalls[i] > 0)
+            {
+              printf("%-5d %9lu\n", i, g_syscalls[i]);
+            }
+        }
+    }
+
+  if (g_ntypes[NOTE_SEM_WAIT] > 0)
+    {
+      printf("\nSemaphore waits: %lu  wakeups: %lu\n",
+             g_ntypes[NOTE_SEM_WAIT], g_ntypes[NOTE_SEM_WAKE]);
+    }
+}
+
+static void show_usage(const char *progname)
+{
+  fprintf(stderr, "USAGE: %s [-t] [<note file>]\n\n", progname);
+  fprintf(stderr, "Where:\n\n");
+  fprintf(stderr, "\t-t : Print the timeline of every note\n");
+  fprintf(stderr, "\t<note file> : Binary data read from /dev/note.  "
+                  "Default: stdin\n");
+  exit(1);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv, char **envp)
+{
+  uint8_t raw[NOTE_SIZE];
+  struct note_s note;
+  bool timeline = false;
+  FILE *stream;
+  size_t nread;
+  int ch;
+
+  /* Parse command line options */
+
+  while ((ch = getopt(argc, argv, ":th")) > 0)
+    {
+      switch (ch)
+        {
+          case 't' :
+            timeline = true;
+            break;
+
+          case 'h' :
+            show_usage(argv[0]);
+            break;
+
+          case '?' :
+          default:
+            fprintf(stderr, "Unexpected option: %c\n", optopt);
+            show_usage(argv[0]);
+            break;
+        }
+    }
+
+  if (optind < argc)
+    {
+      stream = fopen(argv[optind], "rb");
+      if (!stream)
+        {
+          fprintf(stderr, "open %s failed: %s\n", argv[optind],
+                  strerror(errno));
+          exit(2);
+        }
+
+      if (++optind < argc)
+        {
+          fprintf(stderr, "Unexpected garbage at the end of the line\n");
+          show_usage(argv[0]);
+        }
+    }
+  else
+    {
+      stream = stdin;
+    }
+
+  g_tasks = (struct task_s *)calloc(MAX_TASKS, sizeof(struct task_s));
+  if (!g_tasks)
+    {
+      fprintf(stderr, "Failed to allocate task table\n");
+      exit(3);
+    }
+
+  /* Process each note */
+
+  while ((nread = fread(raw, 1, NOTE_SIZE, stream)) == NOTE_SIZE)
+    {
+      decode(raw, &note);
+      if (timeline)
+        {
+          print_timeline(&note);
+        }
+
+      process_note(&note);
+    }
+
+  if (nread != 0)
+    {
+      fprintf(stderr, "Ignoring %lu trailing bytes\n", (unsigned long)nread);
+    }
+
+  if (stream != stdin)
+    {
+      fclose(stream);
+    }
+
+  print_report();
+  free(g_tasks);
+  return 0;
+}